@@ -72,6 +72,7 @@ It handles initialization and termination by subclassing wxApp.
 #include "AboutDialog.h"
 #include "AColor.h"
 #include "AudioIO.h"
+#include "BatchProcessor.h"
 #include "Benchmark.h"
 #include "Clipboard.h"
 #include "CrashReport.h"
@@ -94,6 +95,7 @@ It handles initialization and termination by subclassing wxApp.
 #include "ProjectWindow.h"
 #include "Screenshot.h"
 #include "Sequence.h"
+#include "StreamingConverter.h"
 #include "WaveTrack.h"
 #include "prefs/PrefsDialog.h"
 #include "Theme.h"
@@ -1453,9 +1455,64 @@ bool AudacityApp::OnInit()
       //
       if (!didRecoverAnything)
       {
+         // Run the benchmarks without dialogs, and report
          if (parser->Found(wxT("t")))
          {
-            RunBenchmark( nullptr, *project);
+            const BenchmarkOptions options;
+            const auto results = RunBenchmarks(*project, options);
+
+            wxString reportPath;
+            if (parser->Found(wxT("r"), &reportPath))
+               WriteBenchmarkReport(options, results, reportPath);
+            else
+               wxPrintf("%s", FormatBenchmarkReport(options, results));
+            QuitAudacity(true);
+         }
+
+         // Apply a macro to the files, instead of opening them, and report
+         wxString macroName;
+         if (parser->Found(wxT("m"), &macroName))
+         {
+            FilePaths files;
+            for (size_t i = 0, cnt = parser->GetParamCount(); i < cnt; i++)
+               files.push_back(parser->GetParam(i));
+
+            BatchFileResults results;
+            {
+               long jobs = 0;
+               parser->Found(wxT("j"), &jobs);
+               BatchProcessor processor{ macroName,
+                  static_cast<size_t>(jobs > 0 ? jobs : 0) };
+               results = processor.Run(files);
+            }
+
+            wxString reportPath;
+            if (parser->Found(wxT("r"), &reportPath))
+               BatchProcessor::WriteReport(results, reportPath);
+            else
+               wxPrintf("%s", BatchProcessor::FormatReport(results));
+            QuitAudacity(true);
+         }
+
+         // Convert a file, a few buffers at a time, instead of opening it
+         wxString outputPath;
+         if (parser->Found(wxT("c"), &outputPath))
+         {
+            TranslatableString errorMessage;
+            bool success = false;
+            if (parser->GetParamCount() != 1)
+               errorMessage = XO("Give one file to convert");
+            else {
+               StreamingConverter converter{ *project };
+               wxString effects;
+               parser->Found(wxT("e"), &effects);
+               success = converter.SetEffects(
+                  wxSplit(effects, wxT(';'), wxT('\\')), errorMessage) &&
+                  converter.Convert(
+                     parser->GetParam(0), outputPath, errorMessage);
+            }
+            if (!success)
+               wxPrintf("%s\n", errorMessage.Translation());
             QuitAudacity(true);
          }
 
@@ -1950,6 +2007,30 @@ std::unique_ptr<wxCmdLineParser> AudacityApp::ParseCommandLine()
    parser->AddSwitch(wxT("h"), wxT("help"), _("this help message"),
                      wxCMD_LINE_OPTION_HELP);
 
+   /*i18n-hint: This applies a macro to the files named on the command line,
+    *           then quits */
+   parser->AddOption(wxT("m"), wxT("macro"), _("apply the named macro to the files and quit"),
+                     wxCMD_LINE_VAL_STRING);
+
+   /*i18n-hint: This is how many files a macro is applied to at once */
+   parser->AddOption(wxT("j"), wxT("jobs"), _("number of files to apply a macro to at once"),
+                     wxCMD_LINE_VAL_NUMBER);
+
+   /*i18n-hint: This names a file to write the results of applying a macro,
+    *           or of the self diagnostics */
+   parser->AddOption(wxT("r"), wxT("report"), _("file for the results of applying a macro or of the diagnostics"),
+                     wxCMD_LINE_VAL_STRING);
+
+   /*i18n-hint: This converts the file named on the command line to another
+    *           file, whose extension gives the format, then quits */
+   parser->AddOption(wxT("c"), wxT("convert"), _("convert the file to this file and quit"),
+                     wxCMD_LINE_VAL_STRING);
+
+   /*i18n-hint: These are effects to apply while converting a file, each as
+    *           in a macro, separated by semicolons */
+   parser->AddOption(wxT("e"), wxT("effects"), _("effects to apply while converting"),
+                     wxCMD_LINE_VAL_STRING);
+
    /*i18n-hint: This runs a set of automatic tests on Audacity itself */
    parser->AddSwitch(wxT("t"), wxT("test"), _("run self diagnostics"));
 
@@ -456,6 +456,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 #endif
 
 #include "Mix.h"
+#include "Profiler.h"
 #include "Resample.h"
 #include "RingBuffer.h"
 #include "prefs/GUISettings.h"
@@ -1493,6 +1494,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
                          const AudioIOStartStreamOptions &options)
 {
    mLostSamples = 0;
+   mMetrics.Reset();
    mLostCaptureIntervals.clear();
    mDetectDropouts =
       gPrefs->Read( WarningDialogKey(wxT("DropoutDetected")), true ) != 0;
@@ -2584,6 +2586,8 @@ AudioThread::ExitCode AudioThread::Entry()
       auto loopPassStart = Clock::now();
       const auto interval = ScrubPollInterval_ms;
 
+      Tracer::NameThread("Audio IO");
+
       // Set LoopActive outside the tests to avoid race condition
       gAudioIO->mAudioThreadFillBuffersLoopActive = true;
       if( gAudioIO->mAudioThreadShouldCallFillBuffersOnce )
@@ -2667,6 +2671,8 @@ size_t AudioIO::GetCommonlyAvailCapture()
 // (which communicates with the audio device).
 void AudioIO::FillBuffers()
 {
+   PROFILE_ZONE("AudioIO::FillBuffers");
+   AudioIOMetrics::FillBuffersScope metricsScope{ mMetrics };
    unsigned int i;
 
    auto delayedHandler = [this] ( AudacityException * pException ) {
@@ -2710,6 +2716,7 @@ void AudioIO::FillBuffers()
       // perhaps again later in play to avoid underfilling the queue and falling
       // behind the real-time demand on the consumer side in the callback.
       auto nReady = GetCommonlyReadyPlayback();
+      PROFILE_COUNTER("Playback samples ready", nReady);
       auto nNeeded =
          mPlaybackQueueMinimum - std::min(mPlaybackQueueMinimum, nReady);
 
@@ -3940,8 +3947,12 @@ bool AudioIoCallback::FillOutputBuffers(
       // Last channel of a track seen now
       len = mMaxFramesOutput;
 
-      if( !dropQuickly && selected )
+      if( !dropQuickly && selected ) {
+         const auto start = AudioIOMetrics::Clock::now();
          len = em.RealtimeProcess(group, chanCnt, tempBufs, len);
+         mMetrics.AddEffectTime(
+            group, AudioIOMetrics::Clock::now() - start, len);
+      }
       group++;
 
       CallbackCheckCompletion(mCallbackReturn, len);
@@ -4073,6 +4084,7 @@ void AudioIoCallback::FillInputBuffers(
    if (len < framesPerBuffer)
    {
       mLostSamples += (framesPerBuffer - len);
+      mMetrics.AddLostSamples(framesPerBuffer - len);
       wxPrintf(wxT("lost %d samples\n"), (int)(framesPerBuffer - len));
    }
 
@@ -4359,6 +4371,11 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
                           const PaStreamCallbackTimeInfo *timeInfo,
                           const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   Tracer::NameThread("Audio callback");
+   PROFILE_ZONE("AudioIoCallback::AudioCallback");
+   AudioIOMetrics::CallbackScope metricsScope{
+      mMetrics, framesPerBuffer, mRate, statusFlags };
+
    mbHasSoloTracks = CountSoloingTracks() > 0 ;
    mCallbackReturn = paContinue;
 
@@ -4421,6 +4438,22 @@ int AudioIoCallback::AudioCallback(const void *inputBuffer, void *outputBuffer,
       framesPerBuffer,
       outputMeterFloats);
 
+   // How close the ring buffers are to running dry, or over
+   if (!mPlaybackTracks.empty()) {
+      const auto ready = GetCommonlyReadyPlayback();
+      const auto capacity = mPlaybackBuffers[0]->AvailForGet() +
+         mPlaybackBuffers[0]->AvailForPut();
+      mMetrics.AddPlaybackFill(ready, capacity - std::min(ready, capacity));
+   }
+   if (!mCaptureTracks.empty()) {
+      auto free = mCaptureBuffers[0]->AvailForPut();
+      for (unsigned i = 1; i < mCaptureTracks.size(); ++i)
+         free = std::min(free, mCaptureBuffers[i]->AvailForPut());
+      const auto capacity = mCaptureBuffers[0]->AvailForGet() +
+         mCaptureBuffers[0]->AvailForPut();
+      mMetrics.AddCaptureFill(capacity - std::min(free, capacity), free);
+   }
+
    // Test for no track audio to play (because we are paused and have faded out)
    if( mPaused &&  (( !mbMicroFades ) || AllTracksAlreadySilent() ))
       return mCallbackReturn;
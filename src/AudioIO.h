@@ -16,6 +16,7 @@
 #include "Audacity.h" // for USE_* macros
 
 #include "AudioIOBase.h" // to inherit
+#include "AudioIOMetrics.h" // member variable
 
 #include "Experimental.h"
 
@@ -252,6 +253,9 @@ public:
    std::shared_ptr< AudioIOListener > GetListener() const
       { return mListener.lock(); }
    void SetListener( const std::shared_ptr< AudioIOListener > &listener);
+
+   //! Health of the audio path since the stream started, for monitoring
+   const AudioIOMetrics &GetMetrics() const { return mMetrics; }
    
    // Part of the callback
    int CallbackDoSeek();
@@ -454,6 +458,7 @@ public:
    unsigned int        mNumPlaybackChannels;
    sampleFormat        mCaptureFormat;
    unsigned long long  mLostSamples{ 0 };
+   AudioIOMetrics      mMetrics;
    volatile bool       mAudioThreadShouldCallFillBuffersOnce;
    volatile bool       mAudioThreadFillBuffersLoopRunning;
    volatile bool       mAudioThreadFillBuffersLoopActive;
@@ -0,0 +1,239 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AudioIOMetrics.cpp
+
+*******************************************************************//**
+
+\class AudioIOHistogram
+\brief Counts of values in fixed buckets, updated without locks.
+
+*//****************************************************************//**
+
+\class AudioIOMetrics
+\brief Counters and histograms of the health of the audio path.
+
+*//*******************************************************************/
+
+#include "AudioIOMetrics.h"
+
+#include <algorithm>
+
+#include "portaudio.h"
+
+namespace {
+
+void StoreMax(std::atomic<unsigned long long> &max, unsigned long long value)
+{
+   auto old = max.load(std::memory_order_relaxed);
+   while (old < value &&
+      !max.compare_exchange_weak(old, value, std::memory_order_relaxed))
+      ;
+}
+
+unsigned long long Microseconds(AudioIOMetrics::Clock::duration duration)
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+}
+
+AudioIOHistogram::AudioIOHistogram(bool linear)
+   : mLinear{ linear }
+{
+   Reset();
+}
+
+size_t AudioIOHistogram::BucketOf(unsigned long long value) const
+{
+   if (mLinear)
+      return std::min<unsigned long long>(value / 10, LinearBuckets - 1);
+
+   size_t bucket = 0;
+   while (value > 0 && bucket < LogBuckets - 1) {
+      value >>= 1;
+      ++bucket;
+   }
+   return bucket;
+}
+
+unsigned long long AudioIOHistogram::UpperBound(size_t bucket) const
+{
+   if (mLinear)
+      return bucket < LinearBuckets - 1 ? 10 * (bucket + 1) : 0;
+   return bucket < LogBuckets - 1 ? 1ull << bucket : 0;
+}
+
+void AudioIOHistogram::Add(unsigned long long value)
+{
+   mBuckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+   mCount.fetch_add(1, std::memory_order_relaxed);
+   mSum.fetch_add(value, std::memory_order_relaxed);
+   StoreMax(mMax, value);
+}
+
+void AudioIOHistogram::Reset()
+{
+   for (auto &bucket : mBuckets)
+      bucket.store(0, std::memory_order_relaxed);
+   mCount.store(0, std::memory_order_relaxed);
+   mSum.store(0, std::memory_order_relaxed);
+   mMax.store(0, std::memory_order_relaxed);
+}
+
+auto AudioIOHistogram::GetBuckets() const -> std::vector<Bucket>
+{
+   std::vector<Bucket> buckets;
+   const auto nBuckets = mLinear ? LinearBuckets : LogBuckets;
+   for (size_t ii = 0; ii < nBuckets; ++ii) {
+      const auto count = mBuckets[ii].load(std::memory_order_relaxed);
+      if (count > 0)
+         buckets.push_back({ UpperBound(ii), count });
+   }
+   return buckets;
+}
+
+unsigned long long AudioIOHistogram::GetCount() const
+{
+   return mCount.load(std::memory_order_relaxed);
+}
+
+unsigned long long AudioIOHistogram::GetMax() const
+{
+   return mMax.load(std::memory_order_relaxed);
+}
+
+double AudioIOHistogram::GetMean() const
+{
+   const auto count = GetCount();
+   return count > 0
+      ? (double)mSum.load(std::memory_order_relaxed) / count
+      : 0.0;
+}
+
+AudioIOMetrics::AudioIOMetrics()
+{
+   Reset();
+}
+
+void AudioIOMetrics::Reset()
+{
+   for (auto pHistogram : { &mCallbackMicroseconds, &mCallbackLoad,
+      &mPlaybackFill, &mCaptureFill,
+      &mFillBuffersMicroseconds, &mFillBuffersWait })
+      pHistogram->Reset();
+
+   for (auto pCounter : { &mLostSamples,
+      &mInputOverflows, &mInputUnderflows,
+      &mOutputOverflows, &mOutputUnderflows })
+      pCounter->store(0, std::memory_order_relaxed);
+
+   for (auto &counters : mEffectGroups) {
+      counters.blocks.store(0, std::memory_order_relaxed);
+      counters.nanoseconds.store(0, std::memory_order_relaxed);
+      counters.frames.store(0, std::memory_order_relaxed);
+   }
+
+   mRate.store(0, std::memory_order_relaxed);
+   mLastFillBuffersEnd.store(0, std::memory_order_relaxed);
+}
+
+AudioIOMetrics::CallbackScope::CallbackScope(AudioIOMetrics &metrics,
+   unsigned long framesPerBuffer, double rate, unsigned long statusFlags)
+   : mMetrics{ metrics }
+   , mStart{ Clock::now() }
+   , mBufferMicroseconds{ rate > 0 ? 1e6 * framesPerBuffer / rate : 0.0 }
+{
+   metrics.mRate.store(rate, std::memory_order_relaxed);
+
+   // Priming the output is not a fault of ours
+   if (statusFlags & paPrimingOutput)
+      return;
+   if (statusFlags & paInputOverflow)
+      metrics.mInputOverflows.fetch_add(1, std::memory_order_relaxed);
+   if (statusFlags & paInputUnderflow)
+      metrics.mInputUnderflows.fetch_add(1, std::memory_order_relaxed);
+   if (statusFlags & paOutputOverflow)
+      metrics.mOutputOverflows.fetch_add(1, std::memory_order_relaxed);
+   if (statusFlags & paOutputUnderflow)
+      metrics.mOutputUnderflows.fetch_add(1, std::memory_order_relaxed);
+}
+
+AudioIOMetrics::CallbackScope::~CallbackScope()
+{
+   const auto microseconds = Microseconds(Clock::now() - mStart);
+   mMetrics.mCallbackMicroseconds.Add(microseconds);
+   if (mBufferMicroseconds > 0)
+      mMetrics.mCallbackLoad.Add(
+         (unsigned long long)(100.0 * microseconds / mBufferMicroseconds));
+}
+
+AudioIOMetrics::FillBuffersScope::FillBuffersScope(AudioIOMetrics &metrics)
+   : mMetrics{ metrics }
+   , mStart{ Clock::now() }
+{
+   const auto lastEnd =
+      metrics.mLastFillBuffersEnd.load(std::memory_order_relaxed);
+   if (lastEnd != 0)
+      metrics.mFillBuffersWait.Add(Microseconds(
+         mStart - Clock::time_point{ Clock::duration{ lastEnd } }));
+}
+
+AudioIOMetrics::FillBuffersScope::~FillBuffersScope()
+{
+   const auto end = Clock::now();
+   mMetrics.mFillBuffersMicroseconds.Add(Microseconds(end - mStart));
+   mMetrics.mLastFillBuffersEnd.store(
+      end.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void AudioIOMetrics::AddPlaybackFill(size_t ready, size_t free)
+{
+   if (ready + free > 0)
+      mPlaybackFill.Add(100ull * ready / (ready + free));
+}
+
+void AudioIOMetrics::AddCaptureFill(size_t ready, size_t free)
+{
+   if (ready + free > 0)
+      mCaptureFill.Add(100ull * ready / (ready + free));
+}
+
+void AudioIOMetrics::AddLostSamples(unsigned long long count)
+{
+   mLostSamples.fetch_add(count, std::memory_order_relaxed);
+}
+
+void AudioIOMetrics::AddEffectTime(
+   int group, Clock::duration duration, size_t frames)
+{
+   auto &counters = mEffectGroups[
+      std::min<size_t>(std::max(group, 0), MaxEffectGroups - 1)];
+   counters.blocks.fetch_add(1, std::memory_order_relaxed);
+   counters.nanoseconds.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+      std::memory_order_relaxed);
+   counters.frames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+auto AudioIOMetrics::GetEffectGroups() const -> std::vector<EffectGroup>
+{
+   const auto rate = GetRate();
+   std::vector<EffectGroup> groups;
+   for (size_t ii = 0; ii < MaxEffectGroups; ++ii) {
+      const auto &counters = mEffectGroups[ii];
+      const auto blocks = counters.blocks.load(std::memory_order_relaxed);
+      if (blocks == 0)
+         continue;
+      const auto nanoseconds =
+         counters.nanoseconds.load(std::memory_order_relaxed);
+      const auto frames = counters.frames.load(std::memory_order_relaxed);
+      const double audioNanoseconds = rate > 0 ? 1e9 * frames / rate : 0.0;
+      groups.push_back({ (int)ii, blocks, nanoseconds / 1000,
+         audioNanoseconds > 0 ? 100.0 * nanoseconds / audioNanoseconds : 0.0
+      });
+   }
+   return groups;
+}
@@ -0,0 +1,183 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AudioIOMetrics.h
+
+*******************************************************************//**
+
+\file AudioIOMetrics.h
+\brief Counters and histograms of the health of the audio path, updated
+without locks by the audio callback and the audio thread.
+
+  They show how long callbacks take against the time their buffers play,
+  how full the ring buffers run, how late FillBuffers comes round, what
+  PortAudio reports as over- and underflows, and how long realtime effects
+  take for each group.  So a monitor can see an xrun coming, and not only
+  after it happens.
+
+  Writers use relaxed atomics only; a reader may see a snapshot with one
+  counter a little ahead of another, which is good enough for monitoring.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_AUDIO_IO_METRICS__
+#define __AUDACITY_AUDIO_IO_METRICS__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+//! Counts of values in fixed buckets, with their number, sum and maximum
+class AudioIOHistogram
+{
+public:
+   //! Buckets are [0, 1), then doubling up to 2^(LogBuckets - 2), then the
+   //! rest; or with linear, [0, 10), [10, 20) ... [90, 100), then the rest
+   static constexpr size_t LogBuckets = 24;
+   static constexpr size_t LinearBuckets = 11;
+
+   explicit AudioIOHistogram(bool linear);
+
+   void Add(unsigned long long value);
+   void Reset();
+
+   struct Bucket {
+      //! The values of the bucket are less than this, or 0 for the last
+      unsigned long long upTo;
+      unsigned long long count;
+   };
+   //! The buckets that are not empty
+   std::vector<Bucket> GetBuckets() const;
+
+   unsigned long long GetCount() const;
+   unsigned long long GetMax() const;
+   double GetMean() const;
+
+private:
+   size_t BucketOf(unsigned long long value) const;
+   unsigned long long UpperBound(size_t bucket) const;
+
+   const bool mLinear;
+   std::array< std::atomic<unsigned long long>, LogBuckets > mBuckets;
+   std::atomic<unsigned long long> mCount{ 0 }, mSum{ 0 }, mMax{ 0 };
+};
+
+class AudioIOMetrics
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   //! Groups beyond this are counted in the last
+   static constexpr size_t MaxEffectGroups = 32;
+
+   AudioIOMetrics();
+
+   //! When a stream starts; not while the callback runs
+   void Reset();
+
+   //! In the audio callback, times it against its buffer
+   class CallbackScope
+   {
+   public:
+      CallbackScope(AudioIOMetrics &metrics, unsigned long framesPerBuffer,
+         double rate, unsigned long statusFlags);
+      CallbackScope(const CallbackScope&) = delete;
+      CallbackScope &operator= (const CallbackScope&) = delete;
+      ~CallbackScope();
+
+   private:
+      AudioIOMetrics &mMetrics;
+      const Clock::time_point mStart;
+      const double mBufferMicroseconds;
+   };
+
+   //! In the audio thread, times FillBuffers and the wait before it
+   class FillBuffersScope
+   {
+   public:
+      explicit FillBuffersScope(AudioIOMetrics &metrics);
+      FillBuffersScope(const FillBuffersScope&) = delete;
+      FillBuffersScope &operator= (const FillBuffersScope&) = delete;
+      ~FillBuffersScope();
+
+   private:
+      AudioIOMetrics &mMetrics;
+      const Clock::time_point mStart;
+   };
+
+   //! In the audio callback; ready and free samples of the ring buffers
+   void AddPlaybackFill(size_t ready, size_t free);
+   void AddCaptureFill(size_t ready, size_t free);
+
+   //! In the audio callback
+   void AddLostSamples(unsigned long long count);
+   void AddEffectTime(int group, Clock::duration duration, size_t frames);
+
+   // Reading, on any thread
+
+   //! Of the stream, as of the last callback
+   double GetRate() const { return mRate.load(std::memory_order_relaxed); }
+
+   const AudioIOHistogram &GetCallbackMicroseconds() const
+   { return mCallbackMicroseconds; }
+   //! Percentage of the time of its buffer that each callback took
+   const AudioIOHistogram &GetCallbackLoad() const { return mCallbackLoad; }
+   const AudioIOHistogram &GetPlaybackFill() const { return mPlaybackFill; }
+   const AudioIOHistogram &GetCaptureFill() const { return mCaptureFill; }
+   const AudioIOHistogram &GetFillBuffersMicroseconds() const
+   { return mFillBuffersMicroseconds; }
+   //! From the end of one FillBuffers to the start of the next
+   const AudioIOHistogram &GetFillBuffersWait() const
+   { return mFillBuffersWait; }
+
+   unsigned long long GetLostSamples() const
+   { return mLostSamples.load(std::memory_order_relaxed); }
+   unsigned long long GetInputOverflows() const
+   { return mInputOverflows.load(std::memory_order_relaxed); }
+   unsigned long long GetInputUnderflows() const
+   { return mInputUnderflows.load(std::memory_order_relaxed); }
+   unsigned long long GetOutputOverflows() const
+   { return mOutputOverflows.load(std::memory_order_relaxed); }
+   unsigned long long GetOutputUnderflows() const
+   { return mOutputUnderflows.load(std::memory_order_relaxed); }
+
+   struct EffectGroup {
+      int group;
+      unsigned long long blocks;
+      unsigned long long microseconds;
+      //! Percentage of the time of the samples processed
+      double load;
+   };
+   //! The groups that processed anything
+   std::vector<EffectGroup> GetEffectGroups() const;
+
+private:
+   struct EffectCounters {
+      std::atomic<unsigned long long> blocks{ 0 };
+      std::atomic<unsigned long long> nanoseconds{ 0 };
+      std::atomic<unsigned long long> frames{ 0 };
+   };
+
+   AudioIOHistogram mCallbackMicroseconds{ false };
+   AudioIOHistogram mCallbackLoad{ true };
+   AudioIOHistogram mPlaybackFill{ true };
+   AudioIOHistogram mCaptureFill{ true };
+   AudioIOHistogram mFillBuffersMicroseconds{ false };
+   AudioIOHistogram mFillBuffersWait{ false };
+
+   std::atomic<double> mRate{ 0 };
+   std::atomic<unsigned long long> mLostSamples{ 0 };
+   std::atomic<unsigned long long> mInputOverflows{ 0 };
+   std::atomic<unsigned long long> mInputUnderflows{ 0 };
+   std::atomic<unsigned long long> mOutputOverflows{ 0 };
+   std::atomic<unsigned long long> mOutputUnderflows{ 0 };
+
+   std::array<EffectCounters, MaxEffectGroups> mEffectGroups;
+
+   //! Since the epoch of the clock, or 0 if there was none since Reset()
+   std::atomic<Clock::rep> mLastFillBuffersEnd{ 0 };
+};
+
+#endif
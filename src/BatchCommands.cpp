@@ -757,6 +757,10 @@ bool MacroCommands::ApplyMacro(
            Verbatim( command.GET() )
          : iter->name.Msgid().Stripped();
 
+      // A deferred export of an earlier line may still be reading the project
+      if (auto pExports = DeferredExports::Current())
+         pExports->Wait();
+
       wxTimeSpan before;
       if (trace) {
          before = wxTimeSpan(0, 0, 0, wxGetUTCTimeMillis());
@@ -37,6 +37,7 @@
 #include <wx/imaglist.h>
 #include <wx/settings.h>
 
+#include "BatchProcessor.h"
 #include "ShuttleGui.h"
 #include "Menus.h"
 #include "Prefs.h"
@@ -331,13 +332,6 @@ void ApplyMacroDialog::OnApplyToFiles(wxCommandEvent & WXUNUSED(event))
    gPrefs->Write(wxT("/Batch/ActiveMacro"), name);
    gPrefs->Flush();
 
-   AudacityProject *project = &mProject;
-   if (!TrackList::Get( *project ).empty()) {
-      AudacityMessageBox(
-         XO("Please save and close the current project first.") );
-      return;
-   }
-
    auto prompt =  XO("Select file(s) for batch processing...");
 
    const auto fileTypes = Importer::Get().GetFileTypes();
@@ -357,7 +351,7 @@ void ApplyMacroDialog::OnApplyToFiles(wxCommandEvent & WXUNUSED(event))
    }
    Raise();
    
-   wxArrayString files;
+   FilePaths files;
    dlog.GetPaths(files);
 
    files.Sort();
@@ -427,36 +421,40 @@ void ApplyMacroDialog::OnApplyToFiles(wxCommandEvent & WXUNUSED(event))
    // and hiding this one temporarily has some advantages.
    Hide();
 
-   mMacroCommands.ReadMacro(name); 
+   BatchFileResults results;
    {
       wxWindowDisabler wd(&activityWin);
-      for (i = 0; i < (int)files.size(); i++) {
-         if (i > 0) {
+      // The files go into projects of the processor's own, several at once
+      BatchProcessor processor{ name };
+      results = processor.Run(files, [&](size_t index, size_t total) {
+         if (index > 0) {
             //Clear the arrow in previous item.
-            fileList->SetItemImage(i - 1, 0, 0);
+            fileList->SetItemImage(index - 1, 0, 0);
          }
-         fileList->SetItemImage(i, 1, 1);
-         fileList->EnsureVisible(i);
-
-         auto success = GuardedCall< bool >([&] {
-            ProjectFileManager::Get(*project).Import(files[i]);
-            ProjectWindow::Get(*project).ZoomAfterImport(nullptr);
-            SelectUtilities::DoSelectAll(*project);
-            if (!mMacroCommands.ApplyMacro(mCatalog))
-               return false;
-
-            if (!activityWin.IsShown() || mAbort)
-               return false;
-
+         if (index == total)
             return true;
-         });
+         fileList->SetItemImage(index, 1, 1);
+         fileList->EnsureVisible(index);
 
-         if (!success)
-            break;
+         return activityWin.IsShown() && !mAbort;
+      });
+   }
 
-         ProjectManager::Get(*project).ResetProjectToEmpty();
-      }
+   // Report the files that failed
+   TranslatableString failures;
+   size_t nFailures = 0;
+   for (const auto &result : results) {
+      if (result.success)
+         continue;
+      failures += Verbatim( wxT("\n%s: %s") )
+         .Format( result.file, result.message );
+      ++nFailures;
    }
+   if (nFailures > 0)
+      AudacityMessageBox(
+         XO("The macro failed for %lld of %lld files:%s")
+            .Format( (long long) nFailures, (long long) results.size(),
+               failures ) );
 
    Show();
    Raise();
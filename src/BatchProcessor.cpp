@@ -0,0 +1,191 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BatchProcessor.cpp
+
+**********************************************************************/
+
+#include "BatchProcessor.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <wx/ffile.h>
+#include <wx/frame.h>
+
+#include "AudacityException.h"
+#include "BatchCommands.h"
+#include "Prefs.h"
+#include "Project.h"
+#include "ProjectFileManager.h"
+#include "ProjectManager.h"
+#include "SelectUtilities.h"
+#include "ThreadPool.h"
+#include "export/Export.h"
+
+struct BatchProcessor::Context
+{
+   AudacityProject *pProject{};
+   std::unique_ptr<MacroCommands> pCommands;
+   std::unique_ptr<MacroCommandsCatalog> pCatalog;
+   DeferredExports exports;
+
+   // The file in the project, if busy
+   size_t index{ 0 };
+   bool busy{ false };
+   std::chrono::steady_clock::time_point start;
+};
+
+size_t BatchProcessor::DefaultConcurrency()
+{
+   return std::max(1L, gPrefs->Read(wxT("/Batch/ConcurrentFiles"),
+      (long) ThreadPool::DefaultSize()));
+}
+
+wxString BatchProcessor::FormatReport(const BatchFileResults &results)
+{
+   wxString report = wxT("File\tResult\tSeconds\tOutputs\tMessage\n");
+   for (const auto &result : results) {
+      wxString outputs;
+      for (const auto &output : result.outputs) {
+         if (!outputs.empty())
+            outputs += wxT(";");
+         outputs += output;
+      }
+      wxString message = result.message;
+      message.Replace(wxT("\n"), wxT(" "));
+      message.Replace(wxT("\t"), wxT(" "));
+      report += wxString::Format(wxT("%s\t%s\t%.3f\t%s\t%s\n"),
+         result.file,
+         result.success ? wxT("OK") : wxT("FAILED"),
+         result.seconds,
+         outputs,
+         message);
+   }
+   return report;
+}
+
+bool BatchProcessor::WriteReport(
+   const BatchFileResults &results, const FilePath &path)
+{
+   wxFFile file(path, wxT("w"));
+   return file.IsOpened() && file.Write(FormatReport(results), wxConvUTF8);
+}
+
+BatchProcessor::BatchProcessor(const wxString &macroName, size_t nProjects)
+   : mMacroName{ macroName }
+{
+   if (nProjects == 0)
+      nProjects = DefaultConcurrency();
+
+   // New projects become active; the user's project should stay so
+   const auto pActive = GetActiveProject();
+   auto cleanup = finally( [&]{ SetActiveProject(pActive); } );
+
+   for (size_t ii = 0; ii < nProjects; ++ii) {
+      auto pContext = std::make_unique<Context>();
+      pContext->pProject = ProjectManager::New();
+      GetProjectFrame( *pContext->pProject ).Hide();
+      pContext->pCommands =
+         std::make_unique<MacroCommands>( *pContext->pProject );
+      pContext->pCommands->ReadMacro(mMacroName);
+      pContext->pCatalog =
+         std::make_unique<MacroCommandsCatalog>( pContext->pProject );
+      mContexts.push_back(std::move(pContext));
+   }
+}
+
+BatchProcessor::~BatchProcessor()
+{
+   for (auto &pContext : mContexts) {
+      // Exports must finish before the project goes
+      pContext->exports.Wait();
+      GuardedCall( [&]{
+         ProjectManager::Get( *pContext->pProject ).ResetProjectToEmpty();
+      } );
+      // The project is clean and empty, so this asks nothing
+      GetProjectFrame( *pContext->pProject ).Close(true);
+   }
+}
+
+BatchFileResults BatchProcessor::Run(
+   const FilePaths &files, const ProgressCallback &progress)
+{
+   BatchFileResults results;
+   results.reserve(files.size());
+
+   // Projects take files in turn; the next file waits for the exports of
+   // the one that the project had before, which is the oldest
+   for (size_t ii = 0; ii < files.size(); ++ii) {
+      if (progress && !progress(ii, files.size()))
+         break;
+      auto &context = *mContexts[ii % mContexts.size()];
+      Finish(context, results);
+      results.emplace_back();
+      results.back().file = files[ii];
+      Start(context, files[ii], ii, results);
+   }
+
+   for (auto &pContext : mContexts)
+      Finish(*pContext, results);
+   if (progress)
+      progress(files.size(), files.size());
+
+   return results;
+}
+
+void BatchProcessor::Start(Context &context, const FilePath &file,
+   size_t index, BatchFileResults &results)
+{
+   auto &project = *context.pProject;
+   context.index = index;
+   context.busy = true;
+   context.start = std::chrono::steady_clock::now();
+
+   wxString failure;
+   const bool success = GuardedCall<bool>( [&]{
+      DeferredExports::Scope scope{ context.exports };
+
+      failure = wxT("Import failed");
+      if (!ProjectFileManager::Get( project ).Import(file, nullptr, false))
+         return false;
+
+      SelectUtilities::DoSelectAll( project );
+
+      failure = wxT("Macro failed");
+      return context.pCommands->ApplyMacro( *context.pCatalog );
+   }, MakeSimpleGuard(false) );
+
+   auto &result = results[index];
+   result.success = success;
+   if (!success)
+      result.message = failure;
+}
+
+void BatchProcessor::Finish(Context &context, BatchFileResults &results)
+{
+   if (!context.busy)
+      return;
+   context.busy = false;
+
+   auto &result = results[context.index];
+   for (const auto &exported : context.exports.TakeResults()) {
+      if (exported.success)
+         result.outputs.push_back(exported.path);
+      else {
+         result.success = false;
+         if (result.message.empty())
+            result.message = exported.error.empty()
+               ? wxString::Format(wxT("Export to %s failed"), exported.path)
+               : exported.error.Translation();
+      }
+   }
+
+   result.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - context.start).count();
+
+   GuardedCall( [&]{
+      ProjectManager::Get( *context.pProject ).ResetProjectToEmpty();
+   } );
+}
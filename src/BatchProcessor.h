@@ -0,0 +1,87 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BatchProcessor.h
+
+*******************************************************************//**
+
+\file BatchProcessor.h
+\brief Applies a macro to many files, several at a time, without the
+Macros dialogs, and reports the outcome for each file.
+
+  Each file is imported into one of a few hidden projects, which the
+  processor owns; each project has its own database, in its own
+  temporary file.  The macro runs on the main thread, as commands must,
+  but exports that plug-ins can do on worker threads are deferred
+  (see DeferredExports), and the next file goes into another project
+  while they run.  A project is emptied for reuse only after its
+  exports finish.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BATCH_PROCESSOR__
+#define __AUDACITY_BATCH_PROCESSOR__
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "audacity/Types.h"
+
+//! The outcome of applying the macro to one file
+struct BatchFileResult
+{
+   FilePath file;
+   bool success{ false };
+   //! Why it failed, for the report; empty on success
+   wxString message;
+   //! Files that the macro exported
+   FilePaths outputs;
+   //! From the start of the import until its exports were collected
+   double seconds{ 0.0 };
+};
+
+using BatchFileResults = std::vector<BatchFileResult>;
+
+class BatchProcessor final
+{
+public:
+   //! Number of projects to use at once if none is given: the preference
+   //! /Batch/ConcurrentFiles, or the size of the thread pool
+   static size_t DefaultConcurrency();
+
+   //! Tab separated, one line for each file after a line of headings
+   static wxString FormatReport(const BatchFileResults &results);
+   static bool WriteReport(
+      const BatchFileResults &results, const FilePath &path);
+
+   /*! @param macroName as for MacroCommands::ReadMacro
+    @param nProjects at least one; zero means DefaultConcurrency() */
+   BatchProcessor(const wxString &macroName, size_t nProjects = 0);
+   BatchProcessor(const BatchProcessor&) = delete;
+   BatchProcessor &operator= (const BatchProcessor&) = delete;
+   ~BatchProcessor();
+
+   //! Called on the main thread when a file is about to start, and once
+   //! more with index equal to the number of files; returns false to start
+   //! no more files
+   using ProgressCallback = std::function< bool(size_t index, size_t total) >;
+
+   //! Apply the macro to each file, in order of starting; files not
+   //! started, if stopped, are not in the results
+   BatchFileResults Run(
+      const FilePaths &files, const ProgressCallback &progress = {});
+
+private:
+   struct Context;
+
+   void Start(Context &context, const FilePath &file, size_t index,
+      BatchFileResults &results);
+   void Finish(Context &context, BatchFileResults &results);
+
+   const wxString mMacroName;
+   std::vector< std::unique_ptr<Context> > mContexts;
+};
+
+#endif
@@ -8,9 +8,24 @@
 
 *******************************************************************//**
 
-\class BenchmarkDialog
-\brief BenchmarkDialog is used for measuring performance and accuracy
-of sample block storage.
+\file Benchmark.cpp
+\brief Measures the performance and accuracy of sample block storage,
+and of the code that reads it, with no user interface.
+
+  A track of 16 bit samples is appended in the project database, in
+  chunks of equal samples that are cut and pasted at random, so that the
+  contents can be checked after.  The chunks are (and are supposed to be)
+  a different size from the sample blocks, so that edits cross block
+  boundaries.  The same track is then read, summarized, drawn, mixed,
+  exported and processed by effects.
+
+  Separately, blobs the size of sample blocks are read from scratch
+  databases with several page sizes, with and without memory mapping, as
+  the GetSamples statement reads them, to show what the storage tuning of
+  DBConnection gains.
+
+  Each benchmark gives its time and throughput, and whether it passed;
+  the results are written as JSON, for scripts that track regressions.
 
 *//*******************************************************************/
 
@@ -18,566 +33,665 @@ of sample block storage.
 #include "Audacity.h"
 #include "Benchmark.h"
 
-#include <wx/app.h>
-#include <wx/log.h>
-#include <wx/textctrl.h>
-#include <wx/button.h>
-#include <wx/checkbox.h>
-#include <wx/choice.h>
-#include <wx/dialog.h>
-#include <wx/sizer.h>
-#include <wx/stattext.h>
-#include <wx/timer.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <math.h>
+#include <random>
+#include <string.h>
+
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
 #include <wx/utils.h>
-#include <wx/valgen.h>
-#include <wx/valtext.h>
-#include <wx/intl.h>
 
+#include "sqlite3.h"
+
+#include "AudacityException.h"
+#include "FileNames.h"
+#include "Internat.h"
+#include "Mix.h"
 #include "SampleBlock.h"
-#include "ShuttleGui.h"
 #include "Project.h"
 #include "WaveClip.h"
 #include "WaveTrack.h"
 #include "Sequence.h"
+#include "SummaryKernels.h"
 #include "Prefs.h"
 #include "ProjectSettings.h"
-#include "ViewInfo.h"
+#include "effects/Effect.h"
+#include "effects/EffectManager.h"
+#include "export/Export.h"
+#include "widgets/HelpSystem.h"
+#include "widgets/ProgressDialog.h"
 
-#include "FileNames.h"
-#include "widgets/AudacityMessageBox.h"
-#include "widgets/wxPanelWrapper.h"
-
-// Change these to the desired format...should probably make the
-// choice available in the dialog
+// Change these to the desired format
 #define SampleType short
 #define SampleFormat int16Sample
 
-class BenchmarkDialog final : public wxDialogWrapper
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Samples at a time for reading, mixing and effects
+constexpr size_t BufferSize = 65536;
+
+class Benchmarks
 {
 public:
-   // constructors and destructors
-   BenchmarkDialog( wxWindow *parent, AudacityProject &project );
+   Benchmarks(AudacityProject &project, const BenchmarkOptions &options);
 
-   void MakeBenchmarkDialog();
+   BenchmarkResults Run();
 
 private:
-   // WDR: handler declarations
-   void OnRun( wxCommandEvent &event );
-   void OnSave( wxCommandEvent &event );
-   void OnClear( wxCommandEvent &event );
-   void OnClose( wxCommandEvent &event );
-
-   void Printf(const TranslatableString &str);
-   void HoldPrint(bool hold);
-   void FlushPrint();
+   //! Time the step, which may fail the result; exceptions fail it too
+   /*! The step may set the seconds itself, to leave out its setup.
+    @param samples processed, for the throughput
+    @return whether it passed */
+   bool Time(const wxString &name, sampleCount samples,
+      const std::function< void(BenchmarkResult &result) > &step);
+
+   void Append(BenchmarkResult &result);
+   void Edit(BenchmarkResult &result);
+   void Read(BenchmarkResult &result);
+   void Storage();
+   void GetSamples(BenchmarkResult &result, int pageSize, bool mapped);
+   void Summaries();
+   void Waveform(BenchmarkResult &result);
+   void MinMaxRMS(BenchmarkResult &result);
+   void Mixdown(BenchmarkResult &result);
+   void Export(BenchmarkResult &result);
+   void ApplyEffect(const CommandID &name, const wxString &parameters);
+
+   const Sequence &GetSequence() const
+   { return *mpTrack->GetClipByIndex(0)->GetSequence(); }
+   bool CheckLength(BenchmarkResult &result, const wxString &when);
 
    AudacityProject &mProject;
-   const ProjectSettings &mSettings;
-
-   bool      mHoldPrint;
-   wxString  mToPrint;
-
-   wxString  mBlockSizeStr;
-   wxString  mDataSizeStr;
-   wxString  mNumEditsStr;
-   wxString  mRandSeedStr;
+   const BenchmarkOptions mOptions;
+   const double mRate;
 
-   bool      mBlockDetail;
-   bool      mEditDetail;
+   std::shared_ptr<WaveTrack> mpTrack;
+   uint64_t mNumChunks{ 0 }, mChunkSize{ 0 };
+   // Value of the samples of each chunk, in order
+   ArrayOf<SampleType> mChunkValues;
 
-   wxTextCtrl  *mText;
-
-private:
-   DECLARE_EVENT_TABLE()
+   BenchmarkResults mResults;
 };
 
-void RunBenchmark( wxWindow *parent, AudacityProject &project )
+Benchmarks::Benchmarks(
+   AudacityProject &project, const BenchmarkOptions &options)
+   : mProject{ project }
+   , mOptions{ options }
+   , mRate{ ProjectSettings::Get( project ).GetRate() }
 {
-   /*
-   int action = AudacityMessageBox(
-XO("This will close all project windows (without saving)\nand open the Audacity Benchmark dialog.\n\nAre you sure you want to do this?"),
-      XO("Benchmark"),
-      wxYES_NO | wxICON_EXCLAMATION,
-      NULL);
+}
 
-   if (action != wxYES)
-      return;
+BenchmarkResults Benchmarks::Run()
+{
+   bool editClipCanMove = true;
+   gPrefs->Read(wxT("/GUI/EditClipCanMove"), &editClipCanMove);
+   gPrefs->Write(wxT("/GUI/EditClipCanMove"), false);
+   gPrefs->Flush();
 
-   for ( auto pProject : AllProjects{} )
-      GetProjectFrame( *pProject ).Close();
-   */
+   // Remember the old blocksize, so that we can restore it later.
+   auto oldBlockSize = Sequence::GetMaxDiskBlockSize();
+   Sequence::SetMaxDiskBlockSize(mOptions.blockSizeKB * 1024);
 
-   BenchmarkDialog dlog{ parent, project };
+   const auto cleanup = finally( [&] {
+      mpTrack.reset();
+      Sequence::SetMaxDiskBlockSize(oldBlockSize);
+      gPrefs->Write(wxT("/GUI/EditClipCanMove"), editClipCanMove);
+      gPrefs->Flush();
+   } );
 
-   dlog.CentreOnParent();
+   srand(mOptions.randSeed);
 
-   dlog.ShowModal();
+   //chunkSize = 7500ull + (rand() % 1000ull);
+   mChunkSize = 200ull + (rand() % 100ull);
+   mNumChunks =
+      (mOptions.dataSizeMB * 1048576ull) / (mChunkSize * sizeof(SampleType));
+   while (mNumChunks < 20 || mChunkSize > (mOptions.blockSizeKB * 1024) / 4)
+   {
+      mChunkSize = std::max( uint64_t(1), (mChunkSize / 2) + (rand() % 100) );
+      mNumChunks = (mOptions.dataSizeMB * 1048576ull) /
+         (mChunkSize * sizeof(SampleType));
+   }
+   const sampleCount numSamples = mNumChunks * mChunkSize;
+
+   // Edits are exact at a rate of 1; the rate changes after them
+   mpTrack = WaveTrackFactory{ ProjectSettings::Get( mProject ),
+      SampleBlockFactory::New( mProject ) }.NewWaveTrack(SampleFormat);
+   mpTrack->SetRate(1);
+
+   // Later benchmarks would mean nothing without the data
+   if (!Time(wxT("append"), numSamples,
+         [&](BenchmarkResult &result){ Append(result); }) ||
+       !Time(wxT("edit"), 0,
+         [&](BenchmarkResult &result){ Edit(result); }))
+      return std::move(mResults);
+
+   mpTrack->SetRate(mRate);
+
+   Time(wxT("read"), numSamples,
+      [&](BenchmarkResult &result){ Read(result); });
+   Storage();
+   Summaries();
+   Time(wxT("waveform"), 0,
+      [&](BenchmarkResult &result){ Waveform(result); });
+   Time(wxT("minmax-rms"), 0,
+      [&](BenchmarkResult &result){ MinMaxRMS(result); });
+   Time(wxT("mixdown"), 2 * numSamples,
+      [&](BenchmarkResult &result){ Mixdown(result); });
+   Time(wxT("export-wav"), numSamples,
+      [&](BenchmarkResult &result){ Export(result); });
+
+   ApplyEffect(wxT("Amplify"), wxT("Ratio=0.5"));
+   ApplyEffect(wxT("BassAndTreble"), wxT("Bass=6 Treble=-6 Gain=0"));
+   ApplyEffect(wxT("Echo"), wxT("Delay=0.25 Decay=0.5"));
+   ApplyEffect(wxT("Phaser"),
+      wxT("Stages=8 Freq=0.4 Depth=100 Feedback=30"));
+
+   return std::move(mResults);
 }
 
-//
-// BenchmarkDialog
-//
-
-enum {
-   RunID = 1000,
-   BSaveID,
-   ClearID,
-   StaticTextID,
-   BlockSizeID,
-   DataSizeID,
-   NumEditsID,
-   RandSeedID
-};
-
-BEGIN_EVENT_TABLE(BenchmarkDialog, wxDialogWrapper)
-   EVT_BUTTON( RunID,   BenchmarkDialog::OnRun )
-   EVT_BUTTON( BSaveID,  BenchmarkDialog::OnSave )
-   EVT_BUTTON( ClearID, BenchmarkDialog::OnClear )
-   EVT_BUTTON( wxID_CANCEL, BenchmarkDialog::OnClose )
-END_EVENT_TABLE()
-
-BenchmarkDialog::BenchmarkDialog(
-   wxWindow *parent, AudacityProject &project)
-   :
-      /* i18n-hint: Benchmark means a software speed test */
-      wxDialogWrapper( parent, 0, XO("Benchmark"),
-                wxDefaultPosition, wxDefaultSize,
-                wxDEFAULT_DIALOG_STYLE |
-                wxRESIZE_BORDER)
-   , mProject(project)
-   , mSettings{ ProjectSettings::Get(project) }
+bool Benchmarks::Time(const wxString &name, sampleCount samples,
+   const std::function< void(BenchmarkResult &result) > &step)
 {
-   SetName();
-
-   mBlockSizeStr = wxT("64");
-   mNumEditsStr = wxT("100");
-   mDataSizeStr = wxT("32");
-   mRandSeedStr = wxT("234657");
-
-   mBlockDetail = false;
-   mEditDetail = false;
+   mResults.emplace_back();
+   auto &result = mResults.back();
+   result.name = name;
 
-   HoldPrint(false);
+   const auto start = Clock::now();
+   try {
+      step(result);
+   }
+   catch (const AudacityException &) {
+      result.passed = false;
+      if (result.message.empty())
+         result.message = wxT("Exception");
+   }
+   if (result.seconds == 0)
+      result.seconds =
+         std::chrono::duration<double>(Clock::now() - start).count();
+   if (result.seconds > 0 && samples > 0)
+      result.samplesPerSecond = samples.as_double() / result.seconds;
 
-   MakeBenchmarkDialog();
+   return result.passed;
 }
 
-// WDR: handler implementations for BenchmarkDialog
-
-void BenchmarkDialog::OnClose(wxCommandEvent & WXUNUSED(event))
+bool Benchmarks::CheckLength(BenchmarkResult &result, const wxString &when)
 {
-   EndModal(0);
+   const auto length = GetSequence().GetNumSamples();
+   if (length == mNumChunks * mChunkSize)
+      return true;
+   result.passed = false;
+   result.message = wxString::Format(
+      wxT("%s: expected length %lld, track length %lld"),
+      when, (long long)(mNumChunks * mChunkSize), length.as_long_long());
+   return false;
 }
 
-void BenchmarkDialog::MakeBenchmarkDialog()
+void Benchmarks::Append(BenchmarkResult &result)
 {
-   ShuttleGui S(this, eIsCreating);
-
-   // Strings don't need to be translated because this class doesn't
-   // ever get used in a stable release.
-
-   S.StartVerticalLay(true);
-   {
-      S.SetBorder(8);
-      S.StartMultiColumn(4);
-      {
-         //
-         S.Id(BlockSizeID)
-            .Validator<wxTextValidator>(wxFILTER_NUMERIC, &mBlockSizeStr)
-            .AddTextBox(XXO("Disk Block Size (KB):"),
-                                             wxT(""),
-                                             12);
-
-         //
-         S.Id(NumEditsID)
-            .Validator<wxTextValidator>(wxFILTER_NUMERIC, &mNumEditsStr)
-            .AddTextBox(XXO("Number of Edits:"),
-                                            wxT(""),
-                                            12);
-
-         //
-         S.Id(DataSizeID)
-            .Validator<wxTextValidator>(wxFILTER_NUMERIC, &mDataSizeStr)
-            .AddTextBox(XXO("Test Data Size (MB):"),
-                                            wxT(""),
-                                            12);
-
-         ///
-         S.Id(RandSeedID)
-            .Validator<wxTextValidator>(wxFILTER_NUMERIC, &mRandSeedStr)
-            /* i18n-hint: A "seed" is a number that initializes a
-               pseudorandom number generating algorithm */
-            .AddTextBox(XXO("Random Seed:"),
-                                            wxT(""),
-                                            12);
-
-      }
-      S.EndMultiColumn();
-
-      //
-      S.Validator<wxGenericValidator>(&mBlockDetail)
-         .AddCheckBox(XXO("Show detailed info about each block file"),
-                           false);
-
-      //
-      S.Validator<wxGenericValidator>(&mEditDetail)
-         .AddCheckBox(XXO("Show detailed info about each editing operation"),
-                           false);
-
-      //
-      mText = S.Id(StaticTextID)
-         /* i18n-hint noun */
-         .Name(XO("Output"))
-         .Style( wxTE_MULTILINE | wxTE_READONLY | wxTE_RICH )
-         .MinSize( { 500, 200 } )
-         .AddTextWindow(wxT(""));
-
-      //
-      S.SetBorder(10);
-      S.StartHorizontalLay(wxALIGN_LEFT | wxEXPAND, false);
-      {
-         S.StartHorizontalLay(wxALIGN_LEFT, false);
-         {
-            S.Id(RunID).AddButton(XXO("Run"), wxALIGN_CENTRE, true);
-            S.Id(BSaveID).AddButton(XXO("Save"));
-            /* i18n-hint verb; to empty or erase */
-            S.Id(ClearID).AddButton(XXO("Clear"));
-         }
-         S.EndHorizontalLay();
-
-         S.StartHorizontalLay(wxALIGN_CENTER, true);
-         {
-            // Spacer
-         }
-         S.EndHorizontalLay();
-
-         S.StartHorizontalLay(wxALIGN_NOT | wxALIGN_LEFT, false);
-         {
-            /* i18n-hint verb */
-            S.Id(wxID_CANCEL).AddButton(XXO("Close"));
-         }
-         S.EndHorizontalLay();
-      }
-      S.EndHorizontalLay();
+   mChunkValues.reinit(mNumChunks);
+   ArrayOf<SampleType> block{ mChunkSize };
+   for (uint64_t i = 0; i < mNumChunks; i++) {
+      const SampleType v = SampleType(rand());
+      mChunkValues[i] = v;
+      std::fill(block.get(), block.get() + mChunkSize, v);
+      mpTrack->Append((samplePtr)block.get(), SampleFormat, mChunkSize);
    }
-   S.EndVerticalLay();
+   mpTrack->Flush();
 
-   Fit();
-   SetSizeHints(GetSize());
+   CheckLength(result, wxT("Append"));
 }
 
-void BenchmarkDialog::OnSave( wxCommandEvent & WXUNUSED(event))
+void Benchmarks::Edit(BenchmarkResult &result)
 {
-/* i18n-hint: Benchmark means a software speed test;
-   leave untranslated file extension .txt */
-   auto fName = XO("benchmark.txt").Translation();
-
-   fName = FileNames::SelectFile(FileNames::Operation::Export,
-      XO("Export Benchmark Data as:"),
-      wxEmptyString,
-      fName,
-      wxT("txt"),
-      { FileNames::TextFiles },
-      wxFD_SAVE | wxRESIZE_BORDER,
-      this);
-
-   if (fName.empty())
-      return;
+   for (size_t z = 0; z < mOptions.numEdits; z++) {
+      // First chunk to cut
+      // 0 <= x0 < nChunks
+      const uint64_t x0 = rand() % mNumChunks;
 
-   mText->SaveFile(fName);
-}
+      // Number of chunks to cut
+      // 1 <= xlen <= nChunks - x0
+      const uint64_t xlen = 1 + (rand() % (mNumChunks - x0));
 
-void BenchmarkDialog::OnClear(wxCommandEvent & WXUNUSED(event))
-{
-   mText->Clear();
-}
+      auto tmp = mpTrack->Cut(
+         double (x0 * mChunkSize), double ((x0 + xlen) * mChunkSize));
 
-void BenchmarkDialog::Printf(const TranslatableString &str)
-{
-   auto s = str.Translation();
-   mToPrint += s;
-   if (!mHoldPrint)
-      FlushPrint();
-}
+      // Position to paste
+      // 0 <= y0 <= nChunks - xlen
+      const uint64_t y0 = rand() % (mNumChunks - xlen + 1);
 
-void BenchmarkDialog::HoldPrint(bool hold)
-{
-   mHoldPrint = hold;
+      mpTrack->Paste((double)(y0 * mChunkSize), tmp.get());
+
+      if (!CheckLength(result, wxString::Format(wxT("Edit %d"), (int)z)))
+         return;
 
-   if (!mHoldPrint)
-      FlushPrint();
+      // Permute the values correspondingly to the cut and paste
+      auto first = &mChunkValues[0];
+      if (x0 + xlen < mNumChunks)
+         std::rotate( first + x0, first + x0 + xlen, first + mNumChunks );
+      std::rotate( first + y0, first + mNumChunks - xlen, first + mNumChunks );
+   }
 }
 
-void BenchmarkDialog::FlushPrint()
+void Benchmarks::Read(BenchmarkResult &result)
 {
-   while(mToPrint.length() > 100) {
-      mText->AppendText(mToPrint.Left(100));
-      mToPrint = mToPrint.Right(mToPrint.length() - 100);
+   // Each chunk is read on its own, which makes reads cross block boundaries
+   const auto &sequence = GetSequence();
+   ArrayOf<SampleType> block{ mChunkSize };
+   uint64_t bad = 0;
+   for (uint64_t i = 0; i < mNumChunks; i++) {
+      const SampleType v = mChunkValues[i];
+      sequence.Get((samplePtr)block.get(), SampleFormat,
+         i * mChunkSize, mChunkSize, true);
+      if (std::any_of(block.get(), block.get() + mChunkSize,
+         [v](SampleType sample){ return sample != v; }))
+         ++bad;
+   }
+
+   if (bad > 0) {
+      result.passed = false;
+      result.message = wxString::Format(wxT("Errors in %lld/%lld chunks"),
+         (long long)bad, (long long)mNumChunks);
    }
-   if (mToPrint.length() > 0)
-      mText->AppendText(mToPrint);
-   mToPrint = wxT("");
 }
 
-void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
+void Benchmarks::Storage()
 {
-   TransferDataFromWindow();
+   const auto numSamples =
+      (sampleCount)(mOptions.dataSizeMB * 1048576ull / sizeof(SampleType));
+   for (auto pageSize : { 4096, 16384, 65536 })
+      for (auto mapped : { false, true })
+         Time(wxString::Format(wxT("getsamples-%dk%s"),
+               pageSize / 1024, mapped ? wxT("-mmap") : wxT("")),
+            numSamples,
+            [&](BenchmarkResult &result){
+               GetSamples(result, pageSize, mapped); } );
+}
 
-   if (!Validate())
+void Benchmarks::GetSamples(
+   BenchmarkResult &result, int pageSize, bool mapped)
+{
+   const wxString path = wxFileName{ FileNames::TempDir(),
+      wxString::Format(wxT("benchmark-%lu.db"), ::wxGetProcessId()) }
+         .GetFullPath();
+   sqlite3 *db = nullptr;
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally( [&]{
+      sqlite3_finalize(stmt);
+      sqlite3_close(db);
+      for (auto suffix : { wxT(""), wxT("-wal"), wxT("-shm") })
+         ::wxRemoveFile(path + suffix);
+   } );
+   auto fail = [&](const wxString &what){
+      result.passed = false;
+      result.message = wxString::Format(wxT("%s: %s"),
+         what, wxString::FromUTF8(sqlite3_errmsg(db)));
+   };
+
+   if (sqlite3_open(path.utf8_str(), &db) != SQLITE_OK) {
+      fail(wxT("Open"));
       return;
-
-   // This code will become part of libaudacity,
-   // and this class will be phased out.
-   long blockSize, numEdits, dataSize, randSeed;
-
-   mBlockSizeStr.ToLong(&blockSize);
-   mNumEditsStr.ToLong(&numEdits);
-   mDataSizeStr.ToLong(&dataSize);
-   mRandSeedStr.ToLong(&randSeed);
-
-   if (blockSize < 1 || blockSize > 1024) {
-      AudacityMessageBox(
-         XO("Block size should be in the range 1 - 1024 KB.") );
+   }
+   const auto config = wxString::Format(
+      "PRAGMA page_size = %d;"
+      "PRAGMA journal_mode = WAL;"
+      "PRAGMA synchronous = NORMAL;"
+      "PRAGMA mmap_size = %lld;"
+      "CREATE TABLE sampleblocks"
+      "  (blockid INTEGER PRIMARY KEY AUTOINCREMENT, samples BLOB);",
+      pageSize, mapped ? (long long)mOptions.dataSizeMB * 2 * 1048576 : 0LL);
+   if (sqlite3_exec(db, config, nullptr, nullptr, nullptr) != SQLITE_OK) {
+      fail(wxT("Configure"));
       return;
    }
 
-   if (numEdits < 1 || numEdits > 10000) {
-      AudacityMessageBox(
-         XO("Number of edits should be in the range 1 - 10000.") );
+   const size_t blockBytes = mOptions.blockSizeKB * 1024;
+   const size_t numBlocks =
+      std::max<size_t>(1, mOptions.dataSizeMB * 1048576ull / blockBytes);
+   ArrayOf<char> block{ blockBytes };
+   for (size_t ii = 0; ii < blockBytes; ++ii)
+      block[ii] = (char)rand();
+
+   sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+   if (sqlite3_prepare_v2(db,
+         "INSERT INTO sampleblocks (samples) VALUES(?1);",
+         -1, &stmt, nullptr) != SQLITE_OK) {
+      fail(wxT("Prepare"));
       return;
    }
-
-   if (dataSize < 1 || dataSize > 2000) {
-      AudacityMessageBox(
-         XO("Test data size should be in the range 1 - 2000 MB.") );
+   for (size_t ii = 0; ii < numBlocks; ++ii) {
+      sqlite3_bind_blob(stmt, 1, block.get(), blockBytes, SQLITE_STATIC);
+      if (sqlite3_step(stmt) != SQLITE_DONE) {
+         fail(wxT("Insert"));
+         return;
+      }
+      sqlite3_reset(stmt);
+   }
+   sqlite3_finalize(stmt);
+   stmt = nullptr;
+   sqlite3_exec(db, "COMMIT;"
+      "PRAGMA wal_checkpoint(TRUNCATE);", nullptr, nullptr, nullptr);
+
+   // Read every block in random order, as SqliteSampleBlock::DoGetSamples
+   // does, timing the reads alone
+   std::vector<sqlite3_int64> ids(numBlocks);
+   for (size_t ii = 0; ii < numBlocks; ++ii)
+      ids[ii] = ii + 1;
+   std::shuffle(ids.begin(), ids.end(), std::minstd_rand{ (unsigned)rand() });
+   if (sqlite3_prepare_v2(db,
+         "SELECT samples FROM sampleblocks WHERE blockid = ?1;",
+         -1, &stmt, nullptr) != SQLITE_OK) {
+      fail(wxT("Prepare"));
       return;
    }
 
-   bool editClipCanMove = true;
-   gPrefs->Read(wxT("/GUI/EditClipCanMove"), &editClipCanMove);
-   gPrefs->Write(wxT("/GUI/EditClipCanMove"), false);
-   gPrefs->Flush();
-
-   // Remember the old blocksize, so that we can restore it later.
-   auto oldBlockSize = Sequence::GetMaxDiskBlockSize();
-   Sequence::SetMaxDiskBlockSize(blockSize * 1024);
-
-   const auto cleanup = finally( [&] {
-      Sequence::SetMaxDiskBlockSize(oldBlockSize);
-      gPrefs->Write(wxT("/GUI/EditClipCanMove"), editClipCanMove);
-      gPrefs->Flush();
-   } );
-
-   wxBusyCursor busy;
-
-   HoldPrint(true);
-
-   const auto t =
-      WaveTrackFactory{ mSettings,
-                    SampleBlockFactory::New( mProject )  }
-         .NewWaveTrack(SampleFormat);
-
-   t->SetRate(1);
-
-   srand(randSeed);
-
-   uint64_t nChunks, chunkSize;
-   //chunkSize = 7500ull + (rand() % 1000ull);
-   chunkSize = 200ull + (rand() % 100ull);
-   nChunks = (dataSize * 1048576ull) / (chunkSize*sizeof(SampleType));
-   while (nChunks < 20 || chunkSize > (blockSize*1024)/4)
-   {
-      chunkSize = std::max( uint64_t(1), (chunkSize / 2) + (rand() % 100) );
-      nChunks = (dataSize * 1048576ull) / (chunkSize*sizeof(SampleType));
+   const auto start = Clock::now();
+   size_t bad = 0;
+   for (auto id : ids) {
+      sqlite3_bind_int64(stmt, 1, id);
+      if (sqlite3_step(stmt) != SQLITE_ROW) {
+         fail(wxT("Select"));
+         return;
+      }
+      if ((size_t)sqlite3_column_bytes(stmt, 0) != blockBytes ||
+          memcmp(sqlite3_column_blob(stmt, 0), block.get(), blockBytes) != 0)
+         ++bad;
+      sqlite3_reset(stmt);
    }
+   result.seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
 
-   // The chunks are the pieces we move around in the test.
-   // They are (and are supposed to be) a different size to
-   // the blocks that make the sample blocks.  That way we get to
-   // do some testing of when edit chunks cross sample block boundaries.
-   Printf( XO("Using %lld chunks of %lld samples each, for a total of %.1f MB.\n")
-      .Format( nChunks, chunkSize, nChunks*chunkSize*sizeof(SampleType)/1048576.0 ) );
-
-   int trials = numEdits;
-
-   using Samples = ArrayOf<SampleType>;
-   Samples small1{nChunks};
-   Samples block{chunkSize};
+   if (bad > 0) {
+      result.passed = false;
+      result.message = wxString::Format(wxT("Errors in %lld/%lld blocks"),
+         (long long)bad, (long long)numBlocks);
+   }
+}
 
-   Printf( XO("Preparing...\n") );
+void Benchmarks::Summaries()
+{
+   // Compare the implementations of the min, max, and RMS summaries
+   // computed for each new sample block
+   const size_t summaryLen = 1 << 20;
+   const int summaryTrials = 64;
+   Floats samples{ summaryLen };
+   for (size_t i = 0; i < summaryLen; i++)
+      samples[i] = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+
+   double expected = 0.0;
+   for (auto implementation : {
+      SummaryImplementation::Scalar,
+      SummaryImplementation::SSE,
+      SummaryImplementation::AVX,
+   }) {
+      if (!IsSummaryImplementationSupported(implementation))
+         continue;
+
+      Time(wxString::Format(wxT("summary-%s"),
+            GetSummaryImplementationName(implementation)),
+         (sampleCount)summaryLen * summaryTrials,
+         [&](BenchmarkResult &result){
+            double sumsq = 0.0;
+            for (int trial = 0; trial < summaryTrials; trial++)
+               for (size_t i = 0; i < summaryLen; i += 256)
+                  sumsq += SummarizeSamples(
+                     &samples[i], 256, implementation).sumsq;
+            const double rms =
+               sqrt(sumsq / ((double)summaryLen * summaryTrials));
+
+            // Each must agree with the first, which is scalar
+            if (expected == 0.0)
+               expected = rms;
+            else if (fabs(rms - expected) > 1e-4 * expected) {
+               result.passed = false;
+               result.message = wxString::Format(
+                  wxT("RMS %f differs from %f"), rms, expected);
+            }
+         } );
+   }
+}
 
-   wxTheApp->Yield();
-   FlushPrint();
+void Benchmarks::Waveform(BenchmarkResult &result)
+{
+   // Draw the whole track across a wide window, at several zoom levels,
+   // as when zooming in and scrolling through it
+   const auto &sequence = GetSequence();
+   const auto numSamples = sequence.GetNumSamples();
+   const size_t width = 2000;
+   std::vector<float> min(width), max(width), rms(width);
+   std::vector<int> bl(width);
+   std::vector<sampleCount> where(width + 1);
+   for (const auto windows : { 1, 8, 64 }) {
+      const auto samplesPerWindow = numSamples.as_double() / windows;
+      for (int window = 0; window < windows; ++window) {
+         for (size_t p = 0; p <= width; ++p)
+            where[p] = sampleCount( floor(
+               samplesPerWindow * (window + (double)p / width) ) );
+         if (!sequence.GetWaveDisplay(min.data(), max.data(), rms.data(),
+               bl.data(), width, where.data())) {
+            result.passed = false;
+            result.message = wxT("Could not get the wave display");
+            return;
+         }
+      }
+   }
+}
 
-   int v;
-   int bad;
-   int z;
-   long elapsed;
-   wxString tempStr;
-   wxStopWatch timer;
+void Benchmarks::MinMaxRMS(BenchmarkResult &result)
+{
+   // Queries of random ranges, as for Contrast and Normalize
+   const auto &sequence = GetSequence();
+   const auto numSamples = sequence.GetNumSamples().as_long_long();
+   for (int query = 0; query < 1000; ++query) {
+      const auto s0 = (long long)(
+         (rand() / (double)RAND_MAX) * (numSamples - 1));
+      const auto len = 1 + (long long)(
+         (rand() / (double)RAND_MAX) * (numSamples - s0 - 1));
+      const auto range = sequence.GetMinMax(s0, len, true);
+      sequence.GetRMS(s0, len, true);
+      if (range.first > range.second) {
+         result.passed = false;
+         result.message = wxString::Format(
+            wxT("No samples from %lld for %lld"), s0, len);
+         return;
+      }
+   }
+}
 
-   for (uint64_t i = 0; i < nChunks; i++) {
-      v = SampleType(rand());
-      small1[i] = v;
-      for (uint64_t b = 0; b < chunkSize; b++)
-         block[b] = v;
+void Benchmarks::Mixdown(BenchmarkResult &result)
+{
+   // Two copies of the track, in stereo, at the rate of the track
+   WaveTrackConstArray tracks{ mpTrack, mpTrack };
+   Mixer mixer{ tracks, true, Mixer::WarpOptions{ nullptr },
+      0.0, mpTrack->GetEndTime(),
+      2, BufferSize, false, mRate, floatSample };
+   sampleCount mixed = 0;
+   while (const auto count = mixer.Process(BufferSize))
+      mixed += count;
+
+   if (mixed != GetSequence().GetNumSamples()) {
+      result.passed = false;
+      result.message = wxString::Format(wxT("Mixed %lld samples"),
+         mixed.as_long_long());
+   }
+}
 
-      t->Append((samplePtr)block.get(), SampleFormat, chunkSize);
+void Benchmarks::Export(BenchmarkResult &result)
+{
+   Exporter exporter{ mProject };
+   const auto &plugins = exporter.GetPlugins();
+   std::unique_ptr<ExportPlugin> pPlugin;
+   int subformat = 0;
+   for (size_t ii = 0; !pPlugin && ii < plugins.size(); ++ii) {
+      auto &plugin = *plugins[ii];
+      for (int format = 0; format < plugin.GetFormatCount(); ++format)
+         if (plugin.IsExtension(wxT("wav"), format) &&
+             plugin.CanExportConcurrently(format)) {
+            pPlugin = exporter.MakePlugin(ii);
+            subformat = format;
+            break;
+         }
    }
-   t->Flush();
-
-   // This forces the WaveTrack to flush all of the appends (which is
-   // only necessary if you want to access the Sequence class directly,
-   // as we're about to do).
-   t->GetEndTime();
-
-   if (t->GetClipByIndex(0)->GetSequence()->GetNumSamples() != nChunks * chunkSize) {
-      Printf( XO("Expected len %lld, track len %lld.\n")
-         .Format(
-            nChunks * chunkSize,
-            t->GetClipByIndex(0)->GetSequence()->GetNumSamples()
-               .as_long_long() ) );
-      goto fail;
+   if (!pPlugin) {
+      result.passed = false;
+      result.message = wxT("No plug-in exports WAV");
+      return;
    }
 
-   Printf( XO("Performing %d edits...\n").Format( trials ) );
-   wxTheApp->Yield();
-   FlushPrint();
-
-   timer.Start();
-   for (z = 0; z < trials; z++) {
-      // First chunk to cut
-      // 0 <= x0 < nChunks
-      const uint64_t x0 = rand() % nChunks;
+   // With a status, the plug-in exports the track and shows no dialogs
+   const wxString path = wxFileName{ FileNames::TempDir(),
+      wxString::Format(wxT("benchmark-%lu.wav"), ::wxGetProcessId()) }
+         .GetFullPath();
+   auto removal = finally( [&]{ ::wxRemoveFile(path); } );
+   ExportJobStatus status;
+   status.mTracks.push_back(mpTrack);
+   ExportJobScope scope{ status };
+   std::unique_ptr<ProgressDialog> pDialog;
+   const auto exported = pPlugin->Export(&mProject, pDialog, 1, path,
+      false, 0.0, mpTrack->GetEndTime(), nullptr, nullptr, subformat);
+
+   if (exported != ProgressResult::Success) {
+      result.passed = false;
+      result.message = status.mError.empty()
+         ? wxString{ wxT("Export failed") }
+         : status.mError.Translation();
+   }
+}
 
-      // Number of chunks to cut
-      // 1 <= xlen <= nChunks - x0
-      const uint64_t xlen = 1 + (rand() % (nChunks - x0));
-      if (mEditDetail)
-         Printf( XO("Cut: %lld - %lld \n")
-            .Format( x0 * chunkSize, (x0 + xlen) * chunkSize) );
-
-      Track::Holder tmp;
-      try {
-         tmp = t->Cut(double (x0 * chunkSize), double ((x0 + xlen) * chunkSize));
-      }
-      catch (const AudacityException&) {
-         Printf( XO("Trial %d\n").Format( z ) );
-         Printf( XO("Cut (%lld, %lld) failed.\n")
-            .Format( (x0 * chunkSize), (x0 + xlen) * chunkSize) );
-         Printf( XO("Expected len %lld, track len %lld.\n")
-            .Format(
-               nChunks * chunkSize,
-               t->GetClipByIndex(0)->GetSequence()->GetNumSamples()
-                  .as_long_long() ) );
-         goto fail;
+void Benchmarks::ApplyEffect(const CommandID &name, const wxString &parameters)
+{
+   auto &manager = EffectManager::Get();
+   const auto &ID = manager.GetEffectByIdentifier(name);
+   const auto pEffect = manager.GetEffect(ID);
+   const auto &sequence = GetSequence();
+   const auto numSamples = sequence.GetNumSamples();
+
+   // Each effect processes the track, a buffer at a time, reading it as
+   // effects do; the output is not written back
+   Time(wxT("effect-") + name, numSamples, [&](BenchmarkResult &result){
+      if (!pEffect || pEffect->GetAudioInCount() != 1 ||
+          pEffect->GetAudioOutCount() != 1 ||
+          !manager.SetEffectParameters(ID, parameters)) {
+         result.passed = false;
+         result.message = wxT("The effect can't be applied to a mono track");
+         return;
       }
 
-      // Position to paste
-      // 0 <= y0 <= nChunks - xlen
-      const uint64_t y0 = rand() % (nChunks - xlen + 1);
-
-      if (mEditDetail)
-         Printf( XO("Paste: %lld\n").Format( y0 * chunkSize ) );
-
-      try {
-         t->Paste((double)(y0 * chunkSize), tmp.get());
+      pEffect->SetSampleRate(mRate);
+      const auto blockSize = std::max<size_t>(1,
+         std::min(BufferSize, pEffect->SetBlockSize(BufferSize)));
+      Floats inBuffer{ blockSize }, outBuffer{ blockSize };
+      float *in = inBuffer.get();
+      float *out = outBuffer.get();
+
+      if (!pEffect->ProcessInitialize(numSamples)) {
+         result.passed = false;
+         result.message = wxT("The effect could not initialize");
+         return;
       }
-      catch (const AudacityException&) {
-         Printf( XO("Trial %d\nFailed on Paste.\n").Format( z ) );
-         goto fail;
+      auto cleanup = finally( [&]{ pEffect->ProcessFinalize(); } );
+
+      for (sampleCount pos = 0; pos < numSamples;) {
+         const auto count =
+            limitSampleBufferSize(blockSize, numSamples - pos);
+         sequence.Get((samplePtr)in, floatSample, pos, count, true);
+         if (pEffect->ProcessBlock(&in, &out, count) != count) {
+            result.passed = false;
+            result.message = wxT("The effect processed too few samples");
+            return;
+         }
+         pos += count;
       }
+   } );
+}
 
-      if (t->GetClipByIndex(0)->GetSequence()->GetNumSamples() != nChunks * chunkSize) {
-         Printf( XO("Trial %d\n").Format( z ) );
-         Printf( XO("Expected len %lld, track len %lld.\n")
-            .Format(
-               nChunks * chunkSize,
-               t->GetClipByIndex(0)->GetSequence()->GetNumSamples()
-                  .as_long_long() ) );
-         goto fail;
+wxString FormatJSONString(const wxString &str)
+{
+   wxString result = wxT("\"");
+   for (const auto ch : str) {
+      switch (ch.GetValue()) {
+      case '"': result += wxT("\\\""); break;
+      case '\\': result += wxT("\\\\"); break;
+      case '\n': result += wxT("\\n"); break;
+      case '\t': result += wxT("\\t"); break;
+      default:
+         if (ch.GetValue() < 0x20)
+            result += wxString::Format(wxT("\\u%04x"), (int)ch.GetValue());
+         else
+            result += ch;
       }
-
-      // Permute small1 correspondingly to the cut and paste
-      auto first = &small1[0];
-      if (x0 + xlen < nChunks)
-         std::rotate( first + x0, first + x0 + xlen, first + nChunks );
-      std::rotate( first + y0, first + nChunks - xlen, first + nChunks );
-   }
-
-   elapsed = timer.Time();
-
-   if (mBlockDetail) {
-      auto seq = t->GetClipByIndex(0)->GetSequence();
-      seq->DebugPrintf(seq->GetBlockArray(), seq->GetNumSamples(), &tempStr);
-      mToPrint += tempStr;
-   }
-   Printf( XO("Time to perform %d edits: %ld ms\n").Format( trials, elapsed ) );
-   FlushPrint();
-   wxTheApp->Yield();
-
-
-#if 0
-   Printf( XO("Checking file pointer leaks:\n") );
-   Printf( XO("Track # blocks: %ld\n").Format( t->GetBlockArray()->size() ) );
-   Printf( XO("Disk # blocks: \n") );
-   system("ls .audacity_temp/* | wc --lines");
-#endif
-
-   Printf( XO("Doing correctness check...\n") );
-   FlushPrint();
-   wxTheApp->Yield();
-
-   bad = 0;
-   timer.Start();
-   for (uint64_t i = 0; i < nChunks; i++) {
-      v = small1[i];
-      t->Get((samplePtr)block.get(), SampleFormat, i * chunkSize, chunkSize);
-      for (uint64_t b = 0; b < chunkSize; b++)
-         if (block[b] != v) {
-            bad++;
-            if (bad < 10)
-               Printf( XO("Bad: chunk %lld sample %lld\n").Format( i, b ) );
-            b = chunkSize;
-         }
    }
-   if (bad == 0)
-      Printf( XO("Passed correctness check!\n") );
-   else
-      Printf( XO("Errors in %d/%lld chunks\n").Format( bad, nChunks ) );
-
-   elapsed = timer.Time();
-
-   Printf( XO("Time to check all data: %ld ms\n").Format( elapsed ) );
-   Printf( XO("Reading data again...\n") );
+   return result + wxT("\"");
+}
 
-   wxTheApp->Yield();
-   FlushPrint();
+}
 
-   timer.Start();
+BenchmarkResults RunBenchmarks(
+   AudacityProject &project, const BenchmarkOptions &options)
+{
+   return Benchmarks{ project, options }.Run();
+}
 
-   for (uint64_t i = 0; i < nChunks; i++) {
-      v = small1[i];
-      t->Get((samplePtr)block.get(), SampleFormat, i * chunkSize, chunkSize);
-      for (uint64_t b = 0; b < chunkSize; b++)
-         if (block[b] != v)
-            bad++;
+wxString FormatBenchmarkReport(
+   const BenchmarkOptions &options, const BenchmarkResults &results)
+{
+   const bool passed = std::all_of(results.begin(), results.end(),
+      [](const BenchmarkResult &result){ return result.passed; });
+
+   wxString report = wxT("{\n");
+   report += wxString::Format(
+      wxT("  \"options\": { \"blockSizeKB\": %lu, \"dataSizeMB\": %lu, ")
+      wxT("\"numEdits\": %lu, \"randSeed\": %u },\n"),
+      (unsigned long)options.blockSizeKB, (unsigned long)options.dataSizeMB,
+      (unsigned long)options.numEdits, options.randSeed);
+   report += wxString::Format(wxT("  \"passed\": %s,\n"),
+      passed ? wxT("true") : wxT("false"));
+   report += wxT("  \"results\": [");
+   for (size_t ii = 0; ii < results.size(); ++ii) {
+      const auto &result = results[ii];
+      // Numbers have a dot, whatever the locale
+      report += wxString::Format(
+         wxT("%s\n    { \"name\": %s, \"seconds\": %s, ")
+         wxT("\"samplesPerSecond\": %s, \"passed\": %s, \"message\": %s }"),
+         ii > 0 ? wxT(",") : wxT(""),
+         FormatJSONString(result.name),
+         Internat::ToString(result.seconds, 6),
+         Internat::ToString(result.samplesPerSecond, 0),
+         result.passed ? wxT("true") : wxT("false"),
+         FormatJSONString(result.message));
    }
+   report += wxT("\n  ]\n}\n");
+   return report;
+}
 
-   elapsed = timer.Time();
-
-   Printf( XO("Time to check all data (2): %ld ms\n").Format( elapsed ) );
-
-   Printf( XO("At 44100 Hz, %d bytes per sample, the estimated number of\n simultaneous tracks that could be played at once: %.1f\n" )
-      .Format( SAMPLE_SIZE(SampleFormat), (nChunks*chunkSize/44100.0)/(elapsed/1000.0) ) );
-
-   goto success;
-
- fail:
-   Printf( XO("TEST FAILED!!!\n") );
+bool WriteBenchmarkReport(const BenchmarkOptions &options,
+   const BenchmarkResults &results, const wxString &path)
+{
+   wxFFile file(path, wxT("w"));
+   return file.IsOpened() &&
+      file.Write(FormatBenchmarkReport(options, results), wxConvUTF8);
+}
 
- success:
+void RunBenchmark( wxWindow *parent, AudacityProject &project )
+{
+   const BenchmarkOptions options;
+   BenchmarkResults results;
+   {
+      wxBusyCursor busy;
+      results = RunBenchmarks(project, options);
+   }
 
-   Printf( XO("Benchmark completed successfully.\n") );
-   HoldPrint(false);
+   // Strings don't need to be translated because this
+   // doesn't ever get used in a stable release.
+   HelpSystem::ShowInfoDialog( parent,
+      /* i18n-hint: Benchmark means a software speed test */
+      XO("Benchmark"),
+      XO("Benchmark results:"),
+      FormatBenchmarkReport(options, results),
+      600, 400);
 }
@@ -11,8 +11,57 @@
 #ifndef __AUDACITY_BENCHMARK__
 #define __AUDACITY_BENCHMARK__
 
+#include <vector>
+
+#include <wx/string.h>
+
 class AudacityProject;
+class wxWindow;
+
+//! Sizes and seed for a run of the benchmarks; a run with the same options
+//! does the same edits
+struct BenchmarkOptions
+{
+   //! Maximum size of a sample block
+   size_t blockSizeKB{ 64 };
+   //! Samples in the test track, as 16 bit samples
+   size_t dataSizeMB{ 32 };
+   //! Random cuts and pastes
+   size_t numEdits{ 100 };
+   unsigned randSeed{ 234657 };
+};
+
+//! The outcome of one benchmark
+struct BenchmarkResult
+{
+   wxString name;
+   double seconds{ 0 };
+   //! Samples processed per second, or 0 where that means nothing
+   double samplesPerSecond{ 0 };
+   bool passed{ true };
+   //! Why it failed, if it did
+   wxString message;
+};
+
+using BenchmarkResults = std::vector<BenchmarkResult>;
+
+//! Time appending, editing, reading, summarizing, drawing, mixing,
+//! exporting and some effects, on a track with samples in the project
+//! database, with no dialogs, so it can run without a user
+/*! The project is not changed, but its database holds the samples while
+ the benchmarks run.  Preferences the benchmarks depend on are restored
+ after. */
+BenchmarkResults RunBenchmarks(
+   AudacityProject &project, const BenchmarkOptions &options = {});
+
+//! Results as JSON, for tracking regressions
+wxString FormatBenchmarkReport(
+   const BenchmarkOptions &options, const BenchmarkResults &results);
+
+bool WriteBenchmarkReport(const BenchmarkOptions &options,
+   const BenchmarkResults &results, const wxString &path);
 
+//! Run with the default options and show the report
 void RunBenchmark( wxWindow *parent, AudacityProject &project );
 
 #endif // define __AUDACITY_BENCHMARK__
@@ -0,0 +1,428 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockArray.cpp
+
+*******************************************************************//**
+
+\class SeqBlock
+\brief Data structure containing pointer to a sample block and
+   a start time. Element of a BlockArray.
+
+*//****************************************************************//**
+
+\class BlockArray
+\brief The sample blocks of a Sequence, in a persistent, height balanced
+   tree with the block and sample counts of each subtree.
+
+  Edits split and join trees, as in "Just Join for Parallel Ordered Sets"
+  (Blelloch, Ferizovic and Sun), which needs no rebalancing but in join.
+
+*//*******************************************************************/
+
+#include "BlockArray.h"
+
+#include <algorithm>
+
+#include <wx/debug.h>
+
+#include "SampleBlock.h"
+
+struct BlockArray::Node
+{
+   SampleBlockPtr sb;
+   size_t length{ 0 };
+
+   NodePtr left, right;
+   unsigned height{ 1 };
+   size_t blockCount{ 1 };
+   sampleCount numSamples{ 0 };
+
+   // Summaries of the block alone and of the subtree, completed as the
+   // blocks become available
+   mutable Summary own;
+   mutable bool ownAvailable{ false };
+   mutable Summary summary;
+   // The first block of the subtree left out of its summary, if any
+   mutable const SampleBlock *pUnavailable{ nullptr };
+
+   void Update();
+   void Combine() const;
+};
+
+namespace {
+
+template< typename Ptr > unsigned Height(const Ptr &p)
+{ return p ? p->height : 0; }
+
+template< typename Ptr > size_t Count(const Ptr &p)
+{ return p ? p->blockCount : 0; }
+
+template< typename Ptr > sampleCount Samples(const Ptr &p)
+{ return p ? p->numSamples : 0; }
+
+bool SummarizeBlock(const SampleBlock *pBlock, BlockArray::Summary &summary)
+{
+   if (!pBlock) {
+      // Nothing to leave out
+      summary = {};
+      return true;
+   }
+   if (!pBlock->IsSummaryAvailable())
+      return false;
+   const auto results = pBlock->GetMinMaxRMS(false);
+   const auto count = pBlock->GetSampleCount();
+   summary = { results.min, results.max,
+      (double)results.RMS * results.RMS * count, count };
+   return true;
+}
+
+}
+
+void BlockArray::Summary::Add(const Summary &other)
+{
+   min = std::min(min, other.min);
+   max = std::max(max, other.max);
+   sumsq += other.sumsq;
+   count += other.count;
+}
+
+void BlockArray::Node::Update()
+{
+   height = 1 + std::max(Height(left), Height(right));
+   blockCount = 1 + Count(left) + Count(right);
+   numSamples = Samples(left) + length + Samples(right);
+   Combine();
+}
+
+void BlockArray::Node::Combine() const
+{
+   Summary result;
+   const SampleBlock *pFirst = nullptr;
+   if (left) {
+      result.Add(left->summary);
+      pFirst = left->pUnavailable;
+   }
+   if (ownAvailable)
+      result.Add(own);
+   else if (!pFirst)
+      pFirst = sb.get();
+   if (right) {
+      result.Add(right->summary);
+      if (!pFirst)
+         pFirst = right->pUnavailable;
+   }
+   summary = result;
+   pUnavailable = pFirst;
+}
+
+size_t BlockArray::size() const
+{
+   return Count(mRoot);
+}
+
+sampleCount BlockArray::GetNumSamples() const
+{
+   return Samples(mRoot);
+}
+
+SeqBlock BlockArray::operator [] (size_t index) const
+{
+   wxASSERT(index < size());
+
+   sampleCount start = 0;
+   auto pNode = mRoot.get();
+   while (pNode) {
+      const auto leftCount = Count(pNode->left);
+      if (index < leftCount)
+         pNode = pNode->left.get();
+      else if (index == leftCount)
+         return { pNode->sb, start + Samples(pNode->left) };
+      else {
+         index -= leftCount + 1;
+         start += Samples(pNode->left) + pNode->length;
+         pNode = pNode->right.get();
+      }
+   }
+   return {};
+}
+
+size_t BlockArray::FindBlock(sampleCount pos) const
+{
+   wxASSERT(pos >= 0 && pos < GetNumSamples());
+
+   size_t index = 0;
+   auto pNode = mRoot.get();
+   while (pNode) {
+      const auto leftSamples = Samples(pNode->left);
+      if (pos < leftSamples)
+         pNode = pNode->left.get();
+      else {
+         const auto leftCount = Count(pNode->left);
+         pos -= leftSamples;
+         if (pos < pNode->length)
+            return index + leftCount;
+         pos -= pNode->length;
+         index += leftCount + 1;
+         pNode = pNode->right.get();
+      }
+   }
+
+   // Not found; the last block, as for the sample just past the end
+   return std::max<size_t>(1, size()) - 1;
+}
+
+BlockArray::const_iterator BlockArray::IteratorAt(size_t index) const
+{
+   return { mRoot.get(), std::min(index, size()) };
+}
+
+BlockArray::const_iterator::const_iterator(const Node *pNode, size_t index)
+   : mIndex{ index }
+{
+   sampleCount start = 0;
+   while (pNode) {
+      const auto leftCount = Count(pNode->left);
+      if (index < leftCount) {
+         mStack.push_back(pNode);
+         pNode = pNode->left.get();
+      }
+      else if (index == leftCount) {
+         start += Samples(pNode->left);
+         mStack.push_back(pNode);
+         break;
+      }
+      else {
+         index -= leftCount + 1;
+         start += Samples(pNode->left) + pNode->length;
+         pNode = pNode->right.get();
+      }
+   }
+   mCurrent.start = start;
+   if (!mStack.empty())
+      mCurrent.sb = mStack.back()->sb;
+}
+
+auto BlockArray::const_iterator::operator ++ () -> const_iterator &
+{
+   wxASSERT(!mStack.empty());
+
+   const auto pNode = mStack.back();
+   mStack.pop_back();
+   for (auto p = pNode->right.get(); p; p = p->left.get())
+      mStack.push_back(p);
+
+   ++mIndex;
+   mCurrent.start += pNode->length;
+   if (mStack.empty())
+      mCurrent.sb.reset();
+   else
+      mCurrent.sb = mStack.back()->sb;
+   return *this;
+}
+
+void BlockArray::push_back(const SampleBlockPtr &sb)
+{
+   Node data;
+   data.sb = sb;
+   data.length = sb ? sb->GetSampleCount() : 0;
+   mRoot = Join(mRoot, data, {});
+}
+
+void BlockArray::pop_back()
+{
+   wxASSERT(!empty());
+
+   NodePtr left, last;
+   Split(mRoot, size() - 1, left, last);
+   mRoot = std::move(left);
+}
+
+void BlockArray::Append(const BlockArray &blocks)
+{
+   mRoot = Merge(mRoot, blocks.mRoot);
+}
+
+BlockArray BlockArray::Slice(size_t b0, size_t b1) const
+{
+   wxASSERT(b0 <= b1 && b1 <= size());
+
+   NodePtr left, middle, right;
+   Split(mRoot, b1, middle, right);
+   Split(middle, b0, left, middle);
+   return BlockArray{ std::move(middle) };
+}
+
+void BlockArray::Replace(size_t b0, size_t b1, const BlockArray &blocks)
+{
+   wxASSERT(b0 <= b1 && b1 <= size());
+
+   NodePtr left, middle, right;
+   Split(mRoot, b1, middle, right);
+   Split(middle, b0, left, middle);
+   mRoot = Merge(Merge(left, blocks.mRoot), right);
+}
+
+auto BlockArray::Summarize(size_t b0, size_t b1) const -> Summary
+{
+   Summary summary;
+   b1 = std::min(b1, size());
+   if (b0 < b1)
+      Summarize(*mRoot, b0, b1, summary);
+   return summary;
+}
+
+void BlockArray::Summarize(
+   const Node &node, size_t b0, size_t b1, Summary &summary)
+{
+   // [b0, b1) is not empty and is relative to this subtree
+   if (b0 == 0 && b1 == node.blockCount) {
+      Complete(node);
+      summary.Add(node.summary);
+      return;
+   }
+
+   const auto leftCount = Count(node.left);
+   if (b0 < leftCount)
+      Summarize(*node.left, b0, std::min(b1, leftCount), summary);
+   if (b0 <= leftCount && leftCount < b1) {
+      if (!node.ownAvailable)
+         node.ownAvailable = SummarizeBlock(node.sb.get(), node.own);
+      if (node.ownAvailable)
+         summary.Add(node.own);
+   }
+   const auto rightStart = leftCount + 1;
+   if (b1 > rightStart)
+      Summarize(*node.right,
+         std::max(b0, rightStart) - rightStart, b1 - rightStart, summary);
+}
+
+void BlockArray::Complete(const Node &node)
+{
+   // Complete subtrees cost nothing; others are looked at again only
+   // while an on-demand import is copying blocks into the project
+   if (!node.pUnavailable)
+      return;
+
+   if (node.left)
+      Complete(*node.left);
+   if (!node.ownAvailable)
+      node.ownAvailable = SummarizeBlock(node.sb.get(), node.own);
+   if (node.right)
+      Complete(*node.right);
+   node.Combine();
+}
+
+auto BlockArray::Remake(
+   const Node &data, const NodePtr &left, const NodePtr &right) -> NodePtr
+{
+   auto pNode = std::make_shared<Node>();
+   pNode->sb = data.sb;
+   pNode->length = data.length;
+   pNode->own = data.own;
+   pNode->ownAvailable = data.ownAvailable ||
+      SummarizeBlock(data.sb.get(), pNode->own);
+   pNode->left = left;
+   pNode->right = right;
+   pNode->Update();
+   return pNode;
+}
+
+auto BlockArray::RotateLeft(
+   const Node &data, const NodePtr &left, const NodePtr &right) -> NodePtr
+{
+   return Remake(*right, Remake(data, left, right->left), right->right);
+}
+
+auto BlockArray::RotateRight(
+   const Node &data, const NodePtr &left, const NodePtr &right) -> NodePtr
+{
+   return Remake(*left, left->left, Remake(data, left->right, right));
+}
+
+auto BlockArray::Join(
+   const NodePtr &left, const Node &data, const NodePtr &right) -> NodePtr
+{
+   if (Height(left) > Height(right) + 1)
+      return JoinRight(left, data, right);
+   if (Height(right) > Height(left) + 1)
+      return JoinLeft(left, data, right);
+   return Remake(data, left, right);
+}
+
+auto BlockArray::JoinRight(
+   const NodePtr &left, const Node &data, const NodePtr &right) -> NodePtr
+{
+   // Descend the right spine of the taller tree to a subtree that the
+   // other can be joined to, then rotate on the way up where needed
+   const auto &l = left->left;
+   const auto &c = left->right;
+   if (Height(c) <= Height(right) + 1) {
+      auto t = Remake(data, c, right);
+      if (Height(t) <= Height(l) + 1)
+         return Remake(*left, l, t);
+      return RotateLeft(*left, l, RotateRight(*t, t->left, t->right));
+   }
+   auto t = JoinRight(c, data, right);
+   if (Height(t) <= Height(l) + 1)
+      return Remake(*left, l, t);
+   return RotateLeft(*left, l, t);
+}
+
+auto BlockArray::JoinLeft(
+   const NodePtr &left, const Node &data, const NodePtr &right) -> NodePtr
+{
+   // Mirror image of JoinRight
+   const auto &c = right->left;
+   const auto &r = right->right;
+   if (Height(c) <= Height(left) + 1) {
+      auto t = Remake(data, left, c);
+      if (Height(t) <= Height(r) + 1)
+         return Remake(*right, t, r);
+      return RotateRight(*right, RotateLeft(*t, t->left, t->right), r);
+   }
+   auto t = JoinLeft(left, data, c);
+   if (Height(t) <= Height(r) + 1)
+      return Remake(*right, t, r);
+   return RotateRight(*right, t, r);
+}
+
+auto BlockArray::Merge(const NodePtr &left, const NodePtr &right) -> NodePtr
+{
+   if (!left)
+      return right;
+   if (!right)
+      return left;
+
+   // Join needs a block between the trees; take the last of the left one
+   NodePtr rest, last;
+   Split(left, left->blockCount - 1, rest, last);
+   return Join(rest, *last, right);
+}
+
+void BlockArray::Split(
+   NodePtr node, size_t index, NodePtr &left, NodePtr &right)
+{
+   if (!node || index == 0) {
+      left.reset();
+      right = std::move(node);
+      return;
+   }
+   if (index >= node->blockCount) {
+      left = std::move(node);
+      right.reset();
+      return;
+   }
+
+   NodePtr rest;
+   const auto leftCount = Count(node->left);
+   if (index <= leftCount) {
+      Split(node->left, index, left, rest);
+      right = Join(rest, *node, node->right);
+   }
+   else {
+      Split(node->right, index - leftCount - 1, rest, right);
+      left = Join(node->left, *node, rest);
+   }
+}
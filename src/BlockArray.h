@@ -0,0 +1,184 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockArray.h
+
+*******************************************************************//**
+
+\file BlockArray.h
+\brief The sample blocks of a Sequence, in a balanced tree, so that edits
+anywhere cost time logarithmic in the number of blocks.
+
+  The tree is ordered by position in the sequence and kept balanced by
+  height.  Each node stores the number of blocks and samples in its
+  subtree, so the start of a block is not stored but summed on the way
+  down; nothing after an edit is shifted, and blocks can't be out of
+  place.  Each node also summarizes its subtree for min, max, and RMS
+  queries and drawing.
+
+  Nodes are immutable, except for completing summaries, and shared: an
+  edit copies only the nodes on the paths to the blocks it changes, and a
+  copy of a whole BlockArray is cheap.  So edits can build a new array
+  and swap it in, to give a strong guarantee, without copying all the
+  blocks.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_ARRAY__
+#define __AUDACITY_BLOCK_ARRAY__
+
+#include <float.h>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "audacity/Types.h"
+
+class SampleBlock;
+
+// This is an internal data structure!  For advanced use only.
+class SeqBlock {
+ public:
+   using SampleBlockPtr = std::shared_ptr<SampleBlock>;
+   SampleBlockPtr sb;
+   ///the sample in the global wavetrack that this block starts at.
+   sampleCount start;
+
+   SeqBlock()
+      : sb{}, start(0)
+   {}
+
+   SeqBlock(const SampleBlockPtr &sb_, sampleCount start_)
+      : sb(sb_), start(start_)
+   {}
+};
+using BlockPtrArray = std::vector<SeqBlock*>; // non-owning pointers
+
+class BlockArray
+{
+   struct Node;
+   using NodePtr = std::shared_ptr<const Node>;
+
+public:
+   using SampleBlockPtr = SeqBlock::SampleBlockPtr;
+
+   //! Min, max, and sum of squares of a run of whole blocks.  Blocks whose
+   //! summaries are not yet available are left out, so that the count falls
+   //! short of the length of the run.
+   struct Summary {
+      float min = FLT_MAX;
+      float max = -FLT_MAX;
+      double sumsq = 0;
+      sampleCount count = 0;
+
+      void Add(const Summary &other);
+   };
+
+   //! Visits blocks in order, with their starts
+   class const_iterator
+   {
+   public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = SeqBlock;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const SeqBlock *;
+      using reference = const SeqBlock &;
+
+      const_iterator() = default;
+
+      reference operator * () const { return mCurrent; }
+      pointer operator -> () const { return &mCurrent; }
+      const_iterator &operator ++ ();
+      const_iterator operator ++ (int)
+      { auto result = *this; ++*this; return result; }
+
+      //! Position of the block in the array
+      size_t Index() const { return mIndex; }
+
+      friend bool operator == (
+         const const_iterator &a, const const_iterator &b)
+      { return a.mIndex == b.mIndex; }
+      friend bool operator != (
+         const const_iterator &a, const const_iterator &b)
+      { return !(a == b); }
+
+   private:
+      friend BlockArray;
+      const_iterator(const Node *pRoot, size_t index);
+
+      // The current node, then ancestors still to be visited
+      std::vector<const Node *> mStack;
+      SeqBlock mCurrent;
+      size_t mIndex{ 0 };
+   };
+
+   BlockArray() = default;
+
+   size_t size() const;
+   bool empty() const { return !mRoot; }
+   sampleCount GetNumSamples() const;
+
+   //! The block and its start, found in logarithmic time
+   SeqBlock operator [] (size_t index) const;
+   SeqBlock front() const { return (*this)[0]; }
+   SeqBlock back() const { return (*this)[size() - 1]; }
+
+   //! Index of the block containing the sample, in logarithmic time
+   /*! @pre 0 <= pos < GetNumSamples() */
+   size_t FindBlock(sampleCount pos) const;
+
+   const_iterator begin() const { return IteratorAt(0); }
+   const_iterator end() const { return IteratorAt(size()); }
+   //! In logarithmic time
+   const_iterator IteratorAt(size_t index) const;
+
+   // Editing.  Each makes only a logarithmic number of new nodes, and
+   // gives a strong guarantee.
+
+   void push_back(const SampleBlockPtr &sb);
+   void pop_back();
+   void Append(const BlockArray &blocks);
+   //! Blocks [b0, b1)
+   BlockArray Slice(size_t b0, size_t b1) const;
+   //! Replace blocks [b0, b1) with the given ones
+   void Replace(size_t b0, size_t b1, const BlockArray &blocks);
+   void clear() { mRoot.reset(); }
+   void swap(BlockArray &other) { mRoot.swap(other.mRoot); }
+
+   //! Summary of blocks [b0, b1), in logarithmic time
+   /*! Summaries left out for want of availability are looked for again,
+    because an on-demand import copies blocks into the project in the
+    background.  That completes the summaries of shared nodes, so, like
+    drawing, this is for the main thread. */
+   Summary Summarize(size_t b0, size_t b1) const;
+
+private:
+   explicit BlockArray(NodePtr root) : mRoot{ std::move(root) } {}
+
+   //! A new node with the block of data and the given children
+   static NodePtr Remake(const Node &data,
+      const NodePtr &left, const NodePtr &right);
+   static NodePtr RotateLeft(const Node &data,
+      const NodePtr &left, const NodePtr &right);
+   static NodePtr RotateRight(const Node &data,
+      const NodePtr &left, const NodePtr &right);
+   //! The blocks of left, then that of data, then those of right, balanced
+   static NodePtr Join(const NodePtr &left, const Node &data,
+      const NodePtr &right);
+   static NodePtr JoinRight(const NodePtr &left, const Node &data,
+      const NodePtr &right);
+   static NodePtr JoinLeft(const NodePtr &left, const Node &data,
+      const NodePtr &right);
+   static NodePtr Merge(const NodePtr &left, const NodePtr &right);
+   //! The first index blocks go left, the rest right
+   static void Split(NodePtr node, size_t index,
+      NodePtr &left, NodePtr &right);
+   static void Complete(const Node &node);
+   static void Summarize(const Node &node, size_t b0, size_t b1,
+      Summary &summary);
+
+   NodePtr mRoot;
+};
+
+#endif
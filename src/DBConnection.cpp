@@ -12,10 +12,14 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include "sqlite3.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <wx/progdlg.h>
 #include <wx/string.h>
 
 #include "Internat.h"
+#include "Prefs.h"
 #include "Project.h"
 
 // Configuration to provide "safe" connections
@@ -31,6 +35,13 @@ static const char *FastConfig =
    "PRAGMA <schema>.synchronous = OFF;"
    "PRAGMA <schema>.journal_mode = OFF;";
 
+// Configuration of both, for a workload of mostly large blobs.  Mapping the
+// file lets SQLite read pages without copying them from the operating
+// system's cache into its own.  The page cache is in KiB when negative.
+static const char *StorageConfig =
+   "PRAGMA <schema>.mmap_size = %lld;"
+   "PRAGMA <schema>.cache_size = -%lld;";
+
 DBConnection::DBConnection(const std::weak_ptr<AudacityProject> &pProject)
 :  mpProject{ pProject }
 {
@@ -67,6 +78,12 @@ bool DBConnection::Open(const char *fileName)
       return false;
    }
 
+   // A new database must have its page size before WAL mode fixes it;
+   // for others this does nothing
+   sqlite3_exec(mDB,
+      wxString::Format("PRAGMA main.page_size = %d;", PageSize()),
+      nullptr, nullptr, nullptr);
+
    // Set default mode
    // (See comments in ProjectFileIO::SaveProject() about threading
    SafeMode();
@@ -80,6 +97,13 @@ bool DBConnection::Open(const char *fileName)
    // Install our checkpoint hook
    sqlite3_wal_hook(mDB, CheckpointHook, this);
 
+   // Time the statements, logging those slower than the preference says
+   mStatistics.Reset();
+   mStatistics.SetSlowThreshold(std::chrono::milliseconds{ std::max(0L,
+      gPrefs->Read(wxT("/Performance/SlowStorageMilliseconds"), 0L)) });
+   sqlite3_trace_v2(mDB, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE,
+      TraceCallback, this);
+
    return mDB;
 }
 
@@ -97,6 +121,7 @@ bool DBConnection::Close()
    // Uninstall our checkpoint hook so that no additional checkpoints
    // are sent our way.  (Though this shouldn't really happen.)
    sqlite3_wal_hook(mDB, nullptr, nullptr);
+   sqlite3_trace_v2(mDB, 0, nullptr, nullptr);
 
    // Display a progress dialog if there's active or pending checkpoints
    if (mCheckpointPending || mCheckpointActive)
@@ -136,11 +161,15 @@ bool DBConnection::Close()
    mCheckpointThread.join();
 
    // We're done with the prepared statements
-   for (auto stmt : mStatements)
    {
-      sqlite3_finalize(stmt.second);
+      std::lock_guard<std::mutex> guard(mStatementsMutex);
+      for (auto stmt : mStatements)
+      {
+         sqlite3_finalize(stmt.second);
+      }
+      mStatements.clear();
+      mStatementIDs.clear();
    }
-   mStatements.clear();
 
    // Close the DB
    rc = sqlite3_close(mDB);
@@ -159,11 +188,13 @@ bool DBConnection::Close()
 
 bool DBConnection::SafeMode(const char *schema /* = "main" */)
 {
+   TuneStorage(mDB, schema);
    return ModeConfig(mDB, schema, SafeConfig);
 }
 
 bool DBConnection::FastMode(const char *schema /* = "main" */)
 {
+   TuneStorage(mDB, schema);
    return ModeConfig(mDB, schema, FastConfig);
 }
 
@@ -182,6 +213,53 @@ bool DBConnection::ModeConfig(sqlite3 *db, const char *schema, const char *confi
    return rc != SQLITE_OK;
 }
 
+int DBConnection::PageSize()
+{
+   // SQLite takes powers of two from 512 to 65536 bytes.  Bigger pages make
+   // shorter overflow chains, but each write of a small row writes a whole
+   // page to the log; 16 KiB reads blobs fastest in Benchmark.cpp
+   const auto kb = gPrefs->Read(wxT("/Performance/StoragePageSizeKB"), 16L);
+   int size = 512;
+   while (size < 65536 && size < kb * 1024)
+      size *= 2;
+   return size;
+}
+
+bool DBConnection::TuneStorage(sqlite3 *db, const char *schema)
+{
+   // Size the page cache to the database, so that small projects don't
+   // hold memory they never use, and large ones keep more of the interior
+   // pages of the tables; mapped reads don't need the cache for blobs
+   sqlite3_int64 pages = 0, pageSize = 0;
+   for (auto pair : { std::make_pair("page_count", &pages),
+                      std::make_pair("page_size", &pageSize) })
+   {
+      sqlite3_stmt *stmt = nullptr;
+      const auto sql =
+         wxString::Format("PRAGMA %s.%s;", schema, pair.first);
+      if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK &&
+          sqlite3_step(stmt) == SQLITE_ROW)
+         *pair.second = sqlite3_column_int64(stmt, 0);
+      sqlite3_finalize(stmt);
+   }
+
+   const sqlite3_int64 minCache = 2 * 1024 * 1024;
+   const sqlite3_int64 maxCache = std::max(minCache, 1024 * 1024 *
+      (sqlite3_int64) gPrefs->Read(wxT("/Performance/StorageCacheMB"), 64L));
+   const auto cache =
+      std::min(maxCache, std::max(minCache, pages * pageSize / 16));
+
+   // Zero turns mapping off, for file systems where it misbehaves
+   const sqlite3_int64 mmap = 1024 * 1024 * (sqlite3_int64) std::max(0L,
+      gPrefs->Read(wxT("/Performance/StorageMmapMB"), 1024L));
+
+   wxString sql;
+   sql.Printf(StorageConfig, (long long) mmap, (long long) (cache / 1024));
+   sql.Replace(wxT("<schema>"), schema);
+
+   return sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
 sqlite3 *DBConnection::DB()
 {
    wxASSERT(mDB != nullptr);
@@ -203,8 +281,11 @@ sqlite3_stmt *DBConnection::Prepare(enum StatementID id, const char *sql)
 {
    int rc;
 
+   const StatementIndex ndx{ std::this_thread::get_id(), id };
+   std::lock_guard<std::mutex> guard(mStatementsMutex);
+
    // Return an existing statement if it's already been prepared
-   auto iter = mStatements.find(id);
+   auto iter = mStatements.find(ndx);
    if (iter != mStatements.end())
    {
       return iter->second;
@@ -220,7 +301,8 @@ sqlite3_stmt *DBConnection::Prepare(enum StatementID id, const char *sql)
    }
 
    // And remember it
-   mStatements.insert({id, stmt});
+   mStatements.insert({ndx, stmt});
+   mStatementIDs.insert({stmt, id});
 
    return stmt;
 }
@@ -228,7 +310,8 @@ sqlite3_stmt *DBConnection::Prepare(enum StatementID id, const char *sql)
 sqlite3_stmt *DBConnection::GetStatement(enum StatementID id)
 {
    // Look it up
-   auto iter = mStatements.find(id);
+   std::lock_guard<std::mutex> guard(mStatementsMutex);
+   auto iter = mStatements.find({ std::this_thread::get_id(), id });
 
    // It should always be there
    wxASSERT(iter != mStatements.end());
@@ -273,7 +356,11 @@ void DBConnection::CheckpointThread()
 
          // And kick off the checkpoint. This may not checkpoint ALL frames
          // in the WAL.  They'll be gotten the next time around.
-         sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+         int logFrames = 0, checkpointed = 0;
+         const auto start = DBStatistics::Clock::now();
+         sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, &logFrames, &checkpointed);
+         mStatistics.AddCheckpoint(
+            DBStatistics::Clock::now() - start, logFrames, checkpointed);
 
          // Reset
          mCheckpointActive = false;
@@ -291,6 +378,8 @@ int DBConnection::CheckpointHook(void *data, sqlite3 *db, const char *schema, in
    // Get access to our object
    DBConnection *that = static_cast<DBConnection *>(data);
 
+   that->mStatistics.SetWalFrames(pages);
+
    // Queue the database pointer for our checkpoint thread to process
    std::lock_guard<std::mutex> guard(that->mCheckpointMutex);
    that->mCheckpointPending = true;
@@ -299,6 +388,104 @@ int DBConnection::CheckpointHook(void *data, sqlite3 *db, const char *schema, in
    return SQLITE_OK;
 }
 
+void DBConnection::CountBytes(sqlite3_stmt *stmt,
+   unsigned long long read, unsigned long long written)
+{
+   mStatistics.AddBytes(StatementName(stmt), read, written);
+}
+
+DBStatistics::Snapshot DBConnection::GetStatistics() const
+{
+   auto snapshot = mStatistics.GetSnapshot();
+
+   // Counts of the page cache of this connection, not reset
+   int current = 0, highwater = 0;
+   sqlite3_db_status(mDB, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 0);
+   snapshot.cacheHits = current;
+   sqlite3_db_status(mDB, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 0);
+   snapshot.cacheMisses = current;
+   sqlite3_db_status(mDB, SQLITE_DBSTATUS_CACHE_WRITE, &current, &highwater, 0);
+   snapshot.cacheWrites = current;
+
+   sqlite3_exec(mDB, "PRAGMA main.page_size;",
+      [](void *data, int cols, char **vals, char **) -> int
+      {
+         if (cols > 0 && vals[0])
+            *static_cast<int *>(data) = atoi(vals[0]);
+         return SQLITE_OK;
+      },
+      &snapshot.pageSize, nullptr);
+
+   return snapshot;
+}
+
+void DBConnection::ResetStatistics()
+{
+   mStatistics.Reset();
+}
+
+wxString DBConnection::StatementName(sqlite3_stmt *stmt)
+{
+   enum StatementID id;
+   {
+      std::lock_guard<std::mutex> guard(mStatementsMutex);
+      auto iter = mStatementIDs.find(stmt);
+      if (iter == mStatementIDs.end())
+         // Not prepared by us, as in sqlite3_exec()
+         return wxT("Other");
+      id = iter->second;
+   }
+
+   switch (id)
+   {
+   case GetSamples: return wxT("GetSamples");
+   case GetSummary256: return wxT("GetSummary256");
+   case GetSummary64k: return wxT("GetSummary64k");
+   case LoadSampleBlock: return wxT("LoadSampleBlock");
+   case InsertSampleBlock: return wxT("InsertSampleBlock");
+   case DeleteSampleBlock: return wxT("DeleteSampleBlock");
+   case GetRootPage: return wxT("GetRootPage");
+   case GetDBPage: return wxT("GetDBPage");
+   case GetSpectrumTile: return wxT("GetSpectrumTile");
+   case TouchSpectrumTile: return wxT("TouchSpectrumTile");
+   case PutSpectrumTile: return wxT("PutSpectrumTile");
+   case GetSpectrumTileUsage: return wxT("GetSpectrumTileUsage");
+   case EvictSpectrumTiles: return wxT("EvictSpectrumTiles");
+   default: return wxT("Other");
+   }
+}
+
+int DBConnection::TraceCallback(unsigned type, void *data, void *p, void *)
+{
+   // SQLite's own profile times have the resolution of its clock, which may
+   // be a millisecond, so time the statements here: from their first step
+   // to their completion or reset, on the thread that runs them
+   using Start = std::pair<sqlite3_stmt *, DBStatistics::Clock::time_point>;
+   static thread_local std::vector<Start> starts;
+
+   const auto stmt = static_cast<sqlite3_stmt *>(p);
+   auto iter = std::find_if(starts.begin(), starts.end(),
+      [stmt](const Start &start){ return start.first == stmt; });
+
+   if (type == SQLITE_TRACE_STMT) {
+      // A statement finalized while tracing was off may have left its
+      // start, and another may have its address now; start again
+      if (iter == starts.end())
+         starts.emplace_back(stmt, DBStatistics::Clock::now());
+      else
+         iter->second = DBStatistics::Clock::now();
+   }
+   else if (type == SQLITE_TRACE_PROFILE && iter != starts.end()) {
+      const auto duration = DBStatistics::Clock::now() - iter->second;
+      starts.erase(iter);
+      auto that = static_cast<DBConnection *>(data);
+      that->mStatistics.AddStatement(
+         that->StatementName(stmt), duration, sqlite3_sql(stmt));
+   }
+
+   return 0;
+}
+
 ConnectionPtr::~ConnectionPtr()
 {
    wxASSERT_MSG(!mpConnection, wxT("Project file was not closed at shutdown"));
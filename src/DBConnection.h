@@ -17,8 +17,10 @@ Paul Licameli -- split from ProjectFileIO.h
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <utility>
 
 #include "ClientData.h"
+#include "DBStatistics.h"
 
 struct sqlite3;
 struct sqlite3_stmt;
@@ -38,6 +40,12 @@ public:
    bool SafeMode(const char *schema = "main");
    bool FastMode(const char *schema = "main");
 
+   //! Page size in bytes for new project databases, from preferences
+   /*! Blobs of samples span many pages, which SQLite reads as a chain of
+    overflow pages; bigger pages make shorter chains.  The size is fixed
+    when the first table is created, or when WAL mode is entered. */
+   static int PageSize();
+
    bool Assign(sqlite3 *handle);
    sqlite3 *Detach();
 
@@ -55,20 +63,37 @@ public:
       InsertSampleBlock,
       DeleteSampleBlock,
       GetRootPage,
-      GetDBPage
+      GetDBPage,
+      GetSpectrumTile,
+      TouchSpectrumTile,
+      PutSpectrumTile,
+      GetSpectrumTileUsage,
+      EvictSpectrumTiles
    };
    sqlite3_stmt *GetStatement(enum StatementID id);
    sqlite3_stmt *Prepare(enum StatementID id, const char *sql);
 
+   //! Count the bytes of blobs a prepared statement read or wrote
+   void CountBytes(sqlite3_stmt *stmt,
+      unsigned long long read, unsigned long long written);
+
+   //! Statements, checkpoints and page cache since the connection opened
+   DBStatistics::Snapshot GetStatistics() const;
+   void ResetStatistics();
+
    void SetBypass( bool bypass );
    bool ShouldBypass();
 
 private:
    bool ModeConfig(sqlite3 *db, const char *schema, const char *config);
+   static bool TuneStorage(sqlite3 *db, const char *schema);
 
    void CheckpointThread();
    static int CheckpointHook(void *data, sqlite3 *db, const char *schema, int pages);
 
+   static int TraceCallback(unsigned type, void *data, void *p, void *x);
+   wxString StatementName(sqlite3_stmt *stmt);
+
 private:
    std::weak_ptr<AudacityProject> mpProject;
    sqlite3 *mDB;
@@ -80,7 +105,16 @@ private:
    std::atomic_bool mCheckpointPending{ false };
    std::atomic_bool mCheckpointActive{ false };
 
-   std::map<enum StatementID, sqlite3_stmt *> mStatements;
+   // Each thread gets its own prepared statements, so that worker threads
+   // may read sample blocks while the main thread uses the connection;
+   // SQLite serializes the uses of the connection itself
+   using StatementIndex = std::pair<std::thread::id, enum StatementID>;
+   std::map<StatementIndex, sqlite3_stmt *> mStatements;
+   // And the reverse, to name statements in the statistics
+   std::map<sqlite3_stmt *, enum StatementID> mStatementIDs;
+   std::mutex mStatementsMutex;
+
+   DBStatistics mStatistics;
 
    // Bypass transactions if database will be deleted after close
    bool mBypass;
@@ -0,0 +1,180 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DBStatistics.cpp
+
+*******************************************************************//**
+
+\class DBStatistics
+\brief Counts, latencies and bytes of the statements a DBConnection runs,
+and the sizes and durations of its WAL checkpoints.
+
+*//*******************************************************************/
+
+#include "DBStatistics.h"
+
+#include <algorithm>
+
+#include <wx/log.h>
+
+namespace {
+
+unsigned long long Microseconds(DBStatistics::Clock::duration duration)
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+double Milliseconds(DBStatistics::Clock::duration duration)
+{
+   return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}
+
+void DBStatistics::Latency::Add(Clock::duration duration)
+{
+   auto microseconds = Microseconds(duration);
+   ++count;
+   totalMicroseconds += microseconds;
+   maxMicroseconds = std::max(maxMicroseconds, microseconds);
+
+   size_t bucket = 0;
+   while (microseconds > 0 && bucket < LatencyBuckets - 1) {
+      microseconds >>= 1;
+      ++bucket;
+   }
+   ++buckets[bucket];
+}
+
+double DBStatistics::Latency::GetMeanMicroseconds() const
+{
+   return count > 0 ? (double)totalMicroseconds / count : 0.0;
+}
+
+unsigned long long DBStatistics::Latency::UpperBound(size_t bucket)
+{
+   return bucket < LatencyBuckets - 1 ? 1ull << bucket : 0;
+}
+
+void DBStatistics::SetSlowThreshold(Clock::duration threshold)
+{
+   std::lock_guard<std::mutex> guard(mMutex);
+   mSlowThreshold = threshold;
+}
+
+void DBStatistics::AddStatement(
+   const wxString &name, Clock::duration duration, const char *sql)
+{
+   std::lock_guard<std::mutex> guard(mMutex);
+   mStatements[name].latency.Add(duration);
+   if (mSlowThreshold > Clock::duration::zero() && duration >= mSlowThreshold)
+      AddSlow(
+         wxString::Format(wxT("%s: %s"), name, wxString::FromUTF8(sql)),
+         duration);
+}
+
+void DBStatistics::AddBytes(const wxString &name,
+   unsigned long long read, unsigned long long written)
+{
+   std::lock_guard<std::mutex> guard(mMutex);
+   auto &statement = mStatements[name];
+   statement.bytesRead += read;
+   statement.bytesWritten += written;
+}
+
+void DBStatistics::SetWalFrames(int frames)
+{
+   std::lock_guard<std::mutex> guard(mMutex);
+   mCheckpoints.walFrames = std::max(0, frames);
+   mCheckpoints.maxWalFrames =
+      std::max(mCheckpoints.maxWalFrames, mCheckpoints.walFrames);
+}
+
+void DBStatistics::AddCheckpoint(
+   Clock::duration duration, int logFrames, int checkpointed)
+{
+   std::lock_guard<std::mutex> guard(mMutex);
+   mCheckpoints.latency.Add(duration);
+   mCheckpoints.framesCheckpointed += std::max(0, checkpointed);
+   if (mSlowThreshold > Clock::duration::zero() && duration >= mSlowThreshold)
+      AddSlow(wxString::Format(
+         wxT("Checkpoint of %d of %d frames"), checkpointed, logFrames),
+         duration);
+}
+
+void DBStatistics::AddSlow(const wxString &what, Clock::duration duration)
+{
+   // Called with the mutex locked
+   const auto milliseconds = Milliseconds(duration);
+   mSlowOperations.push_back({ wxDateTime::Now(), what, milliseconds });
+   if (mSlowOperations.size() > MaxSlowOperations)
+      mSlowOperations.pop_front();
+
+   // wxWidgets queues messages logged by worker threads for the main thread
+   wxLogMessage(wxT("Slow storage operation, %.1f ms: %s"),
+      milliseconds, what);
+}
+
+auto DBStatistics::GetSnapshot() const -> Snapshot
+{
+   Snapshot snapshot;
+   std::lock_guard<std::mutex> guard(mMutex);
+   snapshot.statements = mStatements;
+   snapshot.checkpoints = mCheckpoints;
+   snapshot.slowOperations.assign(
+      mSlowOperations.begin(), mSlowOperations.end());
+   return snapshot;
+}
+
+void DBStatistics::Reset()
+{
+   std::lock_guard<std::mutex> guard(mMutex);
+   mStatements.clear();
+   mCheckpoints = {};
+   mSlowOperations.clear();
+}
+
+wxString DBStatistics::Snapshot::Format() const
+{
+   wxString result;
+
+   result += wxT("Statements (count, mean us, max us, bytes read, written)\n");
+   for (const auto &pair : statements) {
+      const auto &statement = pair.second;
+      result += wxString::Format(
+         wxT("  %-22s %10llu %10.1f %10llu %12llu %12llu\n"),
+         pair.first,
+         statement.latency.count,
+         statement.latency.GetMeanMicroseconds(),
+         statement.latency.maxMicroseconds,
+         statement.bytesRead,
+         statement.bytesWritten);
+   }
+
+   result += wxT("\nPage cache\n");
+   result += wxString::Format(wxT("  Page size %d, hits %llu, misses %llu,")
+      wxT(" writes %llu\n"),
+      pageSize, cacheHits, cacheMisses, cacheWrites);
+
+   const auto &latency = checkpoints.latency;
+   result += wxT("\nCheckpoints\n");
+   result += wxString::Format(wxT("  Count %llu, mean %.1f us, max %llu us\n"),
+      latency.count, latency.GetMeanMicroseconds(), latency.maxMicroseconds);
+   result += wxString::Format(
+      wxT("  Frames checkpointed %llu; in the log %llu, at most %llu\n"),
+      checkpoints.framesCheckpointed,
+      checkpoints.walFrames, checkpoints.maxWalFrames);
+
+   if (!slowOperations.empty()) {
+      result += wxT("\nSlow operations\n");
+      for (const auto &operation : slowOperations)
+         result += wxString::Format(wxT("  %s %8.1f ms  %s\n"),
+            operation.when.FormatISOTime(),
+            operation.milliseconds,
+            operation.what);
+   }
+
+   return result;
+}
@@ -0,0 +1,124 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DBStatistics.h
+
+*******************************************************************//**
+
+\file DBStatistics.h
+\brief Counts, latencies and bytes of the statements a DBConnection runs,
+and the sizes and durations of its WAL checkpoints.
+
+  They are for tuning block size and page cache against real disks: which
+  statements are slow, how much data they move, how much of it the page
+  cache saves, and how big the write-ahead log gets between checkpoints.
+
+  Any thread may add or read; a mutex guards the counts, which costs little
+  next to running a statement.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_DB_STATISTICS__
+#define __AUDACITY_DB_STATISTICS__
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <wx/datetime.h>
+#include <wx/string.h>
+
+class DBStatistics
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   //! Latencies in buckets of [0, 1) microseconds, then doubling up to
+   //! 2^(LatencyBuckets - 2), then the rest
+   static constexpr size_t LatencyBuckets = 24;
+   //! Slow operations remembered, the oldest forgotten first
+   static constexpr size_t MaxSlowOperations = 50;
+
+   struct Latency {
+      unsigned long long count{ 0 };
+      unsigned long long totalMicroseconds{ 0 };
+      unsigned long long maxMicroseconds{ 0 };
+      std::array<unsigned long long, LatencyBuckets> buckets{};
+
+      void Add(Clock::duration duration);
+      double GetMeanMicroseconds() const;
+      //! Upper bound of a bucket in microseconds, or 0 for the last
+      static unsigned long long UpperBound(size_t bucket);
+   };
+
+   struct Statement {
+      Latency latency;
+      //! Of blobs that the callers read and wrote; not of pages
+      unsigned long long bytesRead{ 0 };
+      unsigned long long bytesWritten{ 0 };
+   };
+
+   struct Checkpoints {
+      Latency latency;
+      //! Frames written back to the database by all checkpoints
+      unsigned long long framesCheckpointed{ 0 };
+      //! Frames in the log after the last commit, and at most
+      unsigned long long walFrames{ 0 };
+      unsigned long long maxWalFrames{ 0 };
+   };
+
+   struct SlowOperation {
+      wxDateTime when;
+      wxString what;
+      double milliseconds;
+   };
+
+   //! Counts at one moment, copied so they may be read at leisure
+   struct Snapshot {
+      //! By name of prepared statement, or "Other" for the rest
+      std::map<wxString, Statement> statements;
+      Checkpoints checkpoints;
+      std::vector<SlowOperation> slowOperations;
+
+      //! Page cache of the connection, from SQLite
+      int pageSize{ 0 };
+      unsigned long long cacheHits{ 0 };
+      unsigned long long cacheMisses{ 0 };
+      unsigned long long cacheWrites{ 0 };
+
+      //! Readable summary, for the Diagnostics menu
+      wxString Format() const;
+   };
+
+   //! Operations slower than this are logged and remembered; zero for none
+   void SetSlowThreshold(Clock::duration threshold);
+
+   //! A statement ran to completion or was reset; sql describes it if slow
+   void AddStatement(
+      const wxString &name, Clock::duration duration, const char *sql);
+   void AddBytes(const wxString &name,
+      unsigned long long read, unsigned long long written);
+
+   //! From the WAL hook, the frames in the log after a commit
+   void SetWalFrames(int frames);
+   void AddCheckpoint(
+      Clock::duration duration, int logFrames, int checkpointed);
+
+   Snapshot GetSnapshot() const;
+   void Reset();
+
+private:
+   void AddSlow(const wxString &what, Clock::duration duration);
+
+   mutable std::mutex mMutex;
+   std::map<wxString, Statement> mStatements;
+   Checkpoints mCheckpoints;
+   std::deque<SlowOperation> mSlowOperations;
+   Clock::duration mSlowThreshold{ 0 };
+};
+
+#endif
@@ -32,6 +32,12 @@ state. Call Dither::Apply() to apply the dither. You can call
 Reset() between subsequent dithers to reset the dither state
 and get deterministic behaviour.
 
+  Samples that are not interleaved are converted with vector
+  instructions, where available, except for noise-shaped dithering,
+  whose error feedback goes sample by sample.  The noise comes from a
+  xorshift generator of each instance rather than from rand(), so that
+  instances in different threads share nothing.
+
 *//*******************************************************************/
 
 
@@ -45,6 +51,8 @@ and get deterministic behaviour.
 // (Note: this file should be included first)
 #include "float_cast.h"
 
+#include <algorithm>
+#include <atomic>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -54,6 +62,12 @@ and get deterministic behaviour.
 
 #include <wx/defs.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DITHER_SSE2
+#include <emmintrin.h>
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 
 // Constants for the noise shaping buffer
@@ -64,7 +78,7 @@ const int Dither::BUF_SIZE = 8;
 const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 
 // This is supposed to produce white noise and no dc
-#define DITHER_NOISE (rand() / (float)RAND_MAX - 0.5f)
+#define DITHER_NOISE Noise()
 
 // The following is a rather ugly, but fast implementation
 // of a dither loop. The macro "DITHER" is expanded to an implementation
@@ -207,8 +221,206 @@ const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
     } while (0)
 
 
+//////////////////////////////////////////////////////////////////////////
+
+// Conversions of samples that are not interleaved.  These give the same
+// results as the macros above, except for the noise, which is four
+// independent sequences when vectorized.
+
+namespace {
+
+std::uint32_t NextNoiseBits(std::uint32_t &state)
+{
+    // Marsaglia's xorshift; the state is never zero
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Make a float in [1, 2) from the high bits, then move it to [-0.5, 0.5)
+float NoiseFromBits(std::uint32_t bits)
+{
+    const std::uint32_t pattern = (bits >> 9) | 0x3f800000u;
+    float result;
+    memcpy(&result, &pattern, sizeof(result));
+    return result - 1.5f;
+}
+
+#ifdef DITHER_SSE2
+
+__m128 NextNoise(__m128i &state)
+{
+    state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+    state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+    state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+    const __m128i pattern =
+        _mm_or_si128(_mm_srli_epi32(state, 9), _mm_set1_epi32(0x3f800000));
+    return _mm_sub_ps(_mm_castsi128_ps(pattern), _mm_set1_ps(1.5f));
+}
+
+// Rounded samples are already within the bounds; packing saturates anyway
+void StoreFour(short *dest, __m128i samples)
+{
+    _mm_storel_epi64(
+        reinterpret_cast<__m128i*>(dest), _mm_packs_epi32(samples, samples));
+}
+
+void StoreFour(int *dest, __m128i samples)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), samples);
+}
+
+#endif
+
+void Int16ToFloat(const short *source, float *dest, size_t len)
+{
+    size_t ii = 0;
+#ifdef DITHER_SSE2
+    // Multiplying by a power of two is exact, as is the division
+    const __m128 scale = _mm_set1_ps(1.0f / CONVERT_DIV16);
+    for (; ii + 8 <= len; ii += 8) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + ii));
+        // Sign-extend by unpacking into the high halves and shifting back
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dest + ii, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dest + ii + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; ii < len; ++ii)
+        dest[ii] = source[ii] / CONVERT_DIV16;
+}
+
+void Int24ToFloat(const int *source, float *dest, size_t len)
+{
+    size_t ii = 0;
+#ifdef DITHER_SSE2
+    const __m128 scale = _mm_set1_ps(1.0f / CONVERT_DIV24);
+    for (; ii + 4 <= len; ii += 4) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + ii));
+        _mm_storeu_ps(dest + ii, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+    for (; ii < len; ++ii)
+        dest[ii] = source[ii] / CONVERT_DIV24;
+}
+
+void Int16ToInt24(const short *source, int *dest, size_t len)
+{
+    // Simple enough for the compiler to vectorize
+    for (size_t ii = 0; ii < len; ++ii)
+        dest[ii] = ((int)source[ii]) << 8;
+}
+
+// Clip, promote, dither, round and store, as DITHER_LOOP does
+template< DitherType Type, typename Int >
+void DitherFloatToInt(const float *source, Int *dest, size_t len,
+                      float scale, int minBound, int maxBound,
+                      std::uint32_t &noiseState, float &triangleState)
+{
+    size_t ii = 0;
+#ifdef DITHER_SSE2
+    if (len >= 4) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 minusOne = _mm_set1_ps(-1.0f);
+        const __m128 vscale = _mm_set1_ps(scale);
+        const __m128 lower = _mm_set1_ps(float(minBound));
+        const __m128 upper = _mm_set1_ps(float(maxBound));
+
+        __m128i state = _mm_setzero_si128();
+        if (Type != DitherType::none) {
+            const auto n0 = NextNoiseBits(noiseState);
+            const auto n1 = NextNoiseBits(noiseState);
+            const auto n2 = NextNoiseBits(noiseState);
+            const auto n3 = NextNoiseBits(noiseState);
+            state = _mm_setr_epi32(n0, n1, n2, n3);
+        }
+
+        for (; ii + 4 <= len; ii += 4) {
+            __m128 v = _mm_loadu_ps(source + ii);
+            // Zero any NaN, rather than leave it to the rounding, then
+            // clip as FROM_FLOAT does
+            v = _mm_and_ps(v, _mm_cmpord_ps(v, v));
+            v = _mm_min_ps(_mm_max_ps(v, minusOne), one);
+            v = _mm_mul_ps(v, vscale);
+
+            if (Type == DitherType::rectangle)
+                v = _mm_sub_ps(v, NextNoise(state));
+            else if (Type == DitherType::triangle) {
+                // Subtract the noise of each previous sample: the last of
+                // the previous four, then the first three of these
+                const __m128 r = NextNoise(state);
+                const __m128 shifted =
+                    _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(r), 4));
+                const __m128 previous =
+                    _mm_move_ss(shifted, _mm_set_ss(triangleState));
+                v = _mm_add_ps(v, _mm_sub_ps(r, previous));
+                triangleState =
+                    _mm_cvtss_f32(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+
+            // Clipping before rounding gives the same as after
+            v = _mm_min_ps(_mm_max_ps(v, lower), upper);
+            StoreFour(dest + ii, _mm_cvtps_epi32(v));
+        }
+
+        if (Type != DitherType::none)
+            noiseState = (std::uint32_t)_mm_cvtsi128_si32(state);
+    }
+#endif
+
+    for (; ii < len; ++ii) {
+        const float s = source[ii];
+        float sample = (s > 1.0f ? 1.0f : s < -1.0f ? -1.0f : s) * scale;
+        if (Type == DitherType::rectangle)
+            sample -= NoiseFromBits(NextNoiseBits(noiseState));
+        else if (Type == DitherType::triangle) {
+            const float r = NoiseFromBits(NextNoiseBits(noiseState));
+            sample += r - triangleState;
+            triangleState = r;
+        }
+        const int x = lrintf(sample);
+        dest[ii] = (Int)(x > maxBound ? maxBound : x < minBound ? minBound : x);
+    }
+}
+
+template< typename Int >
+void DitherFloatToInt(DitherType ditherType,
+                      const float *source, Int *dest, size_t len,
+                      float scale, int minBound, int maxBound,
+                      std::uint32_t &noiseState, float &triangleState)
+{
+    switch (ditherType)
+    {
+    case DitherType::none:
+        DitherFloatToInt<DitherType::none>(source, dest, len,
+            scale, minBound, maxBound, noiseState, triangleState);
+        break;
+    case DitherType::rectangle:
+        DitherFloatToInt<DitherType::rectangle>(source, dest, len,
+            scale, minBound, maxBound, noiseState, triangleState);
+        break;
+    case DitherType::triangle:
+        DitherFloatToInt<DitherType::triangle>(source, dest, len,
+            scale, minBound, maxBound, noiseState, triangleState);
+        break;
+    default:
+        wxASSERT(false);
+    }
+}
+
+}
+
 Dither::Dither()
 {
+    // Seed each instance differently, so that successive conversions
+    // don't repeat the same noise
+    static std::atomic<std::uint32_t> sSeed{ 0x2545F491u };
+    mNoiseState = sSeed.fetch_add(0x9E3779B9u) | 1u;
+
     // On startup, initialize dither by resetting values
     Reset();
 }
@@ -259,6 +471,10 @@ void Dither::Apply(enum DitherType ditherType,
     if (len == 0)
         return; // nothing to do
 
+    if (sourceStride == 1 && destStride == 1 && destFormat != sourceFormat &&
+        ApplyContiguous(ditherType, source, sourceFormat, dest, destFormat, len))
+        return;
+
     if (destFormat == sourceFormat)
     {
         // No need to dither, because source and destination
@@ -348,6 +564,66 @@ void Dither::Apply(enum DitherType ditherType,
     }
 }
 
+bool Dither::ApplyContiguous(DitherType ditherType,
+                             const samplePtr source, sampleFormat sourceFormat,
+                             samplePtr dest, sampleFormat destFormat,
+                             unsigned int len)
+{
+    if (destFormat == floatSample)
+    {
+        if (sourceFormat == int16Sample)
+            Int16ToFloat((const short*)source, (float*)dest, len);
+        else if (sourceFormat == int24Sample)
+            Int24ToFloat((const int*)source, (float*)dest, len);
+        else
+            return false;
+        return true;
+    }
+
+    if (destFormat == int24Sample && sourceFormat == int16Sample)
+    {
+        Int16ToInt24((const short*)source, (int*)dest, len);
+        return true;
+    }
+
+    if (ditherType == DitherType::shaped)
+        return false;
+
+    if (ditherType == DitherType::triangle)
+        Reset(); // reset dither filter for this NEW conversion
+
+    if (sourceFormat == floatSample && destFormat == int16Sample)
+        DitherFloatToInt(ditherType, (const float*)source, (short*)dest, len,
+            CONVERT_DIV16, -32768, 32767, mNoiseState, mTriangleState);
+    else if (sourceFormat == floatSample && destFormat == int24Sample)
+        DitherFloatToInt(ditherType, (const float*)source, (int*)dest, len,
+            CONVERT_DIV24, -8388608, 8388607, mNoiseState, mTriangleState);
+    else if (sourceFormat == int24Sample && destFormat == int16Sample)
+    {
+        // Go through float in pieces; the clipping does nothing to
+        // samples in range
+        enum : size_t { chunk = 256 };
+        float buffer[chunk];
+        auto s = (const int*)source;
+        auto d = (short*)dest;
+        for (size_t done = 0; done < len; done += chunk) {
+            const size_t count = std::min<size_t>(chunk, len - done);
+            Int24ToFloat(s + done, buffer, count);
+            DitherFloatToInt(ditherType, buffer, d + done, count,
+                CONVERT_DIV16, -32768, 32767, mNoiseState, mTriangleState);
+        }
+    }
+    else
+        return false;
+
+    return true;
+}
+
+float Dither::Noise()
+{
+    return NoiseFromBits(NextNoiseBits(mNoiseState));
+}
+
 // Dither implementations
 
 // No dither, just return sample
@@ -10,6 +10,8 @@
 #ifndef __AUDACITY_DITHER_H__
 #define __AUDACITY_DITHER_H__
 
+#include <cstdint>
+
 #include "audacity/Types.h" // for samplePtr
 
 template< typename Enum > class EnumSetting;
@@ -27,7 +29,7 @@ public:
 
     static EnumSetting< DitherType > FastSetting, BestSetting;
 
-    /// Default constructor
+    /// Default constructor.  Each instance makes different noise.
     Dither();
 
     /// Reset state of the dither.
@@ -45,6 +47,16 @@ public:
                unsigned int destStride = 1);
 
 private:
+    // Vectorized conversion of samples that are not interleaved.
+    // Returns false if this dither must use the general loops instead.
+    bool ApplyContiguous(DitherType ditherType,
+                         const samplePtr source, sampleFormat sourceFormat,
+                         samplePtr dest, sampleFormat destFormat,
+                         unsigned int len);
+
+    // White noise in [-0.5, 0.5)
+    float Noise();
+
     // Dither methods
     float NoDither(float sample);
     float RectangleDither(float sample);
@@ -60,6 +72,7 @@ private:
     int mPhase;
     float mTriangleState;
     float mBuffer[8 /* = BUF_SIZE */];
+    std::uint32_t mNoiseState;
 };
 
 #endif /* __AUDACITY_DITHER_H__ */
@@ -0,0 +1,76 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MappedFile.cpp
+
+**********************************************************************/
+
+#include "MappedFile.h"
+
+#include <limits>
+
+#include <wx/file.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+MappedFile::MappedFile(const FilePath &path)
+{
+   // wxFile opens names in any encoding; the mapping keeps the file open
+   // after the descriptor closes
+   wxFile file;
+   if (!file.Open(path))
+      return;
+
+   const auto length = file.Length();
+   if (length <= 0 ||
+       static_cast<unsigned long long>(length) >
+          std::numeric_limits<size_t>::max())
+      return;
+
+#ifdef _WIN32
+   const auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(file.fd()));
+   mMapping = CreateFileMapping(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+   if (!mMapping)
+      return;
+   const auto data = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+   if (!data) {
+      CloseHandle(mMapping);
+      mMapping = nullptr;
+      return;
+   }
+#else
+   const auto data =
+      mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file.fd(), 0);
+   if (data == MAP_FAILED)
+      return;
+#endif
+
+   mData = static_cast<const unsigned char *>(data);
+   mSize = static_cast<size_t>(length);
+}
+
+MappedFile::~MappedFile()
+{
+   if (!mData)
+      return;
+#ifdef _WIN32
+   UnmapViewOfFile(mData);
+   CloseHandle(mMapping);
+#else
+   munmap(const_cast<unsigned char *>(mData), mSize);
+#endif
+}
+
+void MappedFile::AdviseSequential()
+{
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+   if (mData)
+      madvise(const_cast<unsigned char *>(mData), mSize, MADV_SEQUENTIAL);
+#endif
+}
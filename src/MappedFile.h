@@ -0,0 +1,51 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MappedFile.h
+
+*******************************************************************//**
+
+\class MappedFile
+\brief A whole file mapped into memory, read only.
+
+  Reading a mapped file costs no system call for each read, and no
+  copy into a buffer, which matters for formats read with small
+  strides, as raw sample data is.  Mapping may fail, as for an empty
+  file or one too large for the address space, so callers need another
+  way to read.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_MAPPED_FILE__
+#define __AUDACITY_MAPPED_FILE__
+
+#include <cstddef>
+
+#include "audacity/Types.h"
+
+class MappedFile final
+{
+public:
+   explicit MappedFile(const FilePath &path);
+   MappedFile(const MappedFile&) = delete;
+   MappedFile &operator= (const MappedFile&) = delete;
+   ~MappedFile();
+
+   bool IsOk() const { return mData != nullptr; }
+
+   const unsigned char *GetData() const { return mData; }
+   size_t GetSize() const { return mSize; }
+
+   //! Hint that the file will be read once from start to end
+   void AdviseSequential();
+
+private:
+   const unsigned char *mData{ nullptr };
+   size_t mSize{ 0 };
+#ifdef _WIN32
+   void *mMapping{ nullptr };
+#endif
+};
+
+#endif
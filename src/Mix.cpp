@@ -33,6 +33,7 @@
 #include "Envelope.h"
 #include "WaveTrack.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Resample.h"
 #include "TimeTrack.h"
 #include "float_cast.h"
@@ -332,12 +333,19 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
 
 Mixer::~Mixer()
 {
+   for (size_t i = 0; i < mNumInputTracks; i++)
+      Resample::Release(std::move(mResample[i]));
 }
 
 void Mixer::MakeResamplers()
 {
-   for (size_t i = 0; i < mNumInputTracks; i++)
-      mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   // Resamplers that have not been used yet, by this mixer or an earlier
+   // one, can be reused, saving the design of their filters
+   for (size_t i = 0; i < mNumInputTracks; i++) {
+      Resample::Release(std::move(mResample[i]));
+      mResample[i] =
+         Resample::Acquire(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   }
 }
 
 void Mixer::ApplyTrackGains(bool apply)
@@ -612,6 +620,8 @@ size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
 
 size_t Mixer::Process(size_t maxToProcess)
 {
+   PROFILE_ZONE("Mixer::Process");
+
    // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
    // it here. It's also unnecessary I think.
    //if (mT >= mT1)
@@ -0,0 +1,637 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  OnDemandImport.cpp
+
+*******************************************************************//**
+
+\class OnDemandSampleBlock
+\brief A SampleBlock reading one channel of an imported file, until it is
+copied into the project database.
+
+*//*******************************************************************/
+
+#include "OnDemandImport.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string.h>
+
+#include <wx/file.h>
+#include <wx/log.h>
+#include <wx/timer.h>
+
+#include "sndfile.h"
+
+#include "AudacityException.h"
+#include "FileFormats.h"
+#include "Internat.h"
+#include "MemoryX.h"
+#include "Project.h"
+#include "ProjectStatus.h"
+#include "SampleFormat.h"
+#include "SummaryKernels.h"
+#include "TrackPanel.h"
+#include "widgets/ProgressDialog.h"
+#include "xml/XMLTagHandler.h"
+#include "xml/XMLWriter.h"
+
+///\brief An imported file, shared by the blocks that read it
+class OnDemandSource
+{
+public:
+   // Returns the source already open for the path, if any
+   static std::shared_ptr<OnDemandSource> Open(const FilePath &path);
+
+   OnDemandSource(const FilePath &path, SFFile &&file, const SF_INFO &info)
+      : mPath{ path }
+      , mFile{ std::move(file) }
+      , mInfo( info )
+   {}
+
+   const FilePath &GetPath() const { return mPath; }
+   int GetChannels() const { return mInfo.channels; }
+
+   // Read len samples of the channel, from frame start, converting to
+   // format; fills with zeroes what is missing from the file.
+   // May be called from any thread.
+   void Read(samplePtr dest, sampleFormat format,
+      int channel, sampleCount start, size_t len);
+
+private:
+   const FilePath mPath;
+
+   // Serializes seeking and reading
+   std::mutex mMutex;
+   SFFile mFile;
+   const SF_INFO mInfo;
+};
+
+namespace {
+
+// Only uncompressed files can be read in blocks in any order without
+// decoding from far back
+bool IsRandomAccess(const SF_INFO &info)
+{
+   if (!info.seekable || info.channels < 1 || info.frames < 1)
+      return false;
+
+   switch (info.format & SF_FORMAT_TYPEMASK) {
+   case SF_FORMAT_FLAC:
+   case SF_FORMAT_OGG:
+      return false;
+   default:
+      break;
+   }
+
+   switch (info.format & SF_FORMAT_SUBMASK) {
+   case SF_FORMAT_PCM_S8:
+   case SF_FORMAT_PCM_16:
+   case SF_FORMAT_PCM_24:
+   case SF_FORMAT_PCM_32:
+   case SF_FORMAT_PCM_U8:
+   case SF_FORMAT_FLOAT:
+   case SF_FORMAT_DOUBLE:
+   case SF_FORMAT_ULAW:
+   case SF_FORMAT_ALAW:
+      return true;
+   default:
+      return false;
+   }
+}
+
+}
+
+std::shared_ptr<OnDemandSource> OnDemandSource::Open(const FilePath &path)
+{
+   static std::mutex sMutex;
+   static std::map< FilePath, std::weak_ptr<OnDemandSource> > sSources;
+
+   std::lock_guard<std::mutex> guard{ sMutex };
+   auto &wSource = sSources[path];
+   if (auto pSource = wSource.lock())
+      return pSource;
+
+   SF_INFO info;
+   memset(&info, 0, sizeof(info));
+
+   SFFile file;
+   wxFile f;
+   if (f.Open(path)) {
+      // As in ImportPCM, open by descriptor, because wxWidgets can open a
+      // file with a Unicode name and libsndfile can't (under Windows)
+      file.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &info, TRUE));
+      // The file descriptor is now owned by "file"
+      f.Detach();
+   }
+
+   if (!file || !IsRandomAccess(info)) {
+      sSources.erase(path);
+      return nullptr;
+   }
+
+   auto pSource =
+      std::make_shared<OnDemandSource>(path, std::move(file), info);
+   wSource = pSource;
+   return pSource;
+}
+
+void OnDemandSource::Read(samplePtr dest, sampleFormat format,
+   int channel, sampleCount start, size_t len)
+{
+   // Read 16 bit files as such, and others as float, as ImportPCM does
+   const auto readFormat = (format == int16Sample) ? int16Sample : floatSample;
+   const auto channels = mInfo.channels;
+   const size_t maxFrames = 16384;
+   SampleBuffer interleaved(std::min(len, maxFrames) * channels, readFormat);
+
+   size_t done = 0;
+   {
+      std::lock_guard<std::mutex> guard{ mMutex };
+      if (SFCall<sf_count_t>(sf_seek, mFile.get(),
+             (sf_count_t)start.as_long_long(), SEEK_SET) >= 0) {
+         while (done < len) {
+            const auto frames = std::min(len - done, maxFrames);
+            sf_count_t got;
+            if (readFormat == int16Sample)
+               got = SFCall<sf_count_t>(sf_readf_short, mFile.get(),
+                  (short *)interleaved.ptr(), (sf_count_t)frames);
+            else
+               got = SFCall<sf_count_t>(sf_readf_float, mFile.get(),
+                  (float *)interleaved.ptr(), (sf_count_t)frames);
+            if (got <= 0)
+               break;
+
+            CopySamples(
+               interleaved.ptr() + channel * SAMPLE_SIZE(readFormat),
+               readFormat,
+               dest + done * SAMPLE_SIZE(format), format,
+               got, true, channels, 1);
+            done += got;
+         }
+      }
+   }
+
+   if (done < len)
+      ClearSamples(dest, format, done, len - done);
+}
+
+class OnDemandSampleBlock final : public SampleBlock
+{
+public:
+   OnDemandSampleBlock(const SampleBlockFactoryPtr &pDatabaseFactory,
+      const std::shared_ptr<OnDemandSource> &pSource,
+      int channel, sampleCount start, size_t len, sampleFormat format);
+   ~OnDemandSampleBlock() override;
+
+   // Copy the samples into a database block, which then answers for this
+   // one.  Main thread only.
+   void Ingest();
+
+   void CloseLock() override;
+
+   SampleBlockID GetBlockID() const override;
+
+   size_t GetSampleCount() const override;
+
+   bool GetSummary256(float *dest, size_t frameoffset, size_t numframes) override;
+   bool GetSummary64k(float *dest, size_t frameoffset, size_t numframes) override;
+
+   size_t GetSpaceUsage() const override;
+
+   bool IsSummaryAvailable() const override;
+
+   void SaveXML(XMLWriter &xmlFile) override;
+
+protected:
+   size_t DoGetSamples(samplePtr dest,
+                       sampleFormat destformat,
+                       size_t sampleoffset,
+                       size_t numsamples) override;
+
+   MinMaxRMS DoGetMinMaxRMS(size_t start, size_t len) override;
+
+   MinMaxRMS DoGetMinMaxRMS() const override;
+
+private:
+   // Other threads may read while the main thread copies
+   SampleBlockPtr Ingested() const { return std::atomic_load(&mpIngested); }
+
+   const SampleBlockFactoryPtr mpDatabaseFactory;
+   const std::shared_ptr<OnDemandSource> mpSource;
+   const int mChannel;
+   const sampleCount mStart;
+   const size_t mSampleCount;
+   const sampleFormat mSampleFormat;
+
+   // Negative, so as not to be confused with the ids of database blocks
+   const SampleBlockID mBlockID;
+
+   SampleBlockPtr mpIngested;
+   bool mLocked = false;
+};
+
+namespace {
+
+SampleBlockID NewOnDemandBlockID()
+{
+   static std::atomic<SampleBlockID> sNextID{ -1 };
+   return sNextID--;
+}
+
+}
+
+OnDemandSampleBlock::OnDemandSampleBlock(
+   const SampleBlockFactoryPtr &pDatabaseFactory,
+   const std::shared_ptr<OnDemandSource> &pSource,
+   int channel, sampleCount start, size_t len, sampleFormat format)
+   : mpDatabaseFactory{ pDatabaseFactory }
+   , mpSource{ pSource }
+   , mChannel{ channel }
+   , mStart{ start }
+   , mSampleCount{ len }
+   , mSampleFormat{ format }
+   , mBlockID{ NewOnDemandBlockID() }
+{
+}
+
+OnDemandSampleBlock::~OnDemandSampleBlock() = default;
+
+void OnDemandSampleBlock::Ingest()
+{
+   // Don't write to the database of a project that is closing
+   if (Ingested() || mLocked)
+      return;
+
+   SampleBuffer buffer(mSampleCount, mSampleFormat);
+   mpSource->Read(buffer.ptr(), mSampleFormat, mChannel, mStart, mSampleCount);
+   auto pBlock =
+      mpDatabaseFactory->Create(buffer.ptr(), mSampleCount, mSampleFormat);
+   std::atomic_store(&mpIngested, pBlock);
+}
+
+void OnDemandSampleBlock::CloseLock()
+{
+   mLocked = true;
+   if (auto pBlock = Ingested())
+      pBlock->CloseLock();
+}
+
+SampleBlockID OnDemandSampleBlock::GetBlockID() const
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetBlockID();
+   return mBlockID;
+}
+
+size_t OnDemandSampleBlock::GetSampleCount() const
+{
+   return mSampleCount;
+}
+
+size_t OnDemandSampleBlock::DoGetSamples(samplePtr dest,
+   sampleFormat destformat, size_t sampleoffset, size_t numsamples)
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetSamples(dest, destformat, sampleoffset, numsamples);
+
+   if (sampleoffset >= mSampleCount)
+      return 0;
+   numsamples = std::min(numsamples, mSampleCount - sampleoffset);
+
+   const auto start = mStart + sampleoffset;
+   if (destformat == mSampleFormat)
+      mpSource->Read(dest, destformat, mChannel, start, numsamples);
+   else {
+      SampleBuffer buffer(numsamples, mSampleFormat);
+      mpSource->Read(buffer.ptr(), mSampleFormat, mChannel, start, numsamples);
+      CopySamples(buffer.ptr(), mSampleFormat, dest, destformat, numsamples);
+   }
+   return numsamples;
+}
+
+bool OnDemandSampleBlock::GetSummary256(
+   float *dest, size_t frameoffset, size_t numframes)
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetSummary256(dest, frameoffset, numframes);
+   std::fill(dest, dest + numframes * 3, 0.0f);
+   return false;
+}
+
+bool OnDemandSampleBlock::GetSummary64k(
+   float *dest, size_t frameoffset, size_t numframes)
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetSummary64k(dest, frameoffset, numframes);
+   std::fill(dest, dest + numframes * 3, 0.0f);
+   return false;
+}
+
+MinMaxRMS OnDemandSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetMinMaxRMS(start, len);
+
+   float min = FLT_MAX;
+   float max = -FLT_MAX;
+   float sumsq = 0;
+
+   if (start < mSampleCount)
+      len = std::min(len, mSampleCount - start);
+   else
+      len = 0;
+
+   if (len > 0)
+   {
+      Floats samples{ len };
+      DoGetSamples((samplePtr) samples.get(), floatSample, start, len);
+      const auto values = SummarizeSamples(samples.get(), len);
+      min = values.min;
+      max = values.max;
+      sumsq = values.sumsq;
+   }
+
+   return { min, max, len > 0 ? (float) sqrt(sumsq / len) : 0.0f };
+}
+
+MinMaxRMS OnDemandSampleBlock::DoGetMinMaxRMS() const
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetMinMaxRMS();
+
+   // Not yet known; the widest extremes make Sequence::GetMinMax read the
+   // samples
+   return { -FLT_MAX, FLT_MAX, 0.0f };
+}
+
+size_t OnDemandSampleBlock::GetSpaceUsage() const
+{
+   if (auto pBlock = Ingested())
+      return pBlock->GetSpaceUsage();
+   return 0;
+}
+
+bool OnDemandSampleBlock::IsSummaryAvailable() const
+{
+   return Ingested() != nullptr;
+}
+
+void OnDemandSampleBlock::SaveXML(XMLWriter &xmlFile)
+{
+   if (auto pBlock = Ingested()) {
+      pBlock->SaveXML(xmlFile);
+      return;
+   }
+
+   xmlFile.WriteAttr(wxT("aliasfile"), mpSource->GetPath());
+   xmlFile.WriteAttr(wxT("aliaschannel"), mChannel);
+   xmlFile.WriteAttr(wxT("aliasstart"), mStart.as_long_long());
+   xmlFile.WriteAttr(wxT("samplecount"), mSampleCount);
+}
+
+std::shared_ptr<OnDemandSampleBlockFactory> OnDemandSampleBlockFactory::Open(
+   const SampleBlockFactoryPtr &pDatabaseFactory, const FilePath &path)
+{
+   auto pSource = OnDemandSource::Open(path);
+   if (!pSource)
+      return nullptr;
+   return std::make_shared<OnDemandSampleBlockFactory>(
+      pDatabaseFactory, pSource);
+}
+
+bool OnDemandSampleBlockFactory::IsOnDemandXML(const wxChar **attrs)
+{
+   while (*attrs) {
+      const wxChar *attr = *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+      if (wxStrcmp(attr, wxT("aliasfile")) == 0)
+         return true;
+   }
+   return false;
+}
+
+SampleBlockPtr OnDemandSampleBlockFactory::CopyFromXML(
+   SampleBlockFactory &factory, sampleFormat format, const wxChar **attrs)
+{
+   FilePath path;
+   long channel = -1;
+   long long start = -1;
+   long long count = -1;
+
+   // loop through attrs, which is a null-terminated list of attribute-value pairs
+   while (*attrs) {
+      const wxChar *attr = *attrs++;
+      const wxChar *value = *attrs++;
+
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (wxStrcmp(attr, wxT("aliasfile")) == 0) {
+         if (XMLValueChecker::IsGoodPathString(strValue))
+            path = strValue;
+      }
+      else if (wxStrcmp(attr, wxT("aliaschannel")) == 0) {
+         if (!XMLValueChecker::IsGoodInt(strValue) ||
+             !strValue.ToLong(&channel))
+            channel = -1;
+      }
+      else if (wxStrcmp(attr, wxT("aliasstart")) == 0) {
+         if (!XMLValueChecker::IsGoodInt64(strValue) ||
+             !strValue.ToLongLong(&start))
+            start = -1;
+      }
+      else if (wxStrcmp(attr, wxT("samplecount")) == 0) {
+         if (!XMLValueChecker::IsGoodInt64(strValue) ||
+             !strValue.ToLongLong(&count))
+            count = -1;
+      }
+   }
+
+   if (path.empty() || channel < 0 || start < 0 || count <= 0)
+      return nullptr;
+
+   const auto len = (size_t)count;
+   auto pSource = OnDemandSource::Open(path);
+   if (!pSource || channel >= pSource->GetChannels()) {
+      wxLogWarning(
+         wxT("Imported file %s is missing; substituting silence"), path);
+      return factory.CreateSilent(len, format);
+   }
+
+   SampleBuffer buffer(len, format);
+   pSource->Read(buffer.ptr(), format, channel, start, len);
+   return factory.Create(buffer.ptr(), len, format);
+}
+
+OnDemandSampleBlockFactory::OnDemandSampleBlockFactory(
+   const SampleBlockFactoryPtr &pDatabaseFactory,
+   const std::shared_ptr<OnDemandSource> &pSource)
+   : mpDatabaseFactory{ pDatabaseFactory }
+   , mpSource{ pSource }
+{
+}
+
+OnDemandSampleBlockFactory::~OnDemandSampleBlockFactory() = default;
+
+SampleBlockPtr OnDemandSampleBlockFactory::CreateOnDemand(
+   int channel, sampleCount start, size_t len, sampleFormat format)
+{
+   return std::make_shared<OnDemandSampleBlock>(
+      mpDatabaseFactory, mpSource, channel, start, len, format);
+}
+
+bool OnDemandSampleBlockFactory::GetSpectrumTile(
+   SpectrumTileKey key, std::vector<float> &tile)
+{
+   return mpDatabaseFactory->GetSpectrumTile(key, tile);
+}
+
+void OnDemandSampleBlockFactory::PutSpectrumTile(
+   SpectrumTileKey key, const float *tile, size_t count)
+{
+   mpDatabaseFactory->PutSpectrumTile(key, tile, count);
+}
+
+SampleBlockPtr OnDemandSampleBlockFactory::DoGet(SampleBlockID sbid)
+{
+   return mpDatabaseFactory->Get(sbid);
+}
+
+SampleBlockPtr OnDemandSampleBlockFactory::DoCreate(
+   samplePtr src, size_t numsamples, sampleFormat srcformat)
+{
+   return mpDatabaseFactory->Create(src, numsamples, srcformat);
+}
+
+SampleBlockPtr OnDemandSampleBlockFactory::DoCreateSilent(
+   size_t numsamples, sampleFormat srcformat)
+{
+   return mpDatabaseFactory->CreateSilent(numsamples, srcformat);
+}
+
+SampleBlockPtr OnDemandSampleBlockFactory::DoCreateFromXML(
+   sampleFormat srcformat, const wxChar **attrs)
+{
+   return mpDatabaseFactory->CreateFromXML(srcformat, attrs);
+}
+
+static const AudacityProject::AttachedObjects::RegisteredFactory sIngestKey{
+  []( AudacityProject &parent ){
+     return std::make_shared< OnDemandIngest >( parent );
+   }
+};
+
+OnDemandIngest &OnDemandIngest::Get( AudacityProject &project )
+{
+   return project.AttachedObjects::Get< OnDemandIngest >( sIngestKey );
+}
+
+OnDemandIngest::OnDemandIngest( AudacityProject &project )
+   : mProject{ project }
+   , mTimer{ std::make_unique<wxTimer>() }
+{
+   mTimer->Bind(wxEVT_TIMER, [this](wxTimerEvent&){ OnTimer(); });
+}
+
+OnDemandIngest::~OnDemandIngest()
+{
+   mTimer->Stop();
+}
+
+void OnDemandIngest::Add( const std::vector<SampleBlockPtr> &blocks )
+{
+   for (const auto &pBlock : blocks) {
+      auto pOnDemand = std::dynamic_pointer_cast<OnDemandSampleBlock>(pBlock);
+      if (!pOnDemand)
+         continue;
+      const auto count = pOnDemand->GetSampleCount();
+      mPending.push_back({ pOnDemand, count });
+      mTotal += count;
+   }
+
+   if (!mPending.empty() && !mTimer->IsRunning())
+      mTimer->Start(200);
+}
+
+void OnDemandIngest::IngestNext()
+{
+   auto &pending = mPending.front();
+   // A block no longer used, as after undoing the import, needs no copy
+   if (auto pBlock = pending.pBlock.lock())
+      pBlock->Ingest();
+   mDone += pending.count;
+   mPending.pop_front();
+}
+
+void OnDemandIngest::OnTimer()
+{
+   // Copy for a part of each interval, leaving the rest to the user
+   using Clock = std::chrono::steady_clock;
+   const auto deadline = Clock::now() + std::chrono::milliseconds(100);
+
+   bool failed = true;
+   GuardedCall( [&]{
+      while (!mPending.empty() && Clock::now() < deadline)
+         IngestNext();
+      failed = false;
+   } );
+
+   auto &status = ProjectStatus::Get( mProject );
+   if (failed || mPending.empty()) {
+      // After a failure to write the database, the blocks go on reading
+      // the imported file; Finish tries again before saving
+      if (failed)
+         status.Set(XO("Copying of imported audio into the project failed"));
+      else
+         status.Set(XO("Imported audio is copied into the project"));
+      mTimer->Stop();
+      if (!failed)
+         mTotal = mDone = 0;
+   }
+   else {
+      const auto percent = (int)(100.0 * mDone / std::max(1ULL, mTotal));
+      status.Set(
+         XO("Copying imported audio into the project... %d%%")
+            .Format( percent ));
+   }
+
+   // Draw the waveforms of the blocks copied
+   TrackPanel::Get( mProject ).Refresh(false);
+}
+
+bool OnDemandIngest::Finish()
+{
+   if (mPending.empty())
+      return true;
+
+   mTimer->Stop();
+   auto cleanup = finally( [&]{
+      if (!mPending.empty())
+         mTimer->Start(200);
+   } );
+
+   ProgressDialog progress(XO("Progress"),
+      XO("Copying imported audio into the project"));
+   while (!mPending.empty()) {
+      IngestNext();
+      const auto result = progress.Update(
+         (wxLongLong_t)mDone, (wxLongLong_t)mTotal);
+      if (result != ProgressResult::Success)
+         return false;
+   }
+
+   mTotal = mDone = 0;
+   ProjectStatus::Get( mProject ).Set(
+      XO("Imported audio is copied into the project"));
+   return true;
+}
@@ -0,0 +1,135 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  OnDemandImport.h
+
+*******************************************************************//**
+
+\file OnDemandImport.h
+\brief Imported tracks that read their samples from the original file
+until a background task copies them into the project.
+
+  An on-demand import gives its tracks an OnDemandSampleBlockFactory,
+  which makes blocks that read a range of one channel of the file.
+  OnDemandIngest later copies each such block into the database, in
+  place, so that every track and undo state sharing the block sees the
+  copy.  Blocks that the factory makes from samples, as for edits, are
+  ordinary database blocks.
+
+  Only the main thread copies blocks, because only it writes the
+  project database.  Other threads may read the blocks meanwhile.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_ON_DEMAND_IMPORT__
+#define __AUDACITY_ON_DEMAND_IMPORT__
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "ClientData.h"
+#include "SampleBlock.h"
+#include "audacity/Types.h"
+
+class AudacityProject;
+class OnDemandSampleBlock;
+class OnDemandSource;
+class wxTimer;
+
+class OnDemandSampleBlockFactory final : public SampleBlockFactory
+{
+public:
+   //! Returns null if the file can't be opened, or can't be read cheaply
+   //! at any position, as for compressed formats
+   static std::shared_ptr<OnDemandSampleBlockFactory> Open(
+      const SampleBlockFactoryPtr &pDatabaseFactory, const FilePath &path);
+
+   //! Whether the attributes of a waveblock tag are those that SaveXML
+   //! writes for a block not yet copied into the project
+   static bool IsOnDemandXML(const wxChar **attrs);
+
+   //! Copy the samples that such attributes describe into a new block of
+   //! the given factory, as when recovering an autosaved project; silence
+   //! replaces them if the file went missing
+   /*! @return null if the attributes are not good */
+   static SampleBlockPtr CopyFromXML(SampleBlockFactory &factory,
+      sampleFormat format, const wxChar **attrs);
+
+   OnDemandSampleBlockFactory(const SampleBlockFactoryPtr &pDatabaseFactory,
+      const std::shared_ptr<OnDemandSource> &pSource);
+   ~OnDemandSampleBlockFactory() override;
+
+   //! A block of len samples of the channel, from frame start of the file
+   SampleBlockPtr CreateOnDemand(int channel, sampleCount start, size_t len,
+      sampleFormat format);
+
+   bool GetSpectrumTile(
+      SpectrumTileKey key, std::vector<float> &tile) override;
+   void PutSpectrumTile(
+      SpectrumTileKey key, const float *tile, size_t count) override;
+
+protected:
+   SampleBlockPtr DoGet(SampleBlockID sbid) override;
+
+   SampleBlockPtr DoCreate(samplePtr src,
+      size_t numsamples,
+      sampleFormat srcformat) override;
+
+   SampleBlockPtr DoCreateSilent(
+      size_t numsamples,
+      sampleFormat srcformat) override;
+
+   SampleBlockPtr DoCreateFromXML(
+      sampleFormat srcformat,
+      const wxChar **attrs) override;
+
+private:
+   const SampleBlockFactoryPtr mpDatabaseFactory;
+   const std::shared_ptr<OnDemandSource> mpSource;
+};
+
+//! Copies the blocks of on-demand imports of a project into its database,
+//! a little at a time on a timer, reporting progress in the status bar
+class OnDemandIngest final : public ClientData::Base
+{
+public:
+   static OnDemandIngest &Get( AudacityProject &project );
+
+   explicit OnDemandIngest( AudacityProject &project );
+   OnDemandIngest( const OnDemandIngest & ) = delete;
+   OnDemandIngest &operator= ( const OnDemandIngest & ) = delete;
+   ~OnDemandIngest() override;
+
+   //! Schedule copying of blocks made by CreateOnDemand; others are ignored
+   void Add( const std::vector<SampleBlockPtr> &blocks );
+
+   //! Copy all remaining blocks now, showing a progress dialog, as before
+   //! saving the project
+   /*! @return false if the user stopped it */
+   bool Finish();
+
+   bool IsBusy() const { return !mPending.empty(); }
+
+private:
+   void OnTimer();
+
+   // Copy the next block, if it is still used
+   void IngestNext();
+
+   AudacityProject &mProject;
+   std::unique_ptr<wxTimer> mTimer;
+
+   struct Pending {
+      std::weak_ptr<OnDemandSampleBlock> pBlock;
+      size_t count;
+   };
+   std::deque<Pending> mPending;
+
+   // Samples in the pending blocks and those already done, for progress
+   unsigned long long mTotal{ 0 };
+   unsigned long long mDone{ 0 };
+};
+
+#endif
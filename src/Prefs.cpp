@@ -187,6 +187,30 @@ AudacityPrefs::AudacityPrefs(const wxString& appName,
 {
 }
 
+bool AudacityPrefs::DoReadString(const wxString& key, wxString *pStr) const
+{
+   std::lock_guard<std::recursive_mutex> guard(mMutex);
+   return wxFileConfig::DoReadString(key, pStr);
+}
+
+bool AudacityPrefs::DoReadLong(const wxString& key, long *pl) const
+{
+   std::lock_guard<std::recursive_mutex> guard(mMutex);
+   return wxFileConfig::DoReadLong(key, pl);
+}
+
+bool AudacityPrefs::DoWriteString(const wxString& key, const wxString& szValue)
+{
+   std::lock_guard<std::recursive_mutex> guard(mMutex);
+   return wxFileConfig::DoWriteString(key, szValue);
+}
+
+bool AudacityPrefs::DoWriteLong(const wxString& key, long lValue)
+{
+   std::lock_guard<std::recursive_mutex> guard(mMutex);
+   return wxFileConfig::DoWriteLong(key, lValue);
+}
+
 
 
 void InitPreferences( const wxFileName &configFileName )
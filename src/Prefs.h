@@ -35,6 +35,7 @@
 #include "MemoryX.h" // for wxArrayStringEx
 
 #include <memory>
+#include <mutex>
 #include <wx/fileconf.h>  // to inherit wxFileConfig
 #include <wx/event.h> // to declare custom event types
 
@@ -84,6 +85,18 @@ public:
    int mVersionMajorKeyInit{};
    int mVersionMinorKeyInit{};
    int mVersionMicroKeyInit{};
+
+protected:
+   // wxFileConfig changes its current group while reading or writing a
+   // key; these serialize that, so that worker threads, such as those
+   // exporting, may read preferences too
+   bool DoReadString(const wxString& key, wxString *pStr) const override;
+   bool DoReadLong(const wxString& key, long *pl) const override;
+   bool DoWriteString(const wxString& key, const wxString& szValue) override;
+   bool DoWriteLong(const wxString& key, long lValue) override;
+
+private:
+   mutable std::recursive_mutex mMutex;
 };
 
 struct ByColumns_t{};
@@ -18,14 +18,25 @@ but it will probably work fine if you use it on a high level.
 \class TaskProfile
 \brief a simple class to keep track of one task that may be called multiple times.
 
+*//****************************************************************//**
+
+\class Tracer
+\brief Records nested zones of time and counters, from any thread, for a
+trace viewer.
+
 *//*******************************************************************/
 
 #include "Audacity.h"
 #include "Profiler.h"
 
+#include <chrono>
 #include <stdio.h>
 #include <string.h>
 #include <wx/crt.h>
+#include <wx/ffile.h>
+#include <wx/string.h>
+
+#include "Internat.h"
 
 ///write to a profile at the end of the test.
 Profiler::~Profiler()
@@ -154,3 +165,202 @@ double TaskProfile::ComputeAverageRunTime()
    else
       return 0.0;
 }
+
+
+namespace {
+
+///the events of one thread, written only by it, without locks.
+struct TraceBuffer
+{
+   //Enough for minutes of playback, at about five megabytes a thread
+   static constexpr size_t Capacity = 1 << 17;
+
+   struct Event
+   {
+      const char* name;
+      long long begin;
+      //for a counter, unused
+      long long end;
+      double value;
+      bool counter;
+   };
+
+   ArrayOf<Event> mEvents{ Capacity };
+   //Events before this are complete; the owner stores it with release
+   std::atomic<size_t> mSize{ 0 };
+   std::atomic<size_t> mDropped{ 0 };
+   //The start of the Tracer that the events are for
+   std::atomic<unsigned> mGeneration{ 0 };
+   std::atomic<const char*> mName{ nullptr };
+   int mThreadId{ 0 };
+
+   void Add(const Event &event)
+   {
+      const auto size = mSize.load(std::memory_order_relaxed);
+      if (size == Capacity) {
+         mDropped.fetch_add(1, std::memory_order_relaxed);
+         return;
+      }
+      mEvents[size] = event;
+      mSize.store(size + 1, std::memory_order_release);
+   }
+};
+
+std::atomic<unsigned> sGeneration{ 0 };
+
+std::mutex sBuffersMutex;
+std::vector< std::shared_ptr<TraceBuffer> > sBuffers;
+
+///the buffer of the calling thread, emptied if the Tracer started again.
+///The first call for a thread allocates.
+TraceBuffer &GetTraceBuffer()
+{
+   thread_local std::shared_ptr<TraceBuffer> pBuffer;
+   if (!pBuffer) {
+      auto pNew = std::make_shared<TraceBuffer>();
+      std::lock_guard<std::mutex> guard{ sBuffersMutex };
+      pNew->mThreadId = (int)sBuffers.size() + 1;
+      sBuffers.push_back(pNew);
+      pBuffer = std::move(pNew);
+   }
+
+   const auto generation = sGeneration.load(std::memory_order_acquire);
+   if (pBuffer->mGeneration.load(std::memory_order_relaxed) != generation) {
+      pBuffer->mSize.store(0, std::memory_order_relaxed);
+      pBuffer->mDropped.store(0, std::memory_order_relaxed);
+      pBuffer->mGeneration.store(generation, std::memory_order_release);
+   }
+   return *pBuffer;
+}
+
+wxString FormatMicroseconds(long long nanoseconds)
+{
+   //The dot is the decimal separator, whatever the locale
+   return Internat::ToString(nanoseconds / 1000.0, 3);
+}
+
+wxString FormatJSONName(const char* name)
+{
+   wxString result = wxT("\"");
+   for (auto p = name; *p; ++p) {
+      if (*p == '"' || *p == '\\')
+         result += wxT('\\');
+      result += wxUniChar((unsigned char)*p);
+   }
+   return result + wxT("\"");
+}
+
+}
+
+std::atomic<bool> Tracer::sEnabled{ false };
+
+void Tracer::Start()
+{
+   sGeneration.fetch_add(1, std::memory_order_release);
+   sEnabled.store(true, std::memory_order_relaxed);
+   NameThread("Main");
+}
+
+void Tracer::Stop()
+{
+   sEnabled.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::NameThread(const char* name)
+{
+   if (IsEnabled())
+      GetTraceBuffer().mName.store(name, std::memory_order_relaxed);
+}
+
+void Tracer::Counter(const char* name, double value)
+{
+   if (IsEnabled())
+      GetTraceBuffer().Add({ name, Now(), 0, value, true });
+}
+
+long long Tracer::Now()
+{
+   using namespace std::chrono;
+   return duration_cast<nanoseconds>(
+      steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::AddZone(const char* name, long long begin, long long end)
+{
+   GetTraceBuffer().Add({ name, begin, end, 0.0, false });
+}
+
+wxString Tracer::FormatChromeTrace()
+{
+   std::vector< std::shared_ptr<TraceBuffer> > buffers;
+   {
+      std::lock_guard<std::mutex> guard{ sBuffersMutex };
+      buffers = sBuffers;
+   }
+
+   //Times are from the first event
+   const auto generation = sGeneration.load(std::memory_order_acquire);
+   long long origin = 0;
+   bool first = true;
+   for (const auto &pBuffer : buffers) {
+      if (pBuffer->mGeneration.load(std::memory_order_acquire) != generation)
+         continue;
+      const auto size = pBuffer->mSize.load(std::memory_order_acquire);
+      for (size_t ii = 0; ii < size; ++ii)
+         if (first || pBuffer->mEvents[ii].begin < origin) {
+            origin = pBuffer->mEvents[ii].begin;
+            first = false;
+         }
+   }
+
+   wxString trace = wxT("{\"traceEvents\":[");
+   size_t dropped = 0;
+   const wxString separator = wxT(",\n");
+   wxString before = wxT("\n");
+   for (const auto &pBuffer : buffers) {
+      if (pBuffer->mGeneration.load(std::memory_order_acquire) != generation)
+         continue;
+      const auto tid = pBuffer->mThreadId;
+      const auto size = pBuffer->mSize.load(std::memory_order_acquire);
+      dropped += pBuffer->mDropped.load(std::memory_order_relaxed);
+
+      if (const auto name = pBuffer->mName.load(std::memory_order_relaxed)) {
+         trace += before + wxString::Format(
+            wxT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,")
+            wxT("\"args\":{\"name\":%s}}"),
+            tid, FormatJSONName(name));
+         before = separator;
+      }
+
+      for (size_t ii = 0; ii < size; ++ii) {
+         const auto &event = pBuffer->mEvents[ii];
+         if (event.counter)
+            trace += before + wxString::Format(
+               wxT("{\"name\":%s,\"ph\":\"C\",\"ts\":%s,\"pid\":1,\"tid\":%d,")
+               wxT("\"args\":{\"value\":%s}}"),
+               FormatJSONName(event.name),
+               FormatMicroseconds(event.begin - origin), tid,
+               Internat::ToString(event.value));
+         else
+            trace += before + wxString::Format(
+               wxT("{\"name\":%s,\"ph\":\"X\",\"ts\":%s,\"dur\":%s,")
+               wxT("\"pid\":1,\"tid\":%d}"),
+               FormatJSONName(event.name),
+               FormatMicroseconds(event.begin - origin),
+               FormatMicroseconds(event.end - event.begin), tid);
+         before = separator;
+      }
+   }
+
+   trace += wxString::Format(
+      wxT("\n],\"displayTimeUnit\":\"ms\",")
+      wxT("\"otherData\":{\"droppedEvents\":%lu}}\n"),
+      (unsigned long)dropped);
+   return trace;
+}
+
+bool Tracer::WriteChromeTrace(const wxString &path)
+{
+   wxFFile file(path, wxT("w"));
+   return file.IsOpened() && file.Write(FormatChromeTrace(), wxConvUTF8);
+}
@@ -18,6 +18,21 @@ but it will probably work fine if you use it on a high level.
 \class TaskProfile
 \brief a simple class to keep track of one task that may be called multiple times.
 
+*//****************************************************************//**
+
+\class Tracer
+\brief Records nested zones of time and counters, from any thread, for a
+trace viewer.  It is compiled in, but does nothing until started.
+
+  Each thread writes to its own buffer, with no locks.  Zones that begin
+  and end in the same scope nest, and are written when they end.  The trace
+  is written as the JSON of the Chrome trace event format, which Perfetto
+  and chrome://tracing open.
+
+\class ProfileZone
+\brief Records the time from its construction to its destruction as a
+zone of the Tracer, if the Tracer was started.
+
 *//*******************************************************************/
 
 
@@ -26,15 +41,25 @@ but it will probably work fine if you use it on a high level.
 
 #ifndef __AUDACITY_PROFILER__
 #define __AUDACITY_PROFILER__
+#include <atomic>
 #include <mutex>
 #include <vector>
 #include <time.h>
 #include "MemoryX.h"
 
+class wxString;
+
 
 #define BEGIN_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->Begin(__FILE__,__LINE__,TASK_DESCRIPTION)
 #define END_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->End(__FILE__,__LINE__,TASK_DESCRIPTION)
 
+#define PROFILE_CONCATENATE2(A, B) A ## B
+#define PROFILE_CONCATENATE(A, B) PROFILE_CONCATENATE2(A, B)
+///record the rest of the scope as a zone; the name must be a literal.
+#define PROFILE_ZONE(NAME) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__){ NAME }
+///record the value of a counter; the name must be a literal.
+#define PROFILE_COUNTER(NAME, VALUE) Tracer::Counter(NAME, VALUE)
+
 class TaskProfile;
 class Profiler
 {
@@ -87,6 +112,56 @@ class Profiler
       clock_t mLastTime;
    };
 
+class Tracer
+{
+ public:
+   ///discard what was recorded and start recording; for the main thread.
+   static void Start();
+   ///stop recording; zones that began before still end.
+   static void Stop();
+   static bool IsEnabled()
+   { return sEnabled.load(std::memory_order_relaxed); }
+
+   ///name the calling thread in the trace; the name must be a literal.
+   static void NameThread(const char* name);
+   ///record a value, drawn as a graph; the name must be a literal.
+   static void Counter(const char* name, double value);
+
+   ///the trace, as Chrome trace event JSON; for the main thread.
+   static wxString FormatChromeTrace();
+   static bool WriteChromeTrace(const wxString &path);
+
+   ///nanoseconds since an arbitrary time.
+   static long long Now();
+   ///for ProfileZone.
+   static void AddZone(const char* name, long long begin, long long end);
+
+ private:
+   static std::atomic<bool> sEnabled;
+};
+
+class ProfileZone
+{
+ public:
+   explicit ProfileZone(const char* name)
+      : mName{ Tracer::IsEnabled() ? name : nullptr }
+   {
+      if (mName)
+         mBegin = Tracer::Now();
+   }
+   ProfileZone(const ProfileZone&) = delete;
+   ProfileZone &operator= (const ProfileZone&) = delete;
+   ~ProfileZone()
+   {
+      if (mName)
+         Tracer::AddZone(mName, mBegin, Tracer::Now());
+   }
+
+ private:
+   const char* mName;
+   long long mBegin{ 0 };
+};
+
 
 #endif
 
@@ -55,6 +55,10 @@ static const char *ProjectFileSchema =
    //
    // See the CMakeList.txt for the SQLite lib for more
    // settings.
+   //
+   // The page size takes effect only before the first table is created,
+   // as in an outbound database; see DBConnection::PageSize()
+   "PRAGMA <schema>.page_size = %d;"
    "PRAGMA <schema>.application_id = %d;"
    "PRAGMA <schema>.user_version = %d;"
    ""
@@ -129,6 +133,35 @@ static const char *ProjectFileSchema =
    "  summary256           BLOB,"
    "  summary64k           BLOB,"
    "  samples              BLOB"
+   ");"
+   ""
+   // CREATE SQL spectrumtiles
+   // Spectrogram columns computed from the sample blocks, which are only
+   // a cache and may be deleted at any time.  See SpectrumTilesSchema.
+   "CREATE TABLE IF NOT EXISTS <schema>.spectrumtiles"
+   "("
+   "  tileid               INTEGER PRIMARY KEY,"
+   "  lastused             INTEGER,"
+   "  data                 BLOB"
+   ");";
+
+// Project files written before the spectrumtiles table was added are still
+// of the same version, because older versions of Audacity can open files
+// having the table; just add it when opening such a file.
+//
+// tileid is a hash of the spectrogram settings and of the ids and positions
+// of the sample blocks that the tile depends on.  Block ids are never
+// reused, so a tile can't outlive the blocks it was computed from and
+// still be found.
+//
+// lastused increases with each use of a tile, so the least recently used
+// tiles can be discarded when the table grows too large.
+static const char *SpectrumTilesSchema =
+   "CREATE TABLE IF NOT EXISTS main.spectrumtiles"
+   "("
+   "  tileid               INTEGER PRIMARY KEY,"
+   "  lastused             INTEGER,"
+   "  data                 BLOB"
    ");";
 
 // This singleton handles initialization/shutdown of the SQLite library.
@@ -644,6 +677,16 @@ bool ProjectFileIO::CheckVersion()
       return UpgradeSchema();
    }
 
+   // Add the cache of spectrogram tiles, if missing
+   rc = sqlite3_exec(db, SpectrumTilesSchema, nullptr, nullptr, nullptr);
+   if (rc != SQLITE_OK)
+   {
+      SetDBError(
+         XO("Unable to initialize the project file")
+      );
+      return false;
+   }
+
    return true;
 }
 
@@ -652,7 +695,8 @@ bool ProjectFileIO::InstallSchema(sqlite3 *db, const char *schema /* = "main" */
    int rc;
 
    wxString sql;
-   sql.Printf(ProjectFileSchema, ProjectFileID, ProjectFileVersion);
+   sql.Printf(ProjectFileSchema,
+      DBConnection::PageSize(), ProjectFileID, ProjectFileVersion);
    sql.Replace("<schema>", schema);
 
    rc = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
@@ -909,6 +953,22 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
          }
       }
 
+      // Copy the spectrogram tiles too, so that compacting doesn't lose
+      // them.  They are only a cache, so ignore failure.  Their keys
+      // assume that block ids are not reused, so continue the sequence of
+      // ids after those of blocks that were not copied.
+      sqlite3_exec(db,
+                   "DELETE FROM outbound.sqlite_sequence"
+                   "  WHERE name = 'sampleblocks';"
+                   "INSERT INTO outbound.sqlite_sequence"
+                   "  SELECT * FROM main.sqlite_sequence"
+                   "  WHERE name = 'sampleblocks';"
+                   "INSERT INTO outbound.spectrumtiles"
+                   "  SELECT * FROM main.spectrumtiles;",
+                   nullptr,
+                   nullptr,
+                   nullptr);
+
       // Write the doc.
       //
       // If we're compacting a temporary project (user initiated from the File
@@ -23,6 +23,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "FileFormats.h"
 #include "FileNames.h"
 #include "Legacy.h"
+#include "OnDemandImport.h"
 #include "PlatformCompatibility.h"
 #include "Project.h"
 #include "ProjectFileIO.h"
@@ -274,6 +275,11 @@ bool ProjectFileManager::DoSave(const FilePath & fileName, const bool fromSaveAs
    }
    // End of confirmations
 
+   // Copy the rest of any on-demand import into the project first, so that
+   // the saved project does not depend on the imported files
+   if (!OnDemandIngest::Get( proj ).Finish())
+      return false;
+
    // Always save a backup of the original project file
    wxString safetyFileName;
    if (fromSaveAs && wxFileExists(fileName))
@@ -604,6 +610,9 @@ bool ProjectFileManager::SaveCopy(const FilePath &fileName /* = wxT("") */)
       break;
    } while (bPrompt);
 
+   if (!OnDemandIngest::Get( project ).Finish())
+      return false;
+
    if (!projectFileIO.SaveCopy(filename.GetFullPath()))
    {
       // Overwrite disallowed. The destination project is open in another window.
@@ -16,9 +16,9 @@
 
       libsoxr, written by Rob Sykes. LGPL.
 
-   Since Audacity always does resampling on mono streams that are
-   contiguous in memory, this class doesn't support multiple channels
-   or some of the other optional features of some of these resamplers.
+   Streams are contiguous in memory; several channels of the same rate may
+   be interleaved and resampled by one handle.  This class doesn't support
+   some of the other optional features of some of these resamplers.
 
 *//*******************************************************************/
 
@@ -27,9 +27,16 @@
 #include "Internat.h"
 #include "../include/audacity/ComponentInterface.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <soxr.h>
 
-Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+                   unsigned numChannels)
+   : mMinFactor{ dMinFactor }
+   , mMaxFactor{ dMaxFactor }
+   , mNumChannels{ numChannels }
 {
    this->SetMethod(useBestMethod);
    soxr_quality_spec_t q_spec;
@@ -43,13 +50,54 @@ Resample::Resample(const bool useBestMethod, const double dMinFactor, const doub
       mbWantConstRateResampling = false; // variable rate resampling
       q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
    }
-   mHandle.reset(soxr_create(1, dMinFactor, 1, 0, 0, &q_spec, 0));
+   mHandle.reset(soxr_create(1, dMinFactor, numChannels, 0, 0, &q_spec, 0));
 }
 
 Resample::~Resample()
 {
 }
 
+namespace {
+// Unused resamplers released by this thread, as by mixers destroyed or
+// restarted before they resampled anything
+thread_local std::vector<std::unique_ptr<Resample>> sReleased;
+
+// Enough for the mixers of a playback of many tracks
+const size_t MaxReleased = 64;
+}
+
+std::unique_ptr<Resample> Resample::Acquire(const bool useBestMethod,
+   const double dMinFactor, const double dMaxFactor, unsigned numChannels)
+{
+   const int method = useBestMethod
+      ? BestMethodSetting.ReadEnum()
+      : FastMethodSetting.ReadEnum();
+   const auto begin = sReleased.begin(), end = sReleased.end();
+   const auto iter = std::find_if(begin, end,
+      [&](const std::unique_ptr<Resample> &pResample){
+         return pResample->mMethod == method &&
+            pResample->mMinFactor == dMinFactor &&
+            pResample->mMaxFactor == dMaxFactor &&
+            pResample->mNumChannels == numChannels;
+      });
+   if (iter == end)
+      return std::make_unique<Resample>(
+         useBestMethod, dMinFactor, dMaxFactor, numChannels);
+
+   auto result = std::move(*iter);
+   sReleased.erase(iter);
+   return result;
+}
+
+void Resample::Release(std::unique_ptr<Resample> pResample)
+{
+   if (!pResample || pResample->mUsed || !pResample->mHandle)
+      return;
+   if (sReleased.size() == MaxReleased)
+      sReleased.erase(sReleased.begin());
+   sReleased.push_back(std::move(pResample));
+}
+
 //////////
 static const std::initializer_list<EnumValueSymbol> methodNames{
    { wxT("LowQuality"), XO("Low Quality (Fastest)") },
@@ -93,6 +141,7 @@ std::pair<size_t, size_t>
                         size_t  outBufferLen)
 {
    size_t idone, odone;
+   mUsed = true;
    if (mbWantConstRateResampling)
    {
       soxr_process(mHandle.get(),
@@ -38,9 +38,23 @@ class Resample final
    /// the fast method.
    // dMinFactor and dMaxFactor specify the range of factors for variable-rate resampling.
    // For constant-rate, pass the same value for both.
-   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
+   // numChannels is the number of interleaved channels in the buffers
+   // passed to Process.
+   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+            unsigned numChannels = 1);
    ~Resample();
 
+   /// A resampler for the same arguments as the constructor, reused from
+   /// those that this thread released, if it can be
+   static std::unique_ptr<Resample> Acquire(const bool useBestMethod,
+      const double dMinFactor, const double dMaxFactor,
+      unsigned numChannels = 1);
+
+   /// Give a resampler back for reuse by this thread.  libsoxr can't be
+   /// reset without designing its filters again, so only a resampler that
+   /// has processed nothing is kept.  Null is allowed.
+   static void Release(std::unique_ptr<Resample> pResample);
+
    static EnumSetting< int > FastMethodSetting;
    static EnumSetting< int > BestMethodSetting;
 
@@ -55,16 +69,17 @@ class Resample final
     * This function may do nothing if you don't pass a large enough output
     * buffer (i.e. there is no where to put a full block of output data)
     @param factor The scaling factor to resample by.
-    @param inBuffer Buffer of input samples to be processed (mono)
-    @param inBufferLen Length of the input buffer, in samples.
+    @param inBuffer Buffer of input samples to be processed, with the
+    channels interleaved
+    @param inBufferLen Length of the input buffer, in samples per channel.
     @param lastFlag Flag to indicate this is the last lot of input samples and
     the buffer needs to be emptied out into the rate converter.
     (unless lastFlag is true, we don't guarantee to process all the samples in
     the input this time, we may leave some for next time)
     @param outBuffer Buffer to write output (converted) samples to.
-    @param outBufferLen How big outBuffer is.
+    @param outBufferLen How big outBuffer is, in samples per channel.
     @return Number of input samples consumed, and number of output samples
-    created by this call
+    created by this call, per channel
    */
    std::pair<size_t, size_t>
                 Process(double  factor,
@@ -81,6 +96,13 @@ class Resample final
    int   mMethod; // resampler-specific enum for resampling method
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
    bool mbWantConstRateResampling;
+
+   // The arguments of construction, to match requests for reuse
+   double mMinFactor;
+   double mMaxFactor;
+   unsigned mNumChannels;
+   // Whether Process was called
+   bool mUsed{ false };
 };
 
 #endif // __AUDACITY_RESAMPLE_H__
@@ -76,6 +76,17 @@ SampleBlockPtr SampleBlockFactory::CreateFromXML(
    return result;
 }
 
+bool SampleBlockFactory::GetSpectrumTile(
+   SpectrumTileKey, std::vector<float> &)
+{
+   return false;
+}
+
+void SampleBlockFactory::PutSpectrumTile(
+   SpectrumTileKey, const float *, size_t)
+{
+}
+
 SampleBlock::~SampleBlock() = default;
 
 size_t SampleBlock::GetSamples(samplePtr dest,
@@ -113,3 +124,7 @@ size_t SampleBlock::GetSamples(samplePtr dest,
    }
 }
 
+bool SampleBlock::IsSummaryAvailable() const
+{
+   return true;
+}
@@ -13,6 +13,7 @@ SampleBlock.h
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 class AudacityProject;
 class ProjectFileIO;
@@ -27,6 +28,9 @@ using SampleBlockFactoryFactory =
 
 using SampleBlockID = long long;
 
+// Hash of everything that a tile of spectrogram columns depends on
+using SpectrumTileKey = unsigned long long;
+
 class MinMaxRMS
 {
 public:
@@ -76,6 +80,12 @@ public:
 
    virtual size_t GetSpaceUsage() const = 0;
 
+   // False while the summaries are not yet computed, as for a block that
+   // still reads from an imported file; then GetSummary256 and GetSummary64k
+   // fill with zeroes, and GetMinMaxRMS for the entire block returns the
+   // widest extremes
+   virtual bool IsSummaryAvailable() const;
+
    virtual void SaveXML(XMLWriter &xmlFile) = 0;
 
 protected:
@@ -131,6 +141,16 @@ public:
       sampleFormat srcformat,
       const wxChar **attrs);
 
+   // Persistent cache of spectrogram columns computed from sample blocks.
+   // Tiles may be discarded at any time, and errors are ignored, because
+   // they can always be computed again.  The default implementations keep
+   // nothing.
+   // Returns false if there is no tile for the key
+   virtual bool GetSpectrumTile(
+      SpectrumTileKey key, std::vector<float> &tile);
+   virtual void PutSpectrumTile(
+      SpectrumTileKey key, const float *tile, size_t count);
+
 protected:
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by Create
@@ -48,7 +48,6 @@
 
 static DitherType gLowQualityDither = DitherType::none;
 static DitherType gHighQualityDither = DitherType::none;
-static Dither gDitherAlgorithm;
 
 void InitDitherers()
 {
@@ -106,7 +105,9 @@ void CopySamples(samplePtr src, sampleFormat srcFormat,
                  unsigned int srcStride /* = 1 */,
                  unsigned int dstStride /* = 1 */)
 {
-   gDitherAlgorithm.Apply(
+   // A Dither for each call, because threads convert samples at once, and
+   // the dithers reset their state for each conversion anyway
+   Dither().Apply(
       highQuality ? gHighQualityDither : gLowQualityDither,
       src, srcFormat, dst, dstFormat, len, srcStride, dstStride);
 }
@@ -117,7 +118,7 @@ void CopySamplesNoDither(samplePtr src, sampleFormat srcFormat,
                  unsigned int srcStride /* = 1 */,
                  unsigned int dstStride /* = 1 */)
 {
-   gDitherAlgorithm.Apply(
+   Dither().Apply(
       DitherType::none,
       src, srcFormat, dst, dstFormat, len, srcStride, dstStride);
 }
@@ -8,7 +8,7 @@
 
 *******************************************************************//**
 \file Sequence.cpp
-\brief Implements classes Sequence and SeqBlock.
+\brief Implements class Sequence.
 
 *//****************************************************************//**
 
@@ -19,12 +19,6 @@
    the audio sample blocks in the database.
    Contrast with RingBuffer.
 
-*//****************************************************************//**
-
-\class SeqBlock
-\brief Data structure containing pointer to a sample block and
-   a start time. Element of a BlockArray.
-
 *//*******************************************************************/
 
 
@@ -33,6 +27,7 @@
 
 #include <algorithm>
 #include <float.h>
+#include <limits.h>
 #include <math.h>
 
 #include <wx/intl.h>
@@ -40,7 +35,9 @@
 #include <wx/ffile.h>
 #include <wx/log.h>
 
+#include "OnDemandImport.h"
 #include "SampleBlock.h"
+#include "SummaryKernels.h"
 #include "InconsistencyException.h"
 #include "widgets/AudacityMessageBox.h"
 
@@ -85,8 +82,8 @@ size_t Sequence::GetIdealBlockSize() const
 
 bool Sequence::CloseLock()
 {
-   for (unsigned int i = 0; i < mBlock.size(); i++)
-      mBlock[i].sb->CloseLock();
+   for (const auto &block : mBlock)
+      block.sb->CloseLock();
 
    return true;
 }
@@ -164,10 +161,6 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format)
    } );
 
    BlockArray newBlockArray;
-   // Use the ratio of old to NEW mMaxSamples to make a reasonable guess
-   // at allocation.
-   newBlockArray.reserve
-      (1 + mBlock.size() * ((float)oldMaxSamples / (float)mMaxSamples));
 
    {
       size_t oldSize = oldMaxSamples;
@@ -175,9 +168,8 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format)
       size_t newSize = oldMaxSamples;
       SampleBuffer bufferNew(newSize, format);
 
-      for (size_t i = 0, nn = mBlock.size(); i < nn; i++)
+      for (const auto &oldSeqBlock : mBlock)
       {
-         SeqBlock &oldSeqBlock = mBlock[i];
          const auto &oldBlockFile = oldSeqBlock.sb;
          const auto len = oldBlockFile->GetSampleCount();
          ensureSampleBufferSize(bufferOld, oldFormat, oldSize, len);
@@ -196,9 +188,8 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format)
          //    from the old blocks... Oh no!
 
          // Using Blockify will handle the cases where len > the NEW mMaxSamples. Previous code did not.
-         const auto blockstart = oldSeqBlock.start;
          Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-                  newBlockArray, blockstart, bufferNew.ptr(), len);
+                  newBlockArray, bufferNew.ptr(), len);
       }
    }
 
@@ -207,7 +198,8 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format)
 
    // Commit the changes to block file array
    CommitChangesIfConsistent
-      (newBlockArray, mNumSamples, wxT("Sequence::ConvertToSampleFormat()"));
+      (newBlockArray, mNumSamples, 0, newBlockArray.size(),
+       wxT("Sequence::ConvertToSampleFormat()"));
 
    // Commit the other changes
    bSuccess = true;
@@ -236,15 +228,25 @@ std::pair<float, float> Sequence::GetMinMax(
 
    // First calculate the min/max of the blocks in the middle of this region;
    // this is very fast because we have the min/max of every entire block
-   // already in memory.
-
-   for (unsigned b = block0 + 1; b < block1; ++b) {
-      auto results = mBlock[b].sb->GetMinMaxRMS(mayThrow);
-
-      if (results.min < min)
-         min = results.min;
-      if (results.max > max)
-         max = results.max;
+   // already in memory, and summaries of subtrees of blocks too.
+
+   if (block1 > block0 + 1) {
+      auto results = mBlock.Summarize(block0 + 1, block1);
+      min = results.min;
+      max = results.max;
+
+      // Read the blocks left out of the summaries
+      if (results.count < mBlock[block1].start - mBlock[block0 + 1].start)
+         for (auto iter = mBlock.IteratorAt(block0 + 1);
+              iter.Index() < block1; ++iter) {
+            const auto &sb = iter->sb;
+            if (sb->IsSummaryAvailable())
+               continue;
+            auto blockResults =
+               sb->GetMinMaxRMS(0, sb->GetSampleCount(), mayThrow);
+            min = std::min(min, blockResults.min);
+            max = std::max(max, blockResults.max);
+         }
    }
 
    // Now we take the first and last blocks into account, noting that the
@@ -312,16 +314,24 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
 
    // First calculate the rms of the blocks in the middle of this region;
    // this is very fast because we have the rms of every entire block
-   // already in memory.
-   for (unsigned b = block0 + 1; b < block1; b++) {
-      const SeqBlock &theBlock = mBlock[b];
-      const auto &sb = theBlock.sb;
-      auto results = sb->GetMinMaxRMS(mayThrow);
-
-      const auto fileLen = sb->GetSampleCount();
-      const auto blockRMS = results.RMS;
-      sumsq += blockRMS * blockRMS * fileLen;
-      length += fileLen;
+   // already in memory, and summaries of subtrees of blocks too.
+   if (block1 > block0 + 1) {
+      auto results = mBlock.Summarize(block0 + 1, block1);
+      sumsq += results.sumsq;
+      length += results.count;
+
+      // Read the blocks left out of the summaries
+      if (results.count < mBlock[block1].start - mBlock[block0 + 1].start)
+         for (auto iter = mBlock.IteratorAt(block0 + 1);
+              iter.Index() < block1; ++iter) {
+            const auto &sb = iter->sb;
+            if (sb->IsSummaryAvailable())
+               continue;
+            const auto l0 = sb->GetSampleCount();
+            auto blockResults = sb->GetMinMaxRMS(0, l0, mayThrow);
+            sumsq += (double)blockResults.RMS * blockResults.RMS * l0;
+            length += l0;
+         }
    }
 
    // Now we take the first and last blocks into account, noting that the
@@ -389,8 +399,6 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
    wxUnusedVar(numBlocks);
    wxASSERT(b0 <= b1);
 
-   dest->mBlock.reserve(b1 - b0 + 1);
-
    auto bufferSize = mMaxSamples;
    SampleBuffer buffer(bufferSize, mSampleFormat);
 
@@ -414,10 +422,10 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
       --b0;
 
    // If there are blocks in the middle, use the blocks whole
-   for (int bb = b0 + 1; bb < b1; ++bb)
-      AppendBlock(pUseFactory, mSampleFormat,
-         dest->mBlock, dest->mNumSamples, mBlock[bb]);
-      // Increase ref count or duplicate file
+   if (b0 + 1 < b1)
+      AppendBlocks(pUseFactory, mSampleFormat,
+         dest->mBlock, dest->mNumSamples, mBlock, b0 + 1, b1);
+      // Share the subtrees or duplicate files
 
    // Do the last block
    if (b1 > b0) {
@@ -434,12 +442,16 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
       }
       else
          // Special case of a whole block
-         AppendBlock(pUseFactory, mSampleFormat,
-            dest->mBlock, dest->mNumSamples, block);
+         AppendBlocks(pUseFactory, mSampleFormat,
+            dest->mBlock, dest->mNumSamples, mBlock, b1, b1 + 1);
          // Increase ref count or duplicate file
    }
 
-   dest->ConsistencyCheck(wxT("Sequence::Copy()"));
+   // Partial blocks were checked as they were appended, and shared blocks
+   // were checked here
+   ConsistencyCheck(dest->mBlock, dest->mMaxSamples,
+      0, pUseFactory ? dest->mBlock.size() : 0,
+      dest->mNumSamples, wxT("Sequence::Copy()"));
 
    return dest;
 }
@@ -521,25 +533,29 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       // onto the end because the current last block is longer than the
       // minimum size
 
-      // Build and swap a copy so there is a strong exception safety guarantee
+      // Build and swap a copy so there is a strong exception safety guarantee;
+      // the copy shares all but a few nodes of the tree
       BlockArray newBlock{ mBlock };
       sampleCount samples = mNumSamples;
-      for (unsigned int i = 0; i < srcNumBlocks; i++)
-         // AppendBlock may throw for limited disk space, if pasting from
-         // one project into another.
-         AppendBlock(pUseFactory, mSampleFormat,
-            newBlock, samples, srcBlock[i]);
+      // AppendBlocks may throw for limited disk space, if pasting from
+      // one project into another.
+      AppendBlocks(pUseFactory, mSampleFormat,
+         newBlock, samples, srcBlock, 0, srcNumBlocks);
 
+      // Shared blocks were checked in src
       CommitChangesIfConsistent
-         (newBlock, samples, wxT("Paste branch one"));
+         (newBlock, samples, numBlocks,
+          pUseFactory ? newBlock.size() : numBlocks, wxT("Paste branch one"));
       return;
    }
 
    const int b = (s == mNumSamples) ? mBlock.size() - 1 : FindBlock(s);
    wxASSERT((b >= 0) && (b < (int)numBlocks));
-   SeqBlock *const pBlock = &mBlock[b];
-   const auto length = pBlock->sb->GetSampleCount();
+   const SeqBlock splitBlock = mBlock[b];
+   const auto length = splitBlock.sb->GetSampleCount();
    const auto largerBlockLen = addedLen + length;
+   // s lies within splitBlock
+   auto splitPoint = ( s - splitBlock.start ).as_size_t();
    // PRL: when insertion point is the first sample of a block,
    // and the following test fails, perhaps we could test
    // whether coalescence with the previous block is possible.
@@ -547,39 +563,36 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       // Special case: we can fit all of the NEW samples inside of
       // one block!
 
-      SeqBlock &block = *pBlock;
       // largerBlockLen is not more than mMaxSamples...
       SampleBuffer buffer(largerBlockLen.as_size_t(), mSampleFormat);
 
       // ...and addedLen is not more than largerBlockLen
       auto sAddedLen = addedLen.as_size_t();
-      // s lies within block:
-      auto splitPoint = ( s - block.start ).as_size_t();
-      Read(buffer.ptr(), mSampleFormat, block, 0, splitPoint, true);
+      Read(buffer.ptr(), mSampleFormat, splitBlock, 0, splitPoint, true);
       src->Get(0, buffer.ptr() + splitPoint*sampleSize,
                mSampleFormat, 0, sAddedLen, true);
       Read(buffer.ptr() + (splitPoint + sAddedLen) * sampleSize,
-           mSampleFormat, block,
+           mSampleFormat, splitBlock,
            splitPoint, length - splitPoint, true);
 
       // largerBlockLen is not more than mMaxSamples...
-      block.sb = mpFactory->Create(
+      BlockArray newBlock;
+      newBlock.push_back(mpFactory->Create(
          buffer.ptr(),
          largerBlockLen.as_size_t(),
-         mSampleFormat);
-
-      // Don't make a duplicate array.  We can still give Strong-guarantee
-      // if we modify only one block in place.
+         mSampleFormat));
 
-      // use No-fail-guarantee in remaining steps
-      for (unsigned int i = b + 1; i < numBlocks; i++)
-         mBlock[i].start += addedLen;
+      // Replacing one block moves the starts of all later blocks, at the
+      // cost of a few new nodes.
+      // Strong-guarantee, then No-fail-guarantee in remaining steps
+      mBlock.Replace(b, b + 1, newBlock);
 
       mNumSamples += addedLen;
 
       // This consistency check won't throw, it asserts.
       // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Paste branch two"), false);
+      ConsistencyCheck(mBlock, mMaxSamples, b, b + 1, mNumSamples,
+         wxT("Paste branch two"), false);
       return;
    }
 
@@ -588,20 +601,12 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    // into one big block along with the split block,
    // then resplit it all
    BlockArray newBlock;
-   newBlock.reserve(numBlocks + srcNumBlocks + 2);
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b);
 
-   SeqBlock &splitBlock = mBlock[b];
-   auto splitLen = splitBlock.sb->GetSampleCount();
-   // s lies within splitBlock
-   auto splitPoint = ( s - splitBlock.start ).as_size_t();
-
-   unsigned int i;
    if (srcNumBlocks <= 4) {
 
       // addedLen is at most four times maximum block size
       auto sAddedLen = addedLen.as_size_t();
-      const auto sum = splitLen + sAddedLen;
+      const auto sum = length + sAddedLen;
 
       SampleBuffer sumBuffer(sum, mSampleFormat);
       Read(sumBuffer.ptr(), mSampleFormat, splitBlock, 0, splitPoint, true);
@@ -610,10 +615,10 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
                0, sAddedLen, true);
       Read(sumBuffer.ptr() + (splitPoint + sAddedLen) * sampleSize, mSampleFormat,
            splitBlock, splitPoint,
-           splitLen - splitPoint, true);
+           length - splitPoint, true);
 
       Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-               newBlock, splitBlock.start, sumBuffer.ptr(), sum);
+               newBlock, sumBuffer.ptr(), sum);
    } else {
 
       // The final case is that we're inserting at least five blocks.
@@ -626,11 +631,11 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
           srcBlock[0].sb->GetSampleCount() + srcBlock[1].sb->GetSampleCount();
       const auto leftLen = splitPoint + srcFirstTwoLen;
 
-      const SeqBlock &penultimate = srcBlock[srcNumBlocks - 2];
+      const SeqBlock penultimate = srcBlock[srcNumBlocks - 2];
       const auto srcLastTwoLen =
          penultimate.sb->GetSampleCount() +
          srcBlock[srcNumBlocks - 1].sb->GetSampleCount();
-      const auto rightSplit = splitBlock.sb->GetSampleCount() - splitPoint;
+      const auto rightSplit = length - splitPoint;
       const auto rightLen = rightSplit + srcLastTwoLen;
 
       SampleBuffer sampleBuffer(std::max(leftLen, rightLen), mSampleFormat);
@@ -640,14 +645,11 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          mSampleFormat, 0, srcFirstTwoLen, true);
 
       Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-               newBlock, splitBlock.start, sampleBuffer.ptr(), leftLen);
+               newBlock, sampleBuffer.ptr(), leftLen);
 
-      for (i = 2; i < srcNumBlocks - 2; i++) {
-         const SeqBlock &block = srcBlock[i];
-         auto sb = ShareOrCopySampleBlock(
-            pUseFactory, mSampleFormat, block.sb );
-         newBlock.push_back(SeqBlock(sb, block.start + s));
-      }
+      sampleCount samples = 0;
+      AppendBlocks(pUseFactory, mSampleFormat,
+         newBlock, samples, srcBlock, 2, srcNumBlocks - 2);
 
       auto lastStart = penultimate.start;
       src->Get(srcNumBlocks - 2, sampleBuffer.ptr(), mSampleFormat,
@@ -656,16 +658,17 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
            splitBlock, splitPoint, rightSplit, true);
 
       Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-               newBlock, s + lastStart, sampleBuffer.ptr(), rightLen);
+               newBlock, sampleBuffer.ptr(), rightLen);
    }
 
-   // Copy remaining blocks to NEW block array and
+   // Splice the NEW blocks in for the split block, then
    // swap the NEW block array in for the old
-   for (i = b + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(addedLen));
+   BlockArray splicedBlock{ mBlock };
+   splicedBlock.Replace(b, b + 1, newBlock);
 
    CommitChangesIfConsistent
-      (newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
+      (splicedBlock, mNumSamples + addedLen, b, b + newBlock.size(),
+       wxT("Paste branch three"));
 }
 
 /*! @excsafety{Strong} */
@@ -695,17 +698,12 @@ void Sequence::InsertSilence(sampleCount s0, sampleCount len)
 
    sampleCount pos = 0;
 
-   // Could nBlocks overflow a size_t?  Not very likely.  You need perhaps
-   // 2 ^ 52 samples which is over 3000 years at 44.1 kHz.
-   auto nBlocks = (len + idealSamples - 1) / idealSamples;
-   sTrack.mBlock.reserve(nBlocks.as_size_t());
-
    if (len >= idealSamples) {
       auto silentFile = factory.CreateSilent(
          idealSamples,
          mSampleFormat);
       while (len >= idealSamples) {
-         sTrack.mBlock.push_back(SeqBlock(silentFile, pos));
+         sTrack.mBlock.push_back(silentFile);
 
          pos += idealSamples;
          len -= idealSamples;
@@ -713,8 +711,8 @@ void Sequence::InsertSilence(sampleCount s0, sampleCount len)
    }
    if (len != 0) {
       // len is not more than idealSamples:
-      sTrack.mBlock.push_back(SeqBlock(
-         factory.CreateSilent(len.as_size_t(), mSampleFormat), pos));
+      sTrack.mBlock.push_back(
+         factory.CreateSilent(len.as_size_t(), mSampleFormat));
       pos += len;
    }
 
@@ -724,23 +722,39 @@ void Sequence::InsertSilence(sampleCount s0, sampleCount len)
    Paste(s0, &sTrack);
 }
 
-void Sequence::AppendBlock( SampleBlockFactory *pFactory, sampleFormat format,
-   BlockArray &mBlock, sampleCount &mNumSamples, const SeqBlock &b)
+void Sequence::AppendBlocks( SampleBlockFactory *pFactory, sampleFormat format,
+   BlockArray &mBlock, sampleCount &mNumSamples,
+   const BlockArray &src, size_t b0, size_t b1)
 {
-   // Quick check to make sure that it doesn't overflow
-   if (Overflows((mNumSamples.as_double()) + ((double)b.sb->GetSampleCount())))
-      THROW_INCONSISTENCY_EXCEPTION;
+   if (!pFactory) {
+      // Share the blocks, and the subtrees that hold them
+      const auto slice = src.Slice(b0, b1);
+
+      // Quick check to make sure that it doesn't overflow
+      if (Overflows(mNumSamples.as_double() + slice.GetNumSamples().as_double()))
+         THROW_INCONSISTENCY_EXCEPTION;
+
+      mBlock.Append(slice);
+      mNumSamples += slice.GetNumSamples();
+      return;
+   }
+
+   for (auto iter = src.IteratorAt(b0); iter.Index() < b1; ++iter) {
+      // Quick check to make sure that it doesn't overflow
+      if (Overflows((mNumSamples.as_double()) +
+                    ((double)iter->sb->GetSampleCount())))
+         THROW_INCONSISTENCY_EXCEPTION;
 
-   auto sb = ShareOrCopySampleBlock( pFactory, format, b.sb );
-   SeqBlock newBlock(sb, mNumSamples);
+      auto sb = ShareOrCopySampleBlock( pFactory, format, iter->sb );
 
-   // We can assume newBlock.sb is not null
+      // We can assume sb is not null
 
-   mBlock.push_back(newBlock);
-   mNumSamples += newBlock.sb->GetSampleCount();
+      mBlock.push_back(sb);
+      mNumSamples += sb->GetSampleCount();
+   }
 
    // Don't do a consistency check here because this
-   // function gets called in an inner loop.
+   // function gets called for many blocks.
 }
 
 sampleCount Sequence::GetBlockStart(sampleCount position) const
@@ -759,17 +773,16 @@ size_t Sequence::GetBestBlockSize(sampleCount start) const
    if (start < 0 || start >= mNumSamples)
       return mMaxSamples;
 
-   int b = FindBlock(start);
-   int numBlocks = mBlock.size();
+   auto iter = mBlock.IteratorAt(FindBlock(start));
+   const auto end = mBlock.end();
 
-   const SeqBlock &block = mBlock[b];
+   const SeqBlock block = *iter;
    // start is in block:
    auto result = (block.start + block.sb->GetSampleCount() - start).as_size_t();
 
    decltype(result) length;
-   while(result < mMinSamples && b+1<numBlocks &&
-         ((length = mBlock[b+1].sb->GetSampleCount()) + result) <= mMaxSamples) {
-      b++;
+   while(result < mMinSamples && ++iter != end &&
+         ((length = iter->sb->GetSampleCount()) + result) <= mMaxSamples) {
       result += length;
    }
 
@@ -786,9 +799,15 @@ bool Sequence::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    if (!wxStrcmp(tag, wxT("waveblock")))
    {
       SeqBlock wb;
+      sampleCount start = 0;
 
-      // Give SampleBlock a go at the attributes first
-      wb.sb = factory.CreateFromXML(mSampleFormat, attrs);
+      // Give SampleBlock a go at the attributes first, unless the block
+      // was still reading from an imported file when saved
+      if (OnDemandSampleBlockFactory::IsOnDemandXML(attrs))
+         wb.sb = OnDemandSampleBlockFactory::CopyFromXML(
+            factory, mSampleFormat, attrs);
+      else
+         wb.sb = factory.CreateFromXML(mSampleFormat, attrs);
       if (wb.sb == nullptr)
       {
          mErrorOpening = true;
@@ -819,11 +838,26 @@ bool Sequence::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
                return false;
             }
 
-            wb.start = nValue;
+            start = nValue;
          }
       }
 
-      mBlock.push_back(wb);
+      // Make sure that start times and lengths are consistent
+      wb.start = mBlock.GetNumSamples();
+      if (start != wb.start)
+      {
+         wxLogWarning(
+            wxT("Gap detected in project file.\n")
+            wxT("   Start (%s) for block file %lld is not one sample past end of previous block (%s).\n")
+            wxT("   Moving start so blocks are contiguous."),
+            // PRL:  Why bother with Internat when the above is just wxT?
+            Internat::ToString(start.as_double(), 0),
+            wb.sb->GetBlockID(),
+            Internat::ToString(wb.start.as_double(), 0));
+         mErrorOpening = true;
+      }
+
+      mBlock.push_back(wb.sb);
 
       return true;
    }
@@ -904,26 +938,8 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
 
    // Make sure that the sequence is valid.
 
-   // Make sure that start times and lengths are consistent
-   sampleCount numSamples = 0;
-   for (unsigned b = 0, nn = mBlock.size(); b < nn;  b++)
-   {
-      SeqBlock &block = mBlock[b];
-      if (block.start != numSamples)
-      {
-         wxLogWarning(
-            wxT("Gap detected in project file.\n")
-            wxT("   Start (%s) for block file %lld is not one sample past end of previous block (%s).\n")
-            wxT("   Moving start so blocks are contiguous."),
-            // PRL:  Why bother with Internat when the above is just wxT?
-            Internat::ToString(block.start.as_double(), 0),
-            block.sb->GetBlockID(),
-            Internat::ToString(numSamples.as_double(), 0));
-         block.start = numSamples;
-         mErrorOpening = true;
-      }
-      numSamples += block.sb->GetSampleCount();
-   }
+   // Starts of blocks were checked as they were read
+   const auto numSamples = mBlock.GetNumSamples();
 
    if (mNumSamples != numSamples)
    {
@@ -951,17 +967,13 @@ XMLTagHandler *Sequence::HandleXMLChild(const wxChar *tag)
 void Sequence::WriteXML(XMLWriter &xmlFile) const
 // may throw
 {
-   unsigned int b;
-
    xmlFile.StartTag(wxT("sequence"));
 
    xmlFile.WriteAttr(wxT("maxsamples"), mMaxSamples);
    xmlFile.WriteAttr(wxT("sampleformat"), (size_t)mSampleFormat);
    xmlFile.WriteAttr(wxT("numsamples"), mNumSamples.as_long_long() );
 
-   for (b = 0; b < mBlock.size(); b++) {
-      const SeqBlock &bb = mBlock[b];
-
+   for (const auto &bb : mBlock) {
       // See http://bugzilla.audacityteam.org/show_bug.cgi?id=451.
       if (bb.sb->GetSampleCount() > mMaxSamples)
       {
@@ -996,47 +1008,10 @@ int Sequence::FindBlock(sampleCount pos) const
 {
    wxASSERT(pos >= 0 && pos < mNumSamples);
 
-   if (pos == 0)
-      return 0;
+   // A descent of the tree of blocks, by the sample counts of subtrees
+   const int rval = mBlock.FindBlock(pos);
 
-   int numBlocks = mBlock.size();
-
-   size_t lo = 0, hi = numBlocks, guess;
-   sampleCount loSamples = 0, hiSamples = mNumSamples;
-
-   while (true) {
-      //this is not a binary search, but a
-      //dictionary search where we guess something smarter than the binary division
-      //of the unsearched area, since samples are usually proportional to block file number.
-      const double frac = (pos - loSamples).as_double() /
-         (hiSamples - loSamples).as_double();
-      guess = std::min(hi - 1, lo + size_t(frac * (hi - lo)));
-      const SeqBlock &block = mBlock[guess];
-
-      wxASSERT(block.sb->GetSampleCount() > 0);
-      wxASSERT(lo <= guess && guess < hi && lo < hi);
-
-      if (pos < block.start) {
-         wxASSERT(lo != guess);
-         hi = guess;
-         hiSamples = block.start;
-      }
-      else {
-         const sampleCount nextStart = block.start + block.sb->GetSampleCount();
-         if (pos < nextStart)
-            break;
-         else {
-            wxASSERT(guess < hi - 1);
-            lo = guess + 1;
-            loSamples = nextStart;
-         }
-      }
-   }
-
-   const int rval = guess;
-   wxASSERT(rval >= 0 && rval < numBlocks &&
-            pos >= mBlock[rval].start &&
-            pos < mBlock[rval].start + mBlock[rval].sb->GetSampleCount());
+   wxASSERT(rval >= 0 && rval < (int)mBlock.size());
 
    return rval;
 }
@@ -1085,8 +1060,8 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
    bool result = true;
-   while (len) {
-      const SeqBlock &block = mBlock[b];
+   for (auto iter = mBlock.IteratorAt(b); len; ++iter) {
+      const SeqBlock &block = *iter;
       // start is in block
       const auto bstart = (start - block.start).as_size_t();
       // bstart is not more than block length
@@ -1097,7 +1072,6 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
 
       len -= blen;
       buffer += (blen * SAMPLE_SIZE(format));
-      b++;
       start += blen;
    }
    return result;
@@ -1124,19 +1098,19 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
       temp.Allocate(tempSize, mSampleFormat);
    }
 
-   int b = FindBlock(start);
+   const int b0 = FindBlock(start);
+   int b = b0;
+   // Replacements for blocks [b0, b)
    BlockArray newBlock;
-   std::copy( mBlock.begin(), mBlock.begin() + b, std::back_inserter(newBlock) );
 
-   while (len > 0
+   for (auto iter = mBlock.IteratorAt(b0); len > 0
       // Redundant termination condition,
       // but it guards against infinite loop in case of inconsistencies
       // (too-small files, not yet seen?)
       // that cause the loop to make no progress because blen == 0
-      && b < (int)size
+      && b < (int)size; ++iter
    ) {
-      newBlock.push_back( mBlock[b] );
-      SeqBlock &block = newBlock.back();
+      SeqBlock block = *iter;
       // start is within block
       const auto bstart = ( start - block.start ).as_size_t();
       const auto fileLength = block.sb->GetSampleCount();
@@ -1199,6 +1173,8 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
             block.sb = factory.CreateSilent(fileLength, mSampleFormat);
       }
 
+      newBlock.push_back( block.sb );
+
       // blen might be zero for inconsistent Sequence...
       if( buffer )
          buffer += (blen * SAMPLE_SIZE(format));
@@ -1210,9 +1186,12 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
       b++;
    }
 
-   std::copy( mBlock.begin() + b, mBlock.end(), std::back_inserter(newBlock) );
+   // Splice the NEW blocks in for the old, sharing the rest
+   BlockArray splicedBlock{ mBlock };
+   splicedBlock.Replace( b0, b, newBlock );
 
-   CommitChangesIfConsistent( newBlock, mNumSamples, wxT("SetSamples") );
+   CommitChangesIfConsistent(
+      splicedBlock, mNumSamples, b0, b, wxT("SetSamples") );
 }
 
 namespace {
@@ -1222,6 +1201,12 @@ struct MinMaxSumsq
    MinMaxSumsq(const float *pv, int count, int divisor)
    {
       min = FLT_MAX, max = -FLT_MAX, sumsq = 0.0f;
+      if (divisor == 1 && count > 0) {
+         // array holds samples
+         const auto values = SummarizeSamples(pv, count);
+         min = values.min, max = values.max, sumsq = values.sumsq;
+         return;
+      }
       while (count--) {
          float v;
          switch (divisor) {
@@ -1315,15 +1300,48 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
                 (whereNext = std::min(s1 - 1, where[nextPixel])) < nextSrcX)
             ++nextPixel;
       }
-      if (nextPixel == pixel)
+      if (nextPixel == pixel) {
          // The entire block's samples fall within one pixel column.
          // Either it's a rare odd block at the end, or else,
          // we must be really zoomed out!
-         // Omit the entire block's contents from min/max/rms
-         // calculation, which is not correct, but correctness might not
-         // be worth the compute time if this happens every pixel
-         // column. -- PRL
+         // So do all of the following blocks before the next column, using
+         // the summaries of subtrees of whole blocks, which are in memory.
+         // Then the cost of drawing depends on the number of columns,
+         // not on the length of the sequence.
+         const auto bEnd = (unsigned) FindBlock(
+            (pixel < len) ? std::min(s1 - 1, where[pixel]) : s1 - 1);
+         if (bEnd == b)
+            // A partial block at the end, after the start of the last
+            // column.  Omit it, which is not correct, but correctness might
+            // not be worth the compute time. -- PRL
+            continue;
+         if (pixel > 0) {
+            const auto values = mBlock.Summarize(b, bEnd);
+            const int lastPixel = pixel - 1;
+            if (values.count < mBlock[bEnd].start - start)
+               // Some summaries are not yet available
+               bl[lastPixel] = -1 - b;
+            float &lastMin = min[lastPixel];
+            lastMin = std::min(lastMin, values.min);
+            float &lastMax = max[lastPixel];
+            lastMax = std::max(lastMax, values.max);
+            float &lastRms = rms[lastPixel];
+            const double lastNumSamples = (double)lastRmsDenom * lastDivisor;
+            const double numSamples = lastNumSamples + values.count.as_double();
+            lastRms = sqrt(
+               (lastRms * lastRms * lastNumSamples + values.sumsq) /
+               numSamples
+            );
+            // Later imputations to this column count the samples
+            lastDivisor = 1;
+            lastRmsDenom = (int)std::min<double>(INT_MAX, numSamples);
+         }
+         b = bEnd - 1;
+         const SeqBlock &lastBlock = mBlock[b];
+         nextSrcX = std::min(s1,
+            lastBlock.start + lastBlock.sb->GetSampleCount());
          continue;
+      }
       if (nextPixel == len)
          whereNext = s1;
 
@@ -1372,12 +1390,18 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
          // Ignore the return value.
          // This function fills with zeroes if read fails
          seqBlock.sb->GetSummary256(temp.get(), startPosition, num);
+         //check to see if summary data has been computed
+         if (!seqBlock.sb->IsSummaryAvailable())
+            //otherwise, mark the display as not yet computed
+            blockStatus = -1 - b;
          break;
       case 65536:
          // Read triples
          // Ignore the return value.
          // This function fills with zeroes if read fails
          seqBlock.sb->GetSummary64k(temp.get(), startPosition, num);
+         if (!seqBlock.sb->IsSummaryAvailable())
+            blockStatus = -1 - b;
          break;
       }
       
@@ -1487,16 +1511,15 @@ void Sequence::Append(samplePtr buffer, sampleFormat format, size_t len)
 
    // If the last block is not full, we need to add samples to it
    int numBlocks = mBlock.size();
-   SeqBlock *pLastBlock;
-   decltype(pLastBlock->sb->GetSampleCount()) length;
+   SeqBlock lastBlock;
+   decltype(lastBlock.sb->GetSampleCount()) length;
    size_t bufferSize = mMaxSamples;
    SampleBuffer buffer2(bufferSize, mSampleFormat);
    bool replaceLast = false;
    if (numBlocks > 0 &&
        (length =
-        (pLastBlock = &mBlock.back())->sb->GetSampleCount()) < mMinSamples) {
+        (lastBlock = mBlock.back()).sb->GetSampleCount()) < mMinSamples) {
       // Enlarge a sub-minimum block at the end
-      const SeqBlock &lastBlock = *pLastBlock;
       const auto addLen = std::min(mMaxSamples - length, len);
 
       Read(buffer2.ptr(), mSampleFormat, lastBlock, 0, length, true);
@@ -1512,9 +1535,8 @@ void Sequence::Append(samplePtr buffer, sampleFormat format, size_t len)
          buffer2.ptr(),
          newLastBlockLen,
          mSampleFormat);
-      SeqBlock newLastBlock(pBlock, lastBlock.start);
 
-      newBlock.push_back( newLastBlock );
+      newBlock.push_back( pBlock );
 
       len -= addLen;
       newNumSamples += addLen;
@@ -1535,7 +1557,7 @@ void Sequence::Append(samplePtr buffer, sampleFormat format, size_t len)
          pBlock = factory.Create(buffer2.ptr(), addedLen, mSampleFormat);
       }
 
-      newBlock.push_back(SeqBlock(pBlock, newNumSamples));
+      newBlock.push_back(pBlock);
 
       buffer += addedLen * SAMPLE_SIZE(format);
       newNumSamples += addedLen;
@@ -1553,27 +1575,36 @@ void Sequence::Append(samplePtr buffer, sampleFormat format, size_t len)
 #endif
 }
 
+void Sequence::AppendSharedBlock(const SeqBlock::SampleBlockPtr &pBlock)
+{
+   const auto len = pBlock->GetSampleCount();
+
+   // Quick check to make sure that it doesn't overflow
+   if (Overflows(mNumSamples.as_double() + ((double)len)))
+      THROW_INCONSISTENCY_EXCEPTION;
+
+   BlockArray newBlock;
+   newBlock.push_back( pBlock );
+
+   AppendBlocksIfConsistent(newBlock, false,
+                            mNumSamples + len, wxT("AppendSharedBlock"));
+}
+
 void Sequence::Blockify(SampleBlockFactory &factory,
                         size_t mMaxSamples, sampleFormat mSampleFormat,
-                        BlockArray &list, sampleCount start, samplePtr buffer, size_t len)
+                        BlockArray &list, samplePtr buffer, size_t len)
 {
    if (len <= 0)
       return;
 
    auto num = (len + (mMaxSamples - 1)) / mMaxSamples;
-   list.reserve(list.size() + num);
 
    for (decltype(num) i = 0; i < num; i++) {
-      SeqBlock b;
-
       const auto offset = i * len / num;
-      b.start = start + offset;
       int newLen = ((i + 1) * len / num) - offset;
       samplePtr bufStart = buffer + (offset * SAMPLE_SIZE(mSampleFormat));
 
-      b.sb = factory.Create(bufStart, newLen, mSampleFormat);
-
-      list.push_back(b);
+      list.push_back(factory.Create(bufStart, newLen, mSampleFormat));
    }
 }
 
@@ -1595,8 +1626,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
 
    auto sampleSize = SAMPLE_SIZE(mSampleFormat);
 
-   SeqBlock *pBlock;
-   decltype(pBlock->sb->GetSampleCount()) length;
+   SeqBlock block0;
+   decltype(block0.sb->GetSampleCount()) length;
 
    // One buffer for reuse in various branches here
    SampleBuffer scratch;
@@ -1607,8 +1638,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    // block and the resulting length is not too small, perform the
    // deletion within this block:
    if (b0 == b1 &&
-       (length = (pBlock = &mBlock[b0])->sb->GetSampleCount()) - len >= mMinSamples) {
-      SeqBlock &b = *pBlock;
+       (length = (block0 = mBlock[b0]).sb->GetSampleCount()) - len >= mMinSamples) {
+      const SeqBlock &b = block0;
       // start is within block
       auto pos = ( start - b.start ).as_size_t();
 
@@ -1629,39 +1660,33 @@ void Sequence::Delete(sampleCount start, sampleCount len)
            // is not more than the length of the block
            ( pos + len ).as_size_t(), newLen - pos, true);
 
-      b.sb = factory.Create(scratch.ptr(), newLen, mSampleFormat);
-
-      // Don't make a duplicate array.  We can still give Strong-guarantee
-      // if we modify only one block in place.
+      BlockArray newBlock;
+      newBlock.push_back(factory.Create(scratch.ptr(), newLen, mSampleFormat));
 
-      // use No-fail-guarantee in remaining steps
-
-      for (unsigned int j = b0 + 1; j < numBlocks; j++)
-         mBlock[j].start -= len;
+      // Replacing one block moves the starts of all later blocks, at the
+      // cost of a few new nodes.
+      // Strong-guarantee, then No-fail-guarantee in remaining steps
+      mBlock.Replace(b0, b0 + 1, newBlock);
 
       mNumSamples -= len;
 
       // This consistency check won't throw, it asserts.
       // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Delete - branch one"), false);
+      ConsistencyCheck(mBlock, mMaxSamples, b0, b0 + 1, mNumSamples,
+         wxT("Delete - branch one"), false);
       return;
    }
 
-   // Create a NEW array of blocks
+   // Create a NEW array of blocks to replace blocks [first, b1] of the old
    BlockArray newBlock;
-   newBlock.reserve(numBlocks - (b1 - b0) + 2);
-
-   // Copy the blocks before the deletion point over to
-   // the NEW array
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b0);
-   unsigned int i;
+   unsigned int first = b0;
 
    // First grab the samples in block b0 before the deletion point
    // into preBuffer.  If this is enough samples for its own block,
    // or if this would be the first block in the array, write it out.
    // Otherwise combine it with the previous block (splitting them
    // 50/50 if necessary).
-   const SeqBlock &preBlock = mBlock[b0];
+   const SeqBlock preBlock = mBlock[b0];
    // start is within preBlock
    auto preBufferLen = ( start - preBlock.start ).as_size_t();
    if (preBufferLen) {
@@ -1673,9 +1698,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          auto pFile =
             factory.Create(scratch.ptr(), preBufferLen, mSampleFormat);
 
-         newBlock.push_back(SeqBlock(pFile, preBlock.start));
+         newBlock.push_back(pFile);
       } else {
-         const SeqBlock &prepreBlock = mBlock[b0 - 1];
+         const SeqBlock prepreBlock = mBlock[b0 - 1];
          const auto prepreLen = prepreBlock.sb->GetSampleCount();
          const auto sum = prepreLen + preBufferLen;
 
@@ -1688,9 +1713,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          Read(scratch.ptr() + prepreLen*sampleSize, mSampleFormat,
               preBlock, 0, preBufferLen, true);
 
-         newBlock.pop_back();
+         --first;
          Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-                  newBlock, prepreBlock.start, scratch.ptr(), sum);
+                  newBlock, scratch.ptr(), sum);
       }
    }
    else {
@@ -1703,7 +1728,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    // for its own block, or if this would be the last block in
    // the array, write it out.  Otherwise combine it with the
    // subsequent block (splitting them 50/50 if necessary).
-   const SeqBlock &postBlock = mBlock[b1];
+   const SeqBlock postBlock = mBlock[b1];
    // start + len - 1 lies within postBlock
    const auto postBufferLen = (
        (postBlock.start + postBlock.sb->GetSampleCount()) - (start + len)
@@ -1719,9 +1744,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          auto file =
             factory.Create(scratch.ptr(), postBufferLen, mSampleFormat);
 
-         newBlock.push_back(SeqBlock(file, start));
+         newBlock.push_back(file);
       } else {
-         SeqBlock &postpostBlock = mBlock[b1 + 1];
+         const SeqBlock postpostBlock = mBlock[b1 + 1];
          const auto postpostLen = postpostBlock.sb->GetSampleCount();
          const auto sum = postpostLen + postBufferLen;
 
@@ -1735,7 +1760,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
               postpostBlock, 0, postpostLen, true);
 
          Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-                  newBlock, start, scratch.ptr(), sum);
+                  newBlock, scratch.ptr(), sum);
          b1++;
       }
    }
@@ -1744,21 +1769,24 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       // right on the end of a block.
    }
 
-   // Copy the remaining blocks over from the old array
-   for (i = b1 + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(-len));
+   // Splice the NEW blocks in for the old, sharing the remaining blocks
+   // before and after, whose starts need no adjustment
+   BlockArray splicedBlock{ mBlock };
+   splicedBlock.Replace(first, b1 + 1, newBlock);
 
    CommitChangesIfConsistent
-      (newBlock, mNumSamples - len, wxT("Delete - branch two"));
+      (splicedBlock, mNumSamples - len, first, first + newBlock.size(),
+       wxT("Delete - branch two"));
 }
 
 void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
 {
-   ConsistencyCheck(mBlock, mMaxSamples, 0, mNumSamples, whereStr, mayThrow);
+   ConsistencyCheck(mBlock, mMaxSamples, 0, mBlock.size(), mNumSamples,
+      whereStr, mayThrow);
 }
 
 void Sequence::ConsistencyCheck
-   (const BlockArray &mBlock, size_t maxSamples, size_t from,
+   (const BlockArray &mBlock, size_t maxSamples, size_t from, size_t to,
     sampleCount mNumSamples, const wxChar *whereStr,
     bool WXUNUSED(mayThrow))
 {
@@ -1766,28 +1794,20 @@ void Sequence::ConsistencyCheck
    // gives a little more discrimination
    Optional<InconsistencyException> ex;
 
-   unsigned int numBlocks = mBlock.size();
-
-   unsigned int i;
-   sampleCount pos = from < numBlocks ? mBlock[from].start : mNumSamples;
-   if ( from == 0 && pos != 0 )
-      ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
-
-   for (i = from; !ex && i < numBlocks; i++) {
-      const SeqBlock &seqBlock = mBlock[i];
-      if (pos != seqBlock.start)
-         ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
-
+   // Starts are contiguous by construction; check the new blocks only, so
+   // that edits cost time in proportion to what they change
+   for (auto iter = mBlock.IteratorAt(from);
+        !ex && iter.Index() < std::min(to, mBlock.size()); ++iter) {
+      const SeqBlock &seqBlock = *iter;
       if ( seqBlock.sb ) {
          const auto length = seqBlock.sb->GetSampleCount();
          if (length > maxSamples)
             ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
-         pos += length;
       }
       else
          ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
    }
-   if ( !ex && pos != mNumSamples )
+   if ( !ex && mBlock.GetNumSamples() != mNumSamples )
       ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
 
    if ( ex )
@@ -1809,9 +1829,10 @@ void Sequence::ConsistencyCheck
 }
 
 void Sequence::CommitChangesIfConsistent
-   (BlockArray &newBlock, sampleCount numSamples, const wxChar *whereStr)
+   (BlockArray &newBlock, sampleCount numSamples,
+    size_t from, size_t to, const wxChar *whereStr)
 {
-   ConsistencyCheck( newBlock, mMaxSamples, 0, numSamples, whereStr ); // may throw
+   ConsistencyCheck( newBlock, mMaxSamples, from, to, numSamples, whereStr ); // may throw
 
    // now commit
    // use No-fail-guarantee
@@ -1830,64 +1851,40 @@ void Sequence::AppendBlocksIfConsistent
    if (additionalBlocks.empty())
       return;
 
-   bool tmpValid = false;
-   SeqBlock tmp;
+   // The copy shares all but a few nodes of the tree
+   BlockArray newBlock{ mBlock };
+   if ( replaceLast && ! newBlock.empty() )
+      newBlock.pop_back();
 
-   if ( replaceLast && ! mBlock.empty() ) {
-      tmp = mBlock.back(), tmpValid = true;
-      mBlock.pop_back();
-   }
-
-   auto prevSize = mBlock.size();
-
-   bool consistent = false;
-   auto cleanup = finally( [&] {
-      if ( !consistent ) {
-         mBlock.resize( prevSize );
-         if ( tmpValid )
-            mBlock.push_back( tmp );
-      }
-   } );
-
-   std::copy( additionalBlocks.begin(), additionalBlocks.end(),
-              std::back_inserter( mBlock ) );
+   const auto prevSize = newBlock.size();
+   newBlock.Append( additionalBlocks );
 
    // Check consistency only of the blocks that were added,
    // avoiding quadratic time for repeated checking of repeating appends
-   ConsistencyCheck( mBlock, mMaxSamples, prevSize, numSamples, whereStr ); // may throw
-
-   // now commit
-   // use No-fail-guarantee
-
-   mNumSamples = numSamples;
-   consistent = true;
+   CommitChangesIfConsistent( newBlock, numSamples,
+      prevSize, newBlock.size(), whereStr ); // may throw
 }
 
 void Sequence::DebugPrintf
    (const BlockArray &mBlock, sampleCount mNumSamples, wxString *dest)
 {
-   unsigned int i;
-   decltype(mNumSamples) pos = 0;
+   unsigned int i = 0;
 
-   for (i = 0; i < mBlock.size(); i++) {
-      const SeqBlock &seqBlock = mBlock[i];
+   for (const auto &seqBlock : mBlock) {
       *dest += wxString::Format
          (wxT("   Block %3u: start %8lld, len %8lld, refs %ld, id %lld"),
-          i,
+          i++,
           seqBlock.start.as_long_long(),
           seqBlock.sb ? (long long) seqBlock.sb->GetSampleCount() : 0,
           seqBlock.sb ? seqBlock.sb.use_count() : 0,
           seqBlock.sb ? (long long) seqBlock.sb->GetBlockID() : 0);
 
-      if ((pos != seqBlock.start) || !seqBlock.sb)
+      if (!seqBlock.sb)
          *dest += wxT("      ERROR\n");
       else
          *dest += wxT("\n");
-
-      if (seqBlock.sb)
-         pos += seqBlock.sb->GetSampleCount();
    }
-   if (pos != mNumSamples)
+   if (mBlock.GetNumSamples() != mNumSamples)
       *dest += wxString::Format
          (wxT("ERROR mNumSamples = %lld\n"), mNumSamples.as_long_long());
 }
@@ -13,6 +13,7 @@
 
 #include <vector>
 
+#include "BlockArray.h"
 #include "SampleFormat.h"
 #include "xml/XMLTagHandler.h"
 
@@ -22,31 +23,6 @@ class SampleBlock;
 class SampleBlockFactory;
 using SampleBlockFactoryPtr = std::shared_ptr<SampleBlockFactory>;
 
-// This is an internal data structure!  For advanced use only.
-class SeqBlock {
- public:
-   using SampleBlockPtr = std::shared_ptr<SampleBlock>;
-   SampleBlockPtr sb;
-   ///the sample in the global wavetrack that this block starts at.
-   sampleCount start;
-
-   SeqBlock()
-      : sb{}, start(0)
-   {}
-
-   SeqBlock(const SampleBlockPtr &sb_, sampleCount start_)
-      : sb(sb_), start(start_)
-   {}
-
-   // Construct a SeqBlock with changed start, same file
-   SeqBlock Plus(sampleCount delta) const
-   {
-      return SeqBlock(sb, start + delta);
-   }
-};
-class BlockArray : public std::vector<SeqBlock> {};
-using BlockPtrArray = std::vector<SeqBlock*>; // non-owning pointers
-
 class PROFILE_DLL_API Sequence final : public XMLTagHandler{
  public:
 
@@ -103,6 +79,9 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    size_t GetIdealAppendLen() const;
    void Append(samplePtr buffer, sampleFormat format, size_t len);
+   // Append a block as it is, without copying its samples; it must have
+   // no more than GetMaxBlockSize() samples
+   void AppendSharedBlock(const SeqBlock::SampleBlockPtr &pBlock);
    void Delete(sampleCount start, sampleCount len);
 
    void SetSilence(sampleCount s0, sampleCount len);
@@ -196,10 +175,12 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    int FindBlock(sampleCount pos) const;
 
-   static void AppendBlock(SampleBlockFactory *pFactory, sampleFormat format,
-                           BlockArray &blocks,
-                           sampleCount &numSamples,
-                           const SeqBlock &b);
+   // Append blocks [b0, b1) of src, sharing them, or copying them into
+   // pFactory if not null
+   static void AppendBlocks(SampleBlockFactory *pFactory, sampleFormat format,
+                            BlockArray &blocks,
+                            sampleCount &numSamples,
+                            const BlockArray &src, size_t b0, size_t b1);
 
    static bool Read(samplePtr buffer,
                     sampleFormat format,
@@ -215,7 +196,6 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
                         size_t maxSamples,
                         sampleFormat format,
                         BlockArray &list,
-                        sampleCount start,
                         samplePtr buffer,
                         size_t len);
 
@@ -242,8 +222,10 @@ public:
       (const BlockArray &block, sampleCount numSamples, wxString *dest);
 
 private:
+   // Checks blocks [from, to), which are new, and the total length; blocks
+   // are contiguous by construction of BlockArray
    static void ConsistencyCheck
-      (const BlockArray &block, size_t maxSamples, size_t from,
+      (const BlockArray &block, size_t maxSamples, size_t from, size_t to,
        sampleCount numSamples, const wxChar *whereStr,
        bool mayThrow = true);
 
@@ -251,8 +233,10 @@ private:
    // They either throw because final consistency check fails, or swap the
    // changed contents into place.
 
+   // Blocks [from, to) of newBlock are new
    void CommitChangesIfConsistent
-      (BlockArray &newBlock, sampleCount numSamples, const wxChar *whereStr);
+      (BlockArray &newBlock, sampleCount numSamples,
+       size_t from, size_t to, const wxChar *whereStr);
 
    void AppendBlocksIfConsistent
       (BlockArray &additionalBlocks, bool replaceLast,
@@ -8,12 +8,17 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 **********************************************************************/
 
+#include <atomic>
 #include <float.h>
+#include <mutex>
 #include <sqlite3.h>
 
 #include "DBConnection.h"
+#include "Prefs.h"
+#include "Profiler.h"
 #include "ProjectFileIO.h"
 #include "SampleFormat.h"
+#include "SummaryKernels.h"
 #include "xml/XMLTagHandler.h"
 
 #include "SampleBlock.h" // to inherit
@@ -63,6 +68,7 @@ public:
 
 private:
    void Load(SampleBlockID sbid);
+   void EnsureLoaded();
    bool GetSummary(float *dest,
                    size_t frameoffset,
                    size_t numframes,
@@ -96,7 +102,8 @@ private:
    friend SqliteSampleBlockFactory;
 
    const std::shared_ptr<ConnectionPtr> mppConnection;
-   bool mValid;
+   // Atomic, because readers on several threads may load the block at once
+   std::atomic<bool> mValid{ false };
    bool mDirty;
    bool mSilent;
    bool mLocked = false;
@@ -143,12 +150,32 @@ public:
       sampleFormat srcformat,
       const wxChar **attrs) override;
 
+   bool GetSpectrumTile(
+      SpectrumTileKey key, std::vector<float> &tile) override;
+   void PutSpectrumTile(
+      SpectrumTileKey key, const float *tile, size_t count) override;
+
 private:
+   DBConnection *TileConnection();
+   void EvictSpectrumTiles(size_t tileBytes);
+
    const std::shared_ptr<ConnectionPtr> mppConnection;
+
+   // Limit on the bytes of spectrogram tiles kept in the project; zero
+   // disables the tile cache
+   const unsigned long long mTileBudget;
+
+   // Usage of the spectrumtiles table, counted from the first use of the
+   // current connection
+   DBConnection *mTileConnection{};
+   unsigned long long mTileBytes{};
+   long long mTileClock{};
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
    : mppConnection{ ConnectionPtr::Get(project).shared_from_this() }
+   , mTileBudget{ 1024ULL * 1024ULL * std::max(0L,
+      gPrefs->Read(wxT("/Performance/SpectrumTileCacheMB"), 256L)) }
 {
    
 }
@@ -239,6 +266,153 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromXML(
    return sb;
 }
 
+DBConnection *SqliteSampleBlockFactory::TileConnection()
+{
+   if (mTileBudget == 0)
+      return nullptr;
+
+   auto pConnection = mppConnection->mpConnection.get();
+   if (pConnection && pConnection != mTileConnection)
+   {
+      // First use, or the project was redirected to another database;
+      // find the usage of the table and the latest use of any tile
+      mTileConnection = pConnection;
+      mTileBytes = 0;
+      mTileClock = 0;
+
+      sqlite3_stmt *stmt = pConnection->Prepare(
+         DBConnection::GetSpectrumTileUsage,
+         "SELECT IFNULL(SUM(length(data)), 0), IFNULL(MAX(lastused), 0)"
+         "  FROM spectrumtiles;");
+      if (sqlite3_step(stmt) == SQLITE_ROW)
+      {
+         mTileBytes = sqlite3_column_int64(stmt, 0);
+         mTileClock = sqlite3_column_int64(stmt, 1);
+      }
+      sqlite3_reset(stmt);
+   }
+
+   return pConnection;
+}
+
+bool SqliteSampleBlockFactory::GetSpectrumTile(
+   SpectrumTileKey key, std::vector<float> &tile)
+{
+   auto pConnection = TileConnection();
+   if (!pConnection)
+      return false;
+
+   // Prepare and cache statement...automatically finalized at DB close
+   sqlite3_stmt *stmt = pConnection->Prepare(DBConnection::GetSpectrumTile,
+      "SELECT data FROM spectrumtiles WHERE tileid = ?1;");
+
+   if (sqlite3_bind_int64(stmt, 1, (sqlite3_int64) key))
+   {
+      wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+   }
+
+   bool found = false;
+   if (sqlite3_step(stmt) == SQLITE_ROW)
+   {
+      auto data = (const float *) sqlite3_column_blob(stmt, 0);
+      auto bytes = sqlite3_column_bytes(stmt, 0);
+      auto count = bytes / sizeof(float);
+      tile.assign(data, data + count);
+      pConnection->CountBytes(stmt, bytes, 0);
+      found = true;
+   }
+
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+
+   if (found)
+   {
+      // Remember the use, so that eviction discards the least recently
+      // used tiles first
+      stmt = pConnection->Prepare(DBConnection::TouchSpectrumTile,
+         "UPDATE spectrumtiles SET lastused = ?2 WHERE tileid = ?1;");
+      if (sqlite3_bind_int64(stmt, 1, (sqlite3_int64) key) ||
+          sqlite3_bind_int64(stmt, 2, ++mTileClock))
+      {
+         wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+      }
+      sqlite3_step(stmt);
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+   }
+
+   return found;
+}
+
+void SqliteSampleBlockFactory::PutSpectrumTile(
+   SpectrumTileKey key, const float *tile, size_t count)
+{
+   auto pConnection = TileConnection();
+   if (!pConnection)
+      return;
+
+   const size_t tileBytes = count * sizeof(float);
+
+   // Prepare and cache statement...automatically finalized at DB close
+   sqlite3_stmt *stmt = pConnection->Prepare(DBConnection::PutSpectrumTile,
+      "INSERT OR REPLACE INTO spectrumtiles (tileid, lastused, data)"
+      "                                 VALUES(?1,?2,?3);");
+
+   if (sqlite3_bind_int64(stmt, 1, (sqlite3_int64) key) ||
+       sqlite3_bind_int64(stmt, 2, ++mTileClock) ||
+       sqlite3_bind_blob(stmt, 3, tile, tileBytes, SQLITE_STATIC))
+   {
+      wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+   }
+
+   const auto rc = sqlite3_step(stmt);
+   if (rc != SQLITE_DONE)
+   {
+      wxLogDebug(wxT("SqliteSampleBlockFactory::PutSpectrumTile - SQLITE error %s"),
+         sqlite3_errmsg(pConnection->DB()));
+   }
+   else
+   {
+      mTileBytes += tileBytes;
+      pConnection->CountBytes(stmt, 0, tileBytes);
+   }
+
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+
+   if (mTileBytes > mTileBudget)
+      EvictSpectrumTiles(tileBytes);
+}
+
+void SqliteSampleBlockFactory::EvictSpectrumTiles(size_t tileBytes)
+{
+   auto pConnection = mTileConnection;
+
+   // Discard the least recently used tiles, down to three quarters of the
+   // budget, so that eviction is not done for every new tile
+   const auto excess = mTileBytes - mTileBudget * 3 / 4;
+   const auto count = (excess + tileBytes - 1) / std::max<size_t>(1, tileBytes);
+
+   sqlite3_stmt *stmt = pConnection->Prepare(DBConnection::EvictSpectrumTiles,
+      "DELETE FROM spectrumtiles WHERE tileid IN"
+      "  (SELECT tileid FROM spectrumtiles ORDER BY lastused LIMIT ?1);");
+
+   if (sqlite3_bind_int64(stmt, 1, (sqlite3_int64) count))
+   {
+      wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+   }
+
+   sqlite3_step(stmt);
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+
+   // Tiles may differ in size; count the usage again
+   mTileConnection = nullptr;
+   TileConnection();
+}
+
 SampleBlockPtr SqliteSampleBlockFactory::DoGet( SampleBlockID sbid )
 {
    auto sb = std::make_shared<SqliteSampleBlock>(mppConnection);
@@ -410,10 +584,7 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
    float max = -FLT_MAX;
    float sumsq = 0;
 
-   if (!mValid && mBlockID)
-   {
-      Load(mBlockID);
-   }
+   EnsureLoaded();
 
    if (start < mSampleCount)
    {
@@ -424,21 +595,12 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
       float *samples = (float *) blockData.ptr();
 
       size_t copied = DoGetSamples((samplePtr) samples, floatSample, start, len);
-      for (size_t i = 0; i < copied; ++i, ++samples)
+      if (copied > 0)
       {
-         float sample = *samples;
-
-         if (sample > max)
-         {
-            max = sample;
-         }
-
-         if (sample < min)
-         {
-            min = sample;
-         }
-
-         sumsq += (sample * sample);
+         const auto values = SummarizeSamples(samples, copied);
+         min = values.min;
+         max = values.max;
+         sumsq = values.sumsq;
       }
    }
 
@@ -465,14 +627,12 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
                                   size_t srcoffset,
                                   size_t srcbytes)
 {
+   PROFILE_ZONE("SqliteSampleBlock::GetBlob");
    auto db = DB();
 
    wxASSERT(mBlockID > 0);
 
-   if (!mValid && mBlockID)
-   {
-      Load(mBlockID);
-   }
+   EnsureLoaded();
 
    int rc;
    size_t minbytes = 0;
@@ -529,11 +689,14 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
    sqlite3_clear_bindings(stmt);
    sqlite3_reset(stmt);
 
+   Conn()->CountBytes(stmt, minbytes, 0);
+
    return srcbytes;
 }
 
 void SqliteSampleBlock::Load(SampleBlockID sbid)
 {
+   PROFILE_ZONE("SqliteSampleBlock::Load");
    auto db = DB();
    int rc;
 
@@ -595,8 +758,20 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    mValid = true;
 }
 
+void SqliteSampleBlock::EnsureLoaded()
+{
+   if (mValid || !mBlockID)
+      return;
+
+   static std::mutex loadMutex;
+   std::lock_guard<std::mutex> guard(loadMutex);
+   if (!mValid)
+      Load(mBlockID);
+}
+
 void SqliteSampleBlock::Commit()
 {
+   PROFILE_ZONE("SqliteSampleBlock::Commit");
    auto db = DB();
    int rc;
 
@@ -638,6 +813,9 @@ void SqliteSampleBlock::Commit()
    // Retrieve returned data
    mBlockID = sqlite3_last_insert_rowid(db);
 
+   Conn()->CountBytes(stmt,
+      0, mSummary256Bytes + mSummary64kBytes + mSampleBytes);
+
    // Reset local arrays
    mSamples.reset();
    mSummary256.reset();
@@ -652,6 +830,7 @@ void SqliteSampleBlock::Commit()
 
 void SqliteSampleBlock::Delete()
 {
+   PROFILE_ZONE("SqliteSampleBlock::Delete");
    auto db = DB();
    int rc;
 
@@ -754,10 +933,6 @@ void SqliteSampleBlock::CalcSummary()
 
    for (int i = 0; i < sumLen; ++i)
    {
-      min = samples[i * 256];
-      max = samples[i * 256];
-      sumsq = min * min;
-
       int jcount = 256;
       if (jcount > mSampleCount - i * 256)
       {
@@ -765,20 +940,10 @@ void SqliteSampleBlock::CalcSummary()
          fraction = 1.0 - (jcount / 256.0);
       }
 
-      for (int j = 1; j < jcount; ++j)
-      {
-         float f1 = samples[i * 256 + j];
-         sumsq += f1 * f1;
-
-         if (f1 < min)
-         {
-            min = f1;
-         }
-         else if (f1 > max)
-         {
-            max = f1;
-         }
-      }
+      const auto values = SummarizeSamples(samples + i * 256, jcount);
+      min = values.min;
+      max = values.max;
+      sumsq = values.sumsq;
 
       totalSquares += sumsq;
 
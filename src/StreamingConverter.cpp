@@ -0,0 +1,634 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  StreamingConverter.cpp
+
+*******************************************************************//**
+
+\class StreamSource
+\brief The ring of buffers between the importer and the export plug-in,
+which applies the effects as the plug-in pulls.
+
+*//*******************************************************************/
+
+#include "StreamingConverter.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string.h>
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "AudacityException.h"
+#include "InconsistencyException.h"
+#include "Project.h"
+#include "ProjectSettings.h"
+#include "SampleBlock.h"
+#include "Tags.h"
+#include "ThreadPool.h"
+#include "UserException.h"
+#include "WaveTrack.h"
+#include "effects/Effect.h"
+#include "effects/EffectManager.h"
+#include "export/Export.h"
+#include "import/Import.h"
+#include "widgets/ProgressDialog.h"
+
+namespace {
+
+// Blocks of each channel that the importer may get ahead of the encoder
+constexpr size_t RingDepth = 4;
+
+///\brief Stands in a track for a block whose samples went to the ring
+class StreamedSampleBlock final : public SampleBlock
+{
+public:
+   explicit StreamedSampleBlock(size_t count)
+      : mCount{ count }
+   {}
+
+   void CloseLock() override {}
+
+   SampleBlockID GetBlockID() const override { return 0; }
+
+   size_t GetSampleCount() const override { return mCount; }
+
+   bool GetSummary256(
+      float *dest, size_t WXUNUSED(frameoffset), size_t numframes) override
+   {
+      memset(dest, 0, 3 * numframes * sizeof(float));
+      return false;
+   }
+   bool GetSummary64k(
+      float *dest, size_t WXUNUSED(frameoffset), size_t numframes) override
+   {
+      memset(dest, 0, 3 * numframes * sizeof(float));
+      return false;
+   }
+
+   size_t GetSpaceUsage() const override { return 0; }
+
+   bool IsSummaryAvailable() const override { return false; }
+
+   void SaveXML(XMLWriter &) override
+   {
+      THROW_INCONSISTENCY_EXCEPTION;
+   }
+
+protected:
+   // The samples are gone; appending, as importers do, never reads back
+   // a block that is at least the minimum size
+   size_t DoGetSamples(samplePtr, sampleFormat, size_t, size_t) override
+   {
+      THROW_INCONSISTENCY_EXCEPTION;
+   }
+
+   MinMaxRMS DoGetMinMaxRMS(size_t, size_t) override { return {}; }
+   MinMaxRMS DoGetMinMaxRMS() const override { return {}; }
+
+private:
+   const size_t mCount;
+};
+
+class StreamSource final : public ExportSource
+{
+public:
+   // Main thread, before the export starts
+   void AddChannel() { mChannels.emplace_back(); }
+   bool InitializeEffects(const std::vector<Effect *> &effects, double rate,
+      TranslatableString &errorMessage);
+
+   // Main thread, for the importer; waits while the ring is full, and
+   // throws UserException if the export ended
+   void Push(unsigned channel, std::vector<float> block);
+   void End(bool failed);
+
+   // Main thread, after the export
+   void FinalizeEffects();
+
+   // Exporting thread
+   unsigned GetChannels() const override { return mChannels.size(); }
+   size_t Pull(float *const *buffers, size_t maxSamples) override;
+   //! Let the importer go on without waiting, when the export is over
+   void Abandon();
+
+private:
+   // Whether every channel has a block, so that Pull can go on
+   bool CanPull() const;
+
+   void ApplyEffects(float *const *buffers, size_t len);
+
+   struct Channel
+   {
+      std::deque< std::vector<float> > blocks;
+      size_t offset{ 0 }; // Samples pulled from the first block
+   };
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::vector<Channel> mChannels;
+   bool mEnded{ false };
+   bool mFailed{ false };
+   bool mAbandoned{ false };
+
+   struct Stage
+   {
+      Effect *pEffect;
+      unsigned groups; // Processors added, each for GetAudioInCount channels
+   };
+   std::vector<Stage> mStages;
+   FloatBuffers mOutBuffers;
+   Floats mDummy;
+   size_t mOutSize{ 0 };
+};
+
+bool StreamSource::InitializeEffects(const std::vector<Effect *> &effects,
+   double rate, TranslatableString &errorMessage)
+{
+   const unsigned channels = GetChannels();
+   for (auto pEffect : effects) {
+      pEffect->SetSampleRate(rate);
+      pEffect->RealtimeInitialize();
+
+      const auto numAudio = pEffect->GetAudioInCount();
+      const unsigned groups = (channels + numAudio - 1) / numAudio;
+      for (unsigned group = 0; group < groups; ++group)
+         pEffect->RealtimeAddProcessor(numAudio, rate);
+      mStages.push_back({ pEffect, groups });
+
+      if (pEffect->GetLatency() > 0) {
+         errorMessage = XO(
+"The effect \"%s\" delays the audio, so it can't be applied while converting")
+            .Format( pEffect->GetSymbol().Msgid() );
+         return false;
+      }
+   }
+   return true;
+}
+
+void StreamSource::FinalizeEffects()
+{
+   for (auto &stage : mStages)
+      stage.pEffect->RealtimeFinalize();
+   mStages.clear();
+}
+
+bool StreamSource::CanPull() const
+{
+   return std::all_of(mChannels.begin(), mChannels.end(),
+      [](const Channel &channel){ return !channel.blocks.empty(); });
+}
+
+void StreamSource::Push(unsigned channel, std::vector<float> block)
+{
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+      auto &blocks = mChannels[channel].blocks;
+      // Wait while the channel is full, but not while the encoder waits for
+      // another channel, as when an importer appends the channels one after
+      // another; memory is then not bounded, but there is no deadlock
+      mCondition.wait(lock, [&]{
+         return mAbandoned || blocks.size() < RingDepth || !CanPull();
+      });
+      if (mAbandoned)
+         throw UserException{};
+      blocks.push_back(std::move(block));
+   }
+   mCondition.notify_all();
+}
+
+void StreamSource::End(bool failed)
+{
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mEnded = true;
+      mFailed = failed;
+   }
+   mCondition.notify_all();
+}
+
+void StreamSource::Abandon()
+{
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mAbandoned = true;
+   }
+   mCondition.notify_all();
+}
+
+size_t StreamSource::Pull(float *const *buffers, size_t maxSamples)
+{
+   size_t count = maxSamples;
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [&]{ return mEnded || CanPull(); });
+      if (mFailed)
+         // The import failed; so does the export
+         throw UserException{};
+
+      // At the end, channels may be unequal; the short ones get silence
+      bool any = false;
+      for (const auto &channel : mChannels)
+         if (!channel.blocks.empty()) {
+            any = true;
+            count = std::min(count,
+               channel.blocks.front().size() - channel.offset);
+         }
+      if (!any)
+         return 0;
+
+      for (size_t ii = 0; ii < mChannels.size(); ++ii) {
+         auto &channel = mChannels[ii];
+         if (channel.blocks.empty()) {
+            std::fill(buffers[ii], buffers[ii] + count, 0.0f);
+            continue;
+         }
+         const auto &block = channel.blocks.front();
+         memcpy(buffers[ii], block.data() + channel.offset,
+            count * sizeof(float));
+         channel.offset += count;
+         if (channel.offset == block.size()) {
+            channel.blocks.pop_front();
+            channel.offset = 0;
+         }
+      }
+   }
+   mCondition.notify_all();
+
+   ApplyEffects(buffers, count);
+   return count;
+}
+
+void StreamSource::ApplyEffects(float *const *buffers, size_t len)
+{
+   if (mStages.empty())
+      return;
+
+   const unsigned channels = GetChannels();
+   if (mOutSize < len) {
+      mOutBuffers.reinit(channels, len);
+      mDummy.reinit(len);
+      mOutSize = len;
+   }
+
+   for (const auto &stage : mStages) {
+      auto &effect = *stage.pEffect;
+      const auto numAudio = effect.GetAudioInCount();
+      std::vector<float *> in(numAudio), out(numAudio);
+      const auto blockSize = std::max<size_t>(1, effect.GetBlockSize());
+
+      for (size_t start = 0; start < len; start += blockSize) {
+         const auto count = std::min(blockSize, len - start);
+         effect.RealtimeProcessStart();
+         for (unsigned group = 0; group < stage.groups; ++group) {
+            // The last group may have fewer channels than the effect takes;
+            // as in realtime processing, repeat its inputs and toss the
+            // extra outputs
+            const auto first = group * numAudio;
+            const auto available = std::min(numAudio, channels - first);
+            for (unsigned ii = 0; ii < numAudio; ++ii) {
+               in[ii] = buffers[first + ii % available] + start;
+               out[ii] = ii < available
+                  ? mOutBuffers[first + ii].get() + start
+                  : mDummy.get();
+            }
+            effect.RealtimeProcess(group, in.data(), out.data(), count);
+         }
+         effect.RealtimeProcessEnd();
+      }
+
+      for (unsigned channel = 0; channel < channels; ++channel)
+         memcpy(buffers[channel], mOutBuffers[channel].get(),
+            len * sizeof(float));
+   }
+}
+
+class Conversion;
+
+///\brief Makes the blocks of one channel, sending their samples to the ring
+class StreamSampleBlockFactory final : public SampleBlockFactory
+{
+public:
+   StreamSampleBlockFactory(Conversion &conversion, unsigned channel)
+      : mConversion{ conversion }
+      , mChannel{ channel }
+   {}
+
+protected:
+   SampleBlockPtr DoGet(SampleBlockID) override
+   {
+      THROW_INCONSISTENCY_EXCEPTION;
+   }
+
+   SampleBlockPtr DoCreate(samplePtr src,
+      size_t numsamples, sampleFormat srcformat) override;
+
+   SampleBlockPtr DoCreateSilent(
+      size_t numsamples, sampleFormat srcformat) override;
+
+   SampleBlockPtr DoCreateFromXML(sampleFormat, const wxChar **) override
+   {
+      THROW_INCONSISTENCY_EXCEPTION;
+   }
+
+private:
+   Conversion &mConversion;
+   const unsigned mChannel;
+};
+
+///\brief One conversion: the export starts on the thread pool when the
+/// importer makes the first block, and the import then feeds it
+class Conversion final
+{
+public:
+   Conversion(AudacityProject &project, const std::vector<Effect *> &effects,
+      std::unique_ptr<ExportPlugin> pPlugin, int subformat,
+      const FilePath &output, const Tags &tags);
+   Conversion(const Conversion&) = delete;
+   Conversion &operator= (const Conversion&) = delete;
+   ~Conversion();
+
+   // For the WaveTrackFactory given to the importer
+   SampleBlockFactoryPtr AddChannel(double rate);
+
+   void Push(unsigned channel, samplePtr src, size_t len,
+      sampleFormat format);
+
+   // If not yet started, as for a file of no samples
+   void Start();
+
+   /*! @return whether the output is good */
+   bool Finish(bool imported, TranslatableString &errorMessage);
+
+private:
+   AudacityProject &mProject;
+   const std::vector<Effect *> &mEffects;
+   const std::unique_ptr<ExportPlugin> mpPlugin;
+   const int mSubformat;
+   const FilePath mOutput;
+   const Tags &mTags;
+
+   const std::shared_ptr<StreamSource> mpSource{
+      std::make_shared<StreamSource>() };
+   double mRate{ 0 };
+
+   bool mStarted{ false };
+   // Why the export could not start, if so
+   TranslatableString mStartError;
+   ExportJobStatus mStatus;
+   std::future<ProgressResult> mResult;
+};
+
+SampleBlockPtr StreamSampleBlockFactory::DoCreate(samplePtr src,
+   size_t numsamples, sampleFormat srcformat)
+{
+   mConversion.Push(mChannel, src, numsamples, srcformat);
+   return std::make_shared<StreamedSampleBlock>(numsamples);
+}
+
+SampleBlockPtr StreamSampleBlockFactory::DoCreateSilent(
+   size_t numsamples, sampleFormat srcformat)
+{
+   mConversion.Push(mChannel, nullptr, numsamples, srcformat);
+   return std::make_shared<StreamedSampleBlock>(numsamples);
+}
+
+Conversion::Conversion(AudacityProject &project,
+   const std::vector<Effect *> &effects,
+   std::unique_ptr<ExportPlugin> pPlugin, int subformat,
+   const FilePath &output, const Tags &tags)
+   : mProject{ project }
+   , mEffects{ effects }
+   , mpPlugin{ std::move(pPlugin) }
+   , mSubformat{ subformat }
+   , mOutput{ output }
+   , mTags{ tags }
+{
+}
+
+Conversion::~Conversion()
+{
+   // The export uses this object
+   if (mResult.valid()) {
+      mpSource->End(true);
+      mResult.wait();
+   }
+}
+
+SampleBlockFactoryPtr Conversion::AddChannel(double rate)
+{
+   // All channels must come before any samples, at one rate
+   if (mStarted || (mRate != 0 && rate != mRate)) {
+      mStartError =
+         XO("Only files of one stream, at one rate, can be streamed");
+      throw UserException{};
+   }
+   mRate = rate;
+
+   const unsigned channel = mpSource->GetChannels();
+   mpSource->AddChannel();
+   return std::make_shared<StreamSampleBlockFactory>(*this, channel);
+}
+
+void Conversion::Push(unsigned channel, samplePtr src, size_t len,
+   sampleFormat format)
+{
+   if (len == 0)
+      return;
+   if (!mStarted)
+      Start();
+
+   std::vector<float> block(len);
+   if (src)
+      CopySamples(src, format, (samplePtr) block.data(), floatSample, len);
+   mpSource->Push(channel, std::move(block));
+}
+
+void Conversion::Start()
+{
+   if (mStarted)
+      return;
+   mStarted = true;
+
+   const unsigned channels = mpSource->GetChannels();
+   if (channels == 0) {
+      mStartError = XO("There is no audio to convert");
+      throw UserException{};
+   }
+   const auto maxChannels = mpPlugin->GetMaxChannels(mSubformat);
+   if (channels > maxChannels) {
+      mStartError = XO("The format of \"%s\" can't have more than %d channels")
+         .Format( mOutput, (int) maxChannels );
+      throw UserException{};
+   }
+   if (!mpSource->InitializeEffects(mEffects, mRate, mStartError))
+      throw UserException{};
+
+   // Plug-ins export at the rate of the project
+   ProjectSettings::Get( mProject ).SetRate(mRate);
+   mStatus.mpSource = mpSource;
+
+   // The importer may yet change its tags
+   const std::shared_ptr<Tags> pTags = mTags.Duplicate();
+
+   const auto pProject = &mProject;
+   const auto pPlugin = mpPlugin.get();
+   const auto pStatus = &mStatus;
+   const auto pSource = mpSource;
+   const auto path = mOutput;
+   const auto subformat = mSubformat;
+   mResult = ThreadPool::Get().Submit( [=]{
+      ExportJobScope scope{ *pStatus };
+      // If the export ends early, the import need not wait for it
+      auto cleanup = finally( [&]{ pSource->Abandon(); } );
+      // Stays null; the plug-in reports to the status instead
+      std::unique_ptr<ProgressDialog> pDialog;
+      // The source ends the export, not the times
+      return pPlugin->Export(pProject, pDialog, channels, path,
+         false, 0.0, 0.0, nullptr, pTags.get(), subformat);
+   } );
+}
+
+bool Conversion::Finish(bool imported, TranslatableString &errorMessage)
+{
+   mpSource->End(!imported);
+
+   auto result = ProgressResult::Failed;
+   const bool exported = mResult.valid();
+   if (exported)
+      // Exceptions from the worker count as failure
+      result = GuardedCall<ProgressResult>(
+         [&]{ return mResult.get(); },
+         MakeSimpleGuard(ProgressResult::Failed) );
+   mpSource->FinalizeEffects();
+
+   const bool success = imported &&
+      (result == ProgressResult::Success || result == ProgressResult::Stopped);
+   if (success)
+      return true;
+
+   if (!mStartError.empty())
+      errorMessage = mStartError;
+   else if (!mStatus.mError.empty())
+      errorMessage = mStatus.mError;
+   else if (errorMessage.empty())
+      errorMessage = imported
+         ? XO("Could not export to \"%s\"").Format( mOutput )
+         : XO("Could not import the file");
+
+   if (exported)
+      ::wxRemoveFile(mOutput);
+   return false;
+}
+
+}
+
+StreamingConverter::StreamingConverter(AudacityProject &project)
+   : mProject{ project }
+{
+}
+
+StreamingConverter::~StreamingConverter()
+{
+}
+
+bool StreamingConverter::SetEffects(const wxArrayString &commands,
+   TranslatableString &errorMessage)
+{
+   auto &manager = EffectManager::Get();
+   std::vector<Effect *> effects;
+   for (const auto &command : commands) {
+      wxString name = command.BeforeFirst(wxT(':'));
+      name.Trim(true).Trim(false);
+      const wxString params = command.AfterFirst(wxT(':'));
+
+      const auto &ID = manager.GetEffectByIdentifier(name);
+      const auto pEffect = manager.GetEffect(ID);
+      if (!pEffect) {
+         errorMessage = XO("\"%s\" is not an effect").Format( name );
+         return false;
+      }
+
+      const auto numAudio = pEffect->GetAudioInCount();
+      if (pEffect->GetType() != EffectTypeProcess ||
+          !pEffect->SupportsRealtime() ||
+          numAudio == 0 || numAudio != pEffect->GetAudioOutCount()) {
+         errorMessage =
+            XO("The effect \"%s\" can't be applied while converting")
+               .Format( name );
+         return false;
+      }
+
+      if (!manager.SetEffectParameters(ID, params)) {
+         errorMessage =
+            XO("Could not set the parameters of the effect \"%s\"")
+               .Format( name );
+         return false;
+      }
+
+      effects.push_back(pEffect);
+   }
+
+   mEffects.swap(effects);
+   return true;
+}
+
+bool StreamingConverter::Convert(const FilePath &input,
+   const FilePath &output, TranslatableString &errorMessage)
+{
+   // The first plug-in that can stream the format of the extension
+   const wxFileName outputName{ output };
+   const auto extension = outputName.GetExt();
+   Exporter exporter{ mProject };
+   const auto &plugins = exporter.GetPlugins();
+   std::unique_ptr<ExportPlugin> pPlugin;
+   int subformat = 0;
+   for (size_t ii = 0; !pPlugin && ii < plugins.size(); ++ii) {
+      auto &plugin = *plugins[ii];
+      for (int format = 0; format < plugin.GetFormatCount(); ++format)
+         if (plugin.IsExtension(extension, format) &&
+             plugin.CanExportConcurrently(format)) {
+            pPlugin = exporter.MakePlugin(ii);
+            subformat = format;
+            break;
+         }
+   }
+   if (!pPlugin) {
+      errorMessage =
+         XO("No format that can be streamed has the extension \"%s\"")
+            .Format( extension );
+      return false;
+   }
+
+   // Conversions change the rate of the project
+   auto &settings = ProjectSettings::Get( mProject );
+   const auto projectRate = settings.GetRate();
+   auto cleanup = finally( [&]{ settings.SetRate(projectRate); } );
+
+   Tags tags;
+   Conversion conversion{ mProject, mEffects, std::move(pPlugin), subformat,
+      output, tags };
+   WaveTrackFactory trackFactory{ settings,
+      [&](sampleFormat, double rate){ return conversion.AddChannel(rate); } };
+
+   const bool imported = GuardedCall<bool>( [&]{
+      TrackHolders tracks;
+      if (!Importer::Get().Import(mProject, input, &trackFactory, tracks,
+         &tags, errorMessage))
+         return false;
+
+      // Send what the importer left in the append buffers
+      for (const auto &group : tracks)
+         for (const auto &pTrack : group)
+            pTrack->Flush();
+      conversion.Start();
+      return true;
+   }, MakeSimpleGuard(false) );
+
+   return conversion.Finish(imported, errorMessage);
+}
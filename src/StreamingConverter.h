@@ -0,0 +1,68 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  StreamingConverter.h
+
+*******************************************************************//**
+
+\file StreamingConverter.h
+\brief Converts audio files to other formats without a project database,
+a few buffers at a time, optionally through realtime effects.
+
+  The importer appends to tracks whose sample block factories hand each
+  new block to a small ring of buffers for each channel, keeping only its
+  length.  An export plug-in that can export concurrently encodes from the
+  ring on the thread pool, through the effects, while the import continues
+  on the main thread; the import waits when the ring is full.  So memory
+  stays bounded, whatever the length of the file, and nothing is written
+  but the output.
+
+  Only effects that support realtime processing, and have no latency, can
+  be applied, because they process each buffer as it comes.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_STREAMING_CONVERTER__
+#define __AUDACITY_STREAMING_CONVERTER__
+
+#include <vector>
+
+#include <wx/arrstr.h>
+
+#include "audacity/Types.h"
+
+class AudacityProject;
+class Effect;
+class TranslatableString;
+
+class StreamingConverter final
+{
+public:
+   //! The project gives the preferences of importers and exporters; its
+   //! tracks are not touched, but its rate is set during each conversion
+   explicit StreamingConverter(AudacityProject &project);
+   StreamingConverter(const StreamingConverter&) = delete;
+   StreamingConverter &operator= (const StreamingConverter&) = delete;
+   ~StreamingConverter();
+
+   //! Effects to apply, in order, to each following conversion
+   /*! @param commands as in macros, "Name: parameters"
+    @return false, with the reason, if an effect is unknown, can't stream
+    or rejects its parameters */
+   bool SetEffects(const wxArrayString &commands,
+      TranslatableString &errorMessage);
+
+   //! The format is that of the first export plug-in that can export
+   //! concurrently and has the extension of the output
+   /*! @return false, with the reason, if it failed; a partial output is
+    then removed */
+   bool Convert(const FilePath &input, const FilePath &output,
+      TranslatableString &errorMessage);
+
+private:
+   AudacityProject &mProject;
+   std::vector<Effect *> mEffects;
+};
+
+#endif
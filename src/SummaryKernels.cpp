@@ -0,0 +1,244 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SummaryKernels.cpp
+
+**********************************************************************/
+
+#include "SummaryKernels.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+    defined(__i386__) || defined(_M_IX86)
+#define SUMMARY_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Compile the vector implementations for their instruction sets, whatever
+// the options for the rest of the program, and call them only when the
+// processor supports them
+#if defined(__GNUC__) || defined(__clang__)
+#define SUMMARY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SUMMARY_TARGET(isa)
+#endif
+
+namespace {
+
+SummaryValues SummarizeScalar(const float *samples, size_t len)
+{
+   SummaryValues result{ samples[0], samples[0], 0.0f };
+   for (size_t ii = 0; ii < len; ++ii) {
+      const float v = samples[ii];
+      if (v < result.min)
+         result.min = v;
+      if (v > result.max)
+         result.max = v;
+      result.sumsq += v * v;
+   }
+   return result;
+}
+
+#ifdef SUMMARY_KERNELS_X86
+
+SUMMARY_TARGET("sse")
+SummaryValues SummarizeSSE(const float *samples, size_t len)
+{
+   size_t ii = 0;
+   SummaryValues result{ samples[0], samples[0], 0.0f };
+
+   if (len >= 8) {
+      // Two accumulators for the sums hide the latency of the additions
+      __m128 vmin = _mm_loadu_ps(samples);
+      __m128 vmax = vmin;
+      __m128 vsum0 = _mm_setzero_ps();
+      __m128 vsum1 = _mm_setzero_ps();
+      for (; ii + 8 <= len; ii += 8) {
+         const __m128 v0 = _mm_loadu_ps(samples + ii);
+         const __m128 v1 = _mm_loadu_ps(samples + ii + 4);
+         vmin = _mm_min_ps(vmin, _mm_min_ps(v0, v1));
+         vmax = _mm_max_ps(vmax, _mm_max_ps(v0, v1));
+         vsum0 = _mm_add_ps(vsum0, _mm_mul_ps(v0, v0));
+         vsum1 = _mm_add_ps(vsum1, _mm_mul_ps(v1, v1));
+      }
+
+      float mins[4], maxs[4], sums[4];
+      _mm_storeu_ps(mins, vmin);
+      _mm_storeu_ps(maxs, vmax);
+      _mm_storeu_ps(sums, _mm_add_ps(vsum0, vsum1));
+      result.min = std::min(std::min(mins[0], mins[1]),
+         std::min(mins[2], mins[3]));
+      result.max = std::max(std::max(maxs[0], maxs[1]),
+         std::max(maxs[2], maxs[3]));
+      result.sumsq = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+   }
+
+   for (; ii < len; ++ii) {
+      const float v = samples[ii];
+      result.min = std::min(result.min, v);
+      result.max = std::max(result.max, v);
+      result.sumsq += v * v;
+   }
+
+   return result;
+}
+
+SUMMARY_TARGET("avx")
+SummaryValues SummarizeAVX(const float *samples, size_t len)
+{
+   size_t ii = 0;
+   SummaryValues result{ samples[0], samples[0], 0.0f };
+
+   if (len >= 16) {
+      __m256 vmin = _mm256_loadu_ps(samples);
+      __m256 vmax = vmin;
+      __m256 vsum0 = _mm256_setzero_ps();
+      __m256 vsum1 = _mm256_setzero_ps();
+      for (; ii + 16 <= len; ii += 16) {
+         const __m256 v0 = _mm256_loadu_ps(samples + ii);
+         const __m256 v1 = _mm256_loadu_ps(samples + ii + 8);
+         vmin = _mm256_min_ps(vmin, _mm256_min_ps(v0, v1));
+         vmax = _mm256_max_ps(vmax, _mm256_max_ps(v0, v1));
+         vsum0 = _mm256_add_ps(vsum0, _mm256_mul_ps(v0, v0));
+         vsum1 = _mm256_add_ps(vsum1, _mm256_mul_ps(v1, v1));
+      }
+
+      // Fold the halves, then reduce as for SSE
+      const __m256 vsum = _mm256_add_ps(vsum0, vsum1);
+      const __m128 min4 = _mm_min_ps(
+         _mm256_castps256_ps128(vmin), _mm256_extractf128_ps(vmin, 1));
+      const __m128 max4 = _mm_max_ps(
+         _mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+      const __m128 sum4 = _mm_add_ps(
+         _mm256_castps256_ps128(vsum), _mm256_extractf128_ps(vsum, 1));
+
+      float mins[4], maxs[4], sums[4];
+      _mm_storeu_ps(mins, min4);
+      _mm_storeu_ps(maxs, max4);
+      _mm_storeu_ps(sums, sum4);
+      result.min = std::min(std::min(mins[0], mins[1]),
+         std::min(mins[2], mins[3]));
+      result.max = std::max(std::max(maxs[0], maxs[1]),
+         std::max(maxs[2], maxs[3]));
+      result.sumsq = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+   }
+
+   for (; ii < len; ++ii) {
+      const float v = samples[ii];
+      result.min = std::min(result.min, v);
+      result.max = std::max(result.max, v);
+      result.sumsq += v * v;
+   }
+
+   return result;
+}
+
+bool HasSSE()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+   // Always present in 64 bit processors
+   return true;
+#elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   return (info[3] & (1 << 25)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("sse");
+#endif
+}
+
+bool HasAVX()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   const bool avx = (info[2] & (1 << 28)) != 0;
+   // The operating system must also save the upper halves of the registers
+   return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+   // This also checks for support by the operating system
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif
+
+using SummaryFunction = SummaryValues (*)(const float *, size_t);
+
+SummaryFunction GetSummaryFunction(SummaryImplementation implementation)
+{
+   switch (implementation) {
+#ifdef SUMMARY_KERNELS_X86
+   case SummaryImplementation::AVX:
+      return SummarizeAVX;
+   case SummaryImplementation::SSE:
+      return SummarizeSSE;
+#endif
+   default:
+      return SummarizeScalar;
+   }
+}
+
+}
+
+SummaryImplementation GetSummaryImplementation()
+{
+   static const auto implementation = []{
+      for (auto candidate :
+           { SummaryImplementation::AVX, SummaryImplementation::SSE })
+         if (IsSummaryImplementationSupported(candidate))
+            return candidate;
+      return SummaryImplementation::Scalar;
+   }();
+   return implementation;
+}
+
+bool IsSummaryImplementationSupported(SummaryImplementation implementation)
+{
+   switch (implementation) {
+#ifdef SUMMARY_KERNELS_X86
+   case SummaryImplementation::AVX:
+      return HasAVX();
+   case SummaryImplementation::SSE:
+      return HasSSE();
+#endif
+   case SummaryImplementation::Scalar:
+      return true;
+   default:
+      return false;
+   }
+}
+
+const char *GetSummaryImplementationName(
+   SummaryImplementation implementation)
+{
+   switch (implementation) {
+   case SummaryImplementation::AVX:
+      return "AVX";
+   case SummaryImplementation::SSE:
+      return "SSE";
+   default:
+      return "scalar";
+   }
+}
+
+SummaryValues SummarizeSamples(const float *samples, size_t len)
+{
+   static const auto function =
+      GetSummaryFunction(GetSummaryImplementation());
+   return function(samples, len);
+}
+
+SummaryValues SummarizeSamples(const float *samples, size_t len,
+   SummaryImplementation implementation)
+{
+   return GetSummaryFunction(implementation)(samples, len);
+}
@@ -0,0 +1,55 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SummaryKernels.h
+
+*******************************************************************//**
+
+\file SummaryKernels.h
+\brief Min, max, and sum of squares of runs of float samples, as needed
+for the summaries of sample blocks and for waveform display.
+
+  The implementation is chosen once, from those that the processor
+  supports.  The vector implementations add the squares in a different
+  order, so sums may differ from the plain one in the last bits.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_KERNELS__
+#define __AUDACITY_SUMMARY_KERNELS__
+
+#include <cstddef>
+
+struct SummaryValues
+{
+   float min;
+   float max;
+   float sumsq;
+};
+
+enum class SummaryImplementation
+{
+   Scalar,
+   SSE,
+   AVX,
+};
+
+//! The fastest implementation that the processor supports
+SummaryImplementation GetSummaryImplementation();
+
+//! Whether the processor supports the implementation
+bool IsSummaryImplementationSupported(SummaryImplementation implementation);
+
+//! Untranslated name, for benchmark reports
+const char *GetSummaryImplementationName(
+   SummaryImplementation implementation);
+
+//! Min, max, and sum of squares of len samples, which must be positive
+SummaryValues SummarizeSamples(const float *samples, size_t len);
+
+//! As above, with a given implementation, which must be supported
+SummaryValues SummarizeSamples(const float *samples, size_t len,
+   SummaryImplementation implementation);
+
+#endif
@@ -0,0 +1,81 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPool.cpp
+
+**********************************************************************/
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Prefs.h"
+
+ThreadPool &ThreadPool::Get()
+{
+   static ThreadPool pool{ DefaultSize() };
+   return pool;
+}
+
+size_t ThreadPool::DefaultSize()
+{
+   long nThreads = 0;
+   if (gPrefs)
+      nThreads = gPrefs->Read(wxT("/Performance/WorkerThreads"), 0L);
+   if (nThreads <= 0)
+      nThreads = std::thread::hardware_concurrency();
+   return std::max(1L, nThreads);
+}
+
+ThreadPool::ThreadPool(size_t nThreads)
+{
+   nThreads = std::max<size_t>(1, nThreads);
+   mThreads.reserve(nThreads);
+   for (size_t ii = 0; ii < nThreads; ++ii)
+      mThreads.emplace_back([this]{ Run(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mStop = true;
+   }
+   mCondition.notify_all();
+
+   for (auto &thread : mThreads)
+      thread.join();
+}
+
+void ThreadPool::Enqueue(std::function< void() > task)
+{
+   {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mTasks.push_back(std::move(task));
+   }
+   mCondition.notify_one();
+}
+
+void ThreadPool::Run()
+{
+   while (true)
+   {
+      std::function< void() > task;
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mCondition.wait(lock, [this]{ return mStop || !mTasks.empty(); });
+
+         // Drain the queue even when stopping, so that no future is
+         // left without a value
+         if (mTasks.empty())
+            return;
+
+         task = std::move(mTasks.front());
+         mTasks.pop_front();
+      }
+
+      // packaged_task captures any exception into its future
+      task();
+   }
+}
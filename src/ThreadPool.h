@@ -0,0 +1,77 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPool.h
+
+*******************************************************************//**
+
+\class ThreadPool
+\brief A fixed set of worker threads that run submitted tasks in
+FIFO order.
+
+  Tasks must not write the project database or touch the GUI; the usual
+  pattern is for the main thread to read sample data, submit the
+  number crunching, and then consume the results in order.  Tasks may
+  read sample blocks, each thread using its own prepared statements.
+
+  A task must not wait on the future of another task submitted to the
+  same pool, or the pool may deadlock.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_THREAD_POOL__
+#define __AUDACITY_THREAD_POOL__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool final
+{
+public:
+   //! The pool shared by the whole application
+   /*! Its size is taken from the preference /Performance/WorkerThreads,
+    or the number of hardware threads if that is zero. */
+   static ThreadPool &Get();
+
+   //! Number of worker threads the shared pool would be given
+   static size_t DefaultSize();
+
+   explicit ThreadPool(size_t nThreads);
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool &operator= (const ThreadPool&) = delete;
+   ~ThreadPool();
+
+   size_t Size() const { return mThreads.size(); }
+
+   //! Queue a callable; its result or exception is delivered by the future
+   template< typename Function >
+   auto Submit( Function &&function )
+      -> std::future< decltype( function() ) >
+   {
+      using Result = decltype( function() );
+      auto pTask = std::make_shared< std::packaged_task< Result() > >(
+         std::forward< Function >( function ) );
+      auto result = pTask->get_future();
+      Enqueue( [pTask]{ (*pTask)(); } );
+      return result;
+   }
+
+private:
+   void Enqueue( std::function< void() > task );
+   void Run();
+
+   std::vector< std::thread > mThreads;
+   std::deque< std::function< void() > > mTasks;
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   bool mStop{ false };
+};
+
+#endif
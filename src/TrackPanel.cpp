@@ -72,6 +72,7 @@ is time to refresh some aspect of the screen.
 #include "float_cast.h"
 
 #include "Prefs.h"
+#include "Profiler.h"
 #include "RefreshCode.h"
 #include "TrackArtist.h"
 #include "TrackPanelAx.h"
@@ -474,6 +475,7 @@ void TrackPanel::OnUndoReset( wxCommandEvent &event )
 ///  completing a repaint operation.
 void TrackPanel::OnPaint(wxPaintEvent & /* event */)
 {
+   PROFILE_ZONE("TrackPanel::OnPaint");
    mLastDrawnSelectedRegion = mViewInfo->selectedRegion;
 
 #if DEBUG_DRAW_TIMING
@@ -819,6 +821,7 @@ void TrackPanel::OnAudioIO(wxCommandEvent & evt)
 /// actual contents of each track are drawn by the TrackArtist.
 void TrackPanel::DrawTracks(wxDC * dc)
 {
+   PROFILE_ZONE("TrackPanel::DrawTracks");
    wxRegion region = GetUpdateRegion();
 
    const wxRect clip = GetRect();
@@ -24,7 +24,11 @@
 #include "Experimental.h"
 
 #include <math.h>
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <future>
+#include <map>
 #include <vector>
 #include <wx/log.h>
 
@@ -33,18 +37,16 @@
 #include "Prefs.h"
 #include "Envelope.h"
 #include "Resample.h"
+#include "SampleBlock.h"
 #include "WaveTrack.h"
 #include "Profiler.h"
+#include "ThreadPool.h"
 #include "InconsistencyException.h"
 #include "UserException.h"
 
 #include "prefs/SpectrogramSettings.h"
 #include "widgets/ProgressDialog.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 class WaveCache {
 public:
    WaveCache()
@@ -414,11 +416,15 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
       const bool ppsMatch = mWaveCache &&
          (fabs(tstep - 1.0 / mWaveCache->pps) * numPixels < (1.0 / mRate));
 
+      // Columns drawn before the summaries of blocks were available, as
+      // while an on-demand import is copied, are computed again
       const bool match =
          mWaveCache &&
          ppsMatch &&
          mWaveCache->len > 0 &&
-         mWaveCache->dirty == mDirty;
+         mWaveCache->dirty == mDirty &&
+         std::none_of(mWaveCache->bl.begin(), mWaveCache->bl.end(),
+            [](int status){ return status < 0; });
 
       if (match &&
          mWaveCache->start == t0 &&
@@ -609,6 +615,202 @@ void ComputeSpectrogramGainFactors
 
 }
 
+// Samples of a clip needed for a range of spectrogram columns.
+// WaveTrackCache and the sample blocks beneath it may be used by only one
+// thread, so everything is read first, and then columns are computed
+// on any thread.
+class SpecSamples
+{
+public:
+   // Ranges must be added in nondecreasing order of start
+   void Add(sampleCount start, size_t len)
+   {
+      if (!mRanges.empty()) {
+         auto &last = mRanges.back();
+         if (start <= last.start + last.len) {
+            const auto end = std::max(last.start + last.len, start + len);
+            last.len = (end - last.start).as_size_t();
+            return;
+         }
+      }
+      mRanges.push_back({ start, len, {}, false });
+   }
+
+   // Add the window of samples for a column centered at a clip sample
+   void AddColumn(sampleCount center, size_t windowSize,
+      sampleCount numSamples, double offset, double rate)
+   {
+      if (center < 0 || center >= numSamples)
+         return;
+      auto from = center - (windowSize >> 1);
+      auto end = std::min(numSamples, from + windowSize);
+      from = std::max(from, sampleCount{ 0 });
+      if (end > from)
+         Add(sampleCount(floor(0.5 + from.as_double() + offset * rate)),
+            (end - from).as_size_t());
+   }
+
+   // Returns false if any of the samples could not be read
+   bool Fetch(WaveTrackCache &cache)
+   {
+      bool result = true;
+      for (auto &range : mRanges) {
+         auto buffer = (const float*)cache.Get(
+            floatSample, range.start, range.len,
+            // Don't throw in this drawing operation
+            false);
+         if (buffer) {
+            range.data.assign(buffer, buffer + range.len);
+            range.valid = true;
+         }
+         else
+            result = false;
+      }
+      return result;
+   }
+
+   // Null if the samples were not added, or could not be read
+   const float *Get(sampleCount start, size_t len) const
+   {
+      auto iter = std::upper_bound(mRanges.begin(), mRanges.end(), start,
+         [](sampleCount value, const Range &range){
+            return value < range.start; });
+      if (iter == mRanges.begin())
+         return nullptr;
+      const auto &range = *--iter;
+      if (!range.valid || start + len > range.start + range.len)
+         return nullptr;
+      return &range.data[(start - range.start).as_size_t()];
+   }
+
+private:
+   struct Range {
+      sampleCount start;
+      size_t len;
+      std::vector<float> data;
+      bool valid;
+   };
+   std::vector<Range> mRanges;
+};
+
+namespace {
+
+// Columns per task when computing spectrogram columns in parallel
+int ColumnChunkSize(int nColumns)
+{
+   // Several chunks per thread even out the costs of the columns
+   const int nChunks = 4 * (int)ThreadPool::Get().Size();
+   return std::max(8, (nColumns + nChunks - 1) / nChunks);
+}
+
+// Call function(chunk, begin, end) for chunks of the columns
+// [lowerBoundX, upperBoundX) on the thread pool.  Returns false if
+// cancelled() became true first.
+template< typename Function >
+bool ForEachColumnChunk(int lowerBoundX, int upperBoundX, int chunkSize,
+   const std::function<bool()> &cancelled, const Function &function)
+{
+   std::atomic<bool> stop{ false };
+   std::vector< std::future<void> > futures;
+   auto cleanup = finally([&]{
+      // Don't leave tasks running with references to this stack frame
+      stop = true;
+      for (auto &future : futures)
+         if (future.valid())
+            future.wait();
+   });
+
+   for (int begin = lowerBoundX, chunk = 0; begin < upperBoundX;
+        begin += chunkSize, ++chunk) {
+      const int end = std::min(upperBoundX, begin + chunkSize);
+      futures.push_back(ThreadPool::Get().Submit(
+         [&function, &stop, chunk, begin, end]{
+            if (!stop)
+               function(chunk, begin, end);
+         }));
+   }
+
+   for (auto &future : futures) {
+      if (cancelled && cancelled())
+         return false;
+      // Rethrows exceptions of the task
+      future.get();
+   }
+   return true;
+}
+
+// 64 bit FNV-1a hash of a sequence of values
+class TileHasher
+{
+public:
+   template< typename Value >
+   void Add(const Value &value)
+   {
+      auto bytes = reinterpret_cast<const unsigned char *>(&value);
+      for (size_t ii = 0; ii < sizeof(Value); ++ii)
+         mHash = (mHash ^ bytes[ii]) * 1099511628211ULL;
+   }
+
+   SpectrumTileKey Get() const { return mHash; }
+
+private:
+   SpectrumTileKey mHash{ 14695981039346656037ULL };
+};
+
+}
+
+SpectrumTileKey SpecCache::TileKey
+   (const SpectrogramSettings &settings, double rate, int level,
+    long long tile, const BlockArray &blocks, sampleCount numSamples)
+{
+   // Change this when the computation of columns changes, so that tiles
+   // saved by other versions are not used
+   static const int TileFormat = 1;
+
+   TileHasher hasher;
+   hasher.Add(TileFormat);
+   hasher.Add(settings.algorithm);
+   hasher.Add(settings.windowType);
+   hasher.Add(settings.WindowSize());
+   hasher.Add(settings.ZeroPaddingFactor());
+   hasher.Add(settings.frequencyGain);
+   hasher.Add(rate);
+   hasher.Add(level);
+   const int columns = TileColumns;
+   hasher.Add(columns);
+
+   // The range of samples in the windows of the columns of the tile
+   const long long hop = 1LL << level;
+   const long long half = settings.WindowSize() / 2;
+   const auto rangeStart = tile * TileColumns * hop - half;
+   const auto rangeEnd = (tile + 1) * TileColumns * hop + half;
+
+   // Columns near the end of the clip are padded with zeroes
+   hasher.Add(
+      std::min(numSamples.as_long_long(), rangeEnd) - rangeStart);
+
+   // The blocks overlapping that range, which are immutable, and their
+   // positions relative to the tile.  Block ids are not reused, but include
+   // the block summary too, as a cheap check of contents.
+   const sampleCount first{ std::max(0LL, rangeStart) };
+   auto iter = blocks.IteratorAt(
+      blocks.empty() ? 0
+      : first < blocks.GetNumSamples() ? blocks.FindBlock(first)
+      : blocks.size() - 1);
+   for (; iter != blocks.end() && iter->start < rangeEnd; ++iter) {
+      const auto &sb = *iter->sb;
+      const auto summary = sb.GetMinMaxRMS(false);
+      hasher.Add(sb.GetBlockID());
+      hasher.Add(iter->start.as_long_long() - rangeStart);
+      hasher.Add(sb.GetSampleCount());
+      hasher.Add(summary.min);
+      hasher.Add(summary.max);
+      hasher.Add(summary.RMS);
+   }
+
+   return hasher.Get();
+}
+
 bool SpecCache::Matches
    (int dirty_, double pixelsPerSecond,
     const SpectrogramSettings &settings, double rate) const
@@ -630,36 +832,41 @@ bool SpecCache::Matches
       algorithm == settings.algorithm;
 }
 
-bool SpecCache::CalculateOneSpectrum
-   (const SpectrogramSettings &settings,
-    WaveTrackCache &waveTrackCache,
-    const int xx, const sampleCount numSamples,
-    double offset, double rate, double pixelsPerSecond,
-    int lowerBoundX, int upperBoundX,
-    const std::vector<float> &gainFactors,
-    float* __restrict scratch, float* __restrict out) const
+sampleCount SpecCache::ColumnCenter
+   (int xx, double rate, double pixelsPerSecond) const
 {
-   bool result = false;
-   const bool reassignment =
-      (settings.algorithm == SpectrogramSettings::algReassignment);
-   const size_t windowSizeSetting = settings.WindowSize();
-
-   sampleCount from;
-
    // xx may be for a column that is out of the visible bounds, but only
    // when we are calculating reassignment contributions that may cross into
    // the visible area.
 
    if (xx < 0)
-      from = sampleCount(
+      return sampleCount(
          where[0].as_double() + xx * (rate / pixelsPerSecond)
       );
    else if (xx > (int)len)
-      from = sampleCount(
+      return sampleCount(
          where[len].as_double() + (xx - len) * (rate / pixelsPerSecond)
       );
    else
-      from = where[xx];
+      return where[xx];
+}
+
+bool SpecCache::CalculateOneSpectrum
+   (const SpectrogramSettings &settings,
+    const SpecSamples &samples,
+    const int xx, const sampleCount numSamples,
+    double offset, double rate, double pixelsPerSecond,
+    int lowerBoundX, int upperBoundX,
+    const std::vector<float> &gainFactors,
+    float* __restrict scratch, float* __restrict out,
+    Reassignments *pReassignments) const
+{
+   bool result = false;
+   const bool reassignment =
+      (settings.algorithm == SpectrogramSettings::algReassignment);
+   const size_t windowSizeSetting = settings.WindowSize();
+
+   sampleCount from = ColumnCenter(xx, rate, pixelsPerSecond);
 
    const bool autocorrelation =
       settings.algorithm == SpectrogramSettings::algPitchEAC;
@@ -680,7 +887,7 @@ bool SpecCache::CalculateOneSpectrum
 
       // We can avoid copying memory when ComputeSpectrum is used below
       bool copy = !autocorrelation || (padding > 0) || reassignment;
-      float *useBuffer = 0;
+      const float *useBuffer = 0;
       float *adj = scratch + padding;
 
       {
@@ -708,13 +915,11 @@ bool SpecCache::CalculateOneSpectrum
          }
 
          if (myLen > 0) {
-            useBuffer = (float*)(waveTrackCache.Get(
-               floatSample, sampleCount(
+            useBuffer = samples.Get(
+               sampleCount(
                   floor(0.5 + from.as_double() + offset * rate)
                ),
-               myLen,
-               // Don't throw in this drawing operation
-               false)
+               myLen
             );
 
             if (copy) {
@@ -819,13 +1024,12 @@ bool SpecCache::CalculateOneSpectrum
 
                   // This is non-negative, because bin and correctedX are
                   auto ind = (int)nBins * correctedX + bin;
-#ifdef _OPENMP
-                  // This assignment can race if index reaches into another thread's bins.
-                  // The probability of a race very low, so this carries little overhead,
-                  // about 5% slower vs allowing it to race.
-                  #pragma omp atomic update
-#endif
-                  out[ind] += power;
+                  // The index may reach into the columns of another
+                  // thread, so let the caller add the power later
+                  if (pReassignments)
+                     pReassignments->emplace_back(ind, power);
+                  else
+                     out[ind] += power;
                }
             }
          }
@@ -840,9 +1044,11 @@ bool SpecCache::CalculateOneSpectrum
          // when there is padding.  Therefore we did not need to reinitialize
          // the part of useBuffer in the padding zones.
 
-         // This function mutates useBuffer
+         // This function mutates useBuffer, which is scratch, because
+         // copy is true when not autocorrelation
+         wxASSERT(useBuffer == scratch);
          ComputeSpectrumUsingRealFFTf
-            (useBuffer, settings.hFFT.get(), settings.window.get(), fftLen, results);
+            (scratch, settings.hFFT.get(), settings.window.get(), fftLen, results);
          if (!gainFactors.empty()) {
             // Apply a frequency-dependent gain factor
             for (size_t ii = 0; ii < nBins; ++ii)
@@ -877,11 +1083,13 @@ void SpecCache::Grow(size_t len_, const SpectrogramSettings& settings,
    frequencyGain = settings.frequencyGain;
 }
 
-void SpecCache::Populate
+bool SpecCache::Populate
    (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
     int copyBegin, int copyEnd, size_t numPixels,
     sampleCount numSamples,
-    double offset, double rate, double pixelsPerSecond)
+    double offset, double rate, double pixelsPerSecond,
+    const std::function<bool()> &cancelled,
+    Sequence *pTileSequence)
 {
    const int &frequencyGainSetting = settings.frequencyGain;
    const size_t windowSizeSetting = settings.WindowSize();
@@ -898,119 +1106,253 @@ void SpecCache::Populate
    // FFT length may be longer than the window of samples that affect results
    // because of zero padding done for increased frequency resolution
    const size_t fftLen = windowSizeSetting * zeroPaddingFactorSetting;
-   const auto nBins = settings.NBins();
-
-   const size_t bufferSize = fftLen;
-   const size_t scratchSize = reassignment ? 3 * bufferSize : bufferSize;
-   std::vector<float> scratch(scratchSize);
 
    std::vector<float> gainFactors;
    if (!autocorrelation)
       ComputeSpectrogramGainFactors(fftLen, rate, frequencyGainSetting, gainFactors);
 
+   const bool useTiles = pTileSequence &&
+      TileLevel(settings, rate / pixelsPerSecond) >= 0;
+
    // Loop over the ranges before and after the copied portion and compute anew.
    // One of the ranges may be empty.
    for (int jj = 0; jj < 2; ++jj) {
       const int lowerBoundX = jj == 0 ? 0 : copyEnd;
       const int upperBoundX = jj == 0 ? copyBegin : numPixels;
+      if (lowerBoundX >= upperBoundX)
+         continue;
 
-#ifdef _OPENMP
-      // Storage for mutable per-thread data.
-      // private clause ensures one copy per thread
-      struct ThreadLocalStorage {
-         ThreadLocalStorage()  { }
-         ~ThreadLocalStorage() { }
-
-         void init(WaveTrackCache &waveTrackCache, size_t scratchSize) {
-            if (!cache) {
-               cache = std::make_unique<WaveTrackCache>(waveTrackCache.GetTrack());
-               scratch.resize(scratchSize);
-            }
-         }
-         std::unique_ptr<WaveTrackCache> cache;
-         std::vector<float> scratch;
-      } tls;
+      if (useTiles) {
+         if (!PopulateFromTiles(settings, waveTrackCache, *pTileSequence,
+               lowerBoundX, upperBoundX, offset, rate, pixelsPerSecond,
+               gainFactors, cancelled))
+            return false;
+         continue;
+      }
 
-      #pragma omp parallel for private(tls)
-#endif
-      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
+      // Reassignment needs to look beyond the edges of the range to
+      // accumulate more time reassignments.
+      // I'm not sure what's a good stopping criterion?
+      const double pixelsPerSample = pixelsPerSecond / rate;
+      const int limit = reassignment
+         ? std::min((int)(0.5 + fftLen * pixelsPerSample), 100)
+         : 0;
+
+      // Read the windows of samples for all columns now
+      SpecSamples samples;
+      for (auto xx = lowerBoundX - limit; xx < upperBoundX + limit; ++xx)
+         samples.AddColumn(ColumnCenter(xx, rate, pixelsPerSecond),
+            windowSizeSetting, numSamples, offset, rate);
+      samples.Fetch(waveTrackCache);
+
+      if (!CalculateColumns(settings, samples, lowerBoundX, upperBoundX,
+            limit, numSamples, offset, rate, pixelsPerSecond,
+            gainFactors, cancelled))
+         return false;
+   }
+
+   return true;
+}
+
+bool SpecCache::CalculateColumns
+   (const SpectrogramSettings &settings, const SpecSamples &samples,
+    int lowerBoundX, int upperBoundX, int limit,
+    sampleCount numSamples,
+    double offset, double rate, double pixelsPerSecond,
+    const std::vector<float> &gainFactors,
+    const std::function<bool()> &cancelled)
+{
+   const bool reassignment =
+      settings.algorithm == SpectrogramSettings::algReassignment;
+   const size_t fftLen = settings.WindowSize() * settings.ZeroPaddingFactor();
+   const auto nBins = settings.NBins();
+
+   const size_t scratchSize = reassignment ? 3 * fftLen : fftLen;
+
+   const int chunkSize = ColumnChunkSize(upperBoundX - lowerBoundX);
+   const int nChunks = (upperBoundX - lowerBoundX + chunkSize - 1) / chunkSize;
+   std::vector<Reassignments> reassignments(reassignment ? nChunks : 0);
+
+   const bool completed = ForEachColumnChunk(
+      lowerBoundX, upperBoundX, chunkSize, cancelled,
+      [&](int chunk, int begin, int end){
+         std::vector<float> buffer(scratchSize);
+         auto pReassignments =
+            reassignment ? &reassignments[chunk] : nullptr;
+         for (auto xx = begin; xx < end; ++xx)
+            CalculateOneSpectrum(
+               settings, samples, xx, numSamples,
+               offset, rate, pixelsPerSecond,
+               lowerBoundX, upperBoundX,
+               gainFactors, &buffer[0], &freq[0], pReassignments);
+      });
+   if (!completed)
+      return false;
+
+   if (reassignment) {
+      std::vector<float> scratch(scratchSize);
+
+      // Accumulate in the order of columns, as if done in one thread
+      for (const auto &chunkReassignments : reassignments)
+         for (const auto &pair : chunkReassignments)
+            freq[pair.first] += pair.second;
+
+      auto xx = lowerBoundX;
+      for (int ii = 0; ii < limit; ++ii)
       {
-#ifdef _OPENMP
-         tls.init(waveTrackCache, scratchSize);
-         WaveTrackCache& cache = *tls.cache;
-         float* buffer = &tls.scratch[0];
-#else
-         WaveTrackCache& cache = waveTrackCache;
-         float* buffer = &scratch[0];
-#endif
-         CalculateOneSpectrum(
-            settings, cache, xx, numSamples,
-            offset, rate, pixelsPerSecond,
-            lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
+         const bool result =
+            CalculateOneSpectrum(
+               settings, samples, --xx, numSamples,
+               offset, rate, pixelsPerSecond,
+               lowerBoundX, upperBoundX,
+               gainFactors, &scratch[0], &freq[0]);
+         if (!result)
+            break;
       }
 
-      if (reassignment) {
-         // Need to look beyond the edges of the range to accumulate more
-         // time reassignments.
-         // I'm not sure what's a good stopping criterion?
-         auto xx = lowerBoundX;
-         const double pixelsPerSample = pixelsPerSecond / rate;
-         const int limit = std::min((int)(0.5 + fftLen * pixelsPerSample), 100);
-         for (int ii = 0; ii < limit; ++ii)
-         {
-            const bool result =
-               CalculateOneSpectrum(
-                  settings, waveTrackCache, --xx, numSamples,
-                  offset, rate, pixelsPerSecond,
-                  lowerBoundX, upperBoundX,
-                  gainFactors, &scratch[0], &freq[0]);
-            if (!result)
-               break;
-         }
-
-         xx = upperBoundX;
-         for (int ii = 0; ii < limit; ++ii)
-         {
-            const bool result =
-               CalculateOneSpectrum(
-                  settings, waveTrackCache, xx++, numSamples,
-                  offset, rate, pixelsPerSecond,
-                  lowerBoundX, upperBoundX,
-                  gainFactors, &scratch[0], &freq[0]);
-            if (!result)
-               break;
-         }
+      xx = upperBoundX;
+      for (int ii = 0; ii < limit; ++ii)
+      {
+         const bool result =
+            CalculateOneSpectrum(
+               settings, samples, xx++, numSamples,
+               offset, rate, pixelsPerSecond,
+               lowerBoundX, upperBoundX,
+               gainFactors, &scratch[0], &freq[0]);
+         if (!result)
+            break;
+      }
 
-         // Now Convert to dB terms.  Do this only after accumulating
-         // power values, which may cross columns with the time correction.
-#ifdef _OPENMP
-         #pragma omp parallel for
-#endif
-         for (xx = lowerBoundX; xx < upperBoundX; ++xx) {
-            float *const results = &freq[nBins * xx];
-            for (size_t ii = 0; ii < nBins; ++ii) {
-               float &power = results[ii];
-               if (power <= 0)
-                  power = -160.0;
-               else
-                  power = 10.0*log10f(power);
-            }
-            if (!gainFactors.empty()) {
-               // Apply a frequency-dependent gain factor
-               for (size_t ii = 0; ii < nBins; ++ii)
-                  results[ii] += gainFactors[ii];
+      // Now Convert to dB terms.  Do this only after accumulating
+      // power values, which may cross columns with the time correction.
+      const bool converted = ForEachColumnChunk(
+         lowerBoundX, upperBoundX, chunkSize, cancelled,
+         [&](int, int begin, int end){
+            for (auto xx = begin; xx < end; ++xx) {
+               float *const results = &freq[nBins * xx];
+               for (size_t ii = 0; ii < nBins; ++ii) {
+                  float &power = results[ii];
+                  if (power <= 0)
+                     power = -160.0;
+                  else
+                     power = 10.0*log10f(power);
+               }
+               if (!gainFactors.empty()) {
+                  // Apply a frequency-dependent gain factor
+                  for (size_t ii = 0; ii < nBins; ++ii)
+                     results[ii] += gainFactors[ii];
+               }
             }
-         }
+         });
+      if (!converted)
+         return false;
+   }
+
+   return true;
+}
+
+int SpecCache::TileLevel
+   (const SpectrogramSettings &settings, double samplesPerPixel)
+{
+   // Reassignment spreads power across columns, so its columns are not
+   // independent of the spacing of the others
+   if (settings.algorithm == SpectrogramSettings::algReassignment)
+      return -1;
+
+   int level = 0;
+   while (level < MaxTileLevel && (2LL << level) <= samplesPerPixel)
+      ++level;
+   return level < MinTileLevel ? -1 : level;
+}
+
+bool SpecCache::PopulateFromTiles
+   (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
+    Sequence &sequence, int lowerBoundX, int upperBoundX,
+    double offset, double rate, double pixelsPerSecond,
+    const std::vector<float> &gainFactors,
+    const std::function<bool()> &cancelled)
+{
+   auto &factory = *sequence.GetFactory();
+   const auto numSamples = sequence.GetNumSamples();
+   const size_t windowSizeSetting = settings.WindowSize();
+   const auto nBins = settings.NBins();
+   const size_t tileSize = TileColumns * nBins;
+
+   const int level = TileLevel(settings, rate / pixelsPerSecond);
+   wxASSERT(level >= 0);
+   const long long hop = 1LL << level;
+
+   // Each pixel column takes the nearest column of the grid
+   const auto gridColumn = [&](int xx){
+      return (where[xx].as_long_long() + hop / 2) / hop;
+   };
+
+   // Find the saved tiles, and which ones must be computed
+   std::map< long long, std::vector<float> > tiles;
+   std::vector< std::pair<long long, SpectrumTileKey> > missing;
+   for (auto xx = lowerBoundX; xx < upperBoundX; ++xx) {
+      const auto tile = gridColumn(xx) / TileColumns;
+      if (tiles.count(tile))
+         continue;
+      auto &data = tiles[tile];
+      const auto key =
+         TileKey(settings, rate, level, tile, sequence.GetBlockArray(),
+            numSamples);
+      if (!factory.GetSpectrumTile(key, data) || data.size() != tileSize)
+         missing.emplace_back(tile, key);
+   }
+
+   if (!missing.empty()) {
+      // Compute the missing tiles together, as the columns of one
+      // temporary cache
+      SpecCache grid;
+      const auto nColumns = missing.size() * TileColumns;
+      grid.Grow(nColumns, settings, pixelsPerSecond, 0);
+      for (size_t ii = 0; ii < missing.size(); ++ii) {
+         const auto first = missing[ii].first * TileColumns;
+         for (int jj = 0; jj < TileColumns; ++jj)
+            grid.where[ii * TileColumns + jj] = (first + jj) * hop;
       }
+      grid.where[nColumns] = grid.where[nColumns - 1] + hop;
+
+      SpecSamples samples;
+      for (size_t xx = 0; xx < nColumns; ++xx)
+         samples.AddColumn(grid.where[xx],
+            windowSizeSetting, numSamples, offset, rate);
+      // Don't save tiles computed from samples that failed to read
+      const bool complete = samples.Fetch(waveTrackCache);
+
+      if (!grid.CalculateColumns(settings, samples, 0, nColumns, 0,
+            numSamples, offset, rate, pixelsPerSecond,
+            gainFactors, cancelled))
+         return false;
+
+      for (size_t ii = 0; ii < missing.size(); ++ii) {
+         const auto begin = grid.freq.begin() + ii * tileSize;
+         auto &data = tiles[missing[ii].first];
+         data.assign(begin, begin + tileSize);
+         if (complete)
+            factory.PutSpectrumTile(missing[ii].second, data.data(), tileSize);
+      }
+   }
+
+   for (auto xx = lowerBoundX; xx < upperBoundX; ++xx) {
+      const auto column = gridColumn(xx);
+      const auto &data = tiles[column / TileColumns];
+      const auto first =
+         data.begin() + (column % TileColumns) * nBins;
+      std::copy(first, first + nBins, freq.begin() + xx * nBins);
    }
+
+   return true;
 }
 
 bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
                               const float *& spectrogram,
                               const sampleCount *& where,
                               size_t numPixels,
-                              double t0, double pixelsPerSecond) const
+                              double t0, double pixelsPerSecond,
+                              const std::function<bool()> &cancelled) const
 {
    const WaveTrack *const track = waveTrackCache.GetTrack().get();
    const SpectrogramSettings &settings = track->GetSpectrogramSettings();
@@ -1105,12 +1447,13 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
    fillWhere(mSpecCache->where, numPixels, 0.5, correction,
       t0, mRate, samplesPerPixel);
 
-   mSpecCache->Populate
+   const bool completed = mSpecCache->Populate
       (settings, waveTrackCache, copyBegin, copyEnd, numPixels,
        mSequence->GetNumSamples(),
-       mOffset, mRate, pixelsPerSecond);
+       mOffset, mRate, pixelsPerSecond, cancelled, mSequence.get());
 
-   mSpecCache->dirty = mDirty;
+   // An incomplete cache must not match next time
+   mSpecCache->dirty = completed ? mDirty : -1;
    spectrogram = &mSpecCache->freq[0];
    where = &mSpecCache->where[0];
 
@@ -1291,6 +1634,15 @@ void WaveClip::Flush()
    //wxLogDebug(wxT("now sample count %lli"), (long long) mSequence->GetNumSamples());
 }
 
+void WaveClip::AppendSharedBlock(const std::shared_ptr<SampleBlock> &pBlock)
+{
+   wxASSERT(mAppendBufferLen == 0);
+
+   mSequence->AppendSharedBlock(pBlock);
+   UpdateEnvelopeTrackLen();
+   MarkChanged();
+}
+
 bool WaveClip::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
 {
    if (!wxStrcmp(tag, wxT("waveclip")))
@@ -1744,17 +2096,19 @@ void WaveClip::Resample(int rate, ProgressDialog *progress)
          XO("Resampling failed.")
       };
    else
-   {
       // Use No-fail-guarantee in these steps
+      SetResampled(std::move(newSequence), rate);
+}
 
-      // Invalidate wave display cache
-      mWaveCache = std::make_unique<WaveCache>();
-      // Invalidate the spectrum display cache
-      mSpecCache = std::make_unique<SpecCache>();
+void WaveClip::SetResampled(std::unique_ptr<Sequence> &&pSequence, int rate)
+{
+   // Invalidate wave display cache
+   mWaveCache = std::make_unique<WaveCache>();
+   // Invalidate the spectrum display cache
+   mSpecCache = std::make_unique<SpecCache>();
 
-      mSequence = std::move(newSequence);
-      mRate = rate;
-   }
+   mSequence = std::move(pSequence);
+   mRate = rate;
 }
 
 // Used by commands which interact with clips using the keyboard.
@@ -21,19 +21,25 @@
 
 #include <wx/longlong.h>
 
+#include <functional>
+#include <utility>
 #include <vector>
 
 class BlockArray;
 class Envelope;
 class ProgressDialog;
+class SampleBlock;
 class SampleBlockFactory;
 using SampleBlockFactoryPtr = std::shared_ptr<SampleBlockFactory>;
 class Sequence;
+class SpecSamples;
 class SpectrogramSettings;
 class WaveCache;
 class WaveTrackCache;
 class wxFileNameWrapper;
 
+using SpectrumTileKey = unsigned long long;
+
 class SpecCache {
 public:
 
@@ -55,27 +61,87 @@ public:
    bool Matches(int dirty_, double pixelsPerSecond,
       const SpectrogramSettings &settings, double rate) const;
 
+   // Power contributions of time-frequency reassignment, as indices into
+   // freq and values to add
+   using Reassignments = std::vector< std::pair<size_t, double> >;
+
+   // Clip sample at the center of a column, which may be out of bounds
+   sampleCount ColumnCenter(int xx, double rate, double pixelsPerSecond) const;
+
    // Calculate one column of the spectrum
+   // If pReassignments is not null, reassigned power is appended to it
+   // instead of being added into out, so that columns may be computed
+   // concurrently
    bool CalculateOneSpectrum
       (const SpectrogramSettings &settings,
-       WaveTrackCache &waveTrackCache,
+       const SpecSamples &samples,
        const int xx, sampleCount numSamples,
        double offset, double rate, double pixelsPerSecond,
        int lowerBoundX, int upperBoundX,
        const std::vector<float> &gainFactors,
        float* __restrict scratch,
-       float* __restrict out) const;
+       float* __restrict out,
+       Reassignments *pReassignments = nullptr) const;
 
    // Grow the cache while preserving the (possibly now invalid!) contents
    void Grow(size_t len_, const SpectrogramSettings& settings,
                double pixelsPerSecond, double start_);
 
-   // Calculate the dirty columns at the begin and end of the cache
-   void Populate
+   // Calculate the dirty columns at the begin and end of the cache,
+   // on all threads of the ThreadPool
+   // If pTileSequence is not null, columns may instead be taken from
+   // spectrogram tiles saved with its sample blocks
+   // Returns false, leaving some columns uncomputed, if cancelled() became
+   // true before the end
+   bool Populate
       (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
        int copyBegin, int copyEnd, size_t numPixels,
        sampleCount numSamples,
-       double offset, double rate, double pixelsPerSecond);
+       double offset, double rate, double pixelsPerSecond,
+       const std::function<bool()> &cancelled,
+       Sequence *pTileSequence = nullptr);
+
+   // Calculate columns [lowerBoundX, upperBoundX) from samples read
+   // beforehand, on all threads of the ThreadPool
+   // Reassignment also takes contributions from limit columns beyond each
+   // edge
+   // Returns false if cancelled() became true before the end
+   bool CalculateColumns
+      (const SpectrogramSettings &settings, const SpecSamples &samples,
+       int lowerBoundX, int upperBoundX, int limit,
+       sampleCount numSamples,
+       double offset, double rate, double pixelsPerSecond,
+       const std::vector<float> &gainFactors,
+       const std::function<bool()> &cancelled);
+
+   // Spectrogram tiles are columns computed at clip samples spaced by a
+   // power of two, the level, and saved in the project, so that redrawing
+   // at another zoom, or after reopening, need not repeat the FFTs.
+   // Pixel columns take the nearest column of the finest level that is no
+   // finer than the pixels.
+   static const int TileColumns = 128;
+   // Below this level, the columns are few enough to compute directly
+   static const int MinTileLevel = 6;
+   static const int MaxTileLevel = 40;
+
+   // Returns -1 if tiles are not used for the settings and zoom
+   static int TileLevel
+      (const SpectrogramSettings &settings, double samplesPerPixel);
+
+   // Identifies the contents of a tile
+   static SpectrumTileKey TileKey
+      (const SpectrogramSettings &settings, double rate, int level,
+       long long tile, const BlockArray &blocks, sampleCount numSamples);
+
+   // Fill columns [lowerBoundX, upperBoundX) from the tiles saved with the
+   // sample blocks of sequence, first computing and saving missing tiles
+   // Returns false if cancelled() became true before the end
+   bool PopulateFromTiles
+      (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
+       Sequence &sequence, int lowerBoundX, int upperBoundX,
+       double offset, double rate, double pixelsPerSecond,
+       const std::vector<float> &gainFactors,
+       const std::function<bool()> &cancelled);
 
    size_t       len { 0 }; // counts pixels, not samples
    int          algorithm;
@@ -212,6 +278,11 @@ public:
    // the length of the clip
    void Resample(int rate, ProgressDialog *progress = NULL);
 
+   // Replace the samples with resampled ones at the given rate, as the
+   // last step of Resample
+   /*! @excsafety{No-fail} */
+   void SetResampled(std::unique_ptr<Sequence> &&pSequence, int rate);
+
    void SetColourIndex( int index ){ mColourIndex = index;};
    int GetColourIndex( ) const { return mColourIndex;};
    void SetOffset(double offset);
@@ -260,11 +331,14 @@ public:
     * calculations and Contrast */
    bool GetWaveDisplay(WaveDisplay &display,
                        double t0, double pixelsPerSecond) const;
+   // The computation stops early, leaving the cache invalid, if the
+   // optional cancelled() becomes true
    bool GetSpectrogram(WaveTrackCache &cache,
                        const float *& spectrogram,
                        const sampleCount *& where,
                        size_t numPixels,
-                       double t0, double pixelsPerSecond) const;
+                       double t0, double pixelsPerSecond,
+                       const std::function<bool()> &cancelled = {}) const;
    std::pair<float, float> GetMinMax(
       double t0, double t1, bool mayThrow = true) const;
    float GetRMS(double t0, double t1, bool mayThrow = true) const;
@@ -287,6 +361,10 @@ public:
    /// Flush must be called after last Append
    void Flush();
 
+   /// Append a block as it is, without copying its samples; there must be
+   /// nothing left to Flush
+   void AppendSharedBlock(const std::shared_ptr<SampleBlock> &pBlock);
+
    /// This name is consistent with WaveTrack::Clear. It performs a "Cut"
    /// operation (but without putting the cutted audio to the clipboard)
    void Clear(double t0, double t1);
@@ -39,6 +39,13 @@ from the project that will own the track.
 #include <float.h>
 #include <math.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <set>
 
 #include "float_cast.h"
 
@@ -50,6 +57,9 @@ from the project that will own the track.
 #include "ProjectSettings.h"
 
 #include "Prefs.h"
+#include "Resample.h"
+#include "ThreadPool.h"
+#include "UserException.h"
 
 #include "effects/TimeWarper.h"
 #include "prefs/QualityPrefs.h"
@@ -60,6 +70,8 @@ from the project that will own the track.
 
 #include "InconsistencyException.h"
 
+#include "widgets/ProgressDialog.h"
+
 #include "tracks/ui/TrackView.h"
 #include "tracks/ui/TrackControls.h"
 
@@ -89,6 +101,8 @@ WaveTrack::Holder WaveTrackFactory::NewWaveTrack(sampleFormat format, double rat
       format = QualityPrefs::SampleFormatChoice();
    if (rate == 0)
       rate = mSettings.GetRate();
+   if (mMaker)
+      return std::make_shared<WaveTrack> ( mMaker(format, rate), format, rate );
    return std::make_shared<WaveTrack> ( mpFactory, format, rate );
 }
 
@@ -2432,10 +2446,208 @@ void WaveTrack::MergeClips(int clipidx1, int clipidx2)
 */
 void WaveTrack::Resample(int rate, ProgressDialog *progress)
 {
-   for (const auto &clip : mClips)
-      clip->Resample(rate, progress);
+   Resample(std::vector<WaveTrack*>{ this }, rate, progress);
+}
+
+namespace {
+// Clips of the same position, length and rate, resampled together
+struct ResampleJob
+{
+   std::vector<WaveClip*> clips;
+   std::vector<std::unique_ptr<Sequence>> sequences;
+};
+
+// Output of a job, one channel after another
+struct ResampledChunk
+{
+   size_t job;
+   size_t len;
+   sampleCount consumed;
+   std::vector<float> samples;
+};
+}
+
+/*! @excsafety{Strong} */
+void WaveTrack::Resample(const std::vector<WaveTrack*> &tracks,
+   int rate, ProgressDialog *progress)
+{
+   // Note:  it is not necessary to do this to cutlines.
+   // They get resampled as needed when they are expanded.
+
+   std::vector<ResampleJob> jobs;
+   std::set<const WaveClip*> paired;
+   const auto needsResampling = [&](const WaveClip *clip){
+      return clip->GetRate() != rate && !paired.count(clip);
+   };
+   for (auto track : tracks) {
+      WaveTrack *partner = nullptr;
+      if (track->GetOwner() && track->IsLeader()) {
+         auto channels = TrackList::Channels(track);
+         if (channels.size() == 2) {
+            partner = *++channels.begin();
+            if (std::find(tracks.begin(), tracks.end(), partner) ==
+                tracks.end())
+               partner = nullptr;
+         }
+      }
+
+      for (const auto &clip : track->mClips) {
+         if (!needsResampling(clip.get()))
+            continue;
+         ResampleJob job;
+         job.clips.push_back(clip.get());
+         if (partner) {
+            for (const auto &other : partner->mClips) {
+               if (needsResampling(other.get()) &&
+                   other->GetOffset() == clip->GetOffset() &&
+                   other->GetRate() == clip->GetRate() &&
+                   other->GetNumSamples() == clip->GetNumSamples()) {
+                  job.clips.push_back(other.get());
+                  paired.insert(other.get());
+                  break;
+               }
+            }
+         }
+         for (auto pClip : job.clips) {
+            auto pSequence = pClip->GetSequence();
+            job.sequences.push_back(std::make_unique<Sequence>(
+               pSequence->GetFactory(), pSequence->GetSampleFormat()));
+         }
+         jobs.push_back(std::move(job));
+      }
+   }
+
+   sampleCount total = 0, done = 0;
+   for (const auto &job : jobs)
+      total += job.clips[0]->GetNumSamples();
+
+   auto &pool = ThreadPool::Get();
+   // Enough to keep the workers busy while this thread appends
+   const size_t maxQueued = 2 * pool.Size();
+
+   std::mutex mutex;
+   std::condition_variable ready, space;
+   std::deque<ResampledChunk> queue;
+   size_t finished = 0;
+   bool stop = false;
+   std::exception_ptr error;
+
+   const auto work = [&](size_t index){
+      try {
+         const auto &clips = jobs[index].clips;
+         const auto nChannels = clips.size();
+         const double factor = (double)rate / (double)clips[0]->GetRate();
+         // constant rate resampling
+         auto resample = Resample::Acquire(true, factor, factor, nChannels);
+
+         const size_t bufsize = 65536;
+         Floats channelBuffer{ bufsize };
+         Floats inBuffer{ bufsize * nChannels };
+         Floats outBuffer{ bufsize * nChannels };
+         sampleCount pos = 0;
+         size_t outGenerated = 0;
+         const auto numSamples = clips[0]->GetNumSamples();
+
+         // Keep going as long as there is something to feed the resampler
+         // or it still spews out samples
+         while (pos < numSamples || outGenerated > 0) {
+            const auto inLen = limitSampleBufferSize( bufsize, numSamples - pos );
+            const bool isLast = ((pos + inLen) == numSamples);
+
+            for (size_t cc = 0; cc < nChannels; ++cc) {
+               clips[cc]->GetSequence()->Get((samplePtr)channelBuffer.get(),
+                  floatSample, pos, inLen, true);
+               for (size_t ii = 0; ii < inLen; ++ii)
+                  inBuffer[ii * nChannels + cc] = channelBuffer[ii];
+            }
+
+            const auto results = resample->Process(factor,
+               inBuffer.get(), inLen, isLast, outBuffer.get(), bufsize);
+            outGenerated = results.second;
+            pos += results.first;
+
+            ResampledChunk chunk{ index, outGenerated, results.first, {} };
+            chunk.samples.resize(outGenerated * nChannels);
+            for (size_t cc = 0; cc < nChannels; ++cc)
+               for (size_t ii = 0; ii < outGenerated; ++ii)
+                  chunk.samples[cc * outGenerated + ii] =
+                     outBuffer[ii * nChannels + cc];
+
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [&]{ return stop || queue.size() < maxQueued; });
+            if (stop)
+               break;
+            queue.push_back(std::move(chunk));
+            ready.notify_one();
+         }
+      }
+      catch (...) {
+         std::lock_guard<std::mutex> guard(mutex);
+         if (!error)
+            error = std::current_exception();
+         stop = true;
+         space.notify_all();
+      }
+
+      std::lock_guard<std::mutex> guard(mutex);
+      ++finished;
+      ready.notify_one();
+   };
+
+   std::vector<std::future<void>> futures;
+   // Whether by success, error or the user, stop the workers before the
+   // state they share goes away
+   auto cleanup = finally([&]{
+      {
+         std::lock_guard<std::mutex> guard(mutex);
+         stop = true;
+      }
+      space.notify_all();
+      for (auto &future : futures)
+         future.wait();
+   });
+   for (size_t ii = 0; ii < jobs.size(); ++ii)
+      futures.push_back(pool.Submit([&work, ii]{ work(ii); }));
+
+   while (true) {
+      std::deque<ResampledChunk> chunks;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         // Wake now and then to keep the progress dialog responsive
+         ready.wait_for(lock, std::chrono::milliseconds(100), [&]{
+            return !queue.empty() || finished == jobs.size() || error;
+         });
+         if (error)
+            std::rethrow_exception(error);
+         chunks.swap(queue);
+         if (chunks.empty() && finished == jobs.size())
+            break;
+      }
+      space.notify_all();
+
+      for (auto &chunk : chunks) {
+         auto &job = jobs[chunk.job];
+         for (size_t cc = 0; cc < job.sequences.size(); ++cc)
+            job.sequences[cc]->Append(
+               (samplePtr)(chunk.samples.data() + cc * chunk.len),
+               floatSample, chunk.len);
+         done += chunk.consumed;
+      }
+
+      if (progress) {
+         auto updateResult = progress->Update(
+            done.as_long_long(), total.as_long_long());
+         if (updateResult != ProgressResult::Success)
+            throw UserException{};
+      }
+   }
 
-   mRate = rate;
+   // Use No-fail-guarantee in these steps
+   for (auto &job : jobs)
+      for (size_t cc = 0; cc < job.clips.size(); ++cc)
+         job.clips[cc]->SetResampled(std::move(job.sequences[cc]), rate);
+   for (auto track : tracks)
+      track->mRate = rate;
 }
 
 namespace {
@@ -503,6 +503,15 @@ private:
    // Resample track (i.e. all clips in the track)
    void Resample(int rate, ProgressDialog *progress = NULL);
 
+   //! Resample all clips of the tracks, several at once on the thread pool
+   /*! Clips of the two channels of a stereo track that line up are
+    resampled together.  Worker threads resample; this thread stores the
+    results, because only it writes the project database.
+    @excsafety{Strong} -- nothing changes unless every clip is resampled
+    */
+   static void Resample(const std::vector<WaveTrack*> &tracks,
+      int rate, ProgressDialog *progress = NULL);
+
    int GetLastScaleType() const { return mLastScaleType; }
    void SetLastScaleType() const;
 
@@ -662,6 +671,19 @@ class AUDACITY_DLL_API WaveTrackFactory final
       , mpFactory(pFactory)
    {
    }
+
+   //! Makes the sample block factory of each new track, as for tracks whose
+   //! samples go elsewhere than the project
+   using SampleBlockFactoryMaker =
+      std::function< SampleBlockFactoryPtr( sampleFormat format, double rate ) >;
+
+   //! GetSampleBlockFactory() is then null
+   WaveTrackFactory( const ProjectSettings &settings,
+      SampleBlockFactoryMaker maker )
+      : mSettings{ settings }
+      , mMaker{ std::move(maker) }
+   {
+   }
    WaveTrackFactory( const WaveTrackFactory & ) PROHIBITED;
    WaveTrackFactory &operator=( const WaveTrackFactory & ) PROHIBITED;
 
@@ -671,6 +693,7 @@ class AUDACITY_DLL_API WaveTrackFactory final
  private:
    const ProjectSettings &mSettings;
    SampleBlockFactoryPtr mpFactory;
+   SampleBlockFactoryMaker mMaker;
  public:
    std::shared_ptr<WaveTrack> DuplicateWaveTrack(const WaveTrack &orig);
    std::shared_ptr<WaveTrack> NewWaveTrack(
@@ -17,6 +17,8 @@ This class now lists
 - Clips
 - Labels
 - Boxes
+- Audio metrics
+- Storage statistics
 
 *//*******************************************************************/
 
@@ -24,6 +26,8 @@ This class now lists
 #include "GetInfoCommand.h"
 
 #include "LoadCommands.h"
+#include "../AudioIO.h"
+#include "../DBConnection.h"
 #include "../Project.h"
 #include "CommandManager.h"
 #include "CommandTargets.h"
@@ -64,6 +68,8 @@ enum {
    kEnvelopes,
    kLabels,
    kBoxes,
+   kAudioMetrics,
+   kStorage,
    nTypes
 };
 
@@ -78,6 +84,8 @@ static const EnumValueSymbol kTypes[nTypes] =
    { XO("Envelopes") },
    { XO("Labels") },
    { XO("Boxes") },
+   { wxT("AudioMetrics"), XO("Audio Metrics") },
+   { XO("Storage") },
 };
 
 enum {
@@ -158,6 +166,8 @@ bool GetInfoCommand::ApplyInner(const CommandContext &context)
       case kEnvelopes    : return SendEnvelopes( context );
       case kLabels       : return SendLabels( context );
       case kBoxes        : return SendBoxes( context );
+      case kAudioMetrics : return SendAudioMetrics( context );
+      case kStorage      : return SendStorage( context );
       default:
          context.Status( "Command options not recognised" );
    }
@@ -527,6 +537,148 @@ bool GetInfoCommand::SendClips(const CommandContext &context)
    return true;
 }
 
+namespace {
+void SendHistogram( const CommandContext &context,
+   const wxString &name, const AudioIOHistogram &histogram )
+{
+   context.StartField( name );
+   context.StartStruct();
+   context.AddItem( (double)histogram.GetCount(), "count" );
+   context.AddItem( histogram.GetMean(), "mean" );
+   context.AddItem( (double)histogram.GetMax(), "max" );
+   // Buckets hold values less than upTo; the last, with upTo 0, the rest
+   context.StartField( "buckets" );
+   context.StartArray();
+   for ( const auto &bucket : histogram.GetBuckets() ) {
+      context.StartStruct();
+      context.AddItem( (double)bucket.upTo, "upTo" );
+      context.AddItem( (double)bucket.count, "count" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   context.EndField();
+   context.EndStruct();
+   context.EndField();
+}
+}
+
+bool GetInfoCommand::SendAudioMetrics(const CommandContext &context)
+{
+   auto gAudioIO = AudioIO::Get();
+   const auto &metrics = gAudioIO->GetMetrics();
+   context.StartStruct();
+   context.AddBool( gAudioIO->IsStreamActive(), "active" );
+   context.AddItem( metrics.GetRate(), "rate" );
+
+   // Times in microseconds; load and fill in percent
+   SendHistogram( context, "callbackMicroseconds",
+      metrics.GetCallbackMicroseconds() );
+   SendHistogram( context, "callbackLoad", metrics.GetCallbackLoad() );
+   SendHistogram( context, "playbackFill", metrics.GetPlaybackFill() );
+   SendHistogram( context, "captureFill", metrics.GetCaptureFill() );
+   SendHistogram( context, "fillBuffersMicroseconds",
+      metrics.GetFillBuffersMicroseconds() );
+   SendHistogram( context, "fillBuffersWaitMicroseconds",
+      metrics.GetFillBuffersWait() );
+
+   context.AddItem( (double)metrics.GetLostSamples(), "lostSamples" );
+   context.AddItem( (double)metrics.GetInputOverflows(), "inputOverflows" );
+   context.AddItem( (double)metrics.GetInputUnderflows(), "inputUnderflows" );
+   context.AddItem( (double)metrics.GetOutputOverflows(), "outputOverflows" );
+   context.AddItem(
+      (double)metrics.GetOutputUnderflows(), "outputUnderflows" );
+
+   context.StartField( "effects" );
+   context.StartArray();
+   for ( const auto &group : metrics.GetEffectGroups() ) {
+      context.StartStruct();
+      context.AddItem( (double)group.group, "group" );
+      context.AddItem( (double)group.blocks, "blocks" );
+      context.AddItem( (double)group.microseconds, "microseconds" );
+      context.AddItem( group.load, "load" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   context.EndField();
+
+   context.EndStruct();
+   return true;
+}
+
+bool GetInfoCommand::SendStorage(const CommandContext &context)
+{
+   auto &pConnection = ConnectionPtr::Get( context.project ).mpConnection;
+   if ( !pConnection ) {
+      context.Status( "The project has no database" );
+      return false;
+   }
+   const auto stats = pConnection->GetStatistics();
+   context.StartStruct();
+
+   // Latencies in microseconds; buckets hold latencies less than upTo,
+   // the last, with upTo 0, the rest
+   context.StartField( "statements" );
+   context.StartArray();
+   for ( const auto &pair : stats.statements ) {
+      const auto &statement = pair.second;
+      const auto &latency = statement.latency;
+      context.StartStruct();
+      context.AddItem( pair.first, "name" );
+      context.AddItem( (double)latency.count, "count" );
+      context.AddItem( latency.GetMeanMicroseconds(), "meanMicroseconds" );
+      context.AddItem( (double)latency.maxMicroseconds, "maxMicroseconds" );
+      context.StartField( "buckets" );
+      context.StartArray();
+      for ( size_t ii = 0; ii < latency.buckets.size(); ++ii ) {
+         if ( latency.buckets[ii] == 0 )
+            continue;
+         context.StartStruct();
+         context.AddItem(
+            (double)DBStatistics::Latency::UpperBound( ii ), "upTo" );
+         context.AddItem( (double)latency.buckets[ii], "count" );
+         context.EndStruct();
+      }
+      context.EndArray();
+      context.EndField();
+      context.AddItem( (double)statement.bytesRead, "bytesRead" );
+      context.AddItem( (double)statement.bytesWritten, "bytesWritten" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   context.EndField();
+
+   context.AddItem( (double)stats.pageSize, "pageSize" );
+   context.AddItem( (double)stats.cacheHits, "cacheHits" );
+   context.AddItem( (double)stats.cacheMisses, "cacheMisses" );
+   context.AddItem( (double)stats.cacheWrites, "cacheWrites" );
+
+   const auto &checkpoints = stats.checkpoints;
+   context.AddItem( (double)checkpoints.latency.count, "checkpoints" );
+   context.AddItem( checkpoints.latency.GetMeanMicroseconds(),
+      "checkpointMeanMicroseconds" );
+   context.AddItem( (double)checkpoints.latency.maxMicroseconds,
+      "checkpointMaxMicroseconds" );
+   context.AddItem( (double)checkpoints.framesCheckpointed,
+      "framesCheckpointed" );
+   context.AddItem( (double)checkpoints.walFrames, "walFrames" );
+   context.AddItem( (double)checkpoints.maxWalFrames, "maxWalFrames" );
+
+   context.StartField( "slowOperations" );
+   context.StartArray();
+   for ( const auto &operation : stats.slowOperations ) {
+      context.StartStruct();
+      context.AddItem( operation.when.FormatISOCombined(), "when" );
+      context.AddItem( operation.what, "what" );
+      context.AddItem( operation.milliseconds, "milliseconds" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   context.EndField();
+
+   context.EndStruct();
+   return true;
+}
+
 bool GetInfoCommand::SendEnvelopes(const CommandContext &context)
 {
    auto &tracks = TrackList::Get( context.project );
@@ -30,6 +30,7 @@
 #include "../LabelTrack.h"
 #include "../Mix.h"
 #include "../PluginManager.h"
+#include "../Profiler.h"
 #include "../ProjectAudioManager.h"
 #include "../ProjectFileIO.h"
 #include "../ProjectSettings.h"
@@ -1203,6 +1204,7 @@ bool Effect::DoEffect(double projectRate,
                       wxWindow *pParent,
                       const EffectDialogFactory &dialogFactory)
 {
+   PROFILE_ZONE("Effect::DoEffect");
    wxASSERT(selectedRegion.duration() >= 0.0);
 
    mOutputTracks.reset();
@@ -1540,6 +1542,7 @@ bool Effect::ProcessTrack(int count,
                           ArrayOf< float * > &inBufPos,
                           ArrayOf< float *> &outBufPos)
 {
+   PROFILE_ZONE("Effect::ProcessTrack");
    bool rc = true;
 
    // Give the plugin a chance to initialize
@@ -1697,6 +1700,7 @@ bool Effect::ProcessTrack(int count,
       decltype(curBlockSize) processed;
       try
       {
+         PROFILE_ZONE("Effect::ProcessBlock");
          processed = ProcessBlock(inBufPos.get(), outBufPos.get(), curBlockSize);
       }
       catch( const AudacityException & WXUNUSED(e) )
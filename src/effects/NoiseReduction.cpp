@@ -49,15 +49,23 @@
 #include "../widgets/HelpSystem.h"
 #include "../Prefs.h"
 #include "../RealFFTf.h"
+#include "../ThreadPool.h"
 
 #include "../WaveTrack.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/valnum.h"
 
 #include <algorithm>
+#include <deque>
 #include <vector>
 #include <math.h>
 
+#if defined(__SSE__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define NOISE_REDUCTION_SSE
+#include <xmmintrin.h>
+#endif
+
 #if defined(__WXMSW__) && !defined(__CYGWIN__)
 #include <float.h>
 #define finite(x) _finite(x)
@@ -277,21 +285,36 @@ private:
                    WaveTrackFactory &factory,
                    int count, WaveTrack *track,
                    sampleCount start, sampleCount len);
+   size_t SegmentSteps(const WaveTrack &track) const;
+   bool ProcessOneParallel(EffectNoiseReduction &effect,
+                   Statistics &statistics,
+                   int count, WaveTrack *track,
+                   sampleCount start, sampleCount len);
+   void ProcessSegment(Statistics &statistics,
+      const FloatVector &input, bool atEnd, FloatVector &output);
+   void ReplaceTrackSamples(WaveTrack *track, WaveTrack *outputTrack,
+      sampleCount start, sampleCount len);
 
    void StartNewTrack();
    void ProcessSamples(Statistics &statistics,
-      WaveTrack *outputTrack, size_t len, float *buffer);
+      FloatVector &output, size_t len, const float *buffer);
    void FillFirstHistoryWindow();
    void ApplyFreqSmoothing(FloatVector &gains);
    void GatherStatistics(Statistics &statistics);
-   inline bool Classify(const Statistics &statistics, int band);
-   void ReduceNoise(const Statistics &statistics, WaveTrack *outputTrack);
+   void Classify(const Statistics &statistics);
+   void ReduceNoise(const Statistics &statistics, FloatVector &output);
    void RotateHistoryWindows();
    void FinishTrackStatistics(Statistics &statistics);
-   void FinishTrack(Statistics &statistics, WaveTrack *outputTrack);
+   void FinishTrack(Statistics &statistics, FloatVector &output);
 
 private:
 
+   // Retained so that parallel lanes can be made with the same settings
+   const Settings &mSettings;
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+   const double mF0, mF1;
+#endif
+
    const bool mDoProfile;
 
    const double mSampleRate;
@@ -307,7 +330,9 @@ private:
    FloatVector mOutWindow;
 
    const size_t mSpectrumSize;
-   FloatVector mFreqSmoothingScratch;
+   std::vector<double> mFreqSmoothingScratch;
+   // 1.0 for bands of the center window classified as noise, else 0.0
+   FloatVector mNoiseFlags;
    const size_t mFreqSmoothingBins;
    // When spectral selection limits the affected band:
    int mBinLow;  // inclusive lower bound
@@ -332,6 +357,9 @@ private:
    unsigned  mNWindowsToExamine;
    unsigned  mCenter;
    unsigned  mHistoryLen;
+   // Steps a parallel lane must run before its output matches the
+   // serial computation
+   unsigned  mWarmUpSteps;
 
    struct Record
    {
@@ -722,26 +750,20 @@ void EffectNoiseReduction::Worker::ApplyFreqSmoothing(FloatVector &gains)
    if (mFreqSmoothingBins == 0)
       return;
 
-   {
-      float *pScratch = &mFreqSmoothingScratch[0];
-      std::fill(pScratch, pScratch + mSpectrumSize, 0.0f);
-   }
-
+   // Running sums of the logs, so that each average costs the same
+   // regardless of the number of smoothing bands.  Double precision
+   // keeps the differences of the sums accurate.
+   double *const pSums = &mFreqSmoothingScratch[0];
+   pSums[0] = 0.0;
    for (size_t ii = 0; ii < mSpectrumSize; ++ii)
-      gains[ii] = log(gains[ii]);
+      pSums[ii + 1] = pSums[ii] + log(gains[ii]);
 
    // ii must be signed
    for (int ii = 0; ii < (int)mSpectrumSize; ++ii) {
       const int j0 = std::max(0, ii - (int)mFreqSmoothingBins);
       const int j1 = std::min(mSpectrumSize - 1, ii + mFreqSmoothingBins);
-      for(int jj = j0; jj <= j1; ++jj) {
-         mFreqSmoothingScratch[ii] += gains[jj];
-      }
-      mFreqSmoothingScratch[ii] /= (j1 - j0 + 1);
+      gains[ii] = exp((pSums[j1 + 1] - pSums[j0]) / (j1 - j0 + 1));
    }
-
-   for (size_t ii = 0; ii < mSpectrumSize; ++ii)
-      gains[ii] = exp(mFreqSmoothingScratch[ii]);
 }
 
 EffectNoiseReduction::Worker::Worker
@@ -750,7 +772,12 @@ EffectNoiseReduction::Worker::Worker
 , double f0, double f1
 #endif
 )
-: mDoProfile(settings.mDoProfile)
+: mSettings(settings)
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+, mF0(f0), mF1(f1)
+#endif
+
+, mDoProfile(settings.mDoProfile)
 
 , mSampleRate(sampleRate)
 
@@ -763,7 +790,8 @@ EffectNoiseReduction::Worker::Worker
 , mOutWindow()
 
 , mSpectrumSize(1 + mWindowSize / 2)
-, mFreqSmoothingScratch(mSpectrumSize)
+, mFreqSmoothingScratch(mSpectrumSize + 1)
+, mNoiseFlags(mSpectrumSize)
 , mFreqSmoothingBins((int)(settings.mFreqSmoothingBands))
 , mBinLow(0)
 , mBinHigh(mSpectrumSize)
@@ -821,6 +849,11 @@ EffectNoiseReduction::Worker::Worker
       mHistoryLen = std::max(mNWindowsToExamine, mCenter + nAttackBlocks);
    }
 
+   // A lane started mid-track must fill its history, refill the
+   // overlap-add buffer, and let any release of gains decay to the
+   // floor, before its output agrees with a run from the track start
+   mWarmUpSteps = mHistoryLen + mStepsPerWindow + nReleaseBlocks;
+
    mQueue.resize(mHistoryLen);
    for (unsigned ii = 0; ii < mHistoryLen; ++ii)
       mQueue[ii] = std::make_unique<Record>(mSpectrumSize);
@@ -938,8 +971,8 @@ void EffectNoiseReduction::Worker::StartNewTrack()
 }
 
 void EffectNoiseReduction::Worker::ProcessSamples
-(Statistics &statistics, WaveTrack *outputTrack,
- size_t len, float *buffer)
+(Statistics &statistics, FloatVector &output,
+ size_t len, const float *buffer)
 {
    while (len && mOutStepCount * mStepSize < mInSampleCount) {
       auto avail = std::min(len, mWindowSize - mInWavePos);
@@ -953,7 +986,7 @@ void EffectNoiseReduction::Worker::ProcessSamples
          if (mDoProfile)
             GatherStatistics(statistics);
          else
-            ReduceNoise(statistics, outputTrack);
+            ReduceNoise(statistics, output);
          ++mOutStepCount;
          RotateHistoryWindows();
 
@@ -1037,7 +1070,7 @@ void EffectNoiseReduction::Worker::FinishTrackStatistics(Statistics &statistics)
 }
 
 void EffectNoiseReduction::Worker::FinishTrack
-(Statistics &statistics, WaveTrack *outputTrack)
+(Statistics &statistics, FloatVector &output)
 {
    // Keep flushing empty input buffers through the history
    // windows until we've output exactly as many samples as
@@ -1049,7 +1082,7 @@ void EffectNoiseReduction::Worker::FinishTrack
    FloatVector empty(mStepSize);
 
    while (mOutStepCount * mStepSize < mInSampleCount) {
-      ProcessSamples(statistics, outputTrack, mStepSize, &empty[0]);
+      ProcessSamples(statistics, output, mStepSize, &empty[0]);
    }
 }
 
@@ -1088,20 +1121,25 @@ void EffectNoiseReduction::Worker::GatherStatistics(Statistics &statistics)
 #endif
 }
 
-// Return true iff the given band of the "center" window looks like noise.
-// Examine the band in a few neighboring windows to decide.
-inline
-bool EffectNoiseReduction::Worker::Classify(const Statistics &statistics, int band)
+// Decide which bands of the "center" window look like noise, setting
+// mNoiseFlags to 1.0 for those and 0.0 for the others.
+// Examine each band in a few neighboring windows to decide.
+void EffectNoiseReduction::Worker::Classify(const Statistics &statistics)
 {
+   int jj = mBinLow;
+   float *const pFlags = &mNoiseFlags[0];
+
    switch (mMethod) {
 #ifdef OLD_METHOD_AVAILABLE
    case DM_OLD_METHOD:
-      {
-         float min = mQueue[0]->mSpectrums[band];
+      for (; jj < mBinHigh; ++jj) {
+         float min = mQueue[0]->mSpectrums[jj];
          for (unsigned ii = 1; ii < mNWindowsToExamine; ++ii)
-            min = std::min(min, mQueue[ii]->mSpectrums[band]);
-         return min <= mOldSensitivityFactor * statistics.mNoiseThreshold[band];
+            min = std::min(min, mQueue[ii]->mSpectrums[jj]);
+         pFlags[jj] =
+            min <= mOldSensitivityFactor * statistics.mNoiseThreshold[jj];
       }
+      return;
 #endif
    // New methods suppose an exponential distribution of power values
    // in the noise; NEW sensitivity is meant to be log of probability
@@ -1115,66 +1153,81 @@ bool EffectNoiseReduction::Worker::Classify(const Statistics &statistics, int ba
       // avoid being fooled by up and down excursions into
       // either the mistake of classifying noise as not noise
       // (leaving a musical noise chime), or the opposite
-      // (distorting the signal with a drop out). 
-      if (mNWindowsToExamine == 3)
-         // No different from second greatest.
-         goto secondGreatest;
-      else if (mNWindowsToExamine == 5)
-      {
-         float greatest = 0.0, second = 0.0, third = 0.0;
-         for (unsigned ii = 0; ii < mNWindowsToExamine; ++ii) {
-            const float power = mQueue[ii]->mSpectrums[band];
-            if (power >= greatest)
-               third = second, second = greatest, greatest = power;
-            else if (power >= second)
-               third = second, second = power;
-            else if (power >= third)
-               third = power;
-         }
-         return third <= mNewSensitivity * statistics.mMeans[band];
-      }
-      else {
-         wxASSERT(false);
-         return true;
-      }
-   secondGreatest:
+      // (distorting the signal with a drop out).
+      // With three windows, that is no different from second greatest.
+      wxASSERT(mNWindowsToExamine == 3 || mNWindowsToExamine == 5);
+      break;
    case DM_SECOND_GREATEST:
-      {
-         // This method just throws out the high outlier.  It
-         // should be less prone to distortions and more prone to
-         // chimes.
-         float greatest = 0.0, second = 0.0;
+      // This method just throws out the high outlier.  It
+      // should be less prone to distortions and more prone to
+      // chimes.
+      break;
+   default:
+      wxASSERT(false);
+      std::fill(pFlags + mBinLow, pFlags + mBinHigh, 1.0f);
+      return;
+   }
+
+   // Find the second (or third) greatest power of each band among the
+   // examined windows, keeping running maxima without branches so that
+   // several bands are done at once.  Inserting p into the sorted
+   // greatest, second, third is:
+   //    third = max(third, min(second, p))
+   //    second = max(second, min(greatest, p))
+   //    greatest = max(greatest, p)
+   const bool useThird = (mMethod == DM_MEDIAN && mNWindowsToExamine == 5);
+   const float sensitivity = mNewSensitivity;
+   const float *const pMeans = &statistics.mMeans[0];
+
+#ifdef NOISE_REDUCTION_SSE
+   {
+      const __m128 vSensitivity = _mm_set1_ps(sensitivity);
+      const __m128 vOne = _mm_set1_ps(1.0f);
+      for (; jj + 4 <= mBinHigh; jj += 4) {
+         __m128 greatest = _mm_setzero_ps(), second = greatest,
+            third = greatest;
          for (unsigned ii = 0; ii < mNWindowsToExamine; ++ii) {
-            const float power = mQueue[ii]->mSpectrums[band];
-            if (power >= greatest)
-               second = greatest, greatest = power;
-            else if (power >= second)
-               second = power;
+            const __m128 power = _mm_loadu_ps(&mQueue[ii]->mSpectrums[jj]);
+            third = _mm_max_ps(third, _mm_min_ps(second, power));
+            second = _mm_max_ps(second, _mm_min_ps(greatest, power));
+            greatest = _mm_max_ps(greatest, power);
          }
-         return second <= mNewSensitivity * statistics.mMeans[band];
+         const __m128 threshold =
+            _mm_mul_ps(vSensitivity, _mm_loadu_ps(pMeans + jj));
+         const __m128 isNoise =
+            _mm_cmple_ps(useThird ? third : second, threshold);
+         _mm_storeu_ps(pFlags + jj, _mm_and_ps(isNoise, vOne));
       }
-   default:
-      wxASSERT(false);
-      return true;
+   }
+#endif
+
+   for (; jj < mBinHigh; ++jj) {
+      float greatest = 0.0, second = 0.0, third = 0.0;
+      for (unsigned ii = 0; ii < mNWindowsToExamine; ++ii) {
+         const float power = mQueue[ii]->mSpectrums[jj];
+         third = std::max(third, std::min(second, power));
+         second = std::max(second, std::min(greatest, power));
+         greatest = std::max(greatest, power);
+      }
+      const float threshold = sensitivity * pMeans[jj];
+      pFlags[jj] = (useThird ? third : second) <= threshold ? 1.0f : 0.0f;
    }
 }
 
 void EffectNoiseReduction::Worker::ReduceNoise
-(const Statistics &statistics, WaveTrack *outputTrack)
+(const Statistics &statistics, FloatVector &output)
 {
    // Raise the gain for elements in the center of the sliding history
    // or, if isolating noise, zero out the non-noise
    {
+      Classify(statistics);
+      const float *pFlag = &mNoiseFlags[mBinLow];
       float *pGain = &mQueue[mCenter]->mGains[0];
       if (mNoiseReductionChoice == NRC_ISOLATE_NOISE) {
          // All above or below the selected frequency range is non-noise
          std::fill(pGain, pGain + mBinLow, 0.0f);
          std::fill(pGain + mBinHigh, pGain + mSpectrumSize, 0.0f);
-         pGain += mBinLow;
-         for (int jj = mBinLow; jj < mBinHigh; ++jj) {
-               const bool isNoise = Classify(statistics, jj);
-            *pGain++ = isNoise ? 1.0 : 0.0;
-         }
+         std::copy(pFlag, pFlag + (mBinHigh - mBinLow), pGain + mBinLow);
       }
       else {
          // All above or below the selected frequency range is non-noise
@@ -1182,8 +1235,8 @@ void EffectNoiseReduction::Worker::ReduceNoise
          std::fill(pGain + mBinHigh, pGain + mSpectrumSize, 1.0f);
          pGain += mBinLow;
          for (int jj = mBinLow; jj < mBinHigh; ++jj) {
-            const bool isNoise = Classify(statistics, jj);
-            if (!isNoise) 
+            const bool isNoise = (*pFlag++ != 0.0f);
+            if (!isNoise)
                *pGain = 1.0;
             ++pGain;
          }
@@ -1219,7 +1272,19 @@ void EffectNoiseReduction::Worker::ReduceNoise
       {
          float *pNextGain = &mQueue[mCenter - 1]->mGains[0];
          const float *pThisGain = &mQueue[mCenter]->mGains[0];
-         for (int nn = mSpectrumSize; nn--;) {
+         int nn = mSpectrumSize;
+#ifdef NOISE_REDUCTION_SSE
+         const __m128 vFloor = _mm_set1_ps(mNoiseAttenFactor);
+         const __m128 vRelease = _mm_set1_ps(mOneBlockRelease);
+         for (; nn >= 4; nn -= 4) {
+            const __m128 released =
+               _mm_max_ps(vFloor, _mm_mul_ps(_mm_loadu_ps(pThisGain), vRelease));
+            _mm_storeu_ps(pNextGain,
+               _mm_max_ps(_mm_loadu_ps(pNextGain), released));
+            pThisGain += 4, pNextGain += 4;
+         }
+#endif
+         for (; nn--;) {
             *pNextGain =
                std::max(*pNextGain,
                         std::max(mNoiseAttenFactor,
@@ -1259,6 +1324,18 @@ void EffectNoiseReduction::Worker::ReduceNoise
             mFFTBuffer[1] = record.mImagFFTs[0] * (record.mGains[last] - 1.0);
          }
          else {
+#ifdef NOISE_REDUCTION_SSE
+            // Products of floats are exact in double, so single precision
+            // gives the same results as the scalar loop
+            for (; nn >= 4; nn -= 4) {
+               const __m128 gain = _mm_loadu_ps(pGain);
+               const __m128 real = _mm_mul_ps(_mm_loadu_ps(pReal), gain);
+               const __m128 imag = _mm_mul_ps(_mm_loadu_ps(pImag), gain);
+               _mm_storeu_ps(pBuffer, _mm_unpacklo_ps(real, imag));
+               _mm_storeu_ps(pBuffer + 4, _mm_unpackhi_ps(real, imag));
+               pGain += 4, pReal += 4, pImag += 4, pBuffer += 8;
+            }
+#endif
             for (; nn--;) {
                const double gain = *pGain++;
                *pBuffer++ = *pReal++ * gain;
@@ -1297,7 +1374,7 @@ void EffectNoiseReduction::Worker::ReduceNoise
       float *buffer = &mOutOverlapBuffer[0];
       if (mOutStepCount >= 0) {
          // Output the first portion of the overlap buffer, they're done
-         outputTrack->Append((samplePtr)buffer, floatSample, mStepSize);
+         output.insert(output.end(), buffer, buffer + mStepSize);
       }
 
       // Shift the remainder over.
@@ -1313,6 +1390,12 @@ bool EffectNoiseReduction::Worker::ProcessOne
    if (track == NULL)
       return false;
 
+   // Long selections are cut into segments computed on all cores
+   if (ThreadPool::Get().Size() > 1 &&
+       mMethod != DM_OLD_METHOD &&
+       len > 2 * SegmentSteps(*track) * mStepSize)
+      return ProcessOneParallel(effect, statistics, count, track, start, len);
+
    StartNewTrack();
 
    WaveTrack::Holder outputTrack;
@@ -1321,6 +1404,7 @@ bool EffectNoiseReduction::Worker::ProcessOne
 
    auto bufferSize = track->GetMaxBlockSize();
    FloatVector buffer(bufferSize);
+   FloatVector output;
 
    bool bLoopSuccess = true;
    auto samplePos = start;
@@ -1336,7 +1420,11 @@ bool EffectNoiseReduction::Worker::ProcessOne
       samplePos += blockSize;
 
       mInSampleCount += blockSize;
-      ProcessSamples(statistics, outputTrack.get(), blockSize, &buffer[0]);
+      ProcessSamples(statistics, output, blockSize, &buffer[0]);
+      if (!output.empty()) {
+         outputTrack->Append((samplePtr)&output[0], floatSample, output.size());
+         output.clear();
+      }
 
       // Update the Progress meter, let user cancel
       bLoopSuccess = 
@@ -1348,26 +1436,176 @@ bool EffectNoiseReduction::Worker::ProcessOne
    if (bLoopSuccess) {
       if (mDoProfile)
          FinishTrackStatistics(statistics);
-      else
-         FinishTrack(statistics, &*outputTrack);
+      else {
+         FinishTrack(statistics, output);
+         if (!output.empty())
+            outputTrack->Append(
+               (samplePtr)&output[0], floatSample, output.size());
+      }
    }
 
-   if (bLoopSuccess && !mDoProfile) {
-      // Flush the output WaveTrack (since it's buffered)
-      outputTrack->Flush();
-
-      // Take the output track and insert it in place of the original
-      // sample data (as operated on -- this may not match mT0/mT1)
-      double t0 = outputTrack->LongSamplesToTime(start);
-      double tLen = outputTrack->LongSamplesToTime(len);
-      // Filtering effects always end up with more data than they started with.  Delete this 'tail'.
-      outputTrack->HandleClear(tLen, outputTrack->GetEndTime(), false, false);
-      track->ClearAndPaste(t0, t0 + tLen, &*outputTrack, true, false);
+   if (bLoopSuccess && !mDoProfile)
+      ReplaceTrackSamples(track, &*outputTrack, start, len);
+
+   return bLoopSuccess;
+}
+
+size_t EffectNoiseReduction::Worker::SegmentSteps(const WaveTrack &track) const
+{
+   // Profiling has no warm-up and may use short segments; noise reduction
+   // makes the warm-up overhead small relative to the segment
+   const size_t blockSteps = track.GetMaxBlockSize() / mStepSize;
+   return mDoProfile
+      ? std::max<size_t>(256, blockSteps)
+      : std::max<size_t>(16 * mWarmUpSteps, 4 * blockSteps);
+}
+
+bool EffectNoiseReduction::Worker::ProcessOneParallel
+(EffectNoiseReduction &effect, Statistics &statistics,
+ int count, WaveTrack *track, sampleCount start, sampleCount len)
+{
+   auto &pool = ThreadPool::Get();
+   const auto nLanes = pool.Size();
+
+   // Each lane has its own history windows and buffers.  The lanes
+   // only compute; all reading and appending of sample data, which goes
+   // through the project database, remains on this thread.
+   std::vector<std::unique_ptr<Worker>> lanes;
+   std::vector<std::unique_ptr<Statistics>> laneStatistics;
+   for (size_t ii = 0; ii < nLanes; ++ii) {
+      lanes.push_back(std::make_unique<Worker>(mSettings, mSampleRate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+         , mF0, mF1
+#endif
+      ));
+      if (mDoProfile)
+         laneStatistics.push_back(std::make_unique<Statistics>(
+            mSpectrumSize, statistics.mRate, statistics.mWindowTypes));
+   }
+
+   // A profiling segment owns the windows that start within it, and reads
+   // ahead to complete the last of them.  A reduction segment begins
+   // early enough to warm up its lane, and reads ahead past the latency
+   // of the history queue and the overlap-add.
+   const size_t segmentLen = SegmentSteps(*track) * mStepSize;
+   const size_t warmUp = mDoProfile ? 0 : mWarmUpSteps * mStepSize;
+   const size_t lookAhead = mDoProfile
+      ? mWindowSize - mStepSize
+      : (mHistoryLen + mStepsPerWindow) * mStepSize;
+
+   struct Segment {
+      size_t lane;
+      size_t offset; // of the wanted output in the lane's output
+      size_t length;
+      FloatVector input;
+      FloatVector output;
+      std::future<void> done;
+   };
+   std::deque<Segment> pending;
+   auto cleanup = finally([&]{
+      // The lanes must outlive their tasks, even after cancellation
+      for (auto &segment : pending)
+         if (segment.done.valid())
+            segment.done.wait();
+   });
+
+   WaveTrack::Holder outputTrack;
+   if (!mDoProfile)
+      outputTrack = track->EmptyCopy();
+
+   bool bLoopSuccess = true;
+   size_t nextLane = 0;
+   sampleCount segmentStart = 0, finished = 0;
+   while (bLoopSuccess && finished < len) {
+      // Keep all lanes busy, reading ahead while they compute
+      while (segmentStart < len && pending.size() < nLanes) {
+         const auto segmentEnd = std::min(len, segmentStart + segmentLen);
+         const auto inputStart = segmentStart > warmUp
+            ? segmentStart - warmUp : sampleCount{ 0 };
+         const auto inputEnd = std::min(len, segmentEnd + lookAhead);
+         const bool atEnd = (inputEnd == len);
+
+         pending.emplace_back();
+         auto &segment = pending.back();
+         segment.lane = nextLane;
+         nextLane = (nextLane + 1) % nLanes;
+         segment.offset = (segmentStart - inputStart).as_size_t();
+         segment.length = (segmentEnd - segmentStart).as_size_t();
+         segment.input.resize((inputEnd - inputStart).as_size_t());
+         track->Get((samplePtr)&segment.input[0], floatSample,
+            start + inputStart, segment.input.size());
+
+         auto &lane = *lanes[segment.lane];
+         auto &laneStats =
+            mDoProfile ? *laneStatistics[segment.lane] : statistics;
+         segment.done = pool.Submit([&lane, &laneStats, &segment, atEnd]{
+            lane.ProcessSegment(laneStats, segment.input, atEnd,
+               segment.output);
+         });
+
+         segmentStart = segmentEnd;
+      }
+
+      // Consume the oldest segment; rethrows any exception of the lane
+      auto &segment = pending.front();
+      segment.done.get();
+      if (!mDoProfile) {
+         wxASSERT(segment.output.size() >= segment.offset + segment.length);
+         outputTrack->Append((samplePtr)&segment.output[segment.offset],
+            floatSample, segment.length);
+      }
+      finished += segment.length;
+      pending.pop_front();
+
+      // Update the Progress meter, let user cancel
+      bLoopSuccess =
+         !effect.TrackProgress(count,
+                               finished.as_double() / len.as_double());
+   }
+
+   if (bLoopSuccess) {
+      if (mDoProfile) {
+         for (const auto &pLaneStatistics : laneStatistics) {
+            statistics.mTrackWindows += pLaneStatistics->mTrackWindows;
+            for (size_t jj = 0; jj < mSpectrumSize; ++jj)
+               statistics.mSums[jj] += pLaneStatistics->mSums[jj];
+         }
+         FinishTrackStatistics(statistics);
+      }
+      else
+         ReplaceTrackSamples(track, &*outputTrack, start, len);
    }
 
    return bLoopSuccess;
 }
 
+void EffectNoiseReduction::Worker::ProcessSegment
+(Statistics &statistics, const FloatVector &input, bool atEnd,
+ FloatVector &output)
+{
+   // Start primed as at the beginning of a track
+   StartNewTrack();
+   mInSampleCount = input.size();
+   ProcessSamples(statistics, output, input.size(), &input[0]);
+   if (atEnd && !mDoProfile)
+      FinishTrack(statistics, output);
+}
+
+void EffectNoiseReduction::Worker::ReplaceTrackSamples
+(WaveTrack *track, WaveTrack *outputTrack, sampleCount start, sampleCount len)
+{
+   // Flush the output WaveTrack (since it's buffered)
+   outputTrack->Flush();
+
+   // Take the output track and insert it in place of the original
+   // sample data (as operated on -- this may not match mT0/mT1)
+   double t0 = outputTrack->LongSamplesToTime(start);
+   double tLen = outputTrack->LongSamplesToTime(len);
+   // Filtering effects always end up with more data than they started with.  Delete this 'tail'.
+   outputTrack->HandleClear(tLen, outputTrack->GetEndTime(), false, false);
+   track->ClearAndPaste(t0, t0 + tLen, outputTrack, true, false);
+}
+
 //----------------------------------------------------------------------------
 // EffectNoiseReduction::Dialog
 //----------------------------------------------------------------------------
@@ -15,6 +15,7 @@
 
 #include "audacity/EffectInterface.h"
 #include "MemoryX.h"
+#include "../Profiler.h"
 
 #include <atomic>
 #include <wx/time.h>
@@ -309,6 +310,8 @@ void RealtimeEffectManager::RealtimeProcessStart()
 //
 size_t RealtimeEffectManager::RealtimeProcess(int group, unsigned chans, float **buffers, size_t numSamples)
 {
+   PROFILE_ZONE("RealtimeEffectManager::RealtimeProcess");
+
    // Protect ourselves from the main thread
    mRealtimeLock.Enter();
 
@@ -31,6 +31,12 @@
 #include "../Audacity.h" // for USE_* macros
 #include "Export.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+
 #include <wx/dcclient.h>
 #include <wx/file.h>
 #include <wx/filectrl.h>
@@ -50,6 +56,7 @@
 
 #include "../widgets/FileDialog/FileDialog.h"
 
+#include "../AudacityException.h"
 #include "../FileFormats.h"
 #include "../Mix.h"
 #include "../Prefs.h"
@@ -60,6 +67,7 @@
 #include "../ProjectWindow.h"
 #include "../ShuttleGui.h"
 #include "../Tags.h"
+#include "../ThreadPool.h"
 #include "../TimeTrack.h"
 #include "../WaveTrack.h"
 #include "../widgets/AudacityMessageBox.h"
@@ -71,6 +79,412 @@
 #include "../widgets/HelpSystem.h"
 #include "../widgets/ProgressDialog.h"
 
+//----------------------------------------------------------------------------
+// ExportSource
+//----------------------------------------------------------------------------
+
+ExportSource::~ExportSource()
+{
+}
+
+//----------------------------------------------------------------------------
+// ExportJobScope
+//----------------------------------------------------------------------------
+
+namespace {
+thread_local ExportJobStatus *sCurrentJob = nullptr;
+}
+
+ExportJobScope::ExportJobScope(ExportJobStatus &status)
+   : mPrevious{ sCurrentJob }
+{
+   sCurrentJob = &status;
+}
+
+ExportJobScope::~ExportJobScope()
+{
+   sCurrentJob = mPrevious;
+}
+
+ExportJobStatus *ExportJobScope::Current()
+{
+   return sCurrentJob;
+}
+
+//----------------------------------------------------------------------------
+// DeferredExports
+//----------------------------------------------------------------------------
+
+namespace {
+thread_local DeferredExports *sCurrentExports = nullptr;
+}
+
+struct DeferredExports::Running
+{
+   std::unique_ptr<ExportPlugin> pPlugin;
+   ExportJobStatus status;
+   wxString path;
+   wxString backup;
+   std::future<ProgressResult> result;
+};
+
+DeferredExports::Scope::Scope(DeferredExports &exports)
+   : mPrevious{ sCurrentExports }
+{
+   sCurrentExports = &exports;
+}
+
+DeferredExports::Scope::~Scope()
+{
+   sCurrentExports = mPrevious;
+}
+
+DeferredExports *DeferredExports::Current()
+{
+   return sCurrentExports;
+}
+
+DeferredExports::DeferredExports()
+{
+}
+
+DeferredExports::~DeferredExports()
+{
+   // The exports use this object
+   for (auto &pRunning : mRunning)
+      pRunning->result.wait();
+}
+
+void DeferredExports::Start(AudacityProject *project,
+   std::unique_ptr<ExportPlugin> pPlugin,
+   unsigned channels, const wxString &path, const wxString &backup,
+   bool selectedOnly, double t0, double t1, int subformat)
+{
+   auto pRunning = std::make_unique<Running>();
+   pRunning->pPlugin = std::move(pPlugin);
+   pRunning->path = path;
+   pRunning->backup = backup;
+
+   auto pExport = pRunning->pPlugin.get();
+   auto pStatus = &pRunning->status;
+   pRunning->result = ThreadPool::Get().Submit( [=]{
+      ExportJobScope scope{ *pStatus };
+      // Stays null; the plug-in reports to the status instead
+      std::unique_ptr<ProgressDialog> pDialog;
+      return pExport->Export(project, pDialog, channels, path,
+         selectedOnly, t0, t1, nullptr, nullptr, subformat);
+   } );
+
+   mRunning.push_back(std::move(pRunning));
+}
+
+void DeferredExports::Add(Result result)
+{
+   mResults.push_back(std::move(result));
+}
+
+void DeferredExports::Wait()
+{
+   for (auto &pRunning : mRunning) {
+      auto &running = *pRunning;
+      // Exceptions from the worker, as for failure to read the project,
+      // count as failure
+      const auto result = GuardedCall<ProgressResult>(
+         [&]{ return running.result.get(); },
+         MakeSimpleGuard(ProgressResult::Failed) );
+      const bool success =
+         result == ProgressResult::Success || result == ProgressResult::Stopped;
+
+      // As in Exporter::ExportTracks
+      if (!running.backup.empty()) {
+         if (success)
+            ::wxRemoveFile(running.backup);
+         else {
+            ::wxRemoveFile(running.path);
+            ::wxRenameFile(running.backup, running.path);
+         }
+      }
+      else if (!success)
+         ::wxRemoveFile(running.path);
+
+      mResults.push_back({ running.path, success, running.status.mError });
+   }
+   mRunning.clear();
+}
+
+std::vector<DeferredExports::Result> DeferredExports::TakeResults()
+{
+   Wait();
+   return std::move(mResults);
+}
+
+ExportProgress::ExportProgress(
+   ProgressDialog *pDialog, ExportJobStatus *pStatus)
+   : mpDialog{ pDialog }
+   , mpStatus{ pStatus }
+{
+}
+
+ProgressResult ExportProgress::Update(double current, double total)
+{
+   if (mpDialog)
+      return mpDialog->Update(current, total);
+
+   if (total > 0)
+      mpStatus->mFraction.store(std::min(1.0, std::max(0.0, current / total)));
+   if (mpStatus->mCancel.load())
+      return ProgressResult::Cancelled;
+   if (mpStatus->mStop.load())
+      return ProgressResult::Stopped;
+   return ProgressResult::Success;
+}
+
+//----------------------------------------------------------------------------
+// ExportMixer
+//----------------------------------------------------------------------------
+
+namespace {
+// Buffers that the mixer may get ahead of the encoder
+constexpr size_t PipelineDepth = 3;
+}
+
+struct ExportMixer::Pipeline
+{
+   struct Slot
+   {
+      ArrayOf<char> data;
+      size_t count{};
+      double time{};
+   };
+   Slot slots[PipelineDepth];
+
+   std::mutex mutex;
+   std::condition_variable condition;
+   size_t filled{ 0 };   // Slots ready for, or held by, the encoder
+   size_t readIndex{ 0 };
+   size_t writeIndex{ 0 };
+   bool reading{ false }; // The encoder holds the slot at readIndex
+   bool ended{ false };
+   bool stop{ false };
+   std::exception_ptr exception;
+
+   std::future<void> producer;
+};
+
+ExportMixer::ExportMixer(std::unique_ptr<Mixer> pMixer, unsigned numChannels,
+   size_t bufferSize, bool interleaved, sampleFormat format,
+   double startTime)
+   : mpMixer{ std::move(pMixer) }
+   , mNumChannels{ numChannels }
+   , mBufferSize{ bufferSize }
+   , mChannelBytes{ bufferSize * SAMPLE_SIZE(format) *
+      (interleaved ? numChannels : 1) }
+   , mInterleaved{ interleaved }
+   , mFormat{ format }
+   , mCurrentTime{ startTime }
+{
+   if (ExportJobScope::Current())
+      return;
+
+   mpPipeline = std::make_unique<Pipeline>();
+   for (auto &slot : mpPipeline->slots)
+      slot.data.reinit(mChannelBytes * (interleaved ? 1 : numChannels));
+
+   // The producer waits only for the encoder, never for other tasks of the
+   // pool, so it is safe to run there
+   mpPipeline->producer = ThreadPool::Get().Submit( [this]{ Produce(); } );
+}
+
+ExportMixer::ExportMixer(std::shared_ptr<ExportSource> pSource,
+   unsigned numChannels, size_t bufferSize, bool interleaved,
+   sampleFormat format, double rate, double startTime)
+   : mNumChannels{ numChannels }
+   , mBufferSize{ bufferSize }
+   , mChannelBytes{ bufferSize * SAMPLE_SIZE(format) *
+      (interleaved ? numChannels : 1) }
+   , mInterleaved{ interleaved }
+   , mFormat{ format }
+   , mCurrentTime{ startTime }
+   , mpSource{ std::move(pSource) }
+   , mRate{ rate }
+{
+   // Room for the channels of the source, and for those it lacks
+   mSourceBuffers.reinit(
+      std::max(numChannels, mpSource->GetChannels()), bufferSize);
+   mBuffer.reinit(mChannelBytes * (interleaved ? 1 : numChannels));
+}
+
+ExportMixer::~ExportMixer()
+{
+   if (!mpPipeline)
+      return;
+
+   {
+      std::lock_guard<std::mutex> guard(mpPipeline->mutex);
+      mpPipeline->stop = true;
+   }
+   mpPipeline->condition.notify_all();
+   mpPipeline->producer.wait();
+}
+
+void ExportMixer::Produce()
+{
+   auto &pipeline = *mpPipeline;
+   try {
+      while (true) {
+         size_t index;
+         {
+            std::unique_lock<std::mutex> lock(pipeline.mutex);
+            // Wait for a slot that is neither filled nor being encoded
+            pipeline.condition.wait(lock, [&]{
+               return pipeline.stop || pipeline.filled < PipelineDepth;
+            });
+            if (pipeline.stop)
+               return;
+            index = pipeline.writeIndex;
+         }
+
+         auto &slot = pipeline.slots[index];
+         slot.count = mpMixer->Process(mBufferSize);
+         slot.time = mpMixer->MixGetCurrentTime();
+         if (mInterleaved)
+            memcpy(slot.data.get(), mpMixer->GetBuffer(), mChannelBytes);
+         else {
+            for (unsigned channel = 0; channel < mNumChannels; ++channel)
+               memcpy(slot.data.get() + channel * mChannelBytes,
+                  mpMixer->GetBuffer(channel), mChannelBytes);
+         }
+
+         {
+            std::lock_guard<std::mutex> guard(pipeline.mutex);
+            ++pipeline.filled;
+            pipeline.writeIndex = (index + 1) % PipelineDepth;
+         }
+         pipeline.condition.notify_all();
+
+         if (slot.count == 0)
+            return;
+      }
+   }
+   catch (...) {
+      {
+         std::lock_guard<std::mutex> guard(pipeline.mutex);
+         pipeline.exception = std::current_exception();
+      }
+      pipeline.condition.notify_all();
+   }
+}
+
+size_t ExportMixer::PullSource()
+{
+   const auto count = mpSource->Pull(mSourceBuffers.get(), mBufferSize);
+   if (count == 0)
+      return 0;
+
+   // Average the source channels into fewer, or repeat them into more
+   const unsigned sourceChannels = mpSource->GetChannels();
+   if (mNumChannels < sourceChannels) {
+      for (unsigned channel = 0; channel < mNumChannels; ++channel) {
+         const auto dest = mSourceBuffers[channel].get();
+         unsigned summed = 1;
+         for (auto other = channel + mNumChannels;
+              other < sourceChannels; other += mNumChannels, ++summed) {
+            const auto src = mSourceBuffers[other].get();
+            for (size_t ii = 0; ii < count; ++ii)
+               dest[ii] += src[ii];
+         }
+         for (size_t ii = 0; ii < count; ++ii)
+            dest[ii] /= summed;
+      }
+   }
+   else {
+      for (auto channel = sourceChannels; channel < mNumChannels; ++channel)
+         memcpy(mSourceBuffers[channel].get(),
+            mSourceBuffers[channel % sourceChannels].get(),
+            count * sizeof(float));
+   }
+
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+   for (unsigned channel = 0; channel < mNumChannels; ++channel) {
+      const auto src = (samplePtr) mSourceBuffers[channel].get();
+      if (mInterleaved)
+         CopySamples(src, floatSample,
+            mBuffer.get() + channel * sampleSize, mFormat,
+            count, true, 1, mNumChannels);
+      else
+         CopySamples(src, floatSample,
+            mBuffer.get() + channel * mChannelBytes, mFormat, count);
+   }
+
+   mCurrentTime += count / mRate;
+   return count;
+}
+
+size_t ExportMixer::Process(size_t maxSamples)
+{
+   wxASSERT(maxSamples == mBufferSize);
+
+   if (mpSource)
+      return PullSource();
+
+   if (!mpPipeline) {
+      auto result = mpMixer->Process(maxSamples);
+      mCurrentTime = mpMixer->MixGetCurrentTime();
+      return result;
+   }
+
+   auto &pipeline = *mpPipeline;
+   std::unique_lock<std::mutex> lock(pipeline.mutex);
+   if (pipeline.ended)
+      return 0;
+
+   // Give back the slot encoded since the last call
+   if (pipeline.reading) {
+      pipeline.reading = false;
+      --pipeline.filled;
+      pipeline.readIndex = (pipeline.readIndex + 1) % PipelineDepth;
+      pipeline.condition.notify_all();
+   }
+
+   pipeline.condition.wait(lock, [&]{
+      return pipeline.filled > 0 || pipeline.exception;
+   });
+   if (pipeline.filled == 0)
+      // Rethrow, in this thread, the failure to read the project
+      std::rethrow_exception(pipeline.exception);
+
+   auto &slot = pipeline.slots[pipeline.readIndex];
+   pipeline.reading = true;
+   mCurrentTime = slot.time;
+   if (slot.count == 0)
+      pipeline.ended = true;
+   return slot.count;
+}
+
+samplePtr ExportMixer::GetBuffer()
+{
+   if (mpSource)
+      return mBuffer.get();
+   if (!mpPipeline)
+      return mpMixer->GetBuffer();
+   return (samplePtr) mpPipeline->slots[mpPipeline->readIndex].data.get();
+}
+
+samplePtr ExportMixer::GetBuffer(int channel)
+{
+   if (mpSource)
+      return mBuffer.get() + channel * mChannelBytes;
+   if (!mpPipeline)
+      return mpMixer->GetBuffer(channel);
+   return (samplePtr) mpPipeline->slots[mpPipeline->readIndex].data.get()
+      + channel * mChannelBytes;
+}
+
+double ExportMixer::MixGetCurrentTime()
+{
+   return mCurrentTime;
+}
+
 //----------------------------------------------------------------------------
 // ExportPlugin
 //----------------------------------------------------------------------------
@@ -88,6 +502,11 @@ bool ExportPlugin::CheckFileName(wxFileName & WXUNUSED(filename), int WXUNUSED(f
   return true;
 }
 
+bool ExportPlugin::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return false;
+}
+
 /** \brief Add a NEW entry to the list of formats this plug-in can export
  *
  * To configure the format use SetFormat, SetCanMetaData etc with the index of
@@ -217,27 +636,39 @@ void ExportPlugin::OptionsCreate(ShuttleGui &S, int WXUNUSED(format))
 }
 
 //Create a mixer by computing the time warp factor
-std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
+std::unique_ptr<ExportMixer> ExportPlugin::CreateMixer(const TrackList &tracks,
          bool selectionOnly,
          double startTime, double stopTime,
          unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
          double outRate, sampleFormat outFormat,
          bool highQuality, MixerSpec *mixerSpec)
 {
+   const auto pJob = ExportJobScope::Current();
+   if (pJob && pJob->mpSource)
+      return std::make_unique<ExportMixer>(pJob->mpSource,
+         numOutChannels, outBufferSize, outInterleaved, outFormat,
+         outRate, startTime);
+
    WaveTrackConstArray inputTracks;
 
-   bool anySolo = !(( tracks.Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
+   // A concurrent export names its tracks, because it can't select them
+   if (pJob && !pJob->mTracks.empty())
+      inputTracks = pJob->mTracks;
+   else {
+      bool anySolo = !(( tracks.Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
+
+      auto range = tracks.Any< const WaveTrack >()
+         + (selectionOnly ? &Track::IsSelected : &Track::Any )
+         - ( anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute);
+      for (auto pTrack: range)
+         inputTracks.push_back(
+            pTrack->SharedPointer< const WaveTrack >() );
+   }
 
-   auto range = tracks.Any< const WaveTrack >()
-      + (selectionOnly ? &Track::IsSelected : &Track::Any )
-      - ( anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute);
-   for (auto pTrack: range)
-      inputTracks.push_back(
-         pTrack->SharedPointer< const WaveTrack >() );
    const auto timeTrack = *tracks.Any<const TimeTrack>().begin();
    auto envelope = timeTrack ? timeTrack->GetEnvelope() : nullptr;
    // MB: the stop time should not be warped, this was a bug.
-   return std::make_unique<Mixer>(inputTracks,
+   auto pMixer = std::make_unique<Mixer>(inputTracks,
                   // Throw, to stop exporting, if read fails:
                   true,
                   Mixer::WarpOptions(envelope),
@@ -245,11 +676,17 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
                   numOutChannels, outBufferSize, outInterleaved,
                   outRate, outFormat,
                   highQuality, mixerSpec);
+   return std::make_unique<ExportMixer>(std::move(pMixer),
+      numOutChannels, outBufferSize, outInterleaved, outFormat, startTime);
 }
 
-void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
+ExportProgress ExportPlugin::InitProgress(
+   std::unique_ptr<ProgressDialog> &pDialog,
    const TranslatableString &title, const TranslatableString &message)
 {
+   if (const auto pJob = ExportJobScope::Current())
+      return { nullptr, pJob };
+
    if (!pDialog)
       pDialog = std::make_unique<ProgressDialog>( title, message );
    else {
@@ -257,15 +694,31 @@ void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
       pDialog->SetMessage( message );
       pDialog->Reinit();
    }
+   return { pDialog.get(), nullptr };
 }
 
-void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
+ExportProgress ExportPlugin::InitProgress(
+   std::unique_ptr<ProgressDialog> &pDialog,
    const wxFileNameWrapper &title, const TranslatableString &message)
 {
    return InitProgress(
       pDialog, Verbatim( title.GetName() ), message );
 }
 
+void ExportPlugin::ShowError(const TranslatableString &message,
+   const TranslatableString &caption, long style)
+{
+   if (const auto pJob = ExportJobScope::Current()) {
+      if (pJob->mError.empty())
+         pJob->mError = message;
+      return;
+   }
+
+   AudacityMessageBox( message,
+      caption.empty() ? AudacityMessageBoxCaptionStr() : caption,
+      style ? style : wxOK | wxCENTRE );
+}
+
 //----------------------------------------------------------------------------
 // Export
 //----------------------------------------------------------------------------
@@ -343,14 +796,17 @@ Exporter::Exporter( AudacityProject &project )
 
       void Visit( SingleItem &item, const Path &path ) override
       {
-         mPlugins.emplace_back(
-            static_cast<ExporterItem&>( item ).mFactory() );
+         const auto &factory = static_cast<ExporterItem&>( item ).mFactory;
+         mPlugins.emplace_back( factory() );
+         mFactories.push_back( factory );
       }
 
       ExportPluginArray mPlugins;
+      std::vector<ExportPluginFactory> mFactories;
    } visitor;
 
    mPlugins.swap( visitor.mPlugins );
+   mFactories.swap( visitor.mFactories );
 
    SetFileDialogTitle( XO("Export Audio") );
 }
@@ -395,6 +851,12 @@ const ExportPluginArray &Exporter::GetPlugins()
    return mPlugins;
 }
 
+std::unique_ptr<ExportPlugin> Exporter::MakePlugin(size_t index) const
+{
+   wxASSERT(index < mFactories.size());
+   return mFactories[index]();
+}
+
 bool Exporter::DoEditMetadata(AudacityProject &project,
    const TranslatableString &title,
    const TranslatableString &shortUndoDescription, bool force)
@@ -937,6 +1399,20 @@ bool Exporter::ExportTracks()
       }
    } );
 
+   const auto pDeferred = DeferredExports::Current();
+   if (pDeferred && !mMixerSpec &&
+       mPlugins[mFormat]->CanExportConcurrently(mSubFormat)) {
+      // The deferred export restores any original file when it is done
+      const auto backup = (mActualName != mFilename)
+         ? mFilename.GetFullPath() : wxString{};
+      pDeferred->Start(mProject, MakePlugin(mFormat), mChannels,
+         mActualName.GetFullPath(), backup,
+         mSelectedOnly, mT0, mT1, mSubFormat);
+      mFilename = mActualName;
+      success = true;
+      return success;
+   }
+
    std::unique_ptr<ProgressDialog> pDialog;
    auto result = mPlugins[mFormat]->Export(mProject,
                                        pDialog,
@@ -952,6 +1428,9 @@ bool Exporter::ExportTracks()
    success =
       result == ProgressResult::Success || result == ProgressResult::Stopped;
 
+   if (pDeferred)
+      pDeferred->Add({ mActualName.GetFullPath(), success, {} });
+
    return success;
 }
 
@@ -11,7 +11,9 @@
 #ifndef __AUDACITY_EXPORT__
 #define __AUDACITY_EXPORT__
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <wx/filename.h> // member variable
 #include "audacity/Types.h"
@@ -28,6 +30,7 @@ class wxMemoryDC;
 class wxSimplebook;
 class wxStaticText;
 class AudacityProject;
+class ExportPlugin;
 class WaveTrack;
 class Tags;
 class TrackList;
@@ -58,6 +61,193 @@ class AUDACITY_DLL_API FormatInfo
       bool mCanMetaData;
 };
 
+//----------------------------------------------------------------------------
+// ExportJobStatus
+//----------------------------------------------------------------------------
+
+//! Samples that a concurrent export encodes in place of a mix of tracks, as
+//! when a file is converted without a project; they are at the project rate
+class AUDACITY_DLL_API ExportSource /* not final */
+{
+public:
+   virtual ~ExportSource();
+
+   virtual unsigned GetChannels() const = 0;
+
+   //! Called on the exporting thread, to fill up to maxSamples of each
+   //! channel; returns how many it filled, 0 at the end
+   virtual size_t Pull(float *const *buffers, size_t maxSamples) = 0;
+};
+
+//! Shared between the main thread and a worker thread exporting one file,
+//! in place of the progress and error dialogs that only the main thread
+//! may show
+class AUDACITY_DLL_API ExportJobStatus
+{
+public:
+   //! Tracks to mix, in place of all or the selected tracks, if not empty
+   WaveTrackConstArray mTracks;
+
+   //! What to encode in place of any tracks, if not null
+   std::shared_ptr<ExportSource> mpSource;
+
+   //! Fraction of the file done, written by the worker
+   std::atomic<double> mFraction{ 0.0 };
+
+   //! Set by the main thread, to make the worker stop or cancel
+   std::atomic<bool> mStop{ false };
+   std::atomic<bool> mCancel{ false };
+
+   //! The first error the export reported; read only when it is done
+   TranslatableString mError;
+};
+
+//! While in scope, exports on the constructing thread report to the status
+class AUDACITY_DLL_API ExportJobScope
+{
+public:
+   explicit ExportJobScope(ExportJobStatus &status);
+   ExportJobScope(const ExportJobScope&) = delete;
+   ExportJobScope &operator= (const ExportJobScope&) = delete;
+   ~ExportJobScope();
+
+   //! The status for this thread, or null when exporting with dialogs
+   static ExportJobStatus *Current();
+
+private:
+   ExportJobStatus *mPrevious;
+};
+
+//! Exports that Exporter started on the thread pool and did not wait for,
+//! as when a batch of files is processed; each reads its project until done
+class AUDACITY_DLL_API DeferredExports
+{
+public:
+   //! While in scope, Exporter defers the exports on the constructing thread
+   //! by plug-ins that can export concurrently
+   class AUDACITY_DLL_API Scope
+   {
+   public:
+      explicit Scope(DeferredExports &exports);
+      Scope(const Scope&) = delete;
+      Scope &operator= (const Scope&) = delete;
+      ~Scope();
+
+   private:
+      DeferredExports *mPrevious;
+   };
+
+   //! The outcome of one export, deferred or not
+   struct Result
+   {
+      wxString path;
+      bool success{ false };
+      //! The error the plug-in reported, if any
+      TranslatableString error;
+   };
+
+   //! The exports for this thread, or null when Exporter waits for them
+   static DeferredExports *Current();
+
+   DeferredExports();
+   DeferredExports(const DeferredExports&) = delete;
+   DeferredExports &operator= (const DeferredExports&) = delete;
+   //! Waits for the exports still running
+   ~DeferredExports();
+
+   //! Run the plug-in on the pool; path is the file it writes, and backup,
+   //! if not empty, the original of that file, to restore if it fails
+   void Start(AudacityProject *project, std::unique_ptr<ExportPlugin> pPlugin,
+      unsigned channels, const wxString &path, const wxString &backup,
+      bool selectedOnly, double t0, double t1, int subformat);
+
+   //! Record an export that was not deferred
+   void Add(Result result);
+
+   bool IsBusy() const { return !mRunning.empty(); }
+
+   //! Wait for the running exports, so that the project may change
+   void Wait();
+
+   //! Wait, then take the results so far
+   std::vector<Result> TakeResults();
+
+private:
+   struct Running;
+   std::vector< std::unique_ptr<Running> > mRunning;
+   std::vector<Result> mResults;
+};
+
+//! What InitProgress gives a plug-in to update as it exports
+class AUDACITY_DLL_API ExportProgress
+{
+public:
+   ExportProgress(ProgressDialog *pDialog, ExportJobStatus *pStatus);
+
+   ProgressResult Update(double current, double total);
+
+private:
+   ProgressDialog *mpDialog;
+   ExportJobStatus *mpStatus;
+};
+
+//----------------------------------------------------------------------------
+// ExportMixer
+//----------------------------------------------------------------------------
+
+//! Runs a Mixer on a worker thread a few buffers ahead of the plug-in that
+//! encodes them, so that mixing and encoding overlap; it has the part of
+//! the interface of Mixer that plug-ins use
+class AUDACITY_DLL_API ExportMixer
+{
+public:
+   ExportMixer(std::unique_ptr<Mixer> pMixer, unsigned numChannels,
+      size_t bufferSize, bool interleaved, sampleFormat format,
+      double startTime);
+   //! Reads the source on the thread that encodes, converting its samples
+   ExportMixer(std::shared_ptr<ExportSource> pSource, unsigned numChannels,
+      size_t bufferSize, bool interleaved, sampleFormat format,
+      double rate, double startTime);
+   ExportMixer(const ExportMixer&) = delete;
+   ExportMixer &operator= (const ExportMixer&) = delete;
+   ~ExportMixer();
+
+   //! The next buffer, waiting for it if need be; 0 at the end
+   /*! @param maxSamples must be the buffer size given to CreateMixer */
+   size_t Process(size_t maxSamples);
+
+   //! The interleaved buffer from the last Process
+   samplePtr GetBuffer();
+   //! One channel of the buffer from the last Process, if not interleaved
+   samplePtr GetBuffer(int channel);
+
+   //! Time at the end of the buffer from the last Process
+   double MixGetCurrentTime();
+
+private:
+   struct Pipeline;
+   void Produce();
+   size_t PullSource();
+
+   std::unique_ptr<Mixer> mpMixer;
+   const unsigned mNumChannels;
+   const size_t mBufferSize;
+   const size_t mChannelBytes;
+   const bool mInterleaved;
+   const sampleFormat mFormat;
+   double mCurrentTime;
+
+   // In place of the mixer, with buffers for its samples and the conversion
+   std::shared_ptr<ExportSource> mpSource;
+   double mRate{ 0 };
+   FloatBuffers mSourceBuffers;
+   ArrayOf<char> mBuffer;
+
+   // Null when mixing on the thread that encodes, as in concurrent exports,
+   // which are already parallel
+   std::unique_ptr<Pipeline> mpPipeline;
+};
+
 //----------------------------------------------------------------------------
 // ExportPlugin
 //----------------------------------------------------------------------------
@@ -101,6 +291,13 @@ public:
     * of channels in exported file. -1 for unspecified */
    virtual int SetNumExportChannels() { return -1; }
 
+   /** @brief Whether Export of the sub-format may run on a worker thread,
+    * inside an ExportJobScope, as ExportMultiple does for several files at
+    * once.  Such an Export must show no dialogs, updating the ExportProgress
+    * from InitProgress and reporting errors with ShowError instead; it may
+    * read preferences.  Default is false. */
+   virtual bool CanExportConcurrently(int subformat);
+
    /** \brief called to export audio into a file.
     *
     * @param pDialog To be initialized with pointer to a NEW ProgressDialog if
@@ -134,19 +331,24 @@ public:
                        int subformat = 0) = 0;
 
 protected:
-   std::unique_ptr<Mixer> CreateMixer(const TrackList &tracks,
+   std::unique_ptr<ExportMixer> CreateMixer(const TrackList &tracks,
          bool selectionOnly,
          double startTime, double stopTime,
          unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
          double outRate, sampleFormat outFormat,
          bool highQuality = true, MixerSpec *mixerSpec = NULL);
 
-   // Create or recycle a dialog.
-   static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
+   // Create or recycle a dialog, unless exporting in an ExportJobScope.
+   static ExportProgress InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
          const TranslatableString &title, const TranslatableString &message);
-   static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
+   static ExportProgress InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
          const wxFileNameWrapper &title, const TranslatableString &message);
 
+   // Show a message box, or in an ExportJobScope, keep the message for the
+   // main thread to show.
+   static void ShowError(const TranslatableString &message,
+         const TranslatableString &caption = {}, long style = 0);
+
 private:
    std::vector<FormatInfo> mFormatInfos;
 };
@@ -200,6 +402,10 @@ public:
 
    const ExportPluginArray &GetPlugins();
 
+   //! A new instance of the plug-in at the index in GetPlugins(), for an
+   //! export on a worker thread that must not share plug-in state
+   std::unique_ptr<ExportPlugin> MakePlugin(size_t index) const;
+
    // Auto Export from Timer Recording
    bool ProcessFromTimerRecording(bool selectedOnly,
                                   double t0,
@@ -235,6 +441,7 @@ private:
    std::unique_ptr<MixerSpec> mMixerSpec;
 
    ExportPluginArray mPlugins;
+   std::vector<ExportPluginFactory> mFactories;
 
    wxFileName mFilename;
    wxFileName mActualName;
@@ -222,6 +222,8 @@ public:
                MixerSpec *mixerSpec = NULL,
                const Tags *metadata = NULL,
                int subformat = 0) override;
+   // optional
+   bool CanExportConcurrently(int subformat) override;
 
 private:
 
@@ -280,7 +282,7 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    // See note in GetMetadata() about a bug in libflac++ 1.1.2
    if (success && !GetMetadata(project, metadata)) {
       // TODO: more precise message
-      AudacityMessageBox( XO("Unable to export") );
+      ShowError( XO("Unable to export") );
       return ProgressResult::Cancelled;
    }
 
@@ -333,7 +335,7 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
 
    if (!success) {
       // TODO: more precise message
-      AudacityMessageBox( XO("Unable to export") );
+      ShowError( XO("Unable to export") );
       return ProgressResult::Cancelled;
    }
 
@@ -343,7 +345,7 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    wxFFile f;     // will be closed when it goes out of scope
    const auto path = fName.GetFullPath();
    if (!f.Open(path, wxT("w+b"))) {
-      AudacityMessageBox( XO("FLAC export couldn't open %s").Format( path ) );
+      ShowError( XO("FLAC export couldn't open %s").Format( path ) );
       return ProgressResult::Cancelled;
    }
 
@@ -352,7 +354,7 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    // libflac can't (under Windows).
    int status = encoder.init(f.fp());
    if (status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
-      AudacityMessageBox(
+      ShowError(
          XO("FLAC encoder failed to initialize\nStatus: %d")
             .Format( status ) );
       return ProgressResult::Cancelled;
@@ -378,11 +380,10 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
 
    ArraysOf<FLAC__int32> tmpsmplbuf{ numChannels, SAMPLES_PER_RUN, true };
 
-   InitProgress( pDialog, fName,
+   auto progress = InitProgress( pDialog, fName,
       selectionOnly
          ? XO("Exporting the selected audio as FLAC")
          : XO("Exporting the audio as FLAC") );
-   auto &progress = *pDialog;
 
    while (updateResult == ProgressResult::Success) {
       auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
@@ -407,7 +408,7 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
                reinterpret_cast<FLAC__int32**>( tmpsmplbuf.get() ),
                samplesThisRun) ) {
             // TODO: more precise message
-            AudacityMessageBox( XO("Unable to export") );
+            ShowError( XO("Unable to export") );
             updateResult = ProgressResult::Cancelled;
             break;
          }
@@ -434,6 +435,11 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    return updateResult;
 }
 
+bool ExportFLAC::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return true;
+}
+
 void ExportFLAC::OptionsCreate(ShuttleGui &S, int format)
 {
    S.AddWindow( safenew ExportFLACOptions{ S.GetParent(), format } );
@@ -219,6 +219,8 @@ public:
                MixerSpec *mixerSpec = NULL,
                const Tags *metadata = NULL,
                int subformat = 0) override;
+   // optional
+   bool CanExportConcurrently(int subformat) override;
 
 private:
 
@@ -265,7 +267,7 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
 
    if (twolame_init_params(encodeOptions) != 0)
    {
-      AudacityMessageBox(
+      ShowError(
          XO("Cannot export MP2 with this sample rate and bit rate"),
          XO("Error"),
          wxICON_STOP);
@@ -278,7 +280,7 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
 
    FileIO outFile(fName, FileIO::Output);
    if (!outFile.IsOpened()) {
-      AudacityMessageBox( XO("Unable to open target file for writing") );
+      ShowError( XO("Unable to open target file for writing") );
       return ProgressResult::Cancelled;
    }
 
@@ -289,7 +291,7 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
    if (id3len && !endOfFile) {
       if ( outFile.Write(id3buffer.get(), id3len).GetLastError() ) {
          // TODO: more precise message
-         AudacityMessageBox( XO("Unable to export") );
+         ShowError( XO("Unable to export") );
          return ProgressResult::Cancelled;
       }
    }
@@ -310,13 +312,12 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
          stereo ? 2 : 1, pcmBufferSize, true,
          rate, int16Sample, true, mixerSpec);
 
-      InitProgress( pDialog, fName,
+      auto progress = InitProgress( pDialog, fName,
          selectionOnly
             ? XO("Exporting selected audio at %ld kbps")
                  .Format( bitrate )
             : XO("Exporting the audio at %ld kbps")
                  .Format( bitrate ) );
-      auto &progress = *pDialog;
 
       while (updateResult == ProgressResult::Success) {
          auto pcmNumSamples = mixer->Process(pcmBufferSize);
@@ -335,14 +336,14 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
 
          if (mp2BufferNumBytes < 0) {
             // TODO: more precise message
-            AudacityMessageBox( XO("Unable to export") );
+            ShowError( XO("Unable to export") );
             updateResult = ProgressResult::Cancelled;
             break;
          }
 
          if ( outFile.Write(mp2Buffer.get(), mp2BufferNumBytes).GetLastError() ) {
             // TODO: more precise message
-            AudacityMessageBox( XO("Unable to export") );
+            ShowError( XO("Unable to export") );
             return ProgressResult::Cancelled;
          }
 
@@ -358,7 +359,7 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
    if (mp2BufferNumBytes > 0)
       if ( outFile.Write(mp2Buffer.get(), mp2BufferNumBytes).GetLastError() ) {
          // TODO: more precise message
-         AudacityMessageBox( XO("Unable to export") );
+         ShowError( XO("Unable to export") );
          return ProgressResult::Cancelled;
       }
 
@@ -367,19 +368,24 @@ ProgressResult ExportMP2::Export(AudacityProject *project,
    if (id3len && endOfFile)
       if ( outFile.Write(id3buffer.get(), id3len).GetLastError() ) {
          // TODO: more precise message
-         AudacityMessageBox( XO("Unable to export") );
+         ShowError( XO("Unable to export") );
          return ProgressResult::Cancelled;
       }
 
    if ( !outFile.Close() ) {
       // TODO: more precise message
-      AudacityMessageBox( XO("Unable to export") );
+      ShowError( XO("Unable to export") );
       return ProgressResult::Cancelled;
    }
 
    return updateResult;
 }
 
+bool ExportMP2::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return true;
+}
+
 void ExportMP2::OptionsCreate(ShuttleGui &S, int format)
 {
    S.AddWindow( safenew ExportMP2Options{ S.GetParent(), format } );
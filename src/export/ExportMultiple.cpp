@@ -18,6 +18,9 @@
 #include "../Audacity.h"
 #include "ExportMultiple.h"
 
+#include <chrono>
+#include <list>
+
 #include <wx/defs.h>
 #include <wx/button.h>
 #include <wx/checkbox.h>
@@ -37,6 +40,7 @@
 #include <wx/textctrl.h>
 #include <wx/textdlg.h>
 
+#include "../AudacityException.h"
 #include "../FileFormats.h"
 #include "../FileNames.h"
 #include "../LabelTrack.h"
@@ -47,6 +51,7 @@
 #include "../SelectionState.h"
 #include "../ShuttleGui.h"
 #include "../Tags.h"
+#include "../ThreadPool.h"
 #include "../WaveTrack.h"
 #include "../widgets/HelpSystem.h"
 #include "../widgets/AudacityMessageBox.h"
@@ -415,6 +420,11 @@ void ExportMultipleDialog::PopulateOrExchange(ShuttleGui& S)
       mOverwrite = S.Id(OverwriteID).TieCheckBox(XXO("Overwrite existing files"),
                                                  {wxT("/Export/OverwriteExisting"),
                                                   false});
+      S.AddSpace(20, 0);
+      S.TieSpinCtrl(XXO("Files to export at once:"),
+                    {wxT("/Export/ConcurrentFiles"),
+                     (int) ThreadPool::DefaultSize()},
+                    64, 1);
    }
    S.EndHorizontalLay();
 
@@ -851,6 +861,26 @@ ProgressResult ExportMultipleDialog::ExportMultipleByLabel(bool byName,
       l++;  // next label, count up one
    }
 
+   if (CanExportConcurrently(numFiles)) {
+      // All files mix the same tracks, those CreateMixer would choose
+      bool anySolo =
+         !(( mTracks->Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
+      WaveTrackConstArray tracks;
+      for (auto pTrack : mTracks->Any<const WaveTrack>() -
+         (anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute))
+         tracks.push_back(pTrack->SharedPointer<const WaveTrack>());
+
+      std::vector<ConcurrentJob> jobs;
+      for (const auto &kit : exportSettings) {
+         // Bug 1440 fix.
+         if (kit.destfile.GetName().empty())
+            continue;
+         jobs.push_back({ kit.destfile, channels, kit.t0, kit.t1,
+            &kit.filetags, tracks });
+      }
+      return DoConcurrentExports(jobs);
+   }
+
    auto ok = ProgressResult::Success;   // did it work?
    int count = 0; // count the number of successful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
@@ -995,6 +1025,24 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    }
    // end of user-interactive data gathering loop, start of export processing
    // loop
+   if (CanExportConcurrently(exportSettings.size())) {
+      // Name the channels of each track, in place of selecting them
+      std::vector<ConcurrentJob> jobs;
+      size_t ii = 0;
+      for (auto tr : mTracks->Leaders<WaveTrack>() -
+         (anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute)) {
+         const auto &kit = exportSettings[ii++];
+         if (kit.destfile.GetName().empty())
+            continue;
+         WaveTrackConstArray tracks;
+         for (auto channel : TrackList::Channels(tr))
+            tracks.push_back(channel->SharedPointer<const WaveTrack>());
+         jobs.push_back({ kit.destfile, kit.channels, kit.t0, kit.t1,
+            &kit.filetags, tracks });
+      }
+      return DoConcurrentExports(jobs);
+   }
+
    int count = 0; // count the number of successful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
    std::unique_ptr<ProgressDialog> pDialog;
@@ -1050,8 +1098,6 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
                               double t1,
                               const Tags &tags)
 {
-   wxFileName name;
-
    wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (inName.GetFullName()));
    wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "), channels, t0, t1);
    if (selectedOnly)
@@ -1060,6 +1106,37 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
       wxLogDebug(wxT("Whole Project"));
 
    wxFileName backup;
+   const wxString fullPath{ PrepareExportFile(inName, backup).GetFullPath() };
+
+   ProgressResult success = ProgressResult::Cancelled;
+
+   auto cleanup = finally( [&] {
+      FinishExportFile(success, backup, fullPath);
+   } );
+
+   // Call the format export routine
+   success = mPlugins[mPluginIndex]->Export(mProject,
+                                            pDialog,
+                                                channels,
+                                                fullPath,
+                                                selectedOnly,
+                                                t0,
+                                                t1,
+                                                NULL,
+                                                &tags,
+                                                mSubFormatIndex);
+
+   Refresh();
+   Update();
+
+   return success;
+}
+
+wxFileName ExportMultipleDialog::PrepareExportFile(
+   const wxFileName &inName, wxFileName &backup)
+{
+   wxFileName name;
+
    if (mOverwrite->GetValue()) {
       name = inName;
       backup.Assign(name);
@@ -1082,50 +1159,182 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
       }
    }
 
-   ProgressResult success = ProgressResult::Cancelled;
-   const wxString fullPath{name.GetFullPath()};
+   return name;
+}
 
-   auto cleanup = finally( [&] {
-      bool ok =
-         success == ProgressResult::Stopped ||
-         success == ProgressResult::Success;
-      if (backup.IsOk()) {
-         if ( ok )
-            // Remove backup
-            ::wxRemoveFile(backup.GetFullPath());
-         else {
-            // Restore original
-            ::wxRemoveFile(fullPath);
-            ::wxRenameFile(backup.GetFullPath(), fullPath);
-         }
-      }
+void ExportMultipleDialog::FinishExportFile(ProgressResult result,
+   const wxFileName &backup, const wxString &fullPath)
+{
+   bool ok =
+      result == ProgressResult::Stopped ||
+      result == ProgressResult::Success;
+   if (backup.IsOk()) {
+      if ( ok )
+         // Remove backup
+         ::wxRemoveFile(backup.GetFullPath());
       else {
-         if ( ! ok )
-            // Remove any new, and only partially written, file.
-            ::wxRemoveFile(fullPath);
+         // Restore original
+         ::wxRemoveFile(fullPath);
+         ::wxRenameFile(backup.GetFullPath(), fullPath);
       }
-   } );
-
-   // Call the format export routine
-   success = mPlugins[mPluginIndex]->Export(mProject,
-                                            pDialog,
-                                                channels,
-                                                fullPath,
-                                                selectedOnly,
-                                                t0,
-                                                t1,
-                                                NULL,
-                                                &tags,
-                                                mSubFormatIndex);
+   }
+   else {
+      if ( ! ok )
+         // Remove any new, and only partially written, file.
+         ::wxRemoveFile(fullPath);
+   }
 
-   if (success == ProgressResult::Success || success == ProgressResult::Stopped) {
+   if (ok)
       mExported.push_back(fullPath);
+}
+
+bool ExportMultipleDialog::CanExportConcurrently(size_t numFiles)
+{
+   return numFiles > 1 &&
+      gPrefs->Read(wxT("/Export/ConcurrentFiles"),
+         (long) ThreadPool::DefaultSize()) > 1 &&
+      mPlugins[mPluginIndex]->CanExportConcurrently(mSubFormatIndex);
+}
+
+ProgressResult ExportMultipleDialog::DoConcurrentExports(
+   const std::vector<ConcurrentJob> &jobs)
+{
+   auto &pool = ThreadPool::Get();
+   const size_t maxRunning = std::min<size_t>(pool.Size(), std::max(1L,
+      gPrefs->Read(wxT("/Export/ConcurrentFiles"),
+         (long) ThreadPool::DefaultSize())));
+
+   // A file that is running, with its own plug-in object, because
+   // plug-ins keep state while exporting
+   struct Running
+   {
+      const ConcurrentJob *pJob;
+      std::unique_ptr<ExportPlugin> pPlugin;
+      std::unique_ptr<ExportJobStatus> pStatus;
+      wxFileName backup;
+      wxString fullPath;
+      std::future<ProgressResult> result;
+   };
+   std::list<Running> running;
+
+   // Progress is the total duration exported, over all files
+   double total = 0;
+   for (const auto &job : jobs)
+      total += job.t1 - job.t0;
+   double done = 0;
+
+   ProgressDialog progress( XO("Export Multiple"),
+      XO("Exporting %lld files, %lld at a time")
+         .Format( (long long) jobs.size(), (long long) maxRunning ) );
+
+   auto ok = ProgressResult::Success;
+   bool stopping = false; // Start no more files
+   size_t next = 0;
+
+   auto start = [&]( const ConcurrentJob &job ) {
+      running.emplace_back();
+      auto &file = running.back();
+      file.pJob = &job;
+      file.pPlugin = mExporter.MakePlugin(mPluginIndex);
+      file.pStatus = std::make_unique<ExportJobStatus>();
+      file.pStatus->mTracks = job.tracks;
+      file.fullPath = PrepareExportFile(job.name, file.backup).GetFullPath();
+
+      auto pPlugin = file.pPlugin.get();
+      auto pStatus = file.pStatus.get();
+      auto project = mProject;
+      auto subFormat = mSubFormatIndex;
+      auto fullPath = file.fullPath;
+      file.result = pool.Submit( [=, &job]{
+         ExportJobScope scope{ *pStatus };
+         // Stays null; the plug-in reports to the status instead
+         std::unique_ptr<ProgressDialog> pDialog;
+         return pPlugin->Export(project, pDialog, job.channels, fullPath,
+            false, job.t0, job.t1, nullptr, job.pTags, subFormat);
+      } );
+   };
+
+   while (true) {
+      while (!stopping && next < jobs.size() && running.size() < maxRunning)
+         start(jobs[next++]);
+
+      if (running.empty()) {
+         if (ok == ProgressResult::Stopped && next < jobs.size()) {
+            AudacityMessageDialog dlgMessage(
+               nullptr,
+               XO("Continue to export remaining files?"),
+               XO("Export"),
+               wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
+            if (dlgMessage.ShowModal() == wxID_YES) {
+               ok = ProgressResult::Success;
+               stopping = false;
+               progress.Reinit();
+               continue;
+            }
+         }
+         break;
+      }
+
+      // Wait a little for the oldest file, then collect all that are done
+      running.front().result.wait_for(std::chrono::milliseconds(50));
+      for (auto iter = running.begin(); iter != running.end();) {
+         auto &file = *iter;
+         if (file.result.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready) {
+            ++iter;
+            continue;
+         }
+
+         // Exceptions from the worker, as for failure to read the project,
+         // are reported here, later, in the main thread
+         auto result = GuardedCall<ProgressResult>(
+            [&]{ return file.result.get(); },
+            MakeSimpleGuard(ProgressResult::Failed) );
+         FinishExportFile(result, file.backup, file.fullPath);
+
+         if (!file.pStatus->mError.empty())
+            AudacityMessageBox( file.pStatus->mError );
+
+         if (result == ProgressResult::Failed ||
+             result == ProgressResult::Cancelled) {
+            // As when exporting one at a time, start no more files, but let
+            // the others finish
+            if (ok != ProgressResult::Cancelled)
+               ok = result;
+            stopping = true;
+         }
+
+         done += file.pJob->t1 - file.pJob->t0;
+         iter = running.erase(iter);
+      }
+
+      double current = done;
+      for (const auto &file : running)
+         current += file.pStatus->mFraction.load() *
+            (file.pJob->t1 - file.pJob->t0);
+
+      auto updateResult = progress.Update(current, total);
+      if (updateResult == ProgressResult::Cancelled) {
+         for (auto &file : running)
+            file.pStatus->mCancel.store(true);
+         ok = ProgressResult::Cancelled;
+         stopping = true;
+      }
+      else if (updateResult == ProgressResult::Stopped && !stopping) {
+         // Keep what the running files have so far, then ask whether to
+         // export the rest
+         for (auto &file : running)
+            file.pStatus->mStop.store(true);
+         if (ok == ProgressResult::Success)
+            ok = ProgressResult::Stopped;
+         stopping = true;
+      }
    }
 
    Refresh();
    Update();
 
-   return success;
+   return ok;
 }
 
 wxString ExportMultipleDialog::MakeFileName(const wxString &input)
@@ -79,6 +79,34 @@ private:
                  double t0,
                  double t1,
                  const Tags &tags);
+
+   //! One file of an export multiple set, for DoConcurrentExports
+   struct ConcurrentJob
+   {
+      wxFileName name;
+      unsigned channels;
+      double t0;
+      double t1;
+      const Tags *pTags;
+      WaveTrackConstArray tracks; /**< The tracks to mix into the file */
+   };
+
+   //! Whether DoConcurrentExports may be used for the selected format
+   bool CanExportConcurrently(size_t numFiles);
+
+   /** Export the files of an export multiple set several at a time, on
+    * worker threads, showing the combined progress in one dialog.  The
+    * number at a time is the preference /Export/ConcurrentFiles. */
+   ProgressResult DoConcurrentExports(const std::vector<ConcurrentJob> &jobs);
+
+   /** Find the name to export to, and if overwriting, move any existing
+    * file to a backup */
+   wxFileName PrepareExportFile(const wxFileName &inName, wxFileName &backup);
+
+   /** Remove the backup, or restore it if the export failed, and record
+    * the exported file */
+   void FinishExportFile(ProgressResult result,
+                 const wxFileName &backup, const wxString &fullPath);
    /** \brief Takes an arbitrary text string and converts it to a form that can
     * be used as a file name, if necessary prompting the user to edit the file
     * name produced */
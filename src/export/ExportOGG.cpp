@@ -143,6 +143,8 @@ public:
                MixerSpec *mixerSpec = NULL,
                const Tags *metadata = NULL,
                int subformat = 0) override;
+   // optional
+   bool CanExportConcurrently(int subformat) override;
 
 private:
 
@@ -182,7 +184,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    FileIO outFile(fName, FileIO::Output);
 
    if (!outFile.IsOpened()) {
-      AudacityMessageBox( XO("Unable to open target file for writing") );
+      ShowError( XO("Unable to open target file for writing") );
       return ProgressResult::Cancelled;
    }
 
@@ -209,7 +211,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    vorbis_info_init(&info);
    if (vorbis_encode_init_vbr(&info, numChannels, (int)(rate + 0.5), quality)) {
       // TODO: more precise message
-      AudacityMessageBox( XO("Unable to export - rate or quality problem") );
+      ShowError( XO("Unable to export - rate or quality problem") );
       return ProgressResult::Cancelled;
    }
 
@@ -223,14 +225,14 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
 
    // Retrieve tags
    if (!FillComment(project, &comment, metadata)) {
-      AudacityMessageBox( XO("Unable to export - problem with metadata") );
+      ShowError( XO("Unable to export - problem with metadata") );
       return ProgressResult::Cancelled;
    }
 
    // Set up analysis state and auxiliary encoding storage
    if (vorbis_analysis_init(&dsp, &info) ||
        vorbis_block_init(&dsp, &block)) {
-      AudacityMessageBox( XO("Unable to export - problem initialising") );
+      ShowError( XO("Unable to export - problem initialising") );
       return ProgressResult::Cancelled;
    }
 
@@ -239,7 +241,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    // chained streams with concatenation.
    srand(time(NULL));
    if (ogg_stream_init(&stream, rand())) {
-      AudacityMessageBox( XO("Unable to export - problem creating stream") );
+      ShowError( XO("Unable to export - problem creating stream") );
       return ProgressResult::Cancelled;
    }
 
@@ -261,7 +263,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
       ogg_stream_packetin(&stream, &bitstream_header) ||
       ogg_stream_packetin(&stream, &comment_header) ||
       ogg_stream_packetin(&stream, &codebook_header)) {
-      AudacityMessageBox( XO("Unable to export - problem with packets") );
+      ShowError( XO("Unable to export - problem with packets") );
       return ProgressResult::Cancelled;
    }
 
@@ -270,7 +272,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    while (ogg_stream_flush(&stream, &page)) {
       if ( outFile.Write(page.header, page.header_len).GetLastError() ||
            outFile.Write(page.body, page.body_len).GetLastError()) {
-         AudacityMessageBox( XO("Unable to export - problem with file") );
+         ShowError( XO("Unable to export - problem with file") );
          return ProgressResult::Cancelled;
       }
    }
@@ -281,11 +283,10 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
          numChannels, SAMPLES_PER_RUN, false,
          rate, floatSample, true, mixerSpec);
 
-      InitProgress( pDialog, fName,
+      auto progress = InitProgress( pDialog, fName,
          selectionOnly
             ? XO("Exporting the selected audio as Ogg Vorbis")
             : XO("Exporting the audio as Ogg Vorbis") );
-      auto &progress = *pDialog;
 
       while (updateResult == ProgressResult::Success && !eos) {
          float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
@@ -338,7 +339,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
                   if ( outFile.Write(page.header, page.header_len).GetLastError() ||
                        outFile.Write(page.body, page.body_len).GetLastError()) {
                      // TODO: more precise message
-                     AudacityMessageBox( XO("Unable to export") );
+                     ShowError( XO("Unable to export") );
                      return ProgressResult::Cancelled;
                   }
 
@@ -352,7 +353,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
          if (err) {
             updateResult = ProgressResult::Cancelled;
             // TODO: more precise message
-            AudacityMessageBox( XO("Unable to export") );
+            ShowError( XO("Unable to export") );
             break;
          }
 
@@ -363,12 +364,17 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    if ( !outFile.Close() ) {
       updateResult = ProgressResult::Cancelled;
       // TODO: more precise message
-      AudacityMessageBox( XO("Unable to export") );
+      ShowError( XO("Unable to export") );
    }
 
    return updateResult;
 }
 
+bool ExportOGG::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return true;
+}
+
 void ExportOGG::OptionsCreate(ShuttleGui &S, int format)
 {
    S.AddWindow( safenew ExportOGGOptions{ S.GetParent(), format } );
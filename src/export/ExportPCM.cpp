@@ -396,6 +396,7 @@ public:
                          const Tags *metadata = NULL,
                          int subformat = 0) override;
    // optional
+   bool CanExportConcurrently(int subformat) override;
    wxString GetFormat(int index) override;
    FileExtension GetExtension(int index) override;
    unsigned GetMaxChannels(int index) override;
@@ -441,6 +442,12 @@ void ExportPCM::ReportTooBigError(wxWindow * pParent)
       XO("You have attempted to Export a WAV or AIFF file which would be greater than 4GB.\n"
       "Audacity cannot do this, the Export was abandoned.");
 
+   if (const auto pJob = ExportJobScope::Current()) {
+      if (pJob->mError.empty())
+         pJob->mError = message;
+      return;
+   }
+
    ShowErrorDialog(pParent, XO("Error Exporting"), message,
                   wxT("Size_limits_for_WAV_and_AIFF_files"));
 
@@ -535,12 +542,12 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       // Bug 46.  Trap here, as sndfile.c does not trap it properly.
       if( (numChannels != 1) && ((sf_format & SF_FORMAT_SUBMASK) == SF_FORMAT_GSM610) )
       {
-         AudacityMessageBox( XO("GSM 6.10 requires mono") );
+         ShowError( XO("GSM 6.10 requires mono") );
          return ProgressResult::Cancelled;
       }
 
       if (sf_format == SF_FORMAT_WAVEX + SF_FORMAT_GSM610) {
-         AudacityMessageBox(
+         ShowError(
             XO("WAVEX and GSM 6.10 formats are not compatible") );
          return ProgressResult::Cancelled;
       }
@@ -554,7 +561,7 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       if (!sf_format_check(&info))
          info.format = (info.format & SF_FORMAT_TYPEMASK);
       if (!sf_format_check(&info)) {
-         AudacityMessageBox( XO("Cannot export audio in this format.") );
+         ShowError( XO("Cannot export audio in this format.") );
          return ProgressResult::Cancelled;
       }
       const auto path = fName.GetFullPath();
@@ -568,7 +575,7 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       }
 
       if (!sf) {
-         AudacityMessageBox( XO("Cannot export audio to %s").Format( path ) );
+         ShowError( XO("Cannot export audio to %s").Format( path ) );
          return ProgressResult::Cancelled;
       }
       // Retrieve tags if not given a set
@@ -615,12 +622,11 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
                                   info.channels, maxBlockLen, true,
                                   rate, format, true, mixerSpec);
 
-         InitProgress( pDialog, fName,
+         auto progress = InitProgress( pDialog, fName,
             (selectionOnly
                ? XO("Exporting the selected audio as %s")
                : XO("Exporting the audio as %s"))
                .Format( formatStr ) );
-         auto &progress = *pDialog;
 
          while (updateResult == ProgressResult::Success) {
             sf_count_t samplesWritten;
@@ -639,7 +645,7 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
             if (static_cast<size_t>(samplesWritten) != numSamples) {
                char buffer2[1000];
                sf_error_str(sf.get(), buffer2, 1000);
-               AudacityMessageBox(
+               ShowError(
                   XO(
                   /* i18n-hint: %s will be the error message from libsndfile, which
                    * is usually something unhelpful (and untranslated) like "system
@@ -661,13 +667,13 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
              fileFormat == SF_FORMAT_WAVEX) {
             if (!AddStrings(project, sf.get(), metadata, sf_format)) {
                // TODO: more precise message
-               AudacityMessageBox( XO("Unable to export") );
+               ShowError( XO("Unable to export") );
                return ProgressResult::Cancelled;
             }
          }
          if (0 != sf.close()) {
             // TODO: more precise message
-            AudacityMessageBox( XO("Unable to export") );
+            ShowError( XO("Unable to export") );
             return ProgressResult::Cancelled;
          }
       }
@@ -680,7 +686,7 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
          // Note: file has closed, and gets reopened and closed again here:
          if (!AddID3Chunk(fName, metadata, sf_format) ) {
             // TODO: more precise message
-            AudacityMessageBox( XO("Unable to export") );
+            ShowError( XO("Unable to export") );
             return ProgressResult::Cancelled;
          }
 
@@ -1009,6 +1015,11 @@ void ExportPCM::OptionsCreate(ShuttleGui &S, int format)
    }
 }
 
+bool ExportPCM::CanExportConcurrently(int WXUNUSED(subformat))
+{
+   return true;
+}
+
 wxString ExportPCM::GetFormat(int index)
 {
    if (index != FMT_OTHER)
@@ -29,8 +29,8 @@ for classification of the sample format and the used endianness.
 
 #include "sndfile.h"
 
-FormatClassifier::FormatClassifier(const char* filename) :
-   mReader(filename),
+FormatClassifier::FormatClassifier(const uint8_t* data, size_t size) :
+   mReader(data, size),
    mMeter(cSiglen)
 {
    // Define the classification classes
@@ -54,9 +54,7 @@ FormatClassifier::FormatClassifier(const char* filename) :
    
 #ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
    // Build a debug writer
-   char dfile [1024];
-   sprintf(dfile, "%s.sig", filename);
-   mpWriter = std::make_unique<DebugWriter>(dfile);
+   mpWriter = std::make_unique<DebugWriter>("FormatClassifier.sig");
 #endif
 
    // Run it
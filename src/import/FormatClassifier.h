@@ -92,7 +92,8 @@ private:
    unsigned             mResultChannels { 0 };
 
 public:
-   FormatClassifier(const char* filename);
+   //! Classify the data, which may be the start of a file or all of it
+   FormatClassifier(const uint8_t* data, size_t size);
    ~FormatClassifier();
 
    FormatClassT GetResultFormat();
@@ -64,6 +64,8 @@ static Importer::RegisteredUnusableImportPlugin registered{
 
 #else /* USE_LIBFLAC */
 
+#include <algorithm>
+
 #include <wx/string.h>
 #include <wx/utils.h>
 #include <wx/file.h>
@@ -75,6 +77,7 @@ static Importer::RegisteredUnusableImportPlugin registered{
 #include "../Prefs.h"
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
+#include "SegmentDecoder.h"
 
 #ifdef USE_LIBID3TAG
 extern "C" {
@@ -121,6 +124,37 @@ class MyFLACFile final : public FLAC::Decoder::File
 };
 
 
+#ifndef LEGACY_FLAC
+// Decodes a range of samples for FLACImportFileHandle::ImportSegments.
+// FLAC frames are independent, so it can seek straight to the start.
+class FLACSegmentFile final : public FLAC::Decoder::File
+{
+ public:
+   FLACSegmentFile(DecodedSegment &segment,
+                   FLAC__uint64 start, FLAC__uint64 end)
+   : mSegment(segment), mStart(start), mEnd(end), mPosition(start)
+   {
+      set_metadata_ignore_all();
+   }
+
+   bool Decode(const FilePath &filename);
+
+ protected:
+   FLAC__StreamDecoderWriteStatus write_callback(const FLAC__Frame *frame,
+                                                 const FLAC__int32 * const buffer[]) override;
+   void error_callback(FLAC__StreamDecoderErrorStatus) override
+   {
+      // Ignored, as for the whole file
+   }
+
+ private:
+   DecodedSegment &mSegment;
+   const FLAC__uint64 mStart;
+   const FLAC__uint64 mEnd;
+   FLAC__uint64 mPosition;
+};
+#endif
+
 class FLACImportPlugin final : public ImportPlugin
 {
  public:
@@ -164,6 +198,10 @@ public:
    {}
 
 private:
+#ifndef LEGACY_FLAC
+   void ImportSegments(size_t nSegments);
+#endif
+
    sampleFormat          mFormat;
    std::unique_ptr<MyFLACFile> mFile;
    wxFFile               mHandle;
@@ -281,6 +319,77 @@ FLAC__StreamDecoderWriteStatus MyFLACFile::write_callback(const FLAC__Frame *fra
    }, MakeSimpleGuard(FLAC__STREAM_DECODER_WRITE_STATUS_ABORT) );
 }
 
+#ifndef LEGACY_FLAC
+bool FLACSegmentFile::Decode(const FilePath &filename)
+{
+   wxFFile handle;
+   if (!handle.Open(filename, wxT("rb"))) {
+      return false;
+   }
+
+   // As in FLACImportFileHandle::Init, libflac takes the file handle
+   bool result = init(handle.fp()) == FLAC__STREAM_DECODER_INIT_STATUS_OK;
+   handle.Detach();
+   if (!result) {
+      return false;
+   }
+
+   // Seeking decodes the frame with the start in it
+   if (!process_until_end_of_metadata() || !seek_absolute(mStart)) {
+      return false;
+   }
+
+   while (mPosition < mEnd &&
+          get_state() < FLAC__STREAM_DECODER_END_OF_STREAM) {
+      if (!process_single()) {
+         break;
+      }
+   }
+
+   return true;
+}
+
+FLAC__StreamDecoderWriteStatus FLACSegmentFile::write_callback(const FLAC__Frame *frame,
+                                                               const FLAC__int32 * const buffer[])
+{
+   // Don't let C++ exceptions propagate through libflac
+   return GuardedCall< FLAC__StreamDecoderWriteStatus > ( [&] {
+      // After a seek, libflac passes only the part of the frame from the
+      // target on, numbered accordingly
+      const auto first = frame->header.number.sample_number;
+      const auto count = frame->header.blocksize;
+      if (first >= mEnd) {
+         return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+      }
+      if (first + count <= mStart) {
+         return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+      }
+
+      const auto from = static_cast<size_t>(mStart > first ? mStart - first : 0);
+      const auto to = static_cast<size_t>(std::min<FLAC__uint64>(count, mEnd - first));
+      const auto channels = mSegment.channels;
+      auto dest = mSegment.Extend(to - from);
+
+      // Convert as MyFLACFile::write_callback does, interleaving the channels
+      if (mSegment.format == int16Sample) {
+         auto samples = reinterpret_cast<short *>(dest);
+         for (size_t s = from; s < to; s++)
+            for (unsigned int chn = 0; chn < channels; ++chn)
+               *samples++ = buffer[chn][s];
+      }
+      else {
+         auto samples = reinterpret_cast<FLAC__int32 *>(dest);
+         for (size_t s = from; s < to; s++)
+            for (unsigned int chn = 0; chn < channels; ++chn)
+               *samples++ = buffer[chn][s];
+      }
+
+      mPosition = first + to;
+      return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+   }, MakeSimpleGuard(FLAC__STREAM_DECODER_WRITE_STATUS_ABORT) );
+}
+#endif
+
 TranslatableString FLACImportPlugin::GetPluginFormatDescription()
 {
     return DESC;
@@ -426,6 +535,14 @@ ProgressResult FLACImportFileHandle::Import(WaveTrackFactory *trackFactory,
          *iter = trackFactory->NewWaveTrack(mFormat, mSampleRate);
    }
 
+#ifndef LEGACY_FLAC
+   // Long files decode faster in segments, if there are threads for them
+   const auto nSegments = CountDecodeSegments(mNumSamples, mSampleRate);
+   if (nSegments > 0)
+      ImportSegments(nSegments);
+   else
+#endif
+   {
    // TODO: Vigilant Sentry: Variable res unused after assignment (error code DA1)
    //    Should check the result.
    #ifdef LEGACY_FLAC
@@ -434,6 +551,7 @@ ProgressResult FLACImportFileHandle::Import(WaveTrackFactory *trackFactory,
       bool res = (mFile->process_until_end_of_stream() != 0);
    #endif
       wxUnusedVar(res);
+   }
 
    if (mUpdateResult == ProgressResult::Failed || mUpdateResult == ProgressResult::Cancelled) {
       return mUpdateResult;
@@ -463,6 +581,38 @@ ProgressResult FLACImportFileHandle::Import(WaveTrackFactory *trackFactory,
 }
 
 
+#ifndef LEGACY_FLAC
+void FLACImportFileHandle::ImportSegments(size_t nSegments)
+{
+   // The same choice of format as MyFLACFile::write_callback makes
+   const auto format = (mBitsPerSample == 16) ? int16Sample : int24Sample;
+
+   DecodeSegments(nSegments,
+      [&](size_t segment) {
+         DecodedSegment result;
+         result.format = format;
+         result.channels = mNumChannels;
+         FLACSegmentFile file{ result,
+            mNumSamples * segment / nSegments,
+            mNumSamples * (segment + 1) / nSegments };
+         if (!file.Decode(mFilename))
+            result.error = true;
+         return result;
+      },
+      [&](DecodedSegment &segment) {
+         if (segment.error) {
+            mUpdateResult = ProgressResult::Failed;
+            return false;
+         }
+         segment.AppendTo(mChannels);
+         mSamplesDone += segment.length;
+
+         mUpdateResult = mProgress->Update((wxULongLong_t) mSamplesDone, (wxULongLong_t)mNumSamples);
+         return mUpdateResult == ProgressResult::Success;
+      });
+}
+#endif
+
 FLACImportFileHandle::~FLACImportFileHandle()
 {
    mFile->finish();
@@ -19,6 +19,12 @@
   Much of this source code is based on 'minimad.c' as distributed
   with libmad.
 
+  Long files are decoded in segments on several threads.  A scan of the
+  frame headers finds where the segments begin, and each segment's
+  decoder starts a few frames early, discarding their output, to fill
+  the bit reservoir and the synthesis filters as a decoding of the whole
+  file would have.
+
 *//****************************************************************//**
 
 \class MP3ImportPlugin
@@ -58,12 +64,17 @@ static Importer::RegisteredUnusableImportPlugin registered
 #include <stdlib.h>
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include <wx/file.h>
 #include <wx/string.h>
 
 #include "../Prefs.h"
 #include "../Tags.h"
+#include "../ThreadPool.h"
 #include "../WaveTrack.h"
+#include "SegmentDecoder.h"
 #include "../prefs/QualityPrefs.h"
 #include "../widgets/AudacityMessageBox.h"
 #include "../widgets/ProgressDialog.h"
@@ -89,6 +100,13 @@ extern "C"
 // (This is an "observed" value.)
 #define MAD_DELAY 529
 
+// How far before its first frame the decoding of a segment starts.  A
+// layer III frame may take up to 511 bytes of its data from earlier frames,
+// and its output overlaps that of the frame before; with this much, the
+// two frames before the segment decode exactly.
+#define PRIMING_FRAMES 4
+#define PRIMING_BYTES 4096
+
 class MP3ImportPlugin final : public ImportPlugin
 {
 public:
@@ -126,6 +144,22 @@ private:
    bool FillBuffer();
    void LoadID3(Tags *tags);
 
+   // Decoding in segments
+
+   // Find the file offsets of all frames, and facts from the first header
+   bool ScanFrames(std::vector<wxFileOffset> &offsets, unsigned &channels,
+                   unsigned &sampleRate, unsigned &samplesPerFrame);
+   ProgressResult ImportSegments(const std::vector<wxFileOffset> &offsets,
+                                 unsigned channels, unsigned sampleRate,
+                                 size_t nSegments);
+   // Decode frames [first, end); called on worker threads
+   DecodedSegment DecodeSegment(const std::vector<wxFileOffset> &offsets,
+                                unsigned channels, size_t first, size_t end);
+
+   // Detect the Xing or LAME tags in the first frame
+   mad_flow CheckInfoFrame(struct mad_stream const *stream,
+                           struct mad_frame *frame);
+
    // The MAD callbacks
 
    static mad_flow input_cb(void *that,
@@ -268,19 +302,42 @@ ProgressResult MP3ImportFileHandle::Import(WaveTrackFactory *trackFactory,
    mDelay = MAD_DELAY;
    mPadding = 0;
 
-   // Initialize decoder
-   mad_decoder_init(&mDecoder, this, input_cb, 0, filter_cb, output_cb, error_cb, 0);
+   // Long files decode faster in segments, if there are threads for them
+   std::vector<wxFileOffset> offsets;
+   unsigned channels = 0, sampleRate = 0, samplesPerFrame = 0;
+   size_t nSegments = 0;
+   if (ThreadPool::Get().Size() > 1 &&
+       ScanFrames(offsets, channels, sampleRate, samplesPerFrame))
+   {
+      nSegments = CountDecodeSegments(
+         (unsigned long long) offsets.size() * samplesPerFrame, sampleRate);
+   }
 
-   // Send the decoder on its way!
-   auto res = mad_decoder_run(&mDecoder, MAD_DECODER_MODE_SYNC);
+   if (nSegments > 0)
+   {
+      mUpdateResult =
+         ImportSegments(offsets, channels, sampleRate, nSegments);
+      if (mUpdateResult == ProgressResult::Failed)
+      {
+         return mUpdateResult;
+      }
+   }
+   else
+   {
+      // Initialize decoder
+      mad_decoder_init(&mDecoder, this, input_cb, 0, filter_cb, output_cb, error_cb, 0);
 
-   // Terminate decoder
-   mad_decoder_finish(&mDecoder);
+      // Send the decoder on its way!
+      auto res = mad_decoder_run(&mDecoder, MAD_DECODER_MODE_SYNC);
 
-   // Decoding failed, so pass it on
-   if (res != 0)
-   {
-      return ProgressResult::Failed;
+      // Terminate decoder
+      mad_decoder_finish(&mDecoder);
+
+      // Decoding failed, so pass it on
+      if (res != 0)
+      {
+         return ProgressResult::Failed;
+      }
    }
 
    // The user canceled the decoding, so bail without saving tracks or tags
@@ -920,6 +977,12 @@ mad_flow MP3ImportFileHandle::FilterCB(struct mad_stream const *stream,
    // We only want to jinspect the first frame, so disable future calls
    mDecoder.filter_func = nullptr;
 
+   return CheckInfoFrame(stream, frame);
+}
+
+mad_flow MP3ImportFileHandle::CheckInfoFrame(struct mad_stream const *stream,
+                                             struct mad_frame *frame)
+{
    // Is it a VBRI info frame?
    if (memcmp(&stream->this_frame[4 + 32], "VBRI", 4) == 0)
    {
@@ -1102,4 +1165,272 @@ enum mad_flow MP3ImportFileHandle::ErrorCB(struct mad_stream *stream,
    return MAD_FLOW_BREAK;
 }
 
+bool MP3ImportFileHandle::ScanFrames(std::vector<wxFileOffset> &offsets,
+                                     unsigned &channels,
+                                     unsigned &sampleRate,
+                                     unsigned &samplesPerFrame)
+{
+   // Use another file, leaving mFile where Import expects it
+   wxFile file;
+   if (!file.Open(mFilename) ||
+       file.Seek(mFilePos, wxFromStart) == wxInvalidOffset || file.Error())
+   {
+      return false;
+   }
+
+   std::vector<unsigned char> buffer(INPUT_BUFFER_SIZE + MAD_BUFFER_GUARD);
+   wxFileOffset bufferPos = mFilePos; // file offset of the buffer's start
+   size_t bufferLen = 0;
+   bool atEnd = false;
+   bool needInput = true;
+
+   mad_stream stream;
+   mad_stream_init(&stream);
+   mad_header header;
+   mad_header_init(&header);
+   auto cleanup = finally([&]{
+      mad_header_finish(&header);
+      mad_stream_finish(&stream);
+   });
+
+   while (true)
+   {
+      if (needInput)
+      {
+         if (atEnd)
+         {
+            break;
+         }
+
+         // Keep what libmad has not consumed, as InputCB does
+         size_t keep = 0;
+         if (stream.next_frame)
+         {
+            keep = buffer.data() + bufferLen - stream.next_frame;
+            memmove(buffer.data(), stream.next_frame, keep);
+         }
+         bufferPos += bufferLen - keep;
+
+         auto want = (size_t) wxMin((wxFileOffset) (INPUT_BUFFER_SIZE - keep),
+                                    mFileLen - (bufferPos + (wxFileOffset) keep));
+         if (want == 0 && bufferPos + (wxFileOffset) keep < mFileLen)
+         {
+            // A frame bigger than the buffer can't be
+            return false;
+         }
+         if (file.Read(buffer.data() + keep, want) != (ssize_t) want || file.Error())
+         {
+            return false;
+         }
+         bufferLen = keep + want;
+
+         // Add the guard at the end, as FillBuffer does
+         if (bufferPos + (wxFileOffset) bufferLen == mFileLen)
+         {
+            memset(buffer.data() + bufferLen, 0, MAD_BUFFER_GUARD);
+            bufferLen += MAD_BUFFER_GUARD;
+            atEnd = true;
+         }
+
+         mad_stream_buffer(&stream, buffer.data(), bufferLen);
+         needInput = false;
+      }
+
+      if (mad_header_decode(&header, &stream) == -1)
+      {
+         if (stream.error == MAD_ERROR_BUFLEN)
+         {
+            needInput = true;
+         }
+         else if (!MAD_RECOVERABLE(stream.error))
+         {
+            return false;
+         }
+         continue;
+      }
+
+      if (offsets.empty())
+      {
+         channels = MAD_NCHANNELS(&header);
+         sampleRate = header.samplerate;
+         samplesPerFrame = 32 * MAD_NSBSAMPLES(&header);
+      }
+      offsets.push_back(bufferPos + (stream.this_frame - buffer.data()));
+   }
+
+   return !offsets.empty();
+}
+
+ProgressResult MP3ImportFileHandle::ImportSegments(
+   const std::vector<wxFileOffset> &offsets,
+   unsigned channels, unsigned sampleRate, size_t nSegments)
+{
+   const auto nFrames = offsets.size();
+   const auto segmentStart = [&](size_t segment)
+   {
+      return nFrames * segment / nSegments;
+   };
+
+   auto result = ProgressResult::Success;
+   size_t consumed = 0;
+   DecodeSegments(nSegments,
+      [&](size_t segment)
+      {
+         return DecodeSegment(offsets, channels,
+            segmentStart(segment), segmentStart(segment + 1));
+      },
+      [&](DecodedSegment &segment)
+      {
+         if (segment.error)
+         {
+            AudacityMessageBox(XO("Import failed\n\nThis is likely caused by a malformed MP3.\n\n"));
+            result = ProgressResult::Failed;
+            return false;
+         }
+
+         if (mChannels.empty())
+         {
+            mNumChannels = channels;
+            mChannels.resize(mNumChannels);
+
+            auto format = QualityPrefs::SampleFormatChoice();
+
+            for (auto &channel: mChannels)
+            {
+               channel = mTrackFactory->NewWaveTrack(format, sampleRate);
+            }
+         }
+
+         segment.AppendTo(mChannels);
+
+         const auto end = segmentStart(++consumed);
+         const auto pos = end < nFrames ? offsets[end] : mFileLen;
+         result = mProgress->Update((wxLongLong_t) pos, (wxLongLong_t) mFileLen);
+         return result == ProgressResult::Success;
+      });
+
+   return result;
+}
+
+DecodedSegment MP3ImportFileHandle::DecodeSegment(
+   const std::vector<wxFileOffset> &offsets,
+   unsigned channels, size_t first, size_t end)
+{
+   DecodedSegment result;
+   result.format = floatSample;
+   result.channels = channels;
+
+   // The first segment starts where decoding of the whole file would.
+   // Others start early, but not at the first frame, which may be an
+   // information frame that is not decoded.
+   auto begin = first;
+   if (first > 0)
+   {
+      while (begin > 1 &&
+             (first - begin < PRIMING_FRAMES ||
+              offsets[first] - offsets[begin] < PRIMING_BYTES))
+      {
+         --begin;
+      }
+   }
+
+   const bool isLast = (end == offsets.size());
+   const wxFileOffset start = offsets[begin];
+   const wxFileOffset stop = isLast ? mFileLen : offsets[end];
+
+   // libmad needs MAD_BUFFER_GUARD bytes after the last frame: the start
+   // of the next frame, or zeros at the end of the file
+   const wxFileOffset readEnd = wxMin(stop + MAD_BUFFER_GUARD, mFileLen);
+   const auto readLen = (size_t) (readEnd - start);
+   std::vector<unsigned char> data(readLen + MAD_BUFFER_GUARD, 0);
+
+   wxFile file;
+   if (!file.Open(mFilename) ||
+       file.Seek(start, wxFromStart) == wxInvalidOffset ||
+       file.Read(data.data(), readLen) != (ssize_t) readLen || file.Error())
+   {
+      result.error = true;
+      return result;
+   }
+
+   mad_stream stream;
+   mad_frame frame;
+   mad_synth synth;
+   mad_stream_init(&stream);
+   mad_frame_init(&frame);
+   mad_synth_init(&synth);
+   auto cleanup = finally([&]{
+      mad_synth_finish(&synth);
+      mad_frame_finish(&frame);
+      mad_stream_finish(&stream);
+   });
+
+   mad_stream_buffer(&stream, data.data(), data.size());
+
+   bool checkInfo = (first == 0);
+   while (true)
+   {
+      const bool decoded = (mad_frame_decode(&frame, &stream) == 0);
+      if (!decoded && stream.error == MAD_ERROR_BUFLEN)
+      {
+         break;
+      }
+
+      const auto pos = start + (stream.this_frame - data.data());
+      if (pos >= stop)
+      {
+         break;
+      }
+      const bool priming = (pos < offsets[first]);
+
+      if (!decoded)
+      {
+         // Frames before the segment lack their reservoir.  Otherwise
+         // tolerate what ErrorCB tolerates.
+         if (MAD_RECOVERABLE(stream.error) &&
+             (priming ||
+              (stream.error == MAD_ERROR_LOSTSYNC && isLast) ||
+              (stream.error == MAD_ERROR_BADDATAPTR && first == 0 &&
+               result.length == 0)))
+         {
+            continue;
+         }
+         result.error = true;
+         break;
+      }
+
+      // As FilterCB does for the first frame of the file
+      if (checkInfo)
+      {
+         checkInfo = false;
+         if (CheckInfoFrame(&stream, &frame) == MAD_FLOW_IGNORE)
+         {
+            continue;
+         }
+      }
+
+      // Synthesize even the priming frames, to fill the filters
+      mad_synth_frame(&synth, &frame);
+      if (priming)
+      {
+         continue;
+      }
+
+      // Convert libmad's fixed point representation to float, as OutputCB
+      // does, interleaving the channels
+      const auto &pcm = synth.pcm;
+      auto dest = reinterpret_cast<float *>(result.Extend(pcm.length));
+      for (unsigned sample = 0; sample < pcm.length; ++sample)
+      {
+         for (unsigned chn = 0; chn < channels; ++chn)
+         {
+            const auto source = std::min<unsigned>(chn, pcm.channels - 1);
+            *dest++ = ((float) pcm.samples[source][sample] / (1L << MAD_F_FRACBITS));
+         }
+      }
+   }
+
+   return result;
+}
+
 #endif
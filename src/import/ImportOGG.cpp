@@ -62,6 +62,9 @@ static Importer::RegisteredUnusableImportPlugin registered{
 
 #else /* USE_LIBVORBIS */
 
+#include <algorithm>
+#include <cstring>
+
 #include <wx/log.h>
 #include <wx/string.h>
 #include <wx/utils.h>
@@ -76,6 +79,7 @@ static Importer::RegisteredUnusableImportPlugin registered{
 
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
+#include "SegmentDecoder.h"
 
 using NewChannelGroup = std::vector< std::shared_ptr<WaveTrack> >;
 
@@ -152,6 +156,9 @@ public:
    }
 
 private:
+   // Decode a file of one stream in segments, each with its own decoder
+   ProgressResult ImportSegments(size_t nSegments, int endian);
+
    std::unique_ptr<wxFFile> mFile;
    std::unique_ptr<OggVorbis_File> mVorbisFile;
 
@@ -297,6 +304,20 @@ ProgressResult OggImportFileHandle::Import(
       // zeros inserted at the beginning
       ov_pcm_seek(mVorbisFile.get(), 0);
 
+      // A long file decodes faster in segments, if there are threads for
+      // them; vorbisfile seeks to the sample, so they join seamlessly.
+      // Chained files keep to one decoder, for the bitstream switches.
+      size_t nSegments = 0;
+      if (mVorbisFile->links == 1 && mStreamUsage[0] != 0 &&
+          ov_seekable(mVorbisFile.get())) {
+         const auto total = ov_pcm_total(mVorbisFile.get(), -1);
+         if (total > 0)
+            nSegments = CountDecodeSegments(total, mVorbisFile->vi[0].rate);
+      }
+
+      if (nSegments > 0)
+         updateResult = ImportSegments(nSegments, endian);
+      else
       do {
          /* get data from the decoder */
          bytesRead = ov_read(mVorbisFile.get(), (char *)mainBuffer.get(),
@@ -383,6 +404,90 @@ ProgressResult OggImportFileHandle::Import(
    return res;
 }
 
+ProgressResult OggImportFileHandle::ImportSegments(
+   size_t nSegments, int endian)
+{
+   const auto total =
+      static_cast<unsigned long long>(ov_pcm_total(mVorbisFile.get(), -1));
+   const int channels = mVorbisFile->vi[0].channels;
+   unsigned long long samplesDone = 0;
+   auto updateResult = ProgressResult::Success;
+
+   DecodeSegments(nSegments,
+      [&](size_t segment) {
+         DecodedSegment result;
+         result.format = int16Sample;
+         result.channels = channels;
+
+         // The decoders of the segments can't share the file position
+         wxFFile file(mFilename, wxT("rb"));
+         OggVorbis_File vorbisFile;
+         if (!file.IsOpened() ||
+             ov_open(file.fp(), &vorbisFile, NULL, 0) < 0) {
+            result.error = true;
+            return result;
+         }
+         auto cleanup = finally( [&] {
+            ov_clear(&vorbisFile);
+            file.Detach();
+         } );
+
+         const auto start = total * segment / nSegments;
+         const auto end = total * (segment + 1) / nSegments;
+         if (ov_pcm_seek(&vorbisFile, start) < 0) {
+            result.error = true;
+            return result;
+         }
+
+         ArrayOf<short> buffer{ CODEC_TRANSFER_SIZE };
+         int bitstream = 0;
+         auto position = start;
+         while (position < end) {
+            long bytesRead = ov_read(&vorbisFile, (char *)buffer.get(),
+               CODEC_TRANSFER_SIZE,
+               endian,
+               2,    // word length (2 for 16 bit samples)
+               1,    // signed
+               &bitstream);
+
+            if (bytesRead == OV_HOLE) {
+               // Best effort, as when decoding the whole file
+               continue;
+            }
+            else if (bytesRead < 0) {
+               wxLogError(wxT("Ogg Vorbis importer: ov_read() returned error %i"),
+                  bytesRead);
+               result.error = true;
+               break;
+            }
+            else if (bytesRead == 0)
+               break;
+
+            const auto samplesRead = std::min<unsigned long long>(
+               bytesRead / channels / sizeof(short), end - position);
+            memcpy(result.Extend(samplesRead), buffer.get(),
+               samplesRead * channels * sizeof(short));
+            position += samplesRead;
+         }
+
+         return result;
+      },
+      [&](DecodedSegment &segment) {
+         if (segment.error) {
+            updateResult = ProgressResult::Failed;
+            return false;
+         }
+         segment.AppendTo(mChannels.front());
+         samplesDone += segment.length;
+
+         updateResult = mProgress->Update(
+            (wxULongLong_t)samplesDone, (wxULongLong_t)total);
+         return updateResult == ProgressResult::Success;
+      });
+
+   return updateResult;
+}
+
 OggImportFileHandle::~OggImportFileHandle()
 {
    ov_clear(mVorbisFile.get());
@@ -47,12 +47,19 @@
 #endif
 
 #include "../FileFormats.h"
+#include "../OnDemandImport.h"
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
+#include "../ThreadPool.h"
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
 
 #ifdef USE_LIBID3TAG
    #include <id3tag.h>
@@ -88,7 +95,8 @@ public:
 class PCMImportFileHandle final : public ImportFileHandle
 {
 public:
-   PCMImportFileHandle(const FilePath &name, SFFile &&file, SF_INFO info);
+   PCMImportFileHandle(const FilePath &name, SFFile &&file, SF_INFO info,
+      AudacityProject *project);
    ~PCMImportFileHandle();
 
    TranslatableString GetFileDescription() override;
@@ -108,9 +116,15 @@ public:
    {}
 
 private:
+   // Fill tracks with blocks that read the file until they are copied in
+   // the background
+   void ImportOnDemand(OnDemandSampleBlockFactory &factory,
+      std::vector< std::shared_ptr<WaveTrack> > &channels);
+
    SFFile                mFile;
    const SF_INFO         mInfo;
    sampleFormat          mFormat;
+   AudacityProject      *mProject;
 };
 
 TranslatableString PCMImportPlugin::GetPluginFormatDescription()
@@ -119,7 +133,7 @@ TranslatableString PCMImportPlugin::GetPluginFormatDescription()
 }
 
 std::unique_ptr<ImportFileHandle> PCMImportPlugin::Open(
-   const FilePath &filename, AudacityProject*)
+   const FilePath &filename, AudacityProject *project)
 {
    SF_INFO info;
    wxFile f;   // will be closed when it goes out of scope
@@ -180,7 +194,8 @@ std::unique_ptr<ImportFileHandle> PCMImportPlugin::Open(
    }
 
    // Success, so now transfer the duty to close the file from "file".
-   return std::make_unique<PCMImportFileHandle>(filename, std::move(file), info);
+   return std::make_unique<PCMImportFileHandle>(
+      filename, std::move(file), info, project);
 }
 
 static Importer::RegisteredImportPlugin registered{ "PCM",
@@ -188,10 +203,12 @@ static Importer::RegisteredImportPlugin registered{ "PCM",
 };
 
 PCMImportFileHandle::PCMImportFileHandle(const FilePath &name,
-                                         SFFile &&file, SF_INFO info)
+                                         SFFile &&file, SF_INFO info,
+                                         AudacityProject *project)
 :  ImportFileHandle(name),
    mFile(std::move(file)),
-   mInfo(info)
+   mInfo(info),
+   mProject(project)
 {
    wxASSERT(info.channels >= 0);
 
@@ -290,6 +307,162 @@ using id3_tag_holder = std::unique_ptr<id3_tag, id3_tag_deleter>;
 
 using NewChannelGroup = std::vector< std::shared_ptr<WaveTrack> >;
 
+namespace {
+
+// Reads interleaved frames on a thread of its own, some buffers ahead of
+// the consumer, so that decoding and file reads overlap the appending of
+// samples to the tracks, which only the main thread may do because it
+// writes the project database.
+class PCMFrameReader
+{
+public:
+   // Each buffer must hold maxFrames interleaved frames
+   PCMFrameReader(SNDFILE *file, sampleFormat format,
+      size_t maxFrames, std::vector<SampleBuffer> &buffers)
+      : mFile{ file }
+      , mFormat{ format }
+      , mMaxFrames{ maxFrames }
+      , mBuffers{ buffers }
+      , mFrames( buffers.size() )
+   {
+      for (size_t ii = 0; ii < buffers.size(); ++ii)
+         mFree.push_back(ii);
+      mThread = std::thread{ [this]{ Run(); } };
+   }
+
+   PCMFrameReader(const PCMFrameReader&) = delete;
+   PCMFrameReader &operator= (const PCMFrameReader&) = delete;
+
+   ~PCMFrameReader()
+   {
+      {
+         std::lock_guard<std::mutex> guard{ mMutex };
+         mStop = true;
+      }
+      mCondition.notify_all();
+      mThread.join();
+   }
+
+   // Wait for the next buffer; the number of frames in it is zero at the
+   // end of the file
+   size_t Next(long &frames)
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mCondition.wait(lock, [this]{ return !mFull.empty(); });
+      const auto index = mFull.front();
+      mFull.pop_front();
+      frames = mFrames[index];
+      return index;
+   }
+
+   // Give a buffer back for reading more
+   void Recycle(size_t index)
+   {
+      {
+         std::lock_guard<std::mutex> guard{ mMutex };
+         mFree.push_back(index);
+      }
+      mCondition.notify_all();
+   }
+
+private:
+   void Run()
+   {
+      while (true) {
+         size_t index;
+         {
+            std::unique_lock<std::mutex> lock{ mMutex };
+            mCondition.wait(lock, [this]{ return mStop || !mFree.empty(); });
+            if (mStop)
+               return;
+            index = mFree.front();
+            mFree.pop_front();
+         }
+
+         long frames = mMaxFrames;
+         const auto ptr = mBuffers[index].ptr();
+         if (mFormat == int16Sample)
+            frames = SFCall<sf_count_t>(sf_readf_short, mFile, (short *)ptr, frames);
+         //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
+         else
+            frames = SFCall<sf_count_t>(sf_readf_float, mFile, (float *)ptr, frames);
+
+         if (frames < 0 || frames > (long)mMaxFrames)
+            frames = mMaxFrames;
+
+         {
+            std::lock_guard<std::mutex> guard{ mMutex };
+            mFrames[index] = frames;
+            mFull.push_back(index);
+         }
+         mCondition.notify_all();
+
+         if (frames == 0)
+            return;
+      }
+   }
+
+   SNDFILE *const mFile;
+   const sampleFormat mFormat;
+   const size_t mMaxFrames;
+   std::vector<SampleBuffer> &mBuffers;
+   std::vector<long> mFrames;
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque<size_t> mFree;
+   std::deque<size_t> mFull;
+   bool mStop{ false };
+
+   std::thread mThread;
+};
+
+// Copy channels [c0, c1) of the interleaved frames into consecutive runs of
+// stride samples each
+template< typename Sample >
+void Deinterleave(const Sample *src, Sample *dst, int channels,
+   int c0, int c1, long frames, size_t stride)
+{
+   for (int c = c0; c < c1; ++c) {
+      Sample *const out = dst + c * stride;
+      for (long j = 0; j < frames; ++j)
+         out[j] = src[channels * j + c];
+   }
+}
+
+// De-interleave on the thread pool when there are enough channels to be
+// worth it
+void DeinterleaveChannels(sampleFormat format, samplePtr src, samplePtr dst,
+   int channels, long frames, size_t stride)
+{
+   const auto run = [=](int c0, int c1){
+      if (format == int16Sample)
+         Deinterleave((const short *)src, (short *)dst,
+            channels, c0, c1, frames, stride);
+      else
+         Deinterleave((const float *)src, (float *)dst,
+            channels, c0, c1, frames, stride);
+   };
+
+   auto &pool = ThreadPool::Get();
+   const int nTasks = std::min<int>(pool.Size(), channels / 2);
+   if (nTasks < 2) {
+      run(0, channels);
+      return;
+   }
+
+   std::vector< std::future<void> > futures;
+   for (int task = 0; task < nTasks; ++task) {
+      const int c0 = channels * task / nTasks;
+      const int c1 = channels * (task + 1) / nTasks;
+      futures.push_back(pool.Submit([=]{ run(c0, c1); }));
+   }
+   for (auto &future : futures)
+      future.get();
+}
+
+}
+
 ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
                                 TrackHolders &outTracks,
                                 Tags *tags)
@@ -298,7 +471,18 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
 
    wxASSERT(mFile.get());
 
-   CreateProgress();
+   // In the "edit" mode, the tracks read the file until a background task
+   // has copied it into the project.  Files that can't be read cheaply in
+   // any order are copied now.  Tracks without a project database, as in a
+   // streaming conversion, have nothing to copy into.
+   std::shared_ptr<OnDemandSampleBlockFactory> pOnDemandFactory;
+   if (mProject && trackFactory->GetSampleBlockFactory() &&
+       FileFormatsCopyOrEditSetting.Read() == wxT("edit"))
+      pOnDemandFactory = OnDemandSampleBlockFactory::Open(
+         trackFactory->GetSampleBlockFactory(), mFilename);
+
+   if (!pOnDemandFactory)
+      CreateProgress();
 
    NewChannelGroup channels(mInfo.channels);
 
@@ -306,7 +490,11 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
       // iter not used outside this scope.
       auto iter = channels.begin();
       for (int c = 0; c < mInfo.channels; ++iter, ++c)
-         *iter = trackFactory->NewWaveTrack(mFormat, mInfo.samplerate);
+         if (pOnDemandFactory)
+            *iter = std::make_shared<WaveTrack>(
+               pOnDemandFactory, mFormat, mInfo.samplerate);
+         else
+            *iter = trackFactory->NewWaveTrack(mFormat, mInfo.samplerate);
    }
 
    auto fileTotalFrames =
@@ -314,7 +502,11 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
    auto maxBlockSize = channels.begin()->get()->GetMaxBlockSize();
    auto updateResult = ProgressResult::Cancelled;
 
-   {
+   if (pOnDemandFactory) {
+      ImportOnDemand(*pOnDemandFactory, channels);
+      updateResult = ProgressResult::Success;
+   }
+   else {
       // Otherwise, we're in the "copy" mode, where we read in the actual
       // samples from the file and store our own local copy of the
       // samples in the tracks.
@@ -330,48 +522,47 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
       if (maxBlock < 1)
          return ProgressResult::Failed;
 
-      SampleBuffer srcbuffer, buffer;
+      // Buffers for the reader thread, which fills one while the samples
+      // of another are appended; and a buffer for all channels of one read,
+      // not interleaved
+      const size_t nBuffers = 3;
+      std::vector<SampleBuffer> srcbuffers(nBuffers);
+      SampleBuffer buffer;
       wxASSERT(mInfo.channels >= 0);
-      while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr() ||
-             NULL == buffer.Allocate(maxBlock, mFormat).ptr())
+      while (NULL == srcbuffers[0].Allocate(maxBlock * mInfo.channels, mFormat).ptr() ||
+             NULL == buffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr())
       {
          maxBlock /= 2;
          if (maxBlock < 1)
             return ProgressResult::Failed;
       }
+      // Read less far ahead if memory is short
+      for (size_t ii = 1; ii < nBuffers; ++ii)
+         if (NULL == srcbuffers[ii].Allocate(maxBlock * mInfo.channels, mFormat).ptr()) {
+            srcbuffers.resize(ii);
+            break;
+         }
 
       decltype(fileTotalFrames) framescompleted = 0;
 
+      PCMFrameReader reader{ mFile.get(), mFormat, maxBlock, srcbuffers };
+
       long block;
       do {
-         block = maxBlock;
+         const auto index = reader.Next(block);
 
-         if (mFormat == int16Sample)
-            block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short *)srcbuffer.ptr(), block);
-         //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
-         else
-            block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float *)srcbuffer.ptr(), block);
-
-         if(block < 0 || block > (long)maxBlock) {
-            wxASSERT(false);
-            block = maxBlock;
+         if (block) {
+            DeinterleaveChannels(mFormat, srcbuffers[index].ptr(),
+               buffer.ptr(), mInfo.channels, block, maxBlock);
          }
+         reader.Recycle(index);
 
          if (block) {
             auto iter = channels.begin();
             for(int c=0; c<mInfo.channels; ++iter, ++c) {
-               if (mFormat==int16Sample) {
-                  for(int j=0; j<block; j++)
-                     ((short *)buffer.ptr())[j] =
-                        ((short *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
-               else {
-                  for(int j=0; j<block; j++)
-                     ((float *)buffer.ptr())[j] =
-                        ((float *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
-
-               iter->get()->Append(buffer.ptr(), (mFormat == int16Sample)?int16Sample:floatSample, block);
+               iter->get()->Append(
+                  buffer.ptr() + c * maxBlock * SAMPLE_SIZE(mFormat),
+                  (mFormat == int16Sample)?int16Sample:floatSample, block);
             }
             framescompleted += block;
          }
@@ -589,6 +780,27 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
    return updateResult;
 }
 
+void PCMImportFileHandle::ImportOnDemand(OnDemandSampleBlockFactory &factory,
+   NewChannelGroup &channels)
+{
+   // Make blocks for all channels of one range of frames after another,
+   // so that the copying proceeds from the start of the file
+   const auto maxBlockSize = channels[0]->GetMaxBlockSize();
+   const sampleCount fileTotalFrames = mInfo.frames;
+   std::vector<SampleBlockPtr> blocks;
+   for (sampleCount start = 0; start < fileTotalFrames; start += maxBlockSize) {
+      const auto len =
+         limitSampleBufferSize(maxBlockSize, fileTotalFrames - start);
+      for (int c = 0; c < mInfo.channels; ++c) {
+         auto pBlock = factory.CreateOnDemand(c, start, len, mFormat);
+         channels[c]->RightmostOrNewClip()->AppendSharedBlock(pBlock);
+         blocks.push_back(std::move(pBlock));
+      }
+   }
+
+   OnDemandIngest::Get(*mProject).Add(blocks);
+}
+
 PCMImportFileHandle::~PCMImportFileHandle()
 {
 }
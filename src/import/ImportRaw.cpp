@@ -25,6 +25,7 @@ and sample size to help you importing data of an unknown format.
 #include "ImportRaw.h"
 
 #include "../FileFormats.h"
+#include "../MappedFile.h"
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
 #include "../UserException.h"
@@ -89,6 +90,136 @@ class ImportRawDialog final : public wxDialogWrapper {
    DECLARE_EVENT_TABLE()
 };
 
+namespace {
+
+// Bytes in a sample of the encodings that are read from the mapped file
+// directly, or 0 for those that libsndfile must decode
+size_t DirectSampleSize(int encoding)
+{
+   switch (encoding & SF_FORMAT_SUBMASK) {
+   case SF_FORMAT_PCM_S8:
+   case SF_FORMAT_PCM_U8:
+      return 1;
+   case SF_FORMAT_PCM_16:
+      return 2;
+   case SF_FORMAT_PCM_24:
+      return 3;
+   case SF_FORMAT_PCM_32:
+   case SF_FORMAT_FLOAT:
+      return 4;
+   case SF_FORMAT_DOUBLE:
+      return 8;
+   default:
+      return 0;
+   }
+}
+
+// As libsndfile takes the byte order of raw data
+bool IsBigEndian(int encoding)
+{
+   switch (encoding & SF_FORMAT_ENDMASK) {
+   case SF_ENDIAN_LITTLE:
+      return false;
+   case SF_ENDIAN_BIG:
+      return true;
+   default:
+      return wxBYTE_ORDER == wxBIG_ENDIAN;
+   }
+}
+
+template< size_t Size, bool Big >
+inline uint64_t LoadBits(const unsigned char *p)
+{
+   uint64_t bits = 0;
+   for (size_t ii = 0; ii < Size; ++ii)
+      bits = (bits << 8) | p[Big ? ii : Size - 1 - ii];
+   return bits;
+}
+
+// Convert samples of one channel, frameBytes apart, as libsndfile's
+// sf_readf_float or sf_readf_short would
+template< typename Sample, size_t Size, bool Big, typename Convert >
+void Deinterleave(const unsigned char *src, size_t frameBytes, size_t len,
+   Sample *dest, const Convert &convert)
+{
+   for (size_t jj = 0; jj < len; ++jj, src += frameBytes)
+      dest[jj] = convert(LoadBits<Size, Big>(src));
+}
+
+template< bool Big >
+void ReadChannel(const unsigned char *src, size_t frameBytes, size_t len,
+   int encoding, sampleFormat format, samplePtr dest)
+{
+   const auto shorts = reinterpret_cast<short *>(dest);
+   const auto floats = reinterpret_cast<float *>(dest);
+   // Only encodings of up to 16 bits are read into int16Sample
+   if (format == int16Sample) {
+      switch (encoding & SF_FORMAT_SUBMASK) {
+      case SF_FORMAT_PCM_S8:
+         Deinterleave<short, 1, Big>(src, frameBytes, len, shorts,
+            [](uint64_t bits){ return short(int8_t(bits) * 256); });
+         break;
+      case SF_FORMAT_PCM_U8:
+         Deinterleave<short, 1, Big>(src, frameBytes, len, shorts,
+            [](uint64_t bits){ return short((int(bits) - 128) * 256); });
+         break;
+      default:
+         Deinterleave<short, 2, Big>(src, frameBytes, len, shorts,
+            [](uint64_t bits){ return short(int16_t(bits)); });
+         break;
+      }
+      return;
+   }
+
+   switch (encoding & SF_FORMAT_SUBMASK) {
+   case SF_FORMAT_PCM_S8:
+      Deinterleave<float, 1, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){ return int8_t(bits) * (1.0f / 0x80); });
+      break;
+   case SF_FORMAT_PCM_U8:
+      Deinterleave<float, 1, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){ return (int(bits) - 128) * (1.0f / 0x80); });
+      break;
+   case SF_FORMAT_PCM_16:
+      Deinterleave<float, 2, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){ return int16_t(bits) * (1.0f / 0x8000); });
+      break;
+   case SF_FORMAT_PCM_24:
+      Deinterleave<float, 3, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){
+            return int32_t(uint32_t(bits) << 8) * (1.0f / 0x80000000); });
+      break;
+   case SF_FORMAT_PCM_32:
+      Deinterleave<float, 4, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){ return int32_t(bits) * (1.0f / 0x80000000); });
+      break;
+   case SF_FORMAT_FLOAT:
+      Deinterleave<float, 4, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){
+            const auto word = uint32_t(bits);
+            float value;
+            memcpy(&value, &word, sizeof(value));
+            return value; });
+      break;
+   case SF_FORMAT_DOUBLE:
+      Deinterleave<float, 8, Big>(src, frameBytes, len, floats,
+         [](uint64_t bits){
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return float(value); });
+      break;
+   default:
+      wxASSERT(false);
+      break;
+   }
+}
+
+// Amount of the start of a file that the classifier gets, if the file
+// can't be mapped; more than it reads
+const size_t ClassifierBytes = 1024 * 1024;
+
+}
+
 // This function leaves outTracks empty as an indication of error,
 // but may also throw FileException to make use of the application's
 // user visible error reporting.
@@ -108,12 +239,28 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       SF_INFO sndInfo;
       unsigned numChannels = 0;
 
+      // Guessing and most imports read the file mapped into memory
+      MappedFile mapped{ fileName };
+
       try {
-         // Yes, FormatClassifier currently handles filenames in UTF8 format only, that's
-         // a TODO ...
-         FormatClassifier theClassifier(fileName.utf8_str());
-         encoding = theClassifier.GetResultFormatLibSndfile();
-         numChannels = theClassifier.GetResultChannels();
+         if (mapped.IsOk()) {
+            FormatClassifier theClassifier(mapped.GetData(), mapped.GetSize());
+            encoding = theClassifier.GetResultFormatLibSndfile();
+            numChannels = theClassifier.GetResultChannels();
+         }
+         else {
+            // Guess from the start of the file
+            wxFile f;
+            ArrayOf<uint8_t> start{ ClassifierBytes };
+            ssize_t count = -1;
+            if (f.Open(fileName))
+               count = f.Read(start.get(), ClassifierBytes);
+            if (count > 0) {
+               FormatClassifier theClassifier(start.get(), count);
+               encoding = theClassifier.GetResultFormatLibSndfile();
+               numChannels = theClassifier.GetResultChannels();
+            }
+         }
          offset = 0;
       } catch (...) {
          // Something went wrong in FormatClassifier, use defaults instead.
@@ -145,9 +292,22 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       sndInfo.channels = (int)numChannels;
       sndInfo.format = encoding | SF_FORMAT_RAW;
 
+      // Read common encodings straight from the mapped file; libsndfile
+      // decodes the others
+      const auto sampleSize = DirectSampleSize(encoding);
+      const bool direct = mapped.IsOk() && sampleSize > 0 && offset >= 0;
+      const size_t frameBytes = sampleSize * numChannels;
+
       wxFile f;   // will be closed when it goes out of scope
       SFFile sndFile;
 
+      if (direct) {
+         const auto available = (size_t)offset < mapped.GetSize()
+            ? mapped.GetSize() - (size_t)offset : 0;
+         sndInfo.frames = available / frameBytes;
+         mapped.AdviseSequential();
+      }
+      else
       if (f.Open(fileName)) {
          // Even though there is an sf_open() that takes a filename, use the one that
          // takes a file descriptor since wxWidgets can open a file with a Unicode name and
@@ -155,7 +315,7 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
          sndFile.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &sndInfo, FALSE));
       }
 
-      if (!sndFile){
+      if (!direct && !sndFile){
          char str[1000];
          sf_error_str((SNDFILE *)NULL, str, 1000);
          wxPrintf("%s\n", str);
@@ -164,7 +324,7 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       }
 
 
-      {
+      if (!direct) {
          int result = sf_command(sndFile.get(), SFC_SET_RAW_START_OFFSET, &offset, sizeof(offset));
          if (result != 0) {
             char str[1000];
@@ -173,8 +333,8 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
 
             throw FileException{ FileException::Cause::Read, fileName };
          }
+         SFCall<sf_count_t>(sf_seek, sndFile.get(), 0, SEEK_SET);
       }
-      SFCall<sf_count_t>(sf_seek, sndFile.get(), 0, SEEK_SET);
 
       auto totalFrames =
          // fraction of a sf_count_t value
@@ -207,7 +367,8 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       const auto firstChannel = channels.begin()->get();
       auto maxBlockSize = firstChannel->GetMaxBlockSize();
 
-      SampleBuffer srcbuffer(maxBlockSize * numChannels, format);
+      // Not needed to read the mapped file
+      SampleBuffer srcbuffer(direct ? 0 : maxBlockSize * numChannels, format);
       SampleBuffer buffer(maxBlockSize, format);
 
       decltype(totalFrames) framescompleted = 0;
@@ -221,11 +382,40 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       /* i18n-hint: 'Raw' means 'unprocessed' here and should usually be tanslated.*/
       ProgressDialog progress(XO("Import Raw"), msg);
 
+      const bool big = IsBigEndian(encoding);
+
       size_t block;
       do {
          block =
             limitSampleBufferSize( maxBlockSize, totalFrames - framescompleted );
 
+         if (direct) {
+            // De-interleave each channel straight into the block for it
+            const auto frames = mapped.GetData() + offset +
+               framescompleted.as_size_t() * frameBytes;
+            auto iter = channels.begin();
+            for (decltype(numChannels) c = 0; c < numChannels; ++iter, ++c) {
+               const auto src = frames + c * sampleSize;
+               if (big)
+                  ReadChannel<true>(src, frameBytes, block,
+                     encoding, format, buffer.ptr());
+               else
+                  ReadChannel<false>(src, frameBytes, block,
+                     encoding, format, buffer.ptr());
+               iter->get()->Append(buffer.ptr(),
+                  (format == int16Sample) ? int16Sample : floatSample, block);
+            }
+            framescompleted += block;
+
+            updateResult = progress.Update(
+               framescompleted.as_long_long(),
+               totalFrames.as_long_long()
+            );
+            if (updateResult != ProgressResult::Success)
+               break;
+            continue;
+         }
+
          sf_count_t sf_result;
          if (format == int16Sample)
             sf_result = SFCall<sf_count_t>(sf_readf_short, sndFile.get(), (short *)srcbuffer.ptr(), block);
@@ -16,6 +16,7 @@ machine endianness representations.
 
 #include "MultiFormatReader.h"
 
+#include <algorithm>
 #include <exception>
 #include <stdexcept>
 #include <cstring>
@@ -37,31 +38,18 @@ MachineEndianness::MachineEndianness()
 }
 
 
-MultiFormatReader::MultiFormatReader(const char* filename)
-   : mpFid(NULL)
+MultiFormatReader::MultiFormatReader(const uint8_t* data, size_t size)
+   : mpData(data), mSize(size), mPos(0)
 {
-   mpFid = fopen(filename, "rb");
-      
-   if (mpFid == NULL)
-   {
-      throw std::runtime_error("Error opening file");
-   }
 }
 
 MultiFormatReader::~MultiFormatReader()
 {
-   if (mpFid != NULL)
-   {
-      fclose(mpFid);
-   }
 }
 
 void MultiFormatReader::Reset()
 {
-   if (mpFid != NULL)
-   {
-      rewind(mpFid);
-   }
+   mPos = 0;
 }
 
 size_t MultiFormatReader::ReadSamples(void* buffer, size_t len,
@@ -116,17 +104,19 @@ size_t MultiFormatReader::Read(void* buffer, size_t size, size_t len, size_t str
    {
       // There are gaps between consecutive samples,
       // so do a scattered read
-      for (size_t n = 0; n < len; n++)
+      for (size_t n = 0; n < len && mPos < mSize && mSize - mPos >= size; n++)
       {
-         actRead += fread(&(pWork[n*size]), size, 1, mpFid);
-         // FIXME: TRAP_ERR fseek return in MultiFormatReader unchecked.
-         fseek(mpFid, (stride - 1) * size, SEEK_CUR);
+         memcpy(&(pWork[n*size]), mpData + mPos, size);
+         actRead++;
+         mPos += stride * size;
       }
    }
    else
    {
       // Just do a linear read
-      actRead = fread(buffer, size, len, mpFid);
+      actRead = (mPos < mSize) ? std::min(len, (mSize - mPos) / size) : 0;
+      memcpy(buffer, mpData + mPos, actRead * size);
+      mPos += actRead * size;
    }
 
    return actRead;
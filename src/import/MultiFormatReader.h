@@ -11,7 +11,7 @@
 #ifndef __AUDACITY_MULTIFORMATREADER_H__
 #define __AUDACITY_MULTIFORMATREADER_H__
 
-#include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 
 class MachineEndianness
@@ -46,9 +46,13 @@ private:
     EndiannessT mFlag;
 };
 
+// Reads from data in memory, as from a mapped file, so that scattered
+// reads cost no seeks
 class MultiFormatReader
 {
-   FILE* mpFid;   
+   const uint8_t* mpData;
+   size_t mSize;
+   size_t mPos;
    MachineEndianness mEnd;
    uint8_t mSwapBuffer[8];
 
@@ -65,7 +69,7 @@ public:
       Double
    } FormatT;
    
-   MultiFormatReader(const char* filename);
+   MultiFormatReader(const uint8_t* data, size_t size);
    ~MultiFormatReader();
 
    void Reset();
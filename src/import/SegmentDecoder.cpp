@@ -0,0 +1,85 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SegmentDecoder.cpp
+
+**********************************************************************/
+
+#include "SegmentDecoder.h"
+
+#include <deque>
+#include <future>
+
+#include "../MemoryX.h"
+#include "../ThreadPool.h"
+#include "../WaveTrack.h"
+
+// About half a minute of audio to a segment: long enough that priming
+// costs little, short enough that the segments in flight take little memory
+static const double SegmentSeconds = 30.0;
+
+samplePtr DecodedSegment::Extend(size_t len)
+{
+   const auto frameBytes = channels * SAMPLE_SIZE(format);
+   samples.resize((length + len) * frameBytes);
+   auto result = samples.data() + length * frameBytes;
+   length += len;
+   return result;
+}
+
+void DecodedSegment::AppendTo(
+   const std::vector< std::shared_ptr<WaveTrack> > &tracks)
+{
+   wxASSERT(tracks.size() == channels);
+   if (length == 0)
+      return;
+   for (unsigned cc = 0; cc < channels; ++cc)
+      tracks[cc]->Append(samples.data() + cc * SAMPLE_SIZE(format),
+         format, length, channels);
+}
+
+size_t CountDecodeSegments(unsigned long long numSamples, double rate)
+{
+   if (ThreadPool::Get().Size() < 2 || rate <= 0)
+      return 0;
+   const auto nSegments =
+      static_cast<size_t>(numSamples / (rate * SegmentSeconds));
+   return nSegments < 2 ? 0 : nSegments;
+}
+
+bool DecodeSegments(size_t nSegments,
+   const std::function< DecodedSegment(size_t segment) > &decode,
+   const std::function< bool(DecodedSegment &segment) > &consume)
+{
+   auto &pool = ThreadPool::Get();
+   // Keep every worker busy while this thread appends
+   const size_t ahead = pool.Size() + 1;
+
+   std::deque< std::future<DecodedSegment> > pending;
+   // Workers use decode, so wait for them however this returns
+   auto cleanup = finally([&]{
+      for (auto &future : pending)
+         future.wait();
+   });
+
+   size_t next = 0;
+   const auto submit = [&]{
+      while (next < nSegments && pending.size() < ahead) {
+         const auto segment = next++;
+         pending.push_back(pool.Submit([&decode, segment]{
+            return decode(segment);
+         }));
+      }
+   };
+
+   submit();
+   while (!pending.empty()) {
+      auto result = pending.front().get();
+      pending.pop_front();
+      submit();
+      if (!consume(result))
+         return false;
+   }
+   return true;
+}
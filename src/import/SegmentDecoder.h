@@ -0,0 +1,65 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SegmentDecoder.h
+
+*******************************************************************//**
+
+\file SegmentDecoder.h
+\brief Decoding of a long compressed file in segments on the thread pool,
+for importers whose libraries can start decoding in mid-stream.
+
+  Each segment is decoded by its own decoder, which must prime itself
+  with whatever precedes the segment, so that the concatenated segments
+  equal a decoding of the whole file.  The segments come back to the
+  calling thread in order, to be appended to tracks there, because only
+  that thread writes the project database.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SEGMENT_DECODER__
+#define __AUDACITY_SEGMENT_DECODER__
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../SampleFormat.h"
+
+class WaveTrack;
+
+//! Samples decoded from one segment, the channels interleaved
+struct DecodedSegment
+{
+   sampleFormat format{ floatSample };
+   unsigned channels{ 0 };
+   size_t length{ 0 }; //!< samples per channel
+
+   std::vector<char> samples;
+
+   //! Set by the decoder if the library reported an error that makes the
+   //! import fail
+   bool error{ false };
+
+   //! Make room for len more samples per channel; returns where they go
+   samplePtr Extend(size_t len);
+
+   //! Append the channels of the segment to the tracks, one for each
+   void AppendTo(const std::vector< std::shared_ptr<WaveTrack> > &tracks);
+};
+
+//! Whether a file of this many samples per channel is worth decoding in
+//! segments, and if so, how many
+size_t CountDecodeSegments(unsigned long long numSamples, double rate);
+
+//! Decode segments on the thread pool, a few ahead, and consume each on
+//! this thread, in order.
+/*! decode may throw; the first exception is rethrown here, after the
+ workers stop.  consume returns false to stop early.
+ @return false if consume stopped */
+bool DecodeSegments(size_t nSegments,
+   const std::function< DecodedSegment(size_t segment) > &decode,
+   const std::function< bool(DecodedSegment &segment) > &consume);
+
+#endif
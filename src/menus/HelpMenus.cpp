@@ -11,6 +11,7 @@
 #include "../AudioIOBase.h"
 #include "../CommonCommandFlags.h"
 #include "../CrashReport.h"
+#include "../DBConnection.h"
 #include "../Dependencies.h"
 #include "../FileNames.h"
 #include "../HelpText.h"
@@ -347,6 +348,17 @@ void OnMidiDeviceInfo(const CommandContext &context)
 }
 #endif
 
+void OnStorageInfo(const CommandContext &context)
+{
+   auto &project = context.project;
+   auto &pConnection = ConnectionPtr::Get( project ).mpConnection;
+   if ( !pConnection )
+      return;
+   wxString info = pConnection->GetStatistics().Format();
+   ShowDiagnostics( project, info,
+      XO("Storage Info"), wxT("storageinfo.txt"), true );
+}
+
 void OnShowLog( const CommandContext &context )
 {
    auto logger = AudacityLogger::Get();
@@ -523,6 +535,9 @@ BaseItemSharedPtr HelpMenu()
                FN(OnMidiDeviceInfo),
                AudioIONotBusyFlag() ),
       #endif
+            Command( wxT("StorageInfo"), XXO("&Storage Info..."),
+               FN(OnStorageInfo),
+               AlwaysEnabledFlag ),
             Command( wxT("Log"), XXO("Show &Log..."), FN(OnShowLog),
                AlwaysEnabledFlag ),
       #if defined(EXPERIMENTAL_CRASH_REPORT)
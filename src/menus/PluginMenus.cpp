@@ -5,9 +5,11 @@
 #include "../BatchProcessDialog.h"
 #include "../Benchmark.h"
 #include "../CommonCommandFlags.h"
+#include "../FileNames.h"
 #include "../Menus.h"
 #include "../PluginManager.h"
 #include "../Prefs.h"
+#include "../Profiler.h"
 #include "../Project.h"
 #include "../ProjectSettings.h"
 #include "../ProjectWindow.h"
@@ -22,6 +24,7 @@
 #include "../effects/RealtimeEffectManager.h"
 #include "../prefs/EffectsPrefs.h"
 #include "../prefs/PrefsDialog.h"
+#include "../widgets/AudacityMessageBox.h"
 
 // private helper classes and functions
 namespace {
@@ -485,6 +488,39 @@ void OnBenchmark(const CommandContext &context)
    ::RunBenchmark( &window, project);
 }
 
+void OnTracePerformance(const CommandContext &context)
+{
+   auto &project = context.project;
+   auto &commandManager = CommandManager::Get( project );
+
+   if (!Tracer::IsEnabled()) {
+      Tracer::Start();
+      commandManager.Check(wxT("TracePerformance"), true);
+      return;
+   }
+
+   Tracer::Stop();
+   commandManager.Check(wxT("TracePerformance"), false);
+
+   auto fName = FileNames::SelectFile(FileNames::Operation::Export,
+      XO("Save Performance Trace as:"),
+      wxEmptyString,
+      wxT("trace.json"),
+      wxT("json"),
+      {
+         FileNames::FileType{ XO("Chrome trace files"), { wxT("json") }, true },
+         FileNames::AllFiles
+      },
+      wxFD_SAVE | wxRESIZE_BORDER,
+      &GetProjectFrame( project ));
+   if (fName.empty())
+      return;
+
+   if (!Tracer::WriteChromeTrace(fName))
+      AudacityMessageBox(
+         XO("Could not write the trace to \"%s\".").Format( fName ) );
+}
+
 void OnSimulateRecordingErrors(const CommandContext &context)
 {
    auto &project = context.project;
@@ -892,8 +928,14 @@ BaseItemSharedPtr ToolsMenu()
          // TODO: What should we do here?  Make benchmark a plug-in?
          // Easy enough to do.  We'd call it mod-self-test.
          Command( wxT("Benchmark"), XXO("&Run Benchmark..."),
-            FN(OnBenchmark), AudioIONotBusyFlag() )
+            FN(OnBenchmark), AudioIONotBusyFlag() ),
    //#endif
+
+         // Check it, use Audacity, then uncheck it to save the trace
+         Command( wxT("TracePerformance"), XXO("&Trace Performance"),
+            FN(OnTracePerformance), AlwaysEnabledFlag,
+            Options{}.CheckTest(
+               [](AudacityProject&){ return Tracer::IsEnabled(); } ) )
       ),
 
       Section( "Tools",
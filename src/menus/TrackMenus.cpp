@@ -727,7 +727,6 @@ void OnResample(const CommandContext &context)
    const auto &settings = ProjectSettings::Get( project );
    auto projectRate = settings.GetRate();
    auto &tracks = TrackList::Get( project );
-   auto &undoManager = UndoManager::Get( project );
    auto &window = ProjectWindow::Get( project );
 
    int newRate;
@@ -798,32 +797,25 @@ void OnResample(const CommandContext &context)
          &window);
    }
 
-   int ndx = 0;
-   auto flags = UndoPush::NONE;
+   std::vector<WaveTrack*> waveTracks;
    for (auto wt : tracks.Selected< WaveTrack >())
+      waveTracks.push_back(wt);
+
+   if (!waveTracks.empty())
    {
-      auto msg = XO("Resampling track %d").Format( ++ndx );
+      auto msg = XO("Resampling %d track(s)").Format( (int)waveTracks.size() );
 
       ProgressDialog progress(XO("Resample"), msg);
 
-      // The resampling of a track may be stopped by the user.  This might
-      // leave a track with multiple clips in a partially resampled state.
-      // But the thrown exception will cause rollback in the application
-      // level handler.
+      // The tracks are resampled together, several clips at once.  If the
+      // user stops it, or it fails, no track changes.
 
-       wt->Resample(newRate, &progress);
-
-      // Each time a track is successfully, completely resampled,
-      // commit that to the undo stack.  The second and later times,
-      // consolidate.
+      WaveTrack::Resample(waveTracks, newRate, &progress);
 
       ProjectHistory::Get( project ).PushState(
-         XO("Resampled audio track(s)"), XO("Resample Track"), flags);
-      flags = flags | UndoPush::CONSOLIDATE;
+         XO("Resampled audio track(s)"), XO("Resample Track"));
    }
 
-   undoManager.StopConsolidating();
-
    // Need to reset
    window.FinishAutoScroll();
 }
@@ -96,6 +96,17 @@ void ImportExportPrefs::PopulateOrExchange(ShuttleGui & S)
    S.SetBorder(2);
    S.StartScroller();
 
+   S.StartStatic(XO("When importing audio files"));
+   {
+      S.StartRadioButtonGroup(FileFormatsCopyOrEditSetting);
+      {
+         S.TieRadioButton();
+         S.TieRadioButton();
+      }
+      S.EndRadioButtonGroup();
+   }
+   S.EndStatic();
+
    S.StartStatic(XO("When exporting tracks to an audio file"));
    {
       S.StartRadioButtonGroup(ImportExportPrefs::ExportDownMixSetting);